@@ -743,10 +743,16 @@ static uint32_t kvm_dirty_ring_reap_one(KVMState *s, CPUState *cpu)
         count++;
     }
     cpu->kvm_fetch_index = fetch;
+    cpu->dirty_pages += count;
 
     return count;
 }
 
+bool kvm_dirty_ring_enabled(void)
+{
+    return kvm_state && kvm_state->kvm_dirty_ring_size;
+}
+
 /* Must be with slots_lock held */
 static uint64_t kvm_dirty_ring_reap_locked(KVMState *s)
 {
@@ -1950,10 +1956,11 @@ int kvm_irqchip_send_msi(KVMState *s, MSIMessage msg)
     return kvm_set_irq(s, route->kroute.gsi, 1);
 }
 
-int kvm_irqchip_add_msi_route(KVMState *s, int vector, PCIDevice *dev)
+int kvm_irqchip_add_msi_route(KVMRouteChange *c, int vector, PCIDevice *dev)
 {
     struct kvm_irq_routing_entry kroute = {};
     int virq;
+    KVMState *s = c->s;
     MSIMessage msg = {0, 0};
 
     if (pci_available && dev) {
@@ -1993,7 +2000,7 @@ int kvm_irqchip_add_msi_route(KVMState *s, int vector, PCIDevice *dev)
 
     kvm_add_routing_entry(s, &kroute);
     kvm_arch_add_msi_route_post(&kroute, vector, dev);
-    kvm_irqchip_commit_routes(s);
+    c->changes++;
 
     return virq;
 }
@@ -2151,7 +2158,7 @@ int kvm_irqchip_send_msi(KVMState *s, MSIMessage msg)
     abort();
 }
 
-int kvm_irqchip_add_msi_route(KVMState *s, int vector, PCIDevice *dev)
+int kvm_irqchip_add_msi_route(KVMRouteChange *c, int vector, PCIDevice *dev)
 {
     return -ENOSYS;
 }
@@ -2674,6 +2681,8 @@ void kvm_flush_coalesced_mmio_buffer(void)
 
     if (s->coalesced_mmio_ring) {
         struct kvm_coalesced_mmio_ring *ring = s->coalesced_mmio_ring;
+        uint8_t buf[4096];
+
         while (ring->first != ring->last) {
             struct kvm_coalesced_mmio *ent;
 
@@ -2683,11 +2692,35 @@ void kvm_flush_coalesced_mmio_buffer(void)
                 address_space_write(&address_space_io, ent->phys_addr,
                                     MEMTXATTRS_UNSPECIFIED, ent->data,
                                     ent->len);
+                smp_wmb();
+                ring->first = (ring->first + 1) % KVM_COALESCED_MMIO_MAX;
             } else {
-                cpu_physical_memory_write(ent->phys_addr, ent->data, ent->len);
+                /*
+                 * Coalesced MMIO is dominated by sequential framebuffer
+                 * style writes; merge adjacent entries into a single
+                 * transaction instead of dispatching every ring entry
+                 * separately.  Slots are released back to the kernel as
+                 * soon as their data has been copied out.
+                 */
+                hwaddr start = ent->phys_addr;
+                hwaddr next = start;
+                size_t size = 0;
+
+                do {
+                    memcpy(buf + size, ent->data, ent->len);
+                    size += ent->len;
+                    next += ent->len;
+                    smp_wmb();
+                    ring->first = (ring->first + 1) % KVM_COALESCED_MMIO_MAX;
+                    if (ring->first == ring->last) {
+                        break;
+                    }
+                    ent = &ring->coalesced_mmio[ring->first];
+                } while (ent->pio == 0 && ent->phys_addr == next &&
+                         size + ent->len <= sizeof(buf));
+
+                cpu_physical_memory_write(start, buf, size);
             }
-            smp_wmb();
-            ring->first = (ring->first + 1) % KVM_COALESCED_MMIO_MAX;
         }
     }
 
@@ -149,6 +149,10 @@ uint32_t curr_cflags(CPUState *cpu)
 {
     uint32_t cflags = cpu->tcg_cflags;
 
+    if (qemu_plugin_sample_tb(cpu)) {
+        cflags |= CF_PLUGIN;
+    }
+
     /*
      * Record gdb single-step.  We should be exiting the TB by raising
      * EXCP_DEBUG, but to simplify other tests, disable chaining too.
@@ -167,6 +171,23 @@ uint32_t curr_cflags(CPUState *cpu)
     return cflags;
 }
 
+/*
+ * Insert @tb as the most recently used entry of its jump cache set,
+ * demoting the previous entries by one way instead of discarding them.
+ * @hash is the index of way 0 of the set.
+ */
+static inline void tb_jmp_cache_insert(CPUState *cpu, uint32_t hash,
+                                       TranslationBlock *tb)
+{
+    unsigned int way;
+
+    for (way = TB_JMP_CACHE_WAYS - 1; way > 0; way--) {
+        qatomic_set(&cpu->tb_jmp_cache[hash + way],
+                    qatomic_read(&cpu->tb_jmp_cache[hash + way - 1]));
+    }
+    qatomic_set(&cpu->tb_jmp_cache[hash], tb);
+}
+
 /* Might cause an exception, so have a longjmp destination ready */
 static inline TranslationBlock *tb_lookup(CPUState *cpu, target_ulong pc,
                                           target_ulong cs_base,
@@ -174,26 +195,40 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, target_ulong pc,
 {
     TranslationBlock *tb;
     uint32_t hash;
+    unsigned int way;
 
     /* we should never be trying to look up an INVALID tb */
     tcg_debug_assert(!(cflags & CF_INVALID));
 
-    hash = tb_jmp_cache_hash_func(pc);
-    tb = qatomic_rcu_read(&cpu->tb_jmp_cache[hash]);
-
-    if (likely(tb &&
-               tb->pc == pc &&
-               tb->cs_base == cs_base &&
-               tb->flags == flags &&
-               tb->trace_vcpu_dstate == *cpu->trace_dstate &&
-               tb_cflags(tb) == cflags)) {
-        return tb;
+    hash = tb_jmp_cache_hash_func(pc) * TB_JMP_CACHE_WAYS;
+    for (way = 0; way < TB_JMP_CACHE_WAYS; way++) {
+        tb = qatomic_rcu_read(&cpu->tb_jmp_cache[hash + way]);
+
+        if (likely(tb &&
+                   tb->pc == pc &&
+                   tb->cs_base == cs_base &&
+                   tb->flags == flags &&
+                   tb->trace_vcpu_dstate == *cpu->trace_dstate &&
+                   tb_cflags(tb) == cflags)) {
+            if (way != 0) {
+                /*
+                 * Promote to MRU, so that two dispatch targets that
+                 * alternate keep hitting instead of evicting each other.
+                 * The swap is racy versus other updaters, but at worst
+                 * an entry is duplicated or lost from the cache.
+                 */
+                qatomic_set(&cpu->tb_jmp_cache[hash + way],
+                            qatomic_read(&cpu->tb_jmp_cache[hash]));
+                qatomic_set(&cpu->tb_jmp_cache[hash], tb);
+            }
+            return tb;
+        }
     }
     tb = tb_htable_lookup(cpu, pc, cs_base, flags, cflags);
     if (tb == NULL) {
         return NULL;
     }
-    qatomic_set(&cpu->tb_jmp_cache[hash], tb);
+    tb_jmp_cache_insert(cpu, hash, tb);
     return tb;
 }
 
@@ -545,6 +580,50 @@ void tb_set_jmp_target(TranslationBlock *tb, int n, uintptr_t addr)
     }
 }
 
+/*
+ * Superblock candidates: once goto_tb linking stitches a run of TBs
+ * together, walk the new chain to see whether a hot trace has formed.
+ * The generic translator cannot re-enter target code at an arbitrary pc
+ * to merge the chain into a single op stream, so formation is recorded
+ * for "info jit" and tracing; the accounting here is what a future
+ * retranslation pass would consume to pick its traces.
+ */
+#define TB_CHAIN_TRACE_MIN  4
+#define TB_CHAIN_TRACE_MAX  16
+
+static void tb_chain_formed(TranslationBlock *tb, TranslationBlock *tb_next)
+{
+    const TranslationBlock *t = tb_next;
+    unsigned len = 1;
+    bool is_loop = false;
+
+    while (len < TB_CHAIN_TRACE_MAX) {
+        uintptr_t d0 = qatomic_read(&t->jmp_dest[0]);
+        uintptr_t d1 = qatomic_read(&t->jmp_dest[1]);
+
+        /*
+         * Follow only unambiguous links: exactly one live successor,
+         * and neither slot marked for invalidation (LSB set).
+         */
+        if ((d0 | d1) & 1 || !d0 == !d1) {
+            break;
+        }
+        t = (TranslationBlock *)(d0 ? d0 : d1);
+        len++;
+        if (t == tb) {
+            is_loop = true;
+            break;
+        }
+    }
+    if (len >= TB_CHAIN_TRACE_MIN || is_loop) {
+        qatomic_inc(&tb_ctx.hot_chain_count);
+        if (len > qatomic_read(&tb_ctx.longest_chain)) {
+            qatomic_set(&tb_ctx.longest_chain, len);
+        }
+        trace_exec_tb_chain(tb, tb->pc, len, is_loop);
+    }
+}
+
 static inline void tb_add_jump(TranslationBlock *tb, int n,
                                TranslationBlock *tb_next)
 {
@@ -579,6 +658,7 @@ static inline void tb_add_jump(TranslationBlock *tb, int n,
                            "] index %d -> %p [" TARGET_FMT_lx "]\n",
                            tb->tc.ptr, tb->pc, n,
                            tb_next->tc.ptr, tb_next->pc);
+    tb_chain_formed(tb, tb_next);
     return;
 
  out_unlock_next:
@@ -948,7 +1028,8 @@ int cpu_exec(CPUState *cpu)
                  * We add the TB in the virtual pc hash table
                  * for the fast lookup
                  */
-                qatomic_set(&cpu->tb_jmp_cache[tb_jmp_cache_hash_func(pc)], tb);
+                tb_jmp_cache_insert(cpu, tb_jmp_cache_hash_func(pc)
+                                    * TB_JMP_CACHE_WAYS, tb);
             }
 
 #ifndef CONFIG_USER_ONLY
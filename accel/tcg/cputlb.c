@@ -100,9 +100,9 @@ static void tlb_window_reset(CPUTLBDesc *desc, int64_t ns,
 
 static void tb_jmp_cache_clear_page(CPUState *cpu, target_ulong page_addr)
 {
-    unsigned int i, i0 = tb_jmp_cache_hash_page(page_addr);
+    unsigned int i, i0 = tb_jmp_cache_hash_page(page_addr) * TB_JMP_CACHE_WAYS;
 
-    for (i = 0; i < TB_JMP_PAGE_SIZE; i++) {
+    for (i = 0; i < TB_JMP_PAGE_SIZE * TB_JMP_CACHE_WAYS; i++) {
         qatomic_set(&cpu->tb_jmp_cache[i0 + i], NULL);
     }
 }
@@ -155,6 +155,44 @@ static void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr)
  * high), since otherwise we are likely to have a significant amount of
  * conflict misses.
  */
+static inline size_t tlb_vtlb_set(const CPUTLBDesc *desc, target_ulong page)
+{
+    return (page >> TARGET_PAGE_BITS) & (desc->n_vsets - 1);
+}
+
+/* Return the page that a (non-empty) victim tlb entry translates.  */
+static target_ulong tlb_entry_page(const CPUTLBEntry *te)
+{
+    if (te->addr_read != -1) {
+        return te->addr_read & TARGET_PAGE_MASK;
+    }
+    if (te->addr_write != -1) {
+        return te->addr_write & TARGET_PAGE_MASK;
+    }
+    return te->addr_code & TARGET_PAGE_MASK;
+}
+
+/*
+ * Scale the victim tlb with the fast table: one set per 64 fast entries,
+ * capped so that even the largest fast table keeps the victim tlb cheap
+ * to scan on a full flush.  Conflict misses in the direct-mapped fast
+ * table then land in a set sized to absorb randomized access patterns
+ * instead of falling straight through to tlb_fill.
+ */
+static void tlb_vtlb_resize_locked(CPUTLBDesc *desc, size_t new_fast_size)
+{
+    size_t n_vsets = MIN(MAX(new_fast_size >> 6, 1), 64);
+
+    if (n_vsets == desc->n_vsets) {
+        return;
+    }
+    g_free(desc->vtable);
+    g_free(desc->viotlb);
+    desc->n_vsets = n_vsets;
+    desc->vtable = g_new(CPUTLBEntry, n_vsets * CPU_VTLB_WAYS);
+    desc->viotlb = g_new(CPUIOTLBEntry, n_vsets * CPU_VTLB_WAYS);
+}
+
 static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
                                   int64_t now)
 {
@@ -228,6 +266,7 @@ static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
         fast->table = g_try_new(CPUTLBEntry, new_size);
         desc->iotlb = g_try_new(CPUIOTLBEntry, new_size);
     }
+    tlb_vtlb_resize_locked(desc, new_size);
 }
 
 static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
@@ -237,7 +276,8 @@ static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
     desc->large_page_mask = -1;
     desc->vindex = 0;
     memset(fast->table, -1, sizeof_tlb(fast));
-    memset(desc->vtable, -1, sizeof(desc->vtable));
+    memset(desc->vtable, -1,
+           desc->n_vsets * CPU_VTLB_WAYS * sizeof(CPUTLBEntry));
 }
 
 static void tlb_flush_one_mmuidx_locked(CPUArchState *env, int mmu_idx,
@@ -259,6 +299,10 @@ static void tlb_mmu_init(CPUTLBDesc *desc, CPUTLBDescFast *fast, int64_t now)
     fast->mask = (n_entries - 1) << CPU_TLB_ENTRY_BITS;
     fast->table = g_new(CPUTLBEntry, n_entries);
     desc->iotlb = g_new(CPUIOTLBEntry, n_entries);
+    desc->n_vsets = 0;
+    desc->vtable = NULL;
+    desc->viotlb = NULL;
+    tlb_vtlb_resize_locked(desc, n_entries);
     tlb_mmu_flush_locked(desc, fast);
 }
 
@@ -272,6 +316,103 @@ static inline void tlb_n_used_entries_dec(CPUArchState *env, uintptr_t mmu_idx)
     env_tlb(env)->d[mmu_idx].n_used_entries--;
 }
 
+/*
+ * Coalesce cross-vCPU page flush shootdowns.  Guests that invalidate
+ * many pages back to back (mmap/munmap heavy workloads) otherwise queue
+ * one piece of work per page per destination vCPU, and draining those
+ * queues serializes all vCPUs.  Pending pages are merged into a single
+ * sorted batch per destination, applied in one pass when the vCPU next
+ * drains its work queue.  Once a batch overflows we degrade to a full
+ * flush of the affected mmu_idx set, which beats that many single-page
+ * flushes anyway.  Applying a flush earlier than its own work item
+ * would have run is safe: flushing only removes entries, and refills
+ * always read the current page tables.
+ */
+#define TLB_FLUSH_BATCH_MAX 64
+
+struct CPUTLBFlushBatch {
+    QemuSpin lock;
+    bool scheduled;
+    unsigned len;
+    uint16_t full_idxmap;
+    target_ulong addr[TLB_FLUSH_BATCH_MAX];
+    uint16_t idxmap[TLB_FLUSH_BATCH_MAX];
+};
+
+/*
+ * Guest page table walks issue a handful of serial, dependent loads of
+ * directory entries through the full memory API on every tlb_fill.
+ * Cache the host mapping of recently touched page table pages so the
+ * walk does cached loads instead of repeated flatview translations.
+ * Only the physical-page-to-host mapping is cached, never the entries
+ * themselves, so guest writes to its page tables need no extra
+ * invalidation; the cache is dropped on TLB flushes, which covers
+ * memory topology changes via tcg_commit().
+ */
+#define PTW_CACHE_SIZE 8
+
+struct CPUPTWCache {
+    hwaddr page[PTW_CACHE_SIZE];
+    uint8_t *host[PTW_CACHE_SIZE];
+};
+
+static void tlb_ptw_cache_clear(CPUPTWCache *ptw)
+{
+    int i;
+
+    for (i = 0; i < PTW_CACHE_SIZE; i++) {
+        ptw->page[i] = -1;
+        ptw->host[i] = NULL;
+    }
+}
+
+static void *tlb_ptw_translate(CPUState *cpu, hwaddr addr)
+{
+    CPUArchState *env = cpu->env_ptr;
+    CPUPTWCache *ptw = env_tlb(env)->c.ptw;
+    hwaddr page = addr & TARGET_PAGE_MASK;
+    size_t idx = (page >> TARGET_PAGE_BITS) & (PTW_CACHE_SIZE - 1);
+    hwaddr xlat, len = TARGET_PAGE_SIZE;
+    MemoryRegion *mr;
+    uint8_t *host;
+
+    if (likely(ptw->page[idx] == page)) {
+        return ptw->host[idx] + (addr & ~TARGET_PAGE_MASK);
+    }
+
+    RCU_READ_LOCK_GUARD();
+    mr = address_space_translate(cpu->as, page, &xlat, &len, false,
+                                 MEMTXATTRS_UNSPECIFIED);
+    if (!memory_region_is_ram(mr) || memory_region_is_romd(mr) ||
+        len < TARGET_PAGE_SIZE) {
+        return NULL;
+    }
+    host = memory_region_get_ram_ptr(mr) + xlat;
+    ptw->page[idx] = page;
+    ptw->host[idx] = host;
+    return host + (addr & ~TARGET_PAGE_MASK);
+}
+
+uint64_t cpu_ldq_ptw(CPUState *cpu, hwaddr addr)
+{
+    void *p = tlb_ptw_translate(cpu, addr);
+
+    if (likely(p)) {
+        return ldq_p(p);
+    }
+    return address_space_ldq(cpu->as, addr, MEMTXATTRS_UNSPECIFIED, NULL);
+}
+
+uint32_t cpu_ldl_ptw(CPUState *cpu, hwaddr addr)
+{
+    void *p = tlb_ptw_translate(cpu, addr);
+
+    if (likely(p)) {
+        return ldl_p(p);
+    }
+    return address_space_ldl(cpu->as, addr, MEMTXATTRS_UNSPECIFIED, NULL);
+}
+
 void tlb_init(CPUState *cpu)
 {
     CPUArchState *env = cpu->env_ptr;
@@ -280,6 +421,12 @@ void tlb_init(CPUState *cpu)
 
     qemu_spin_init(&env_tlb(env)->c.lock);
 
+    env_tlb(env)->c.batch = g_new0(CPUTLBFlushBatch, 1);
+    qemu_spin_init(&env_tlb(env)->c.batch->lock);
+
+    env_tlb(env)->c.ptw = g_new(CPUPTWCache, 1);
+    tlb_ptw_cache_clear(env_tlb(env)->c.ptw);
+
     /* All tlbs are initialized flushed. */
     env_tlb(env)->c.dirty = 0;
 
@@ -294,12 +441,17 @@ void tlb_destroy(CPUState *cpu)
     int i;
 
     qemu_spin_destroy(&env_tlb(env)->c.lock);
+    qemu_spin_destroy(&env_tlb(env)->c.batch->lock);
+    g_free(env_tlb(env)->c.batch);
+    g_free(env_tlb(env)->c.ptw);
     for (i = 0; i < NB_MMU_MODES; i++) {
         CPUTLBDesc *desc = &env_tlb(env)->d[i];
         CPUTLBDescFast *fast = &env_tlb(env)->f[i];
 
         g_free(fast->table);
         g_free(desc->iotlb);
+        g_free(desc->vtable);
+        g_free(desc->viotlb);
     }
 }
 
@@ -364,6 +516,7 @@ static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
 
     qemu_spin_unlock(&env_tlb(env)->c.lock);
 
+    tlb_ptw_cache_clear(env_tlb(env)->c.ptw);
     cpu_tb_jmp_cache_clear(cpu);
 
     if (to_clean == ALL_MMUIDX_BITS) {
@@ -477,10 +630,17 @@ static void tlb_flush_vtlb_page_mask_locked(CPUArchState *env, int mmu_idx,
                                             target_ulong mask)
 {
     CPUTLBDesc *d = &env_tlb(env)->d[mmu_idx];
-    int k;
+    target_ulong set_mask = (d->n_vsets - 1) << TARGET_PAGE_BITS;
+    size_t first = 0, len = d->n_vsets * CPU_VTLB_WAYS;
+    size_t k;
 
     assert_cpu_is_self(env_cpu(env));
-    for (k = 0; k < CPU_VTLB_SIZE; k++) {
+    if ((mask & set_mask) == set_mask) {
+        /* All set index bits are significant: only one set can match.  */
+        first = tlb_vtlb_set(d, page) * CPU_VTLB_WAYS;
+        len = CPU_VTLB_WAYS;
+    }
+    for (k = first; k < first + len; k++) {
         if (tlb_flush_entry_mask_locked(&d->vtable[k], page, mask)) {
             tlb_n_used_entries_dec(env, mmu_idx);
         }
@@ -569,6 +729,73 @@ typedef struct {
     uint16_t idxmap;
 } TLBFlushPageByMMUIdxData;
 
+static void tlb_flush_page_batch_async(CPUState *cpu, run_on_cpu_data data)
+{
+    CPUArchState *env = cpu->env_ptr;
+    CPUTLBFlushBatch *batch = env_tlb(env)->c.batch;
+    target_ulong addrs[TLB_FLUSH_BATCH_MAX];
+    uint16_t idxmaps[TLB_FLUSH_BATCH_MAX];
+    uint16_t full;
+    unsigned len, i;
+
+    qemu_spin_lock(&batch->lock);
+    len = batch->len;
+    full = batch->full_idxmap;
+    memcpy(addrs, batch->addr, len * sizeof(addrs[0]));
+    memcpy(idxmaps, batch->idxmap, len * sizeof(idxmaps[0]));
+    batch->len = 0;
+    batch->full_idxmap = 0;
+    batch->scheduled = false;
+    qemu_spin_unlock(&batch->lock);
+
+    if (full) {
+        tlb_flush_by_mmuidx_async_work(cpu, RUN_ON_CPU_HOST_INT(full));
+    }
+    for (i = 0; i < len; i++) {
+        uint16_t map = idxmaps[i] & ~full;
+
+        if (map) {
+            tlb_flush_page_by_mmuidx_async_0(cpu, addrs[i], map);
+        }
+    }
+}
+
+static void tlb_flush_page_batch_queue(CPUState *dst_cpu, target_ulong addr,
+                                       uint16_t idxmap)
+{
+    CPUArchState *env = dst_cpu->env_ptr;
+    CPUTLBFlushBatch *batch = env_tlb(env)->c.batch;
+    bool need_kick;
+    unsigned i;
+
+    qemu_spin_lock(&batch->lock);
+    /* Insert sorted by address, merging flushes of the same page.  */
+    for (i = 0; i < batch->len && batch->addr[i] < addr; i++) {
+        continue;
+    }
+    if (i < batch->len && batch->addr[i] == addr) {
+        batch->idxmap[i] |= idxmap;
+    } else if (batch->len < TLB_FLUSH_BATCH_MAX) {
+        memmove(&batch->addr[i + 1], &batch->addr[i],
+                (batch->len - i) * sizeof(batch->addr[0]));
+        memmove(&batch->idxmap[i + 1], &batch->idxmap[i],
+                (batch->len - i) * sizeof(batch->idxmap[0]));
+        batch->addr[i] = addr;
+        batch->idxmap[i] = idxmap;
+        batch->len++;
+    } else {
+        batch->full_idxmap |= idxmap;
+    }
+    need_kick = !batch->scheduled;
+    batch->scheduled = true;
+    qemu_spin_unlock(&batch->lock);
+
+    if (need_kick) {
+        async_run_on_cpu(dst_cpu, tlb_flush_page_batch_async,
+                         RUN_ON_CPU_NULL);
+    }
+}
+
 /**
  * tlb_flush_page_by_mmuidx_async_2:
  * @cpu: cpu on which to flush
@@ -624,32 +851,16 @@ void tlb_flush_page(CPUState *cpu, target_ulong addr)
 void tlb_flush_page_by_mmuidx_all_cpus(CPUState *src_cpu, target_ulong addr,
                                        uint16_t idxmap)
 {
+    CPUState *dst_cpu;
+
     tlb_debug("addr: "TARGET_FMT_lx" mmu_idx:%"PRIx16"\n", addr, idxmap);
 
     /* This should already be page aligned */
     addr &= TARGET_PAGE_MASK;
 
-    /*
-     * Allocate memory to hold addr+idxmap only when needed.
-     * See tlb_flush_page_by_mmuidx for details.
-     */
-    if (idxmap < TARGET_PAGE_SIZE) {
-        flush_all_helper(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                         RUN_ON_CPU_TARGET_PTR(addr | idxmap));
-    } else {
-        CPUState *dst_cpu;
-
-        /* Allocate a separate data block for each destination cpu.  */
-        CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
-                TLBFlushPageByMMUIdxData *d
-                    = g_new(TLBFlushPageByMMUIdxData, 1);
-
-                d->addr = addr;
-                d->idxmap = idxmap;
-                async_run_on_cpu(dst_cpu, tlb_flush_page_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(d));
-            }
+    CPU_FOREACH(dst_cpu) {
+        if (dst_cpu != src_cpu) {
+            tlb_flush_page_batch_queue(dst_cpu, addr, idxmap);
         }
     }
 
@@ -665,36 +876,29 @@ void tlb_flush_page_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
                                               target_ulong addr,
                                               uint16_t idxmap)
 {
+    CPUState *dst_cpu;
+
     tlb_debug("addr: "TARGET_FMT_lx" mmu_idx:%"PRIx16"\n", addr, idxmap);
 
     /* This should already be page aligned */
     addr &= TARGET_PAGE_MASK;
 
+    CPU_FOREACH(dst_cpu) {
+        if (dst_cpu != src_cpu) {
+            tlb_flush_page_batch_queue(dst_cpu, addr, idxmap);
+        }
+    }
+
     /*
      * Allocate memory to hold addr+idxmap only when needed.
      * See tlb_flush_page_by_mmuidx for details.
      */
     if (idxmap < TARGET_PAGE_SIZE) {
-        flush_all_helper(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                         RUN_ON_CPU_TARGET_PTR(addr | idxmap));
         async_safe_run_on_cpu(src_cpu, tlb_flush_page_by_mmuidx_async_1,
                               RUN_ON_CPU_TARGET_PTR(addr | idxmap));
     } else {
-        CPUState *dst_cpu;
-        TLBFlushPageByMMUIdxData *d;
-
-        /* Allocate a separate data block for each destination cpu.  */
-        CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
-                d = g_new(TLBFlushPageByMMUIdxData, 1);
-                d->addr = addr;
-                d->idxmap = idxmap;
-                async_run_on_cpu(dst_cpu, tlb_flush_page_by_mmuidx_async_2,
-                                 RUN_ON_CPU_HOST_PTR(d));
-            }
-        }
+        TLBFlushPageByMMUIdxData *d = g_new(TLBFlushPageByMMUIdxData, 1);
 
-        d = g_new(TLBFlushPageByMMUIdxData, 1);
         d->addr = addr;
         d->idxmap = idxmap;
         async_safe_run_on_cpu(src_cpu, tlb_flush_page_by_mmuidx_async_2,
@@ -1021,7 +1225,8 @@ void tlb_reset_dirty(CPUState *cpu, ram_addr_t start1, ram_addr_t length)
                                          start1, length);
         }
 
-        for (i = 0; i < CPU_VTLB_SIZE; i++) {
+        n = env_tlb(env)->d[mmu_idx].n_vsets * CPU_VTLB_WAYS;
+        for (i = 0; i < n; i++) {
             tlb_reset_dirty_range_locked(&env_tlb(env)->d[mmu_idx].vtable[i],
                                          start1, length);
         }
@@ -1054,9 +1259,12 @@ void tlb_set_dirty(CPUState *cpu, target_ulong vaddr)
     }
 
     for (mmu_idx = 0; mmu_idx < NB_MMU_MODES; mmu_idx++) {
-        int k;
-        for (k = 0; k < CPU_VTLB_SIZE; k++) {
-            tlb_set_dirty1_locked(&env_tlb(env)->d[mmu_idx].vtable[k], vaddr);
+        CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
+        size_t first = tlb_vtlb_set(desc, vaddr) * CPU_VTLB_WAYS;
+        size_t k;
+
+        for (k = first; k < first + CPU_VTLB_WAYS; k++) {
+            tlb_set_dirty1_locked(&desc->vtable[k], vaddr);
         }
     }
     qemu_spin_unlock(&env_tlb(env)->c.lock);
@@ -1205,7 +1413,8 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
      * different page; otherwise just overwrite the stale data.
      */
     if (!tlb_hit_page_anyprot(te, vaddr_page) && !tlb_entry_is_empty(te)) {
-        unsigned vidx = desc->vindex++ % CPU_VTLB_SIZE;
+        unsigned vidx = tlb_vtlb_set(desc, tlb_entry_page(te)) * CPU_VTLB_WAYS
+                        + desc->vindex++ % CPU_VTLB_WAYS;
         CPUTLBEntry *tv = &desc->vtable[vidx];
 
         /* Evict the old entry into the victim tlb.  */
@@ -1447,11 +1656,13 @@ static inline target_ulong tlb_read_ofs(CPUTLBEntry *entry, size_t ofs)
 static bool victim_tlb_hit(CPUArchState *env, size_t mmu_idx, size_t index,
                            size_t elt_ofs, target_ulong page)
 {
+    CPUTLBDesc *desc = &env_tlb(env)->d[mmu_idx];
+    size_t first = tlb_vtlb_set(desc, page) * CPU_VTLB_WAYS;
     size_t vidx;
 
     assert_cpu_is_self(env_cpu(env));
-    for (vidx = 0; vidx < CPU_VTLB_SIZE; ++vidx) {
-        CPUTLBEntry *vtlb = &env_tlb(env)->d[mmu_idx].vtable[vidx];
+    for (vidx = first; vidx < first + CPU_VTLB_WAYS; ++vidx) {
+        CPUTLBEntry *vtlb = &desc->vtable[vidx];
         target_ulong cmp;
 
         /* elt_ofs might correspond to .addr_write, so use qatomic_read */
@@ -18,5 +18,6 @@ TranslationBlock *tb_gen_code(CPUState *cpu, target_ulong pc,
 void QEMU_NORETURN cpu_io_recompile(CPUState *cpu, uintptr_t retaddr);
 void page_init(void);
 void tb_htable_init(void);
+void tb_precache_init(const char *path);
 
 #endif /* ACCEL_TCG_INTERNAL_H */
@@ -35,6 +35,8 @@ struct TBContext {
     /* statistics */
     unsigned tb_flush_count;
     unsigned tb_phys_invalidate_count;
+    unsigned hot_chain_count;
+    unsigned longest_chain;
 };
 
 extern TBContext tb_ctx;
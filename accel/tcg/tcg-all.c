@@ -44,6 +44,7 @@ struct TCGState {
     bool mttcg_enabled;
     int splitwx_enabled;
     unsigned long tb_size;
+    char *tb_precache;
 };
 typedef struct TCGState TCGState;
 
@@ -134,6 +135,10 @@ static int tcg_init_machine(MachineState *ms)
     tcg_prologue_init(tcg_ctx);
 #endif
 
+    if (s->tb_precache) {
+        tb_precache_init(s->tb_precache);
+    }
+
     return 0;
 }
 
@@ -196,6 +201,21 @@ static void tcg_set_tb_size(Object *obj, Visitor *v,
     s->tb_size = value;
 }
 
+static char *tcg_get_tb_precache(Object *obj, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+
+    return g_strdup(s->tb_precache);
+}
+
+static void tcg_set_tb_precache(Object *obj, const char *value, Error **errp)
+{
+    TCGState *s = TCG_STATE(obj);
+
+    g_free(s->tb_precache);
+    s->tb_precache = g_strdup(value);
+}
+
 static bool tcg_get_splitwx(Object *obj, Error **errp)
 {
     TCGState *s = TCG_STATE(obj);
@@ -225,6 +245,11 @@ static void tcg_accel_class_init(ObjectClass *oc, void *data)
     object_class_property_set_description(oc, "tb-size",
         "TCG translation block cache size");
 
+    object_class_property_add_str(oc, "tb-precache",
+        tcg_get_tb_precache, tcg_set_tb_precache);
+    object_class_property_set_description(oc, "tb-precache",
+        "Path to the persistent translation block descriptor cache");
+
     object_class_property_add_bool(oc, "split-wx",
         tcg_get_splitwx, tcg_set_splitwx);
     object_class_property_set_description(oc, "split-wx",
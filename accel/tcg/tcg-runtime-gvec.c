@@ -36,13 +36,49 @@ static inline void clear_high(void *d, intptr_t oprsz, uint32_t desc)
     }
 }
 
+/*
+ * Process a 64-bit word of lanes at a time: compute in 64-bit arithmetic
+ * and cancel the carries that would cross lane boundaries ("SWAR").
+ * This widens the per-iteration work of the out-of-line helpers
+ * regardless of what the compiler manages to auto-vectorize.
+ */
+#define SWAR_MSB_8  0x8080808080808080ull
+#define SWAR_MSB_16 0x8000800080008000ull
+#define SWAR_MSB_32 0x8000000080000000ull
+
+static inline uint64_t swar_add(uint64_t a, uint64_t b, uint64_t msb)
+{
+    return ((a & ~msb) + (b & ~msb)) ^ ((a ^ b) & msb);
+}
+
+static inline uint64_t swar_sub(uint64_t a, uint64_t b, uint64_t msb)
+{
+    return ((a | msb) - (b & ~msb)) ^ ((a ^ ~b) & msb);
+}
+
+static inline uint64_t swar_dup8(uint64_t b)
+{
+    return (uint8_t)b * 0x0101010101010101ull;
+}
+
+static inline uint64_t swar_dup16(uint64_t b)
+{
+    return (uint16_t)b * 0x0001000100010001ull;
+}
+
+static inline uint64_t swar_dup32(uint64_t b)
+{
+    return (uint32_t)b * 0x0000000100000001ull;
+}
+
 void HELPER(gvec_add8)(void *d, void *a, void *b, uint32_t desc)
 {
     intptr_t oprsz = simd_oprsz(desc);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint8_t)) {
-        *(uint8_t *)(d + i) = *(uint8_t *)(a + i) + *(uint8_t *)(b + i);
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_add(*(uint64_t *)(a + i),
+                                        *(uint64_t *)(b + i), SWAR_MSB_8);
     }
     clear_high(d, oprsz, desc);
 }
@@ -52,8 +88,9 @@ void HELPER(gvec_add16)(void *d, void *a, void *b, uint32_t desc)
     intptr_t oprsz = simd_oprsz(desc);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint16_t)) {
-        *(uint16_t *)(d + i) = *(uint16_t *)(a + i) + *(uint16_t *)(b + i);
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_add(*(uint64_t *)(a + i),
+                                        *(uint64_t *)(b + i), SWAR_MSB_16);
     }
     clear_high(d, oprsz, desc);
 }
@@ -63,8 +100,9 @@ void HELPER(gvec_add32)(void *d, void *a, void *b, uint32_t desc)
     intptr_t oprsz = simd_oprsz(desc);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint32_t)) {
-        *(uint32_t *)(d + i) = *(uint32_t *)(a + i) + *(uint32_t *)(b + i);
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_add(*(uint64_t *)(a + i),
+                                        *(uint64_t *)(b + i), SWAR_MSB_32);
     }
     clear_high(d, oprsz, desc);
 }
@@ -83,10 +121,11 @@ void HELPER(gvec_add64)(void *d, void *a, void *b, uint32_t desc)
 void HELPER(gvec_adds8)(void *d, void *a, uint64_t b, uint32_t desc)
 {
     intptr_t oprsz = simd_oprsz(desc);
+    uint64_t bb = swar_dup8(b);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint8_t)) {
-        *(uint8_t *)(d + i) = *(uint8_t *)(a + i) + (uint8_t)b;
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_add(*(uint64_t *)(a + i), bb, SWAR_MSB_8);
     }
     clear_high(d, oprsz, desc);
 }
@@ -94,10 +133,11 @@ void HELPER(gvec_adds8)(void *d, void *a, uint64_t b, uint32_t desc)
 void HELPER(gvec_adds16)(void *d, void *a, uint64_t b, uint32_t desc)
 {
     intptr_t oprsz = simd_oprsz(desc);
+    uint64_t bb = swar_dup16(b);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint16_t)) {
-        *(uint16_t *)(d + i) = *(uint16_t *)(a + i) + (uint16_t)b;
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_add(*(uint64_t *)(a + i), bb, SWAR_MSB_16);
     }
     clear_high(d, oprsz, desc);
 }
@@ -105,10 +145,11 @@ void HELPER(gvec_adds16)(void *d, void *a, uint64_t b, uint32_t desc)
 void HELPER(gvec_adds32)(void *d, void *a, uint64_t b, uint32_t desc)
 {
     intptr_t oprsz = simd_oprsz(desc);
+    uint64_t bb = swar_dup32(b);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint32_t)) {
-        *(uint32_t *)(d + i) = *(uint32_t *)(a + i) + (uint32_t)b;
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_add(*(uint64_t *)(a + i), bb, SWAR_MSB_32);
     }
     clear_high(d, oprsz, desc);
 }
@@ -129,8 +170,9 @@ void HELPER(gvec_sub8)(void *d, void *a, void *b, uint32_t desc)
     intptr_t oprsz = simd_oprsz(desc);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint8_t)) {
-        *(uint8_t *)(d + i) = *(uint8_t *)(a + i) - *(uint8_t *)(b + i);
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_sub(*(uint64_t *)(a + i),
+                                        *(uint64_t *)(b + i), SWAR_MSB_8);
     }
     clear_high(d, oprsz, desc);
 }
@@ -140,8 +182,9 @@ void HELPER(gvec_sub16)(void *d, void *a, void *b, uint32_t desc)
     intptr_t oprsz = simd_oprsz(desc);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint16_t)) {
-        *(uint16_t *)(d + i) = *(uint16_t *)(a + i) - *(uint16_t *)(b + i);
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_sub(*(uint64_t *)(a + i),
+                                        *(uint64_t *)(b + i), SWAR_MSB_16);
     }
     clear_high(d, oprsz, desc);
 }
@@ -151,8 +194,9 @@ void HELPER(gvec_sub32)(void *d, void *a, void *b, uint32_t desc)
     intptr_t oprsz = simd_oprsz(desc);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint32_t)) {
-        *(uint32_t *)(d + i) = *(uint32_t *)(a + i) - *(uint32_t *)(b + i);
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_sub(*(uint64_t *)(a + i),
+                                        *(uint64_t *)(b + i), SWAR_MSB_32);
     }
     clear_high(d, oprsz, desc);
 }
@@ -171,10 +215,11 @@ void HELPER(gvec_sub64)(void *d, void *a, void *b, uint32_t desc)
 void HELPER(gvec_subs8)(void *d, void *a, uint64_t b, uint32_t desc)
 {
     intptr_t oprsz = simd_oprsz(desc);
+    uint64_t bb = swar_dup8(b);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint8_t)) {
-        *(uint8_t *)(d + i) = *(uint8_t *)(a + i) - (uint8_t)b;
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_sub(*(uint64_t *)(a + i), bb, SWAR_MSB_8);
     }
     clear_high(d, oprsz, desc);
 }
@@ -182,10 +227,11 @@ void HELPER(gvec_subs8)(void *d, void *a, uint64_t b, uint32_t desc)
 void HELPER(gvec_subs16)(void *d, void *a, uint64_t b, uint32_t desc)
 {
     intptr_t oprsz = simd_oprsz(desc);
+    uint64_t bb = swar_dup16(b);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint16_t)) {
-        *(uint16_t *)(d + i) = *(uint16_t *)(a + i) - (uint16_t)b;
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_sub(*(uint64_t *)(a + i), bb, SWAR_MSB_16);
     }
     clear_high(d, oprsz, desc);
 }
@@ -193,10 +239,11 @@ void HELPER(gvec_subs16)(void *d, void *a, uint64_t b, uint32_t desc)
 void HELPER(gvec_subs32)(void *d, void *a, uint64_t b, uint32_t desc)
 {
     intptr_t oprsz = simd_oprsz(desc);
+    uint64_t bb = swar_dup32(b);
     intptr_t i;
 
-    for (i = 0; i < oprsz; i += sizeof(uint32_t)) {
-        *(uint32_t *)(d + i) = *(uint32_t *)(a + i) - (uint32_t)b;
+    for (i = 0; i < oprsz; i += sizeof(uint64_t)) {
+        *(uint64_t *)(d + i) = swar_sub(*(uint64_t *)(a + i), bb, SWAR_MSB_32);
     }
     clear_high(d, oprsz, desc);
 }
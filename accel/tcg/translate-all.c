@@ -48,6 +48,7 @@
 #include "exec/cputlb.h"
 #include "exec/translate-all.h"
 #include "qemu/bitmap.h"
+#include "qemu/error-report.h"
 #include "qemu/qemu-print.h"
 #include "qemu/timer.h"
 #include "qemu/main-loop.h"
@@ -1205,10 +1206,14 @@ static void do_tb_phys_invalidate(TranslationBlock *tb, bool rm_from_page_list)
     }
 
     /* remove the TB from the hash list */
-    h = tb_jmp_cache_hash_func(tb->pc);
+    h = tb_jmp_cache_hash_func(tb->pc) * TB_JMP_CACHE_WAYS;
     CPU_FOREACH(cpu) {
-        if (qatomic_read(&cpu->tb_jmp_cache[h]) == tb) {
-            qatomic_set(&cpu->tb_jmp_cache[h], NULL);
+        unsigned int way;
+
+        for (way = 0; way < TB_JMP_CACHE_WAYS; way++) {
+            if (qatomic_read(&cpu->tb_jmp_cache[h + way]) == tb) {
+                qatomic_set(&cpu->tb_jmp_cache[h + way], NULL);
+            }
         }
     }
 
@@ -1314,7 +1319,7 @@ static inline void tb_page_add(PageDesc *p, TranslationBlock *tb,
                 continue;
             }
             prot |= p2->flags;
-            p2->flags &= ~PAGE_WRITE;
+            qatomic_set(&p2->flags, p2->flags & ~PAGE_WRITE);
           }
         mprotect(g2h_untagged(page_addr), qemu_host_page_size,
                  (prot & PAGE_BITS) & ~PAGE_WRITE);
@@ -1400,6 +1405,197 @@ tb_link_page(TranslationBlock *tb, tb_page_addr_t phys_pc,
     return tb;
 }
 
+/*
+ * Persistent translation block cache.
+ *
+ * Translated host code cannot be reused across runs, since it embeds
+ * absolute host addresses for helpers and chained TBs.  The set of
+ * guest blocks that proved worth translating can, however.  When
+ * "tb-precache" is enabled we dump the descriptors (pc, cs_base, flags)
+ * of all live TBs at exit and reload them on the next run.  The first
+ * time a guest page yields a translation we eagerly retranslate the
+ * page's recorded blocks while the CPU state is known to be compatible,
+ * so a warm boot pays its translation cost in a few page-sized batches
+ * instead of one TB at a time.
+ */
+
+typedef struct TBPrecacheEntry {
+    uint64_t pc;
+    uint64_t cs_base;
+    uint32_t flags;
+    uint32_t pad;
+} TBPrecacheEntry;
+
+typedef struct TBPrecacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t target_ulong_bits;
+    uint32_t count;
+} TBPrecacheHeader;
+
+#define TB_PRECACHE_MAGIC   0x43425451 /* "QTBC" */
+#define TB_PRECACHE_VERSION 1
+
+static char *tb_precache_path;
+static QemuMutex tb_precache_lock;
+/* pc page -> GArray of TBPrecacheEntry, populated from the cache file */
+static GHashTable *tb_precache_pages;
+static __thread bool tb_precache_replaying;
+
+static gboolean tb_precache_dump_one(gpointer key, gpointer value,
+                                     gpointer data)
+{
+    const TranslationBlock *tb = value;
+    GArray *entries = data;
+    TBPrecacheEntry ent = {
+        .pc = tb->pc,
+        .cs_base = tb->cs_base,
+        .flags = tb->flags,
+    };
+
+    /* One-shot and MMIO blocks are not worth replaying.  */
+    if (tb->cflags & (CF_LAST_IO | CF_COUNT_MASK)) {
+        return FALSE;
+    }
+    g_array_append_val(entries, ent);
+    return FALSE;
+}
+
+static void tb_precache_save(void)
+{
+    GArray *entries = g_array_new(FALSE, FALSE, sizeof(TBPrecacheEntry));
+    TBPrecacheHeader hdr = {
+        .magic = TB_PRECACHE_MAGIC,
+        .version = TB_PRECACHE_VERSION,
+        .target_ulong_bits = TARGET_LONG_BITS,
+    };
+    FILE *f;
+
+    tcg_tb_foreach(tb_precache_dump_one, entries);
+    hdr.count = entries->len;
+
+    f = fopen(tb_precache_path, "wb");
+    if (!f) {
+        warn_report("tb-precache: cannot write %s: %s",
+                    tb_precache_path, strerror(errno));
+        g_array_free(entries, TRUE);
+        return;
+    }
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 ||
+        (hdr.count && fwrite(entries->data, sizeof(TBPrecacheEntry),
+                             hdr.count, f) != hdr.count)) {
+        warn_report("tb-precache: short write to %s", tb_precache_path);
+    }
+    fclose(f);
+    g_array_free(entries, TRUE);
+}
+
+static void tb_precache_load(void)
+{
+    TBPrecacheHeader hdr;
+    FILE *f = fopen(tb_precache_path, "rb");
+    uint32_t i;
+
+    if (!f) {
+        /* Cold run: nothing to preload, the file is written at exit.  */
+        return;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+        hdr.magic != TB_PRECACHE_MAGIC ||
+        hdr.version != TB_PRECACHE_VERSION ||
+        hdr.target_ulong_bits != TARGET_LONG_BITS) {
+        warn_report("tb-precache: %s is not a usable cache, ignoring it",
+                    tb_precache_path);
+        fclose(f);
+        return;
+    }
+
+    tb_precache_pages = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                              g_free, NULL);
+    for (i = 0; i < hdr.count; i++) {
+        TBPrecacheEntry ent;
+        uint64_t page;
+        GArray *entries;
+
+        if (fread(&ent, sizeof(ent), 1, f) != 1) {
+            break;
+        }
+        page = ent.pc & TARGET_PAGE_MASK;
+        entries = g_hash_table_lookup(tb_precache_pages, &page);
+        if (!entries) {
+            entries = g_array_new(FALSE, FALSE, sizeof(TBPrecacheEntry));
+            g_hash_table_insert(tb_precache_pages,
+                                g_memdup(&page, sizeof(page)), entries);
+        }
+        g_array_append_val(entries, ent);
+    }
+    fclose(f);
+}
+
+void tb_precache_init(const char *path)
+{
+    tb_precache_path = g_strdup(path);
+    qemu_mutex_init(&tb_precache_lock);
+    tb_precache_load();
+    atexit(tb_precache_save);
+}
+
+/*
+ * Called from the tail of tb_gen_code: @tb is the first block translated
+ * for its page since the precache was loaded.  Batch-translate the other
+ * blocks the previous run recorded for that page.  A fault raised while
+ * probing guest code (e.g. a recorded block straddling into a page that
+ * is no longer mapped) aborts the remainder of the batch.
+ */
+static void tb_precache_replay(CPUState *cpu, const TranslationBlock *tb)
+{
+    uint64_t page = tb->pc & TARGET_PAGE_MASK;
+    GArray *entries;
+    sigjmp_buf saved_jmp;
+    int saved_ei;
+    guint i;
+
+    if (!tb_precache_pages || tb_precache_replaying) {
+        return;
+    }
+    qemu_mutex_lock(&tb_precache_lock);
+    entries = g_hash_table_lookup(tb_precache_pages, &page);
+    if (entries) {
+        /* Only replay a page once, for the first state that executes it. */
+        g_hash_table_remove(tb_precache_pages, &page);
+    }
+    qemu_mutex_unlock(&tb_precache_lock);
+    if (!entries) {
+        return;
+    }
+
+    tb_precache_replaying = true;
+    memcpy(&saved_jmp, &cpu->jmp_env, sizeof(saved_jmp));
+    saved_ei = cpu->exception_index;
+    if (sigsetjmp(cpu->jmp_env, 0) == 0) {
+        for (i = 0; i < entries->len; i++) {
+            const TBPrecacheEntry *ent =
+                &g_array_index(entries, TBPrecacheEntry, i);
+
+            if (ent->cs_base != tb->cs_base || ent->flags != tb->flags) {
+                continue;
+            }
+            if (ent->pc == tb->pc ||
+                tb_htable_lookup(cpu, ent->pc, ent->cs_base, ent->flags,
+                                 tb->cflags)) {
+                continue;
+            }
+            tb_gen_code(cpu, ent->pc, ent->cs_base, ent->flags, tb->cflags);
+        }
+    } else {
+        /* Swallow the fault; the guest never issued this fetch. */
+        cpu->exception_index = saved_ei;
+    }
+    memcpy(&cpu->jmp_env, &saved_jmp, sizeof(saved_jmp));
+    tb_precache_replaying = false;
+    g_array_free(entries, TRUE);
+}
+
 /* Called with mmap_lock held for user mode emulation.  */
 TranslationBlock *tb_gen_code(CPUState *cpu,
                               target_ulong pc, target_ulong cs_base,
@@ -1674,6 +1870,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
         tcg_tb_remove(tb);
         return existing_tb;
     }
+    tb_precache_replay(cpu, tb);
     return tb;
 }
 
@@ -2125,6 +2322,14 @@ void dump_exec_info(void)
                 qatomic_read(&tb_ctx.tb_flush_count));
     qemu_printf("TB invalidate count %u\n",
                 qatomic_read(&tb_ctx.tb_phys_invalidate_count));
+    qemu_printf("TB hot chains       %u (longest %u)\n",
+                qatomic_read(&tb_ctx.hot_chain_count),
+                qatomic_read(&tb_ctx.longest_chain));
+    qemu_printf("gvec expansions     vector %" PRId64 " scalar %" PRId64
+                " out-of-line %" PRId64 "\n",
+                qatomic_read(&tcg_gvec_vector_expansions),
+                qatomic_read(&tcg_gvec_scalar_expansions),
+                qatomic_read(&tcg_gvec_ool_expansions));
 
     tlb_flush_counts(&flush_full, &flush_part, &flush_elide);
     qemu_printf("TLB full flushes    %zu\n", flush_full);
@@ -2259,6 +2464,12 @@ void page_dump(FILE *f)
     walk_memory_regions(f, dump_region);
 }
 
+/*
+ * May be called without mmap_lock: the radix table is walked with
+ * RCU-style atomic reads and nodes are never freed, and the flags
+ * themselves are updated atomically by the writers (which do hold
+ * mmap_lock).
+ */
 int page_get_flags(target_ulong address)
 {
     PageDesc *p;
@@ -2267,7 +2478,7 @@ int page_get_flags(target_ulong address)
     if (!p) {
         return 0;
     }
-    return p->flags;
+    return qatomic_read(&p->flags);
 }
 
 /* Modify the flags of a page and invalidate the code if necessary.
@@ -2300,10 +2511,11 @@ void page_set_flags(target_ulong start, target_ulong end, int flags)
          len != 0;
          len -= TARGET_PAGE_SIZE, addr += TARGET_PAGE_SIZE) {
         PageDesc *p = page_find_alloc(addr >> TARGET_PAGE_BITS, 1);
+        int old_flags = qatomic_read(&p->flags);
 
         /* If the write protection bit is set, then we invalidate
            the code inside.  */
-        if (!(p->flags & PAGE_WRITE) &&
+        if (!(old_flags & PAGE_WRITE) &&
             (flags & PAGE_WRITE) &&
             p->first_tb) {
             tb_invalidate_phys_page(addr, 0);
@@ -2311,10 +2523,10 @@ void page_set_flags(target_ulong start, target_ulong end, int flags)
         if (reset_target_data) {
             g_free(p->target_data);
             p->target_data = NULL;
-            p->flags = flags;
+            qatomic_set(&p->flags, flags);
         } else {
             /* Using mprotect on a page does not change MAP_ANON. */
-            p->flags = (p->flags & PAGE_ANON) | flags;
+            qatomic_set(&p->flags, (old_flags & PAGE_ANON) | flags);
         }
     }
 }
@@ -2367,24 +2579,27 @@ int page_check_range(target_ulong start, target_ulong len, int flags)
     for (addr = start, len = end - start;
          len != 0;
          len -= TARGET_PAGE_SIZE, addr += TARGET_PAGE_SIZE) {
+        int p_flags;
+
         p = page_find(addr >> TARGET_PAGE_BITS);
         if (!p) {
             return -1;
         }
-        if (!(p->flags & PAGE_VALID)) {
+        p_flags = qatomic_read(&p->flags);
+        if (!(p_flags & PAGE_VALID)) {
             return -1;
         }
 
-        if ((flags & PAGE_READ) && !(p->flags & PAGE_READ)) {
+        if ((flags & PAGE_READ) && !(p_flags & PAGE_READ)) {
             return -1;
         }
         if (flags & PAGE_WRITE) {
-            if (!(p->flags & PAGE_WRITE_ORG)) {
+            if (!(p_flags & PAGE_WRITE_ORG)) {
                 return -1;
             }
             /* unprotect the page if it was put read-only because it
                contains translated code */
-            if (!(p->flags & PAGE_WRITE)) {
+            if (!(p_flags & PAGE_WRITE)) {
                 if (!page_unprotect(addr, 0)) {
                     return -1;
                 }
@@ -2440,7 +2655,7 @@ int page_unprotect(target_ulong address, uintptr_t pc)
             prot = 0;
             for (addr = host_start; addr < host_end; addr += TARGET_PAGE_SIZE) {
                 p = page_find(addr >> TARGET_PAGE_BITS);
-                p->flags |= PAGE_WRITE;
+                qatomic_set(&p->flags, p->flags | PAGE_WRITE);
                 prot |= p->flags;
 
                 /* and since the content will be modified, we must invalidate
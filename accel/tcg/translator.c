@@ -57,6 +57,17 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     db->max_insns = max_insns;
     db->singlestep_enabled = cflags & CF_SINGLE_STEP;
 
+    /*
+     * Resolve the host address of the first guest code page; further
+     * pages are resolved on demand by translator_access().  A NULL
+     * entry (e.g. for execution from MMIO) routes all fetches through
+     * the full cpu_ld*_code path.
+     */
+    db->host_addr[0] = NULL;
+    db->host_addr[1] = NULL;
+    get_page_addr_code_hostp(cpu->env_ptr, db->pc_first & TARGET_PAGE_MASK,
+                             &db->host_addr[0]);
+
     ops->init_disas_context(db, cpu);
     tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
 
@@ -68,7 +79,8 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     ops->tb_start(db, cpu);
     tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
 
-    plugin_enabled = plugin_gen_tb_start(cpu, tb, cflags & CF_MEMI_ONLY);
+    plugin_enabled = (cflags & CF_PLUGIN) &&
+        plugin_gen_tb_start(cpu, tb, cflags & CF_MEMI_ONLY);
 
     while (true) {
         db->num_insns++;
@@ -137,3 +149,102 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     }
 #endif
 }
+
+/*
+ * Return a host pointer for a guest code access of @len bytes at @pc,
+ * or NULL if the access must take the full cpu_ld*_code path (MMIO,
+ * or an access crossing the page boundary).  Host addresses of the
+ * TB's pages are cached in the DisasContextBase, so the common case
+ * is a mask compare and an add.
+ */
+static void *translator_access(CPUArchState *env, DisasContextBase *db,
+                               abi_ptr pc, size_t len)
+{
+    void *host;
+    abi_ptr base, end;
+
+    /* Use slow path if first page is MMIO. */
+    if (unlikely(db->host_addr[0] == NULL)) {
+        return NULL;
+    }
+
+    end = pc + len - 1;
+    if (likely(((db->pc_first ^ end) & TARGET_PAGE_MASK) == 0)) {
+        host = db->host_addr[0];
+        base = db->pc_first & TARGET_PAGE_MASK;
+    } else {
+        host = db->host_addr[1];
+        base = (db->pc_first & TARGET_PAGE_MASK) + TARGET_PAGE_SIZE;
+        if (host == NULL) {
+            get_page_addr_code_hostp(env, base, &db->host_addr[1]);
+            host = db->host_addr[1];
+            if (host == NULL) {
+                return NULL;
+            }
+        }
+
+        /* Use slow path when crossing pages. */
+        if (((db->pc_first ^ pc) & TARGET_PAGE_MASK) == 0) {
+            return NULL;
+        }
+    }
+
+    tcg_debug_assert(pc >= base);
+    return host + (pc - base);
+}
+
+uint8_t translator_ldub(CPUArchState *env, DisasContextBase *db, abi_ptr pc)
+{
+    uint8_t ret;
+    void *p = translator_access(env, db, pc, sizeof(ret));
+
+    if (p) {
+        plugin_insn_append(p, sizeof(ret));
+        return ldub_p(p);
+    }
+    ret = cpu_ldub_code(env, pc);
+    plugin_insn_append(&ret, sizeof(ret));
+    return ret;
+}
+
+uint16_t translator_lduw(CPUArchState *env, DisasContextBase *db, abi_ptr pc)
+{
+    uint16_t ret;
+    void *p = translator_access(env, db, pc, sizeof(ret));
+
+    if (p) {
+        plugin_insn_append(p, sizeof(ret));
+        return lduw_p(p);
+    }
+    ret = cpu_lduw_code(env, pc);
+    plugin_insn_append(&ret, sizeof(ret));
+    return ret;
+}
+
+uint32_t translator_ldl(CPUArchState *env, DisasContextBase *db, abi_ptr pc)
+{
+    uint32_t ret;
+    void *p = translator_access(env, db, pc, sizeof(ret));
+
+    if (p) {
+        plugin_insn_append(p, sizeof(ret));
+        return ldl_p(p);
+    }
+    ret = cpu_ldl_code(env, pc);
+    plugin_insn_append(&ret, sizeof(ret));
+    return ret;
+}
+
+uint64_t translator_ldq(CPUArchState *env, DisasContextBase *db, abi_ptr pc)
+{
+    uint64_t ret;
+    void *p = translator_access(env, db, pc, sizeof(ret));
+
+    if (p) {
+        plugin_insn_append(p, sizeof(ret));
+        return ldq_p(p);
+    }
+    ret = cpu_ldq_code(env, pc);
+    plugin_insn_append(&ret, sizeof(ret));
+    return ret;
+}
@@ -17,6 +17,7 @@
 #include "qapi/qapi-builtin-visit.h"
 #include "qapi/visitor.h"
 #include "qemu/config-file.h"
+#include "qemu/error-report.h"
 #include "qom/object_interfaces.h"
 #include "qemu/mmap-alloc.h"
 
@@ -240,6 +241,48 @@ static void host_memory_backend_set_prealloc(Object *obj, bool value,
     }
 }
 
+static void *host_memory_backend_prealloc_thread(void *opaque)
+{
+    HostMemoryBackend *backend = opaque;
+    void *ptr = memory_region_get_ram_ptr(&backend->mr);
+    uint64_t sz = memory_region_size(&backend->mr);
+    Error *local_err = NULL;
+
+    os_mem_prealloc(memory_region_get_fd(&backend->mr), ptr, sz,
+                    backend->prealloc_threads, &local_err);
+    if (local_err) {
+        error_report_err(local_err);
+    }
+    qatomic_mb_set(&backend->prealloc_done, true);
+    return NULL;
+}
+
+static bool host_memory_backend_get_prealloc_async(Object *obj, Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    return backend->prealloc_async;
+}
+
+static void host_memory_backend_set_prealloc_async(Object *obj, bool value,
+                                                   Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    if (host_memory_backend_mr_inited(backend)) {
+        error_setg(errp, "cannot change property value");
+        return;
+    }
+    backend->prealloc_async = value;
+}
+
+static bool host_memory_backend_get_prealloc_done(Object *obj, Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    return qatomic_read(&backend->prealloc_done);
+}
+
 static void host_memory_backend_get_prealloc_threads(Object *obj, Visitor *v,
     const char *name, void *opaque, Error **errp)
 {
@@ -281,6 +324,17 @@ static void host_memory_backend_post_init(Object *obj)
     object_apply_compat_props(obj);
 }
 
+static void host_memory_backend_finalize(Object *obj)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    /* The worker touches the memory region; reap it before that goes.  */
+    if (backend->prealloc_thread_started) {
+        qemu_thread_join(&backend->prealloc_thread);
+        backend->prealloc_thread_started = false;
+    }
+}
+
 bool host_memory_backend_mr_inited(HostMemoryBackend *backend)
 {
     /*
@@ -392,10 +446,25 @@ host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
          * specified NUMA policy in place.
          */
         if (backend->prealloc) {
-            os_mem_prealloc(memory_region_get_fd(&backend->mr), ptr, sz,
-                            backend->prealloc_threads, &local_err);
-            if (local_err) {
-                goto out;
+            if (backend->prealloc_async) {
+                /*
+                 * Populate in the background so machine init is not held
+                 * up by a large backing file.  Pages the guest touches
+                 * first are simply found already populated by the worker;
+                 * completion is visible through the "prealloc-done"
+                 * property.
+                 */
+                qemu_thread_create(&backend->prealloc_thread, "prealloc",
+                                   host_memory_backend_prealloc_thread,
+                                   backend, QEMU_THREAD_JOINABLE);
+                backend->prealloc_thread_started = true;
+            } else {
+                os_mem_prealloc(memory_region_get_fd(&backend->mr), ptr, sz,
+                                backend->prealloc_threads, &local_err);
+                if (local_err) {
+                    goto out;
+                }
+                backend->prealloc_done = true;
             }
         }
     }
@@ -495,6 +564,15 @@ host_memory_backend_class_init(ObjectClass *oc, void *data)
         host_memory_backend_set_prealloc);
     object_class_property_set_description(oc, "prealloc",
         "Preallocate memory");
+    object_class_property_add_bool(oc, "prealloc-async",
+        host_memory_backend_get_prealloc_async,
+        host_memory_backend_set_prealloc_async);
+    object_class_property_set_description(oc, "prealloc-async",
+        "Preallocate memory in the background instead of blocking init");
+    object_class_property_add_bool(oc, "prealloc-done",
+        host_memory_backend_get_prealloc_done, NULL);
+    object_class_property_set_description(oc, "prealloc-done",
+        "Whether preallocation has completed (read only)");
     object_class_property_add(oc, "prealloc-threads", "int",
         host_memory_backend_get_prealloc_threads,
         host_memory_backend_set_prealloc_threads,
@@ -553,6 +631,7 @@ static const TypeInfo host_memory_backend_info = {
     .instance_size = sizeof(HostMemoryBackend),
     .instance_init = host_memory_backend_init,
     .instance_post_init = host_memory_backend_post_init,
+    .instance_finalize = host_memory_backend_finalize,
     .interfaces = (InterfaceInfo[]) {
         { TYPE_USER_CREATABLE },
         { }
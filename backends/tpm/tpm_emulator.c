@@ -222,6 +222,7 @@ static void tpm_emulator_handle_request(TPMBackend *tb, TPMBackendCmd *cmd,
                                         Error **errp)
 {
     TPMEmulator *tpm_emu = TPM_EMULATOR(tb);
+    int64_t start_us = g_get_monotonic_time();
 
     trace_tpm_emulator_handle_request();
 
@@ -231,6 +232,10 @@ static void tpm_emulator_handle_request(TPMBackend *tb, TPMBackendCmd *cmd,
                                   &cmd->selftest_done, errp) < 0) {
         tpm_util_write_fatal_error_response(cmd->out, cmd->out_len);
     }
+
+    trace_tpm_emulator_handle_request_latency(tpm_cmd_get_ordinal(cmd->in),
+                                              g_get_monotonic_time()
+                                              - start_us);
 }
 
 static int tpm_emulator_probe_caps(TPMEmulator *tpm_emu)
@@ -31,13 +31,34 @@
 #include "block/block_int.h"
 #include "block/qdict.h"
 #include "block/block-copy.h"
+#include "block/dirty-bitmap.h"
 
 #include "block/backup-top.h"
 
+typedef struct BackupTopStagedChunk {
+    int64_t offset;
+    int64_t bytes;
+    uint8_t *buf;
+    QSIMPLEQ_ENTRY(BackupTopStagedChunk) entry;
+} BackupTopStagedChunk;
+
 typedef struct BDRVBackupTopState {
     BlockCopyState *bcs;
     BdrvChild *target;
     int64_t cluster_size;
+
+    /*
+     * Staged CBW: instead of writing old data to the target in the guest's
+     * write path, buffer it in a bounded host-memory ring and let a
+     * background coroutine deliver it to the target.  When the ring is full
+     * the request spills to the synchronous copy path.
+     */
+    int64_t staging_size;   /* max buffered bytes, 0 disables staging */
+    int64_t staged_bytes;
+    int staging_ret;
+    bool flush_running;
+    QSIMPLEQ_HEAD(, BackupTopStagedChunk) staged;
+    BdrvRequestFlags write_flags;
 } BDRVBackupTopState;
 
 static coroutine_fn int backup_top_co_preadv(
@@ -47,6 +68,96 @@ static coroutine_fn int backup_top_co_preadv(
     return bdrv_co_preadv(bs->backing, offset, bytes, qiov, flags);
 }
 
+static void coroutine_fn backup_top_staged_flush_entry(void *opaque)
+{
+    BlockDriverState *bs = opaque;
+    BDRVBackupTopState *s = bs->opaque;
+    BackupTopStagedChunk *chunk;
+
+    while ((chunk = QSIMPLEQ_FIRST(&s->staged))) {
+        QEMUIOVector qiov = QEMU_IOVEC_INIT_BUF(qiov, chunk->buf,
+                                                chunk->bytes);
+        int ret;
+
+        ret = bdrv_co_pwritev(s->target, chunk->offset, chunk->bytes, &qiov,
+                              s->write_flags);
+        if (ret < 0) {
+            /*
+             * Keep the chunk: its buffer holds the only remaining copy of
+             * the old data.  Failing subsequent guest writes (see
+             * backup_top_stage()) surfaces the error instead of silently
+             * completing a torn backup.
+             */
+            s->staging_ret = ret;
+            break;
+        }
+
+        QSIMPLEQ_REMOVE_HEAD(&s->staged, entry);
+        block_copy_staged_end(s->bcs, chunk->offset, chunk->bytes, 0);
+        s->staged_bytes -= chunk->bytes;
+        qemu_vfree(chunk->buf);
+        g_free(chunk);
+    }
+
+    s->flush_running = false;
+    bdrv_dec_in_flight(bs);
+}
+
+/*
+ * Returns 0 if the old data is staged (or was already copied), -EAGAIN if
+ * the caller should spill to the synchronous copy path, and a negative
+ * errno if reading the old data failed.
+ */
+static coroutine_fn int backup_top_stage(BlockDriverState *bs, uint64_t offset,
+                                         uint64_t bytes)
+{
+    BDRVBackupTopState *s = bs->opaque;
+    BackupTopStagedChunk *chunk;
+    QEMUIOVector qiov;
+    int ret;
+
+    if (s->staging_ret < 0) {
+        return s->staging_ret;
+    }
+
+    if (s->staged_bytes + bytes > s->staging_size) {
+        return -EAGAIN;
+    }
+
+    ret = block_copy_staged_begin(s->bcs, offset, bytes);
+    if (ret <= 0) {
+        return ret;
+    }
+
+    chunk = g_new(BackupTopStagedChunk, 1);
+    *chunk = (BackupTopStagedChunk) {
+        .offset = offset,
+        .bytes = bytes,
+        .buf = qemu_blockalign(bs, bytes),
+    };
+
+    qemu_iovec_init_buf(&qiov, chunk->buf, chunk->bytes);
+    ret = bdrv_co_preadv(bs->backing, offset, bytes, &qiov, 0);
+    if (ret < 0) {
+        block_copy_staged_end(s->bcs, offset, bytes, ret);
+        qemu_vfree(chunk->buf);
+        g_free(chunk);
+        return ret;
+    }
+
+    QSIMPLEQ_INSERT_TAIL(&s->staged, chunk, entry);
+    s->staged_bytes += chunk->bytes;
+
+    if (!s->flush_running) {
+        s->flush_running = true;
+        bdrv_inc_in_flight(bs);
+        qemu_coroutine_enter(
+            qemu_coroutine_create(backup_top_staged_flush_entry, bs));
+    }
+
+    return 0;
+}
+
 static coroutine_fn int backup_top_cbw(BlockDriverState *bs, uint64_t offset,
                                        uint64_t bytes, BdrvRequestFlags flags)
 {
@@ -60,6 +171,14 @@ static coroutine_fn int backup_top_cbw(BlockDriverState *bs, uint64_t offset,
     off = QEMU_ALIGN_DOWN(offset, s->cluster_size);
     end = QEMU_ALIGN_UP(offset + bytes, s->cluster_size);
 
+    if (s->staging_size) {
+        int ret = backup_top_stage(bs, off, end - off);
+        if (ret != -EAGAIN) {
+            return ret;
+        }
+        /* Ring full or range partially copied already: copy synchronously */
+    }
+
     return block_copy(s->bcs, off, end - off, true);
 }
 
@@ -190,6 +309,10 @@ BlockDriverState *bdrv_backup_top_append(BlockDriverState *source,
     }
 
     state = top->opaque;
+    QSIMPLEQ_INIT(&state->staged);
+    state->staging_size = perf->has_cbw_staging_size ? perf->cbw_staging_size
+                                                     : 0;
+    state->write_flags = write_flags;
     top->total_sectors = source->total_sectors;
     top->supported_write_flags = BDRV_REQ_WRITE_UNCHANGED |
             (BDRV_REQ_FUA & source->supported_write_flags);
@@ -244,6 +367,23 @@ fail:
 void bdrv_backup_top_drop(BlockDriverState *bs)
 {
     BDRVBackupTopState *s = bs->opaque;
+    BackupTopStagedChunk *chunk;
+
+    bdrv_drain(bs);
+
+    /*
+     * Chunks remain here only if flushing them to the target failed.  Mark
+     * them dirty again so that the copy state we free below is consistent;
+     * block_copy_staged_end() cannot be used outside coroutine context.
+     */
+    while ((chunk = QSIMPLEQ_FIRST(&s->staged))) {
+        QSIMPLEQ_REMOVE_HEAD(&s->staged, entry);
+        bdrv_set_dirty_bitmap(block_copy_dirty_bitmap(s->bcs),
+                              chunk->offset, chunk->bytes);
+        s->staged_bytes -= chunk->bytes;
+        qemu_vfree(chunk->buf);
+        g_free(chunk);
+    }
 
     bdrv_drop_filter(bs, &error_abort);
 
@@ -320,11 +320,12 @@ static void coroutine_fn backup_set_speed(BlockJob *job, int64_t speed)
     BackupBlockJob *s = container_of(job, BackupBlockJob, common);
 
     /*
-     * block_job_set_speed() is called first from block_job_create(), when we
-     * don't yet have s->bcs.
+     * The shared rate limit that s->bcs draws from is already updated by
+     * block_job_set_speed(); just make sure a throttled background request
+     * notices the new quota.  block_job_set_speed() is called first from
+     * block_job_create(), when we don't yet have s->bcs.
      */
     if (s->bcs) {
-        block_copy_set_speed(s->bcs, speed);
         if (s->bg_bcs_call) {
             block_copy_kick(s->bg_bcs_call);
         }
@@ -471,6 +472,12 @@ BlockJob *backup_job_create(const char *job_id, BlockDriverState *bs,
         return NULL;
     }
 
+    if (perf->has_cbw_staging_size && perf->cbw_staging_size < 0) {
+        error_setg(errp, "cbw-staging-size must be zero (which disables "
+                   "staging) or positive");
+        return NULL;
+    }
+
 
     if (sync_bitmap) {
         /* If we need to write to this bitmap, check that we can: */
@@ -550,7 +557,7 @@ BlockJob *backup_job_create(const char *job_id, BlockDriverState *bs,
     job->perf = *perf;
 
     block_copy_set_progress_meter(bcs, &job->common.job.progress);
-    block_copy_set_speed(bcs, speed);
+    block_copy_set_rate_limit(bcs, block_job_rate_limit(&job->common));
 
     /* Required permissions are already taken by backup-top target */
     block_job_add_bdrv(&job->common, "target", target, 0, BLK_PERM_ALL,
@@ -57,6 +57,20 @@ typedef struct {
     uint64_t cur_log_sector;
     uint64_t nr_entries;
     uint64_t update_interval;
+
+    /* Don't log data payloads, only entry headers, for ordering analysis */
+    bool metadata_only;
+
+    /* Log size limit in sectors; the log wraps around when it is reached */
+    uint64_t log_max_sectors;
+
+    /*
+     * Superblock updates are batched: concurrent flush epochs share one
+     * superblock write and log flush instead of serializing on their own.
+     * @super_nr_entries is the entry count the on-disk superblock covers.
+     */
+    CoMutex super_lock;
+    uint64_t super_nr_entries;
 } BDRVBlkLogWritesState;
 
 static QemuOptsList runtime_opts = {
@@ -78,6 +92,18 @@ static QemuOptsList runtime_opts = {
             .type = QEMU_OPT_NUMBER,
             .help = "Log superblock update interval (# of write requests)",
         },
+        {
+            .name = "log-metadata-only",
+            .type = QEMU_OPT_BOOL,
+            .help = "Log only entry headers, not data payloads. Such a log "
+                    "records write ordering but cannot be replayed",
+        },
+        {
+            .name = "log-max-size",
+            .type = QEMU_OPT_SIZE,
+            .help = "Maximum log size in bytes; the log wraps around when "
+                    "the limit is reached (default 0 for unbounded)",
+        },
         { /* end of list */ }
     },
 };
@@ -146,6 +172,7 @@ static int blk_log_writes_open(BlockDriverState *bs, QDict *options, int flags,
     Error *local_err = NULL;
     int ret;
     uint64_t log_sector_size;
+    uint64_t log_max_size;
     bool log_append;
 
     opts = qemu_opts_create(&runtime_opts, NULL, 0, &error_abort);
@@ -183,6 +210,25 @@ static int blk_log_writes_open(BlockDriverState *bs, QDict *options, int flags,
             goto fail_log;
         }
 
+        /*
+         * An appended-to log must stay walkable by
+         * blk_log_writes_find_cur_log_sector(), which assumes every entry
+         * carries its data and that entries only ever grow the log.
+         */
+        if (qemu_opt_get_bool(opts, "log-metadata-only", false)) {
+            ret = -EINVAL;
+            error_setg(errp, "log-append and log-metadata-only are mutually "
+                       "exclusive");
+            goto fail_log;
+        }
+
+        if (qemu_opt_find(opts, "log-max-size")) {
+            ret = -EINVAL;
+            error_setg(errp, "log-append and log-max-size are mutually "
+                       "exclusive");
+            goto fail_log;
+        }
+
         /* Read log superblock or fake one for an empty log */
         if (!bdrv_getlength(s->log_file->bs)) {
             log_sb.magic      = cpu_to_le64(WRITE_LOG_MAGIC);
@@ -250,6 +296,20 @@ static int blk_log_writes_open(BlockDriverState *bs, QDict *options, int flags,
         goto fail_log;
     }
 
+    s->metadata_only = qemu_opt_get_bool(opts, "log-metadata-only", false);
+
+    log_max_size = qemu_opt_get_size(opts, "log-max-size", 0);
+    if (!QEMU_IS_ALIGNED(log_max_size, s->sectorsize)) {
+        ret = -EINVAL;
+        error_setg(errp, "log-max-size must be a multiple of the log sector "
+                   "size %"PRIu32, s->sectorsize);
+        goto fail_log;
+    }
+    s->log_max_sectors = log_max_size >> s->sectorbits;
+
+    qemu_co_mutex_init(&s->super_lock);
+    s->super_nr_entries = s->nr_entries;
+
     ret = 0;
 fail_log:
     if (ret < 0) {
@@ -325,14 +385,76 @@ typedef struct {
     int log_ret;
 } BlkLogWritesLogReq;
 
+/*
+ * Write out the log superblock covering at least @min_entries entries and
+ * flush the log.  Concurrent callers are coalesced: whoever holds the lock
+ * writes the current entry count, and waiters whose entries that write
+ * already covered return without issuing a superblock write of their own.
+ */
+static int coroutine_fn
+blk_log_writes_co_update_super(BDRVBlkLogWritesState *s, uint64_t min_entries)
+{
+    int ret = 0;
+
+    qemu_co_mutex_lock(&s->super_lock);
+    if (s->super_nr_entries < min_entries) {
+        uint64_t nr_entries = s->nr_entries;
+        struct log_write_super super = {
+            .magic      = cpu_to_le64(WRITE_LOG_MAGIC),
+            .version    = cpu_to_le64(WRITE_LOG_VERSION),
+            .nr_entries = cpu_to_le64(nr_entries),
+            .sectorsize = cpu_to_le32(s->sectorsize),
+        };
+        void *zeroes = g_malloc0(s->sectorsize - sizeof(super));
+        QEMUIOVector qiov;
+
+        qemu_iovec_init(&qiov, 2);
+        qemu_iovec_add(&qiov, &super, sizeof(super));
+        qemu_iovec_add(&qiov, zeroes, s->sectorsize - sizeof(super));
+
+        ret = bdrv_co_pwritev(s->log_file, 0, s->sectorsize, &qiov, 0);
+        if (ret == 0) {
+            ret = bdrv_co_flush(s->log_file->bs);
+        }
+        if (ret == 0) {
+            s->super_nr_entries = nr_entries;
+        }
+        qemu_iovec_destroy(&qiov);
+        g_free(zeroes);
+    }
+    qemu_co_mutex_unlock(&s->super_lock);
+
+    return ret;
+}
+
 static void coroutine_fn blk_log_writes_co_do_log(BlkLogWritesLogReq *lr)
 {
     BDRVBlkLogWritesState *s = lr->bs->opaque;
-    uint64_t cur_log_offset = s->cur_log_sector << s->sectorbits;
-
-    s->nr_entries++;
-    s->cur_log_sector +=
+    uint64_t cur_log_offset;
+    uint64_t entry_sectors =
             ROUND_UP(lr->qiov->size, s->sectorsize) >> s->sectorbits;
+    uint64_t nr_sectors = entry_sectors +
+            (ROUND_UP(lr->zero_size, s->sectorsize) >> s->sectorbits);
+    uint64_t nr_entries;
+
+    /*
+     * With a bounded log, wrap around to just past the superblock once the
+     * next entry would no longer fit.  Earlier entries are overwritten; the
+     * superblock entry count keeps growing, so a reader can tell the log has
+     * wrapped when the accumulated entry size exceeds the log size.
+     */
+    if (s->log_max_sectors &&
+        s->cur_log_sector + nr_sectors > s->log_max_sectors) {
+        if (1 + nr_sectors > s->log_max_sectors) {
+            lr->log_ret = -ENOSPC;
+            return;
+        }
+        s->cur_log_sector = 1;
+    }
+
+    cur_log_offset = s->cur_log_sector << s->sectorbits;
+    nr_entries = ++s->nr_entries;
+    s->cur_log_sector += entry_sectors;
 
     lr->log_ret = bdrv_co_pwritev(s->log_file, cur_log_offset, lr->qiov->size,
                                   lr->qiov, 0);
@@ -349,28 +471,9 @@ static void coroutine_fn blk_log_writes_co_do_log(BlkLogWritesLogReq *lr)
 
     /* Update super block on flush or every update interval */
     if (lr->log_ret == 0 && ((lr->entry.flags & LOG_FLUSH_FLAG)
-        || (s->nr_entries % s->update_interval == 0)))
+        || (nr_entries - s->super_nr_entries >= s->update_interval)))
     {
-        struct log_write_super super = {
-            .magic      = cpu_to_le64(WRITE_LOG_MAGIC),
-            .version    = cpu_to_le64(WRITE_LOG_VERSION),
-            .nr_entries = cpu_to_le64(s->nr_entries),
-            .sectorsize = cpu_to_le32(s->sectorsize),
-        };
-        void *zeroes = g_malloc0(s->sectorsize - sizeof(super));
-        QEMUIOVector qiov;
-
-        qemu_iovec_init(&qiov, 2);
-        qemu_iovec_add(&qiov, &super, sizeof(super));
-        qemu_iovec_add(&qiov, zeroes, s->sectorsize - sizeof(super));
-
-        lr->log_ret =
-            bdrv_co_pwritev(s->log_file, 0, s->sectorsize, &qiov, 0);
-        if (lr->log_ret == 0) {
-            lr->log_ret = bdrv_co_flush(s->log_file->bs);
-        }
-        qemu_iovec_destroy(&qiov);
-        g_free(zeroes);
+        lr->log_ret = blk_log_writes_co_update_super(s, nr_entries);
     }
 }
 
@@ -405,7 +508,7 @@ blk_log_writes_co_log(BlockDriverState *bs, uint64_t offset, uint64_t bytes,
             .flags      = cpu_to_le64(entry_flags),
             .data_len   = 0,
         },
-        .zero_size = is_zero_write ? bytes : 0,
+        .zero_size = (is_zero_write && !s->metadata_only) ? bytes : 0,
     };
     void *zeroes = g_malloc0(s->sectorsize - sizeof(lr.entry));
 
@@ -417,7 +520,7 @@ blk_log_writes_co_log(BlockDriverState *bs, uint64_t offset, uint64_t bytes,
     qemu_iovec_init(&log_qiov, niov + 2);
     qemu_iovec_add(&log_qiov, &lr.entry, sizeof(lr.entry));
     qemu_iovec_add(&log_qiov, zeroes, s->sectorsize - sizeof(lr.entry));
-    if (qiov) {
+    if (qiov && !s->metadata_only) {
         qemu_iovec_concat(&log_qiov, qiov, 0, qiov->size);
     }
 
@@ -494,6 +597,8 @@ blk_log_writes_co_pdiscard(BlockDriverState *bs, int64_t offset, int count)
 static const char *const blk_log_writes_strong_runtime_opts[] = {
     "log-append",
     "log-sector-size",
+    "log-metadata-only",
+    "log-max-size",
 
     NULL
 };
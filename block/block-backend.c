@@ -41,6 +41,13 @@ typedef struct BlockBackendAioNotifier {
     QLIST_ENTRY(BlockBackendAioNotifier) list;
 } BlockBackendAioNotifier;
 
+/* Number of in_flight counter shards; each submitting thread uses one */
+#define BLK_IN_FLIGHT_SHARDS 8
+
+typedef struct BlkInFlightCounter {
+    unsigned int count;
+} QEMU_ALIGNED(64) BlkInFlightCounter;
+
 struct BlockBackend {
     char *name;
     int refcnt;
@@ -91,9 +98,13 @@ struct BlockBackend {
     /* Number of in-flight aio requests.  BlockDriverState also counts
      * in-flight requests but aio requests can exist even when blk->root is
      * NULL, so we cannot rely on its counter for that case.
-     * Accessed with atomic ops.
+     * Sharded so that queues submitting from different IOThreads do not
+     * bounce a shared cache line; each shard is accessed with atomic ops
+     * and readers sum all shards.  A request may be incremented and
+     * decremented on different shards, so individual shards can wrap;
+     * only the sum is meaningful.
      */
-    unsigned int in_flight;
+    BlkInFlightCounter in_flight[BLK_IN_FLIGHT_SHARDS];
 };
 
 typedef struct BlockBackendAIOCB {
@@ -1183,10 +1194,39 @@ static int blk_check_byte_request(BlockBackend *blk, int64_t offset,
     return 0;
 }
 
+/* Return the in_flight shard of the calling thread */
+static unsigned int blk_in_flight_shard(void)
+{
+    static unsigned int next_shard;
+    static __thread unsigned int shard;
+
+    if (shard == 0) {
+        shard = qatomic_fetch_inc(&next_shard) % BLK_IN_FLIGHT_SHARDS + 1;
+    }
+    return shard - 1;
+}
+
+/*
+ * Sum the in_flight shards.  Individual shards can wrap when a request
+ * is incremented and decremented on different threads, but unsigned
+ * arithmetic makes the sum come out right.
+ */
+static unsigned int blk_in_flight(BlockBackend *blk)
+{
+    unsigned int sum = 0;
+    int i;
+
+    smp_mb();
+    for (i = 0; i < BLK_IN_FLIGHT_SHARDS; i++) {
+        sum += qatomic_read(&blk->in_flight[i].count);
+    }
+    return sum;
+}
+
 /* To be called between exactly one pair of blk_inc/dec_in_flight() */
 static void coroutine_fn blk_wait_while_drained(BlockBackend *blk)
 {
-    assert(blk->in_flight > 0);
+    assert(blk_in_flight(blk) > 0);
 
     if (blk->quiesce_counter && !blk->disable_request_queuing) {
         blk_dec_in_flight(blk);
@@ -1367,12 +1407,12 @@ int blk_make_zero(BlockBackend *blk, BdrvRequestFlags flags)
 
 void blk_inc_in_flight(BlockBackend *blk)
 {
-    qatomic_inc(&blk->in_flight);
+    qatomic_inc(&blk->in_flight[blk_in_flight_shard()].count);
 }
 
 void blk_dec_in_flight(BlockBackend *blk)
 {
-    qatomic_dec(&blk->in_flight);
+    qatomic_dec(&blk->in_flight[blk_in_flight_shard()].count);
     aio_wait_kick();
 }
 
@@ -1733,8 +1773,7 @@ void blk_drain(BlockBackend *blk)
     }
 
     /* We may have -ENOMEDIUM completions in flight */
-    AIO_WAIT_WHILE(blk_get_aio_context(blk),
-                   qatomic_mb_read(&blk->in_flight) > 0);
+    AIO_WAIT_WHILE(blk_get_aio_context(blk), blk_in_flight(blk) > 0);
 
     if (bs) {
         bdrv_drained_end(bs);
@@ -1753,7 +1792,7 @@ void blk_drain_all(void)
         aio_context_acquire(ctx);
 
         /* We may have -ENOMEDIUM completions in flight */
-        AIO_WAIT_WHILE(ctx, qatomic_mb_read(&blk->in_flight) > 0);
+        AIO_WAIT_WHILE(ctx, blk_in_flight(blk) > 0);
 
         aio_context_release(ctx);
     }
@@ -2405,7 +2444,7 @@ static bool blk_root_drained_poll(BdrvChild *child)
     if (blk->dev_ops && blk->dev_ops->drained_poll) {
         busy = blk->dev_ops->drained_poll(blk->dev_opaque);
     }
-    return busy || !!blk->in_flight;
+    return busy || blk_in_flight(blk) > 0;
 }
 
 static void blk_root_drained_end(BdrvChild *child, int *drained_end_counter)
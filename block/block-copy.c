@@ -26,7 +26,6 @@
 #define BLOCK_COPY_MAX_BUFFER (1 * MiB)
 #define BLOCK_COPY_MAX_MEM (128 * MiB)
 #define BLOCK_COPY_MAX_WORKERS 64
-#define BLOCK_COPY_SLICE_TIME 100000000ULL /* ns */
 
 typedef enum {
     COPY_READ_WRITE_CLUSTER,
@@ -155,7 +154,12 @@ typedef struct BlockCopyState {
     BdrvDirtyBitmap *copy_bitmap;
     ProgressMeter *progress;
     SharedResource *mem;
-    RateLimit rate_limit;
+    RateLimit rate_limit_local;
+    /*
+     * Token bucket to throttle against; either &rate_limit_local or a
+     * shared bucket installed with block_copy_set_rate_limit().
+     */
+    RateLimit *rate_limit;
 } BlockCopyState;
 
 /* Called with lock held */
@@ -302,7 +306,7 @@ void block_copy_state_free(BlockCopyState *s)
         return;
     }
 
-    ratelimit_destroy(&s->rate_limit);
+    ratelimit_destroy(&s->rate_limit_local);
     bdrv_release_dirty_bitmap(s->copy_bitmap);
     shres_destroy(s->mem);
     g_free(s);
@@ -362,7 +366,8 @@ BlockCopyState *block_copy_state_new(BdrvChild *source, BdrvChild *target,
         s->method = use_copy_range ? COPY_RANGE_SMALL : COPY_READ_WRITE;
     }
 
-    ratelimit_init(&s->rate_limit);
+    ratelimit_init(&s->rate_limit_local);
+    s->rate_limit = &s->rate_limit_local;
     qemu_co_mutex_init(&s->lock);
     QLIST_INIT(&s->tasks);
     QLIST_INIT(&s->calls);
@@ -638,6 +643,47 @@ int64_t block_copy_reset_unallocated(BlockCopyState *s,
     return ret;
 }
 
+int coroutine_fn block_copy_staged_begin(BlockCopyState *s, int64_t offset,
+                                         int64_t bytes)
+{
+    QEMU_LOCK_GUARD(&s->lock);
+
+    assert(QEMU_IS_ALIGNED(offset, s->cluster_size));
+    assert(QEMU_IS_ALIGNED(bytes, s->cluster_size));
+
+    while (block_copy_wait_one(s, offset, bytes)) {
+        /* A conflicting task may have copied part of the range meanwhile */
+    }
+
+    if (bdrv_dirty_bitmap_next_dirty(s->copy_bitmap, offset, bytes) < 0) {
+        return 0;
+    }
+    if (bdrv_dirty_bitmap_next_zero(s->copy_bitmap, offset, bytes) >= 0) {
+        return -EAGAIN;
+    }
+
+    bdrv_reset_dirty_bitmap(s->copy_bitmap, offset, bytes);
+    s->in_flight_bytes += bytes;
+
+    return 1;
+}
+
+void coroutine_fn block_copy_staged_end(BlockCopyState *s, int64_t offset,
+                                        int64_t bytes, int ret)
+{
+    QEMU_LOCK_GUARD(&s->lock);
+
+    s->in_flight_bytes -= bytes;
+    if (ret < 0) {
+        bdrv_set_dirty_bitmap(s->copy_bitmap, offset, bytes);
+    } else {
+        progress_work_done(s->progress, bytes);
+    }
+    progress_set_remaining(s->progress,
+                           bdrv_get_dirty_count(s->copy_bitmap) +
+                           s->in_flight_bytes);
+}
+
 /*
  * block_copy_dirty_clusters
  *
@@ -704,7 +750,7 @@ block_copy_dirty_clusters(BlockCopyCallState *call_state)
         }
 
         if (!call_state->ignore_ratelimit) {
-            uint64_t ns = ratelimit_calculate_delay(&s->rate_limit, 0);
+            uint64_t ns = ratelimit_calculate_delay(s->rate_limit, 0);
             if (ns > 0) {
                 block_copy_task_end(task, -EAGAIN);
                 g_free(task);
@@ -714,7 +760,7 @@ block_copy_dirty_clusters(BlockCopyCallState *call_state)
             }
         }
 
-        ratelimit_calculate_delay(&s->rate_limit, task->bytes);
+        ratelimit_calculate_delay(s->rate_limit, task->bytes);
 
         trace_block_copy_process(s, task->offset);
 
@@ -938,14 +984,13 @@ void block_copy_set_skip_unallocated(BlockCopyState *s, bool skip)
     qatomic_set(&s->skip_unallocated, skip);
 }
 
-void block_copy_set_speed(BlockCopyState *s, uint64_t speed)
+void block_copy_set_rate_limit(BlockCopyState *s, RateLimit *limit)
 {
-    ratelimit_set_speed(&s->rate_limit, speed, BLOCK_COPY_SLICE_TIME);
-
     /*
-     * Note: it's good to kick all call states from here, but it should be done
-     * only from a coroutine, to not crash if s->calls list changed while
-     * entering one call. So for now, the only user of this function kicks its
-     * only one call_state by hand.
+     * Note: it would be good to kick all call states when the quota of the
+     * new bucket differs, but that should be done only from a coroutine, to
+     * not crash if s->calls list changed while entering one call. So for now,
+     * the only user of this function kicks its only one call_state by hand.
      */
+    s->rate_limit = limit;
 }
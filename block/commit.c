@@ -21,15 +21,7 @@
 #include "qapi/qmp/qerror.h"
 #include "qemu/ratelimit.h"
 #include "sysemu/block-backend.h"
-
-enum {
-    /*
-     * Size of data buffer for populating the image file.  This should be large
-     * enough to process multiple clusters in a single call, so that populating
-     * contiguous regions of the image is efficient.
-     */
-    COMMIT_BUFFER_SIZE = 512 * 1024, /* in bytes */
-};
+#include "block/copy-window.h"
 
 typedef struct CommitBlockJob {
     BlockJob common;
@@ -112,14 +104,36 @@ static void commit_clean(Job *job)
     blk_unref(s->top);
 }
 
+static int coroutine_fn commit_copy_cb(void *opaque, int64_t offset,
+                                       int64_t bytes, bool *error_is_read)
+{
+    CommitBlockJob *s = opaque;
+    QEMU_AUTO_VFREE void *buf = NULL;
+    int ret;
+
+    assert(bytes < SIZE_MAX);
+
+    buf = blk_blockalign(s->top, bytes);
+    ret = blk_co_pread(s->top, offset, bytes, buf, 0);
+    if (ret >= 0) {
+        ret = blk_co_pwrite(s->base, offset, bytes, buf, 0);
+        if (ret < 0) {
+            *error_is_read = false;
+        }
+    }
+
+    return ret;
+}
+
 static int coroutine_fn commit_run(Job *job, Error **errp)
 {
     CommitBlockJob *s = container_of(job, CommitBlockJob, common.job);
+    CopyWindow *cw;
     int64_t offset;
+    int64_t counted = 0;
     uint64_t delay_ns = 0;
     int ret = 0;
     int64_t n = 0; /* bytes */
-    QEMU_AUTO_VFREE void *buf = NULL;
     int64_t len, base_len;
 
     len = blk_getlength(s->top);
@@ -140,11 +154,12 @@ static int coroutine_fn commit_run(Job *job, Error **errp)
         }
     }
 
-    buf = blk_blockalign(s->top, COMMIT_BUFFER_SIZE);
+    cw = copy_window_new(&s->common.job, commit_copy_cb, s);
 
-    for (offset = 0; offset < len; offset += n) {
+    for (offset = 0; ; offset += n) {
         bool copy;
         bool error_in_source = true;
+        int64_t error_offset;
 
         /* Note that even when no rate limit is applied we need to yield
          * with no pending I/O here so that bdrv_drain_all() returns.
@@ -153,43 +168,70 @@ static int coroutine_fn commit_run(Job *job, Error **errp)
         if (job_is_cancelled(&s->common.job)) {
             break;
         }
+
+        n = 0;
+        delay_ns = 0;
+
+        /* Surface errors of copies that completed in the background */
+        if (offset >= len) {
+            /* The scan is done, wait for the copies still in flight */
+            ret = copy_window_co_drain(cw, &error_offset, &error_in_source);
+        } else {
+            ret = copy_window_error(cw, &error_offset, &error_in_source);
+        }
+        if (ret < 0) {
+            BlockErrorAction action =
+                block_job_error_action(&s->common, s->on_error,
+                                       error_in_source, -ret);
+            if (action == BLOCK_ERROR_ACTION_REPORT) {
+                copy_window_co_free(cw);
+                return ret;
+            } else {
+                /* Retry from the failed chunk once the job is resumed */
+                offset = MIN(offset, error_offset);
+                continue;
+            }
+        }
+        if (offset >= len) {
+            break;
+        }
+
         /* Copy if allocated above the base */
         ret = bdrv_is_allocated_above(blk_bs(s->top), s->base_overlay, true,
-                                      offset, COMMIT_BUFFER_SIZE, &n);
+                                      offset, copy_window_chunk(cw), &n);
         copy = (ret > 0);
         trace_commit_one_iteration(s, offset, n, ret);
-        if (copy) {
-            assert(n < SIZE_MAX);
-
-            ret = blk_co_pread(s->top, offset, n, buf, 0);
-            if (ret >= 0) {
-                ret = blk_co_pwrite(s->base, offset, n, buf, 0);
-                if (ret < 0) {
-                    error_in_source = false;
-                }
-            }
-        }
         if (ret < 0) {
             BlockErrorAction action =
-                block_job_error_action(&s->common, s->on_error,
-                                       error_in_source, -ret);
+                block_job_error_action(&s->common, s->on_error, true, -ret);
             if (action == BLOCK_ERROR_ACTION_REPORT) {
+                copy_window_co_free(cw);
                 return ret;
             } else {
                 n = 0;
                 continue;
             }
         }
-        /* Publish progress */
-        job_progress_update(&s->common.job, n);
-
         if (copy) {
+            copy_window_co_submit(cw, offset, n);
             delay_ns = block_job_ratelimit_get_delay(&s->common, n);
-        } else {
-            delay_ns = 0;
+        }
+
+        /* Publish progress.  Copied chunks are published when they complete,
+         * and a region that was rescanned after an error must not be counted
+         * a second time.
+         */
+        if (offset + n > counted) {
+            if (!copy) {
+                job_progress_update(&s->common.job,
+                                    offset + n - MAX(offset, counted));
+            }
+            counted = offset + n;
         }
     }
 
+    copy_window_co_free(cw);
+
     return 0;
 }
 
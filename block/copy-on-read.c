@@ -22,17 +22,59 @@
 
 #include "qemu/osdep.h"
 #include "block/block_int.h"
+#include "block/dirty-bitmap.h"
 #include "qemu/module.h"
 #include "qapi/error.h"
 #include "qapi/qmp/qdict.h"
 #include "block/copy-on-read.h"
 
 
+/* A region whose copy-on-read request is currently in flight */
+typedef struct CorInFlight {
+    int64_t offset;
+    int64_t bytes;
+    QLIST_ENTRY(CorInFlight) next;
+} CorInFlight;
+
 typedef struct BDRVStateCOR {
     BlockDriverState *bottom_bs;
     bool chain_frozen;
+
+    /*
+     * Optional bitmap on the file child tracking regions that have already
+     * been copied up.  When the bitmap is persistent, an interrupted
+     * warm-up resumes where it stopped instead of re-copying everything.
+     */
+    BdrvDirtyBitmap *progress_bitmap;
+
+    /* Regions with copy-on-read in flight, to dedupe concurrent COR work */
+    QLIST_HEAD(, CorInFlight) inflight;
+    CoQueue inflight_wait;
 } BDRVStateCOR;
 
+static bool cor_region_in_flight(BDRVStateCOR *state, int64_t offset,
+                                 int64_t bytes)
+{
+    CorInFlight *req;
+
+    QLIST_FOREACH(req, &state->inflight, next) {
+        if (offset < req->offset + req->bytes && req->offset < offset + bytes) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Return true if the whole region is known to have been copied up already */
+static bool cor_region_copied(BDRVStateCOR *state, int64_t offset,
+                              int64_t bytes)
+{
+    return state->progress_bitmap &&
+        bdrv_dirty_bitmap_next_zero(state->progress_bitmap, offset,
+                                    bytes) < 0;
+}
+
 
 static int cor_open(BlockDriverState *bs, QDict *options, int flags,
                     Error **errp)
@@ -41,6 +83,11 @@ static int cor_open(BlockDriverState *bs, QDict *options, int flags,
     BDRVStateCOR *state = bs->opaque;
     /* Find a bottom node name, if any */
     const char *bottom_node = qdict_get_try_str(options, "bottom");
+    /* Name of an optional progress bitmap on the file child */
+    const char *bitmap_name = qdict_get_try_str(options, "progress-bitmap");
+
+    QLIST_INIT(&state->inflight);
+    qemu_co_queue_init(&state->inflight_wait);
 
     bs->file = bdrv_open_child(NULL, options, "file", bs, &child_of_bds,
                                BDRV_CHILD_FILTERED | BDRV_CHILD_PRIMARY,
@@ -49,6 +96,25 @@ static int cor_open(BlockDriverState *bs, QDict *options, int flags,
         return -EINVAL;
     }
 
+    if (bitmap_name) {
+        BdrvDirtyBitmap *bitmap =
+            bdrv_find_dirty_bitmap(bs->file->bs, bitmap_name);
+
+        if (!bitmap) {
+            error_setg(errp, "Progress bitmap '%s' not found on node '%s'",
+                       bitmap_name, bs->file->bs->node_name);
+            qdict_del(options, "progress-bitmap");
+            return -EINVAL;
+        }
+        qdict_del(options, "progress-bitmap");
+
+        if (bdrv_dirty_bitmap_check(bitmap, BDRV_BITMAP_DEFAULT, errp)) {
+            return -EINVAL;
+        }
+        bdrv_dirty_bitmap_set_busy(bitmap, true);
+        state->progress_bitmap = bitmap;
+    }
+
     bs->supported_read_flags = BDRV_REQ_PREFETCH;
 
     bs->supported_write_flags = BDRV_REQ_WRITE_UNCHANGED |
@@ -139,11 +205,43 @@ static int coroutine_fn cor_co_preadv_part(BlockDriverState *bs,
     BDRVStateCOR *state = bs->opaque;
 
     if (!state->bottom_bs) {
+        bool do_cor = true;
+
+        if (state->progress_bitmap) {
+            while (cor_region_in_flight(state, offset, bytes)) {
+                /* Someone else is copying part of this region right now */
+                qemu_co_queue_wait(&state->inflight_wait, NULL);
+            }
+            do_cor = !cor_region_copied(state, offset, bytes);
+        }
+        if (!do_cor) {
+            /* Already copied up, don't pay for the allocation queries */
+            return bdrv_co_preadv_part(bs->file, offset, bytes, qiov,
+                                       qiov_offset, flags);
+        }
+
+        if (state->progress_bitmap) {
+            CorInFlight req = { .offset = offset, .bytes = bytes };
+
+            QLIST_INSERT_HEAD(&state->inflight, &req, next);
+            ret = bdrv_co_preadv_part(bs->file, offset, bytes, qiov,
+                                      qiov_offset,
+                                      flags | BDRV_REQ_COPY_ON_READ);
+            QLIST_REMOVE(&req, next);
+            qemu_co_queue_restart_all(&state->inflight_wait);
+            if (ret == 0) {
+                bdrv_set_dirty_bitmap(state->progress_bitmap, offset, bytes);
+            }
+            return ret;
+        }
+
         return bdrv_co_preadv_part(bs->file, offset, bytes, qiov, qiov_offset,
                                    flags | BDRV_REQ_COPY_ON_READ);
     }
 
     while (bytes) {
+        bool cor_this_chunk;
+
         local_flags = flags;
 
         /* In case of failure, try to copy-on-read anyway */
@@ -161,11 +259,35 @@ static int coroutine_fn cor_co_preadv_part(BlockDriverState *bs,
             }
         }
 
+        cor_this_chunk = local_flags & BDRV_REQ_COPY_ON_READ;
+        if (cor_this_chunk && cor_region_copied(state, offset, n)) {
+            /* Copied up in an earlier run, only the read is left to do */
+            local_flags &= ~BDRV_REQ_COPY_ON_READ;
+            cor_this_chunk = false;
+        }
+        if (cor_this_chunk && cor_region_in_flight(state, offset, n)) {
+            /* Someone else is copying this region, wait and re-check */
+            qemu_co_queue_wait(&state->inflight_wait, NULL);
+            continue;
+        }
+
         /* Skip if neither read nor write are needed */
         if ((local_flags & (BDRV_REQ_PREFETCH | BDRV_REQ_COPY_ON_READ)) !=
             BDRV_REQ_PREFETCH) {
+            CorInFlight req = { .offset = offset, .bytes = n };
+
+            if (cor_this_chunk) {
+                QLIST_INSERT_HEAD(&state->inflight, &req, next);
+            }
             ret = bdrv_co_preadv_part(bs->file, offset, n, qiov, qiov_offset,
                                       local_flags);
+            if (cor_this_chunk) {
+                QLIST_REMOVE(&req, next);
+                qemu_co_queue_restart_all(&state->inflight_wait);
+                if (ret == 0 && state->progress_bitmap) {
+                    bdrv_set_dirty_bitmap(state->progress_bitmap, offset, n);
+                }
+            }
             if (ret < 0) {
                 return ret;
             }
@@ -186,8 +308,17 @@ static int coroutine_fn cor_co_pwritev_part(BlockDriverState *bs,
                                             QEMUIOVector *qiov,
                                             size_t qiov_offset, int flags)
 {
-    return bdrv_co_pwritev_part(bs->file, offset, bytes, qiov, qiov_offset,
-                                flags);
+    BDRVStateCOR *state = bs->opaque;
+    int ret;
+
+    ret = bdrv_co_pwritev_part(bs->file, offset, bytes, qiov, qiov_offset,
+                               flags);
+    if (ret == 0 && state->progress_bitmap) {
+        /* Written data is authoritative, no need to ever copy it up */
+        bdrv_set_dirty_bitmap(state->progress_bitmap, offset, bytes);
+    }
+
+    return ret;
 }
 
 
@@ -216,6 +347,37 @@ static int coroutine_fn cor_co_pwritev_compressed(BlockDriverState *bs,
 }
 
 
+/*
+ * Forward copy offloading to the filtered child.  The data read is the
+ * same either way; only the copy-on-read side effect is skipped, which
+ * offloading callers (mirror/backup jobs) do not want anyway.
+ */
+static int coroutine_fn cor_co_copy_range_from(BlockDriverState *bs,
+                                               BdrvChild *src,
+                                               uint64_t src_offset,
+                                               BdrvChild *dst,
+                                               uint64_t dst_offset,
+                                               uint64_t bytes,
+                                               BdrvRequestFlags read_flags,
+                                               BdrvRequestFlags write_flags)
+{
+    return bdrv_co_copy_range_from(bs->file, src_offset, dst, dst_offset,
+                                   bytes, read_flags, write_flags);
+}
+
+static int coroutine_fn cor_co_copy_range_to(BlockDriverState *bs,
+                                             BdrvChild *src,
+                                             uint64_t src_offset,
+                                             BdrvChild *dst,
+                                             uint64_t dst_offset,
+                                             uint64_t bytes,
+                                             BdrvRequestFlags read_flags,
+                                             BdrvRequestFlags write_flags)
+{
+    return bdrv_co_copy_range_to(src, src_offset, bs->file, dst_offset,
+                                 bytes, read_flags, write_flags);
+}
+
 static void cor_eject(BlockDriverState *bs, bool eject_flag)
 {
     bdrv_eject(bs->file->bs, eject_flag);
@@ -232,6 +394,10 @@ static void cor_close(BlockDriverState *bs)
 {
     BDRVStateCOR *s = bs->opaque;
 
+    if (s->progress_bitmap) {
+        bdrv_dirty_bitmap_set_busy(s->progress_bitmap, false);
+    }
+
     if (s->chain_frozen) {
         s->chain_frozen = false;
         bdrv_unfreeze_backing_chain(bs, s->bottom_bs);
@@ -256,6 +422,8 @@ static BlockDriver bdrv_copy_on_read = {
     .bdrv_co_pwrite_zeroes              = cor_co_pwrite_zeroes,
     .bdrv_co_pdiscard                   = cor_co_pdiscard,
     .bdrv_co_pwritev_compressed         = cor_co_pwritev_compressed,
+    .bdrv_co_copy_range_from            = cor_co_copy_range_from,
+    .bdrv_co_copy_range_to              = cor_co_copy_range_to,
 
     .bdrv_eject                         = cor_eject,
     .bdrv_lock_medium                   = cor_lock_medium,
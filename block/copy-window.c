@@ -0,0 +1,165 @@
+/*
+ * Adaptive copy window for background block jobs
+ *
+ * Keeps several variable-size copies in flight for jobs that walk an image
+ * sequentially (stream, commit).  The chunk size grows while copies complete
+ * quickly and shrinks when they become slow, so that high-latency sources
+ * such as remote backing files are kept busy without hand tuning.
+ *
+ * Copyright (c) 2021 QEMU contributors
+ *
+ * This work is licensed under the terms of the GNU LGPL, version 2 or later.
+ * See the COPYING.LIB file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "trace.h"
+#include "qemu/timer.h"
+#include "block/copy-window.h"
+
+/* Bounds of the adaptive chunk size */
+#define COPY_WINDOW_CHUNK_MIN (512 * 1024)
+#define COPY_WINDOW_CHUNK_MAX (16 * 1024 * 1024)
+
+/* Number of copies kept in flight */
+#define COPY_WINDOW_MAX_WORKERS 8
+
+/*
+ * The chunk size is doubled while full-size chunks complete in less than
+ * half of this and halved when a chunk takes more than twice as long.
+ */
+#define COPY_WINDOW_TARGET_LATENCY_NS (100 * SCALE_MS)
+
+struct CopyWindow {
+    Job *job;
+    CopyWindowFunc func;
+    void *opaque;
+
+    int64_t chunk_size;         /* preferred size of the next chunk */
+    int in_flight;              /* copies currently running */
+    Coroutine *waiter;          /* job coroutine waiting for a slot or drain */
+
+    /* first error that has not been consumed yet */
+    int ret;
+    int64_t error_offset;
+    bool error_is_read;
+};
+
+typedef struct CopyWindowTask {
+    CopyWindow *cw;
+    int64_t offset;
+    int64_t bytes;
+} CopyWindowTask;
+
+CopyWindow *copy_window_new(Job *job, CopyWindowFunc func, void *opaque)
+{
+    CopyWindow *cw = g_new0(CopyWindow, 1);
+
+    cw->job = job;
+    cw->func = func;
+    cw->opaque = opaque;
+    cw->chunk_size = COPY_WINDOW_CHUNK_MIN;
+
+    return cw;
+}
+
+int64_t copy_window_chunk(CopyWindow *cw)
+{
+    return cw->chunk_size;
+}
+
+static void copy_window_worker(void *opaque)
+{
+    CopyWindowTask *task = opaque;
+    CopyWindow *cw = task->cw;
+    int64_t start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    int64_t elapsed_ns;
+    bool error_is_read = true;
+    int ret;
+
+    ret = cw->func(cw->opaque, task->offset, task->bytes, &error_is_read);
+    elapsed_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start_ns;
+
+    if (ret == 0) {
+        job_progress_update(cw->job, task->bytes);
+        if (elapsed_ns < COPY_WINDOW_TARGET_LATENCY_NS / 2 &&
+            task->bytes >= cw->chunk_size &&
+            cw->chunk_size < COPY_WINDOW_CHUNK_MAX) {
+            /* short tail chunks finish quickly, only grow on a full chunk */
+            cw->chunk_size *= 2;
+            trace_copy_window_resize(cw, cw->chunk_size);
+        } else if (elapsed_ns > COPY_WINDOW_TARGET_LATENCY_NS * 2 &&
+                   cw->chunk_size > COPY_WINDOW_CHUNK_MIN) {
+            cw->chunk_size /= 2;
+            trace_copy_window_resize(cw, cw->chunk_size);
+        }
+    } else if (cw->ret == 0) {
+        cw->ret = ret;
+        cw->error_offset = task->offset;
+        cw->error_is_read = error_is_read;
+    }
+
+    cw->in_flight--;
+    if (cw->waiter) {
+        qemu_coroutine_enter_if_inactive(cw->waiter);
+    }
+    g_free(task);
+}
+
+void coroutine_fn copy_window_co_submit(CopyWindow *cw, int64_t offset,
+                                        int64_t bytes)
+{
+    CopyWindowTask *task;
+    Coroutine *co;
+
+    while (cw->in_flight >= COPY_WINDOW_MAX_WORKERS) {
+        cw->waiter = qemu_coroutine_self();
+        qemu_coroutine_yield();
+        cw->waiter = NULL;
+    }
+
+    task = g_new(CopyWindowTask, 1);
+    task->cw = cw;
+    task->offset = offset;
+    task->bytes = bytes;
+
+    cw->in_flight++;
+    co = qemu_coroutine_create(copy_window_worker, task);
+    qemu_coroutine_enter(co);
+}
+
+int copy_window_error(CopyWindow *cw, int64_t *error_offset,
+                      bool *error_is_read)
+{
+    int ret = cw->ret;
+
+    if (ret < 0) {
+        if (error_offset) {
+            *error_offset = cw->error_offset;
+        }
+        if (error_is_read) {
+            *error_is_read = cw->error_is_read;
+        }
+        cw->ret = 0;
+    }
+
+    return ret;
+}
+
+int coroutine_fn copy_window_co_drain(CopyWindow *cw, int64_t *error_offset,
+                                      bool *error_is_read)
+{
+    while (cw->in_flight > 0) {
+        cw->waiter = qemu_coroutine_self();
+        qemu_coroutine_yield();
+        cw->waiter = NULL;
+    }
+
+    return copy_window_error(cw, error_offset, error_is_read);
+}
+
+void coroutine_fn copy_window_co_free(CopyWindow *cw)
+{
+    copy_window_co_drain(cw, NULL, NULL);
+    g_free(cw);
+}
@@ -22,6 +22,7 @@
 
 #include "block/block_int.h"
 #include "block/qdict.h"
+#include "block/thread-pool.h"
 #include "sysemu/block-backend.h"
 #include "crypto/block.h"
 #include "qapi/opts-visitor.h"
@@ -33,11 +34,18 @@
 #include "qemu/cutils.h"
 #include "crypto.h"
 
+#define BLOCK_CRYPTO_MAX_THREADS 4
+
 typedef struct BlockCrypto BlockCrypto;
 
 struct BlockCrypto {
     QCryptoBlock *block;
     bool updating_keys;
+
+    /* Gates the number of in-flight cipher jobs on the thread pool */
+    CoMutex lock;
+    CoQueue thread_task_queue;
+    int nb_threads;
 };
 
 
@@ -265,6 +273,9 @@ static int block_crypto_open_generic(QCryptoBlockFormat format,
     unsigned int cflags = 0;
     QDict *cryptoopts = NULL;
 
+    qemu_co_mutex_init(&crypto->lock);
+    qemu_co_queue_init(&crypto->thread_task_queue);
+
     bs->file = bdrv_open_child(NULL, options, "file", bs, &child_of_bds,
                                BDRV_CHILD_IMAGE, false, errp);
     if (!bs->file) {
@@ -294,7 +305,7 @@ static int block_crypto_open_generic(QCryptoBlockFormat format,
                                        block_crypto_read_func,
                                        bs,
                                        cflags,
-                                       1,
+                                       BLOCK_CRYPTO_MAX_THREADS,
                                        errp);
 
     if (!crypto->block) {
@@ -396,6 +407,82 @@ static int block_crypto_reopen_prepare(BDRVReopenState *state,
  */
 #define BLOCK_CRYPTO_MAX_IO_SIZE (1024 * 1024)
 
+/*
+ * Run the cipher work for one request on the AioContext thread pool, so
+ * that large sequential I/O does not serialize all XTS work on the
+ * thread running the coroutine.  Mirrors qcow2_co_process() in
+ * block/qcow2-threads.c; concurrent calls are safe because QCryptoBlock
+ * keeps a pool of cipher contexts and allocates one per request.
+ */
+static int coroutine_fn
+block_crypto_co_process(BlockDriverState *bs, ThreadPoolFunc *func, void *arg)
+{
+    int ret;
+    BlockCrypto *crypto = bs->opaque;
+    ThreadPool *pool = aio_get_thread_pool(bdrv_get_aio_context(bs));
+
+    qemu_co_mutex_lock(&crypto->lock);
+    while (crypto->nb_threads >= BLOCK_CRYPTO_MAX_THREADS) {
+        qemu_co_queue_wait(&crypto->thread_task_queue, &crypto->lock);
+    }
+    crypto->nb_threads++;
+    qemu_co_mutex_unlock(&crypto->lock);
+
+    ret = thread_pool_submit_co(pool, func, arg);
+
+    qemu_co_mutex_lock(&crypto->lock);
+    crypto->nb_threads--;
+    qemu_co_queue_next(&crypto->thread_task_queue);
+    qemu_co_mutex_unlock(&crypto->lock);
+
+    return ret;
+}
+
+/*
+ * BlockCryptoEncDecFunc: common prototype of qcrypto_block_encrypt() and
+ * qcrypto_block_decrypt() functions.
+ */
+typedef int (*BlockCryptoEncDecFunc)(QCryptoBlock *block, uint64_t offset,
+                                     uint8_t *buf, size_t len, Error **errp);
+
+typedef struct BlockCryptoEncDecData {
+    QCryptoBlock *block;
+    uint64_t offset;
+    uint8_t *buf;
+    size_t len;
+
+    BlockCryptoEncDecFunc func;
+} BlockCryptoEncDecData;
+
+static int block_crypto_encdec_pool_func(void *opaque)
+{
+    BlockCryptoEncDecData *data = opaque;
+
+    return data->func(data->block, data->offset, data->buf, data->len, NULL);
+}
+
+static int coroutine_fn
+block_crypto_co_encdec(BlockDriverState *bs, uint64_t offset,
+                       uint8_t *buf, size_t len, BlockCryptoEncDecFunc func)
+{
+    BlockCrypto *crypto = bs->opaque;
+    BlockCryptoEncDecData arg = {
+        .block = crypto->block,
+        .offset = offset,
+        .buf = buf,
+        .len = len,
+        .func = func,
+    };
+
+    assert(QEMU_IS_ALIGNED(offset,
+                           qcrypto_block_get_sector_size(crypto->block)));
+    assert(QEMU_IS_ALIGNED(len,
+                           qcrypto_block_get_sector_size(crypto->block)));
+
+    return len == 0 ? 0 : block_crypto_co_process(
+        bs, block_crypto_encdec_pool_func, &arg);
+}
+
 static coroutine_fn int
 block_crypto_co_preadv(BlockDriverState *bs, uint64_t offset, uint64_t bytes,
                        QEMUIOVector *qiov, int flags)
@@ -439,8 +526,8 @@ block_crypto_co_preadv(BlockDriverState *bs, uint64_t offset, uint64_t bytes,
             goto cleanup;
         }
 
-        if (qcrypto_block_decrypt(crypto->block, offset + bytes_done,
-                                  cipher_data, cur_bytes, NULL) < 0) {
+        if (block_crypto_co_encdec(bs, offset + bytes_done, cipher_data,
+                                   cur_bytes, qcrypto_block_decrypt) < 0) {
             ret = -EIO;
             goto cleanup;
         }
@@ -495,8 +582,8 @@ block_crypto_co_pwritev(BlockDriverState *bs, uint64_t offset, uint64_t bytes,
 
         qemu_iovec_to_buf(qiov, bytes_done, cipher_data, cur_bytes);
 
-        if (qcrypto_block_encrypt(crypto->block, offset + bytes_done,
-                                  cipher_data, cur_bytes, NULL) < 0) {
+        if (block_crypto_co_encdec(bs, offset + bytes_done, cipher_data,
+                                   cur_bytes, qcrypto_block_encrypt) < 0) {
             ret = -EIO;
             goto cleanup;
         }
@@ -59,6 +59,9 @@
 #define CURL_BLOCK_OPT_SSLVERIFY_DEFAULT true
 #define CURL_BLOCK_OPT_TIMEOUT_DEFAULT 5
 
+/* Upper bound for the window the sequential readahead ramp can reach */
+#define CURL_MAX_READAHEAD (4 * 1024 * 1024)
+
 struct BDRVCURLState;
 struct CURLState;
 
@@ -93,6 +96,7 @@ typedef struct CURLState
     char range[128];
     char errmsg[CURL_ERROR_SIZE];
     char in_use;
+    int64_t fetch_start_ns;
 } CURLState;
 
 typedef struct BDRVCURLState {
@@ -103,6 +107,9 @@ typedef struct BDRVCURLState {
     GHashTable *sockets; /* GINT_TO_POINTER(fd) -> socket */
     char *url;
     size_t readahead_size;
+    /* sequential stream detection, protected by mutex */
+    size_t seq_readahead;
+    uint64_t seq_expect;
     bool sslverify;
     uint64_t timeout;
     char *cookie;
@@ -342,6 +349,12 @@ static void curl_multi_check_completion(BDRVCURLState *s)
             curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE,
                               (char **)&state);
 
+            trace_curl_request_done(state->buf_start,
+                                    (uint64_t)state->buf_len,
+                                    (qemu_clock_get_ns(QEMU_CLOCK_REALTIME) -
+                                     state->fetch_start_ns) / SCALE_US,
+                                    (int)error);
+
             if (error) {
                 static int errcount = 100;
 
@@ -502,6 +515,20 @@ static int curl_init_state(BDRVCURLState *s, CURLState *state)
         curl_easy_setopt(state->curl, CURLOPT_REDIR_PROTOCOLS, PROTOCOLS);
 #endif
 
+        /* Prefer HTTP/2 where the server offers it: the parallel range
+         * requests then multiplex over a single TLS connection instead
+         * of opening one connection per easy handle.  PIPEWAIT makes a
+         * new transfer wait for an existing connection rather than
+         * racing it with a fresh one.
+         */
+#if LIBCURL_VERSION_NUM >= 0x072f00
+        curl_easy_setopt(state->curl, CURLOPT_HTTP_VERSION,
+                         CURL_HTTP_VERSION_2TLS);
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072b00
+        curl_easy_setopt(state->curl, CURLOPT_PIPEWAIT, 1L);
+#endif
+
 #ifdef DEBUG_VERBOSE
         curl_easy_setopt(state->curl, CURLOPT_VERBOSE, 1);
 #endif
@@ -576,6 +603,9 @@ static void curl_attach_aio_context(BlockDriverState *bs,
     curl_multi_setopt(s->multi, CURLMOPT_SOCKETFUNCTION, curl_sock_cb);
     curl_multi_setopt(s->multi, CURLMOPT_TIMERDATA, s);
     curl_multi_setopt(s->multi, CURLMOPT_TIMERFUNCTION, curl_timer_cb);
+#if LIBCURL_VERSION_NUM >= 0x072b00
+    curl_multi_setopt(s->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
 }
 
 static QemuOptsList runtime_opts = {
@@ -679,6 +709,7 @@ static int curl_open(BlockDriverState *bs, QDict *options, int flags,
                    s->readahead_size);
         goto out_noclean;
     }
+    s->seq_readahead = s->readahead_size;
 
     s->timeout = qemu_opt_get_number(opts, CURL_BLOCK_OPT_TIMEOUT,
                                      CURL_BLOCK_OPT_TIMEOUT_DEFAULT);
@@ -863,10 +894,22 @@ static void curl_setup_preadv(BlockDriverState *bs, CURLAIOCB *acb)
     acb->start = 0;
     acb->end = MIN(acb->bytes, s->len - start);
 
+    /*
+     * Ramp up the readahead window while the guest streams sequentially
+     * (the request starts at or straddles the end of the previously
+     * fetched window); drop back to the configured size on a seek.
+     */
+    if (start <= s->seq_expect && start + acb->bytes > s->seq_expect) {
+        s->seq_readahead = MIN(s->seq_readahead * 2, CURL_MAX_READAHEAD);
+    } else {
+        s->seq_readahead = s->readahead_size;
+    }
+
     state->buf_off = 0;
     g_free(state->orig_buf);
     state->buf_start = start;
-    state->buf_len = MIN(acb->end + s->readahead_size, s->len - start);
+    state->buf_len = MIN(acb->end + s->seq_readahead, s->len - start);
+    s->seq_expect = start + state->buf_len;
     end = start + state->buf_len - 1;
     state->orig_buf = g_try_malloc(state->buf_len);
     if (state->buf_len && state->orig_buf == NULL) {
@@ -879,6 +922,7 @@ static void curl_setup_preadv(BlockDriverState *bs, CURLAIOCB *acb)
     snprintf(state->range, 127, "%" PRIu64 "-%" PRIu64, start, end);
     trace_curl_setup_preadv(acb->bytes, start, state->range);
     curl_easy_setopt(state->curl, CURLOPT_RANGE, state->range);
+    state->fetch_start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
 
     if (curl_multi_add_handle(s->multi, state->curl) != CURLM_OK) {
         state->acb[0] = NULL;
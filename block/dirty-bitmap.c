@@ -51,6 +51,10 @@ struct BdrvDirtyBitmap {
     bool skip_store;            /* We are either migrating or deleting this
                                  * bitmap; it should not be stored on the next
                                  * inactivation. */
+    bool modified;              /* Content changed since the bitmap was loaded
+                                 * from or last stored to the image. Lets the
+                                 * format driver skip rewriting unchanged
+                                 * bitmaps. */
     QLIST_ENTRY(BdrvDirtyBitmap) list;
 };
 
@@ -314,6 +318,7 @@ BdrvDirtyBitmap *bdrv_reclaim_dirty_bitmap_locked(BdrvDirtyBitmap *parent,
         return NULL;
     }
 
+    parent->modified = true;
     parent->disabled = successor->disabled;
     parent->busy = false;
     bdrv_release_dirty_bitmap_locked(successor);
@@ -349,6 +354,7 @@ void bdrv_dirty_bitmap_truncate(BlockDriverState *bs, int64_t bytes)
         assert(!bdrv_dirty_bitmap_has_successor(bitmap));
         assert(!bitmap->active_iterators);
         hbitmap_truncate(bitmap->bitmap, bytes);
+        bitmap->modified = true;
         bitmap->size = bytes;
     }
     bdrv_dirty_bitmaps_unlock(bs);
@@ -627,6 +633,7 @@ void bdrv_set_dirty_bitmap_locked(BdrvDirtyBitmap *bitmap,
                                   int64_t offset, int64_t bytes)
 {
     assert(!bdrv_dirty_bitmap_readonly(bitmap));
+    bitmap->modified = true;
     hbitmap_set(bitmap->bitmap, offset, bytes);
 }
 
@@ -643,6 +650,7 @@ void bdrv_reset_dirty_bitmap_locked(BdrvDirtyBitmap *bitmap,
                                     int64_t offset, int64_t bytes)
 {
     assert(!bdrv_dirty_bitmap_readonly(bitmap));
+    bitmap->modified = true;
     hbitmap_reset(bitmap->bitmap, offset, bytes);
 }
 
@@ -658,6 +666,7 @@ void bdrv_clear_dirty_bitmap(BdrvDirtyBitmap *bitmap, HBitmap **out)
 {
     assert(!bdrv_dirty_bitmap_readonly(bitmap));
     bdrv_dirty_bitmaps_lock(bitmap->bs);
+    bitmap->modified = true;
     if (!out) {
         hbitmap_reset_all(bitmap->bitmap);
     } else {
@@ -673,6 +682,7 @@ void bdrv_restore_dirty_bitmap(BdrvDirtyBitmap *bitmap, HBitmap *backup)
 {
     HBitmap *tmp = bitmap->bitmap;
     assert(!bdrv_dirty_bitmap_readonly(bitmap));
+    bitmap->modified = true;
     bitmap->bitmap = backup;
     hbitmap_free(tmp);
 }
@@ -712,6 +722,7 @@ void bdrv_dirty_bitmap_deserialize_part(BdrvDirtyBitmap *bitmap,
                                         uint8_t *buf, uint64_t offset,
                                         uint64_t bytes, bool finish)
 {
+    bitmap->modified = true;
     hbitmap_deserialize_part(bitmap->bitmap, buf, offset, bytes, finish);
 }
 
@@ -719,6 +730,7 @@ void bdrv_dirty_bitmap_deserialize_zeroes(BdrvDirtyBitmap *bitmap,
                                           uint64_t offset, uint64_t bytes,
                                           bool finish)
 {
+    bitmap->modified = true;
     hbitmap_deserialize_zeroes(bitmap->bitmap, offset, bytes, finish);
 }
 
@@ -726,6 +738,7 @@ void bdrv_dirty_bitmap_deserialize_ones(BdrvDirtyBitmap *bitmap,
                                         uint64_t offset, uint64_t bytes,
                                         bool finish)
 {
+    bitmap->modified = true;
     hbitmap_deserialize_ones(bitmap->bitmap, offset, bytes, finish);
 }
 
@@ -748,6 +761,7 @@ void bdrv_set_dirty(BlockDriverState *bs, int64_t offset, int64_t bytes)
             continue;
         }
         assert(!bdrv_dirty_bitmap_readonly(bitmap));
+        bitmap->modified = true;
         hbitmap_set(bitmap->bitmap, offset, bytes);
     }
     bdrv_dirty_bitmaps_unlock(bs);
@@ -835,6 +849,19 @@ bool bdrv_dirty_bitmap_get_persistence(BdrvDirtyBitmap *bitmap)
     return bitmap->persistent && !bitmap->skip_store;
 }
 
+/* Called with BQL taken. */
+void bdrv_dirty_bitmap_set_modified(BdrvDirtyBitmap *bitmap, bool modified)
+{
+    bdrv_dirty_bitmaps_lock(bitmap->bs);
+    bitmap->modified = modified;
+    bdrv_dirty_bitmaps_unlock(bitmap->bs);
+}
+
+bool bdrv_dirty_bitmap_modified(const BdrvDirtyBitmap *bitmap)
+{
+    return bitmap->modified;
+}
+
 bool bdrv_dirty_bitmap_inconsistent(const BdrvDirtyBitmap *bitmap)
 {
     return bitmap->inconsistent;
@@ -875,6 +902,12 @@ bool bdrv_dirty_bitmap_next_dirty_area(BdrvDirtyBitmap *bitmap,
                                    dirty_start, dirty_count);
 }
 
+unsigned bdrv_dirty_bitmap_next_dirty_runs(BdrvDirtyBitmap *bitmap,
+        int64_t start, int64_t end, HBitmapRun *runs, unsigned max_runs)
+{
+    return hbitmap_next_dirty_runs(bitmap->bitmap, start, end, runs, max_runs);
+}
+
 /**
  * bdrv_merge_dirty_bitmap: merge src into dest.
  * Ensures permissions on bitmaps are reasonable; use for public API.
@@ -933,6 +966,8 @@ bool bdrv_dirty_bitmap_merge_internal(BdrvDirtyBitmap *dest,
     assert(!bdrv_dirty_bitmap_inconsistent(dest));
     assert(!bdrv_dirty_bitmap_inconsistent(src));
 
+    dest->modified = true;
+
     if (lock) {
         bdrv_dirty_bitmaps_lock(dest->bs);
         if (src->bs != dest->bs) {
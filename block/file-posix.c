@@ -2183,6 +2183,12 @@ static void raw_close(BlockDriverState *bs)
     BDRVRawState *s = bs->opaque;
 
     if (s->fd >= 0) {
+#ifdef CONFIG_LINUX_IO_URING
+        if (s->use_linux_io_uring) {
+            LuringState *aio = aio_get_linux_io_uring(bdrv_get_aio_context(bs));
+            luring_fd_unregister(aio, s->fd);
+        }
+#endif
         qemu_close(s->fd);
         s->fd = -1;
     }
@@ -465,6 +465,24 @@ static BlockAIOCB *raw_aio_pwritev(BlockDriverState *bs,
     }
 }
 
+static void raw_aio_plug(BlockDriverState *bs)
+{
+    BDRVRawState *s = bs->opaque;
+
+    if (s->aio) {
+        win32_aio_io_plug(s->aio);
+    }
+}
+
+static void raw_aio_unplug(BlockDriverState *bs)
+{
+    BDRVRawState *s = bs->opaque;
+
+    if (s->aio) {
+        win32_aio_io_unplug(s->aio);
+    }
+}
+
 static BlockAIOCB *raw_aio_flush(BlockDriverState *bs,
                          BlockCompletionFunc *cb, void *opaque)
 {
@@ -662,6 +680,8 @@ BlockDriver bdrv_file = {
     .bdrv_aio_preadv    = raw_aio_preadv,
     .bdrv_aio_pwritev   = raw_aio_pwritev,
     .bdrv_aio_flush     = raw_aio_flush,
+    .bdrv_io_plug       = raw_aio_plug,
+    .bdrv_io_unplug     = raw_aio_unplug,
 
     .bdrv_co_truncate   = raw_co_truncate,
     .bdrv_getlength	= raw_getlength,
@@ -829,6 +849,8 @@ static BlockDriver bdrv_host_device = {
     .bdrv_aio_preadv    = raw_aio_preadv,
     .bdrv_aio_pwritev   = raw_aio_pwritev,
     .bdrv_aio_flush     = raw_aio_flush,
+    .bdrv_io_plug       = raw_aio_plug,
+    .bdrv_io_unplug     = raw_aio_unplug,
 
     .bdrv_detach_aio_context = raw_detach_aio_context,
     .bdrv_attach_aio_context = raw_attach_aio_context,
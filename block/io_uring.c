@@ -13,15 +13,26 @@
 #include "qemu-common.h"
 #include "block/aio.h"
 #include "qemu/queue.h"
+#include "qemu/units.h"
 #include "block/block.h"
 #include "block/raw-aio.h"
 #include "qemu/coroutine.h"
+#include "exec/cpu-common.h"
 #include "qapi/error.h"
 #include "trace.h"
 
 /* io_uring ring size */
 #define MAX_ENTRIES 128
 
+/*
+ * Maximum number of registered buffers and file descriptors.  The kernel
+ * caps a single registered buffer at 1 GiB, so guest RAM blocks are carved
+ * into 1 GiB chunks; 64 chunks cover 64 GiB of guest RAM.
+ */
+#define MAX_REG_BUFFERS 64
+#define MAX_REG_FILES 64
+#define REG_BUF_CHUNK (1 * GiB)
+
 typedef struct LuringAIOCB {
     Coroutine *co;
     struct io_uring_sqe sqeq;
@@ -56,8 +67,158 @@ typedef struct LuringState {
 
     /* I/O completion processing.  Only runs in I/O thread.  */
     QEMUBH *completion_bh;
+
+    /*
+     * Guest RAM chunks registered with the kernel, in buf_index order.
+     * Empty when registration failed or no RAM blocks existed when the
+     * ring was created.
+     */
+    struct iovec reg_bufs[MAX_REG_BUFFERS];
+    unsigned n_reg_bufs;
+
+    /* Registered fds, index == fixed file slot; -1 marks a free slot. */
+    int reg_fds[MAX_REG_FILES];
+    bool fixed_files;
 } LuringState;
 
+static int luring_add_ram_block(RAMBlock *rb, void *opaque)
+{
+    LuringState *s = opaque;
+    uint8_t *host = qemu_ram_get_host_addr(rb);
+    ram_addr_t len = qemu_ram_get_used_length(rb);
+
+    while (len && s->n_reg_bufs < MAX_REG_BUFFERS) {
+        size_t chunk = MIN(len, REG_BUF_CHUNK);
+
+        s->reg_bufs[s->n_reg_bufs++] = (struct iovec) {
+            .iov_base = host,
+            .iov_len = chunk,
+        };
+        host += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+/**
+ * luring_register_buffers:
+ *
+ * Register guest RAM with the kernel so that the hot path can use
+ * READ_FIXED/WRITE_FIXED and skip the per-request page mapping work.
+ * Best effort: registration fails on kernels without support or when
+ * RLIMIT_MEMLOCK does not cover guest RAM, and RAM blocks hotplugged
+ * after the ring was created are not covered.  Requests that are not
+ * backed by a registered chunk fall back to READV/WRITEV.
+ */
+static void luring_register_buffers(LuringState *s)
+{
+    int rc;
+
+    qemu_ram_foreach_block(luring_add_ram_block, s);
+    if (s->n_reg_bufs == 0) {
+        return;
+    }
+    rc = io_uring_register_buffers(&s->ring, s->reg_bufs, s->n_reg_bufs);
+    trace_luring_register_buffers(s, s->n_reg_bufs, rc);
+    if (rc < 0) {
+        s->n_reg_bufs = 0;
+    }
+}
+
+/**
+ * luring_register_files:
+ *
+ * Register a sparse fixed file table; slots are filled lazily by
+ * luring_fixed_fd() as file descriptors are first submitted.
+ */
+static void luring_register_files(LuringState *s)
+{
+    int i, rc;
+
+    for (i = 0; i < MAX_REG_FILES; i++) {
+        s->reg_fds[i] = -1;
+    }
+    rc = io_uring_register_files(&s->ring, s->reg_fds, MAX_REG_FILES);
+    trace_luring_register_files(s, rc);
+    s->fixed_files = rc == 0;
+}
+
+/**
+ * luring_fixed_fd:
+ *
+ * Return the fixed file slot of @fd, registering it on first use, or -1
+ * when fixed files are unavailable or the table is full.
+ */
+static int luring_fixed_fd(LuringState *s, int fd)
+{
+    int i;
+
+    if (!s->fixed_files) {
+        return -1;
+    }
+    for (i = 0; i < MAX_REG_FILES; i++) {
+        if (s->reg_fds[i] == fd) {
+            return i;
+        }
+        if (s->reg_fds[i] == -1) {
+            int rc;
+
+            s->reg_fds[i] = fd;
+            rc = io_uring_register_files_update(&s->ring, i,
+                                                &s->reg_fds[i], 1);
+            if (rc < 0) {
+                s->reg_fds[i] = -1;
+                return -1;
+            }
+            return i;
+        }
+    }
+    return -1;
+}
+
+void luring_fd_unregister(LuringState *s, int fd)
+{
+    int i;
+
+    if (!s->fixed_files) {
+        return;
+    }
+    for (i = 0; i < MAX_REG_FILES; i++) {
+        if (s->reg_fds[i] == fd) {
+            s->reg_fds[i] = -1;
+            io_uring_register_files_update(&s->ring, i, &s->reg_fds[i], 1);
+            return;
+        }
+    }
+}
+
+/**
+ * luring_fixed_buf_index:
+ *
+ * Return the registered buffer index covering the request, or -1 when
+ * the request must fall back to an iovec.  Only single-segment requests
+ * entirely within one registered chunk qualify.
+ */
+static int luring_fixed_buf_index(LuringState *s, QEMUIOVector *qiov)
+{
+    uintptr_t base;
+    unsigned i;
+
+    if (qiov->niov != 1) {
+        return -1;
+    }
+    base = (uintptr_t)qiov->iov[0].iov_base;
+    for (i = 0; i < s->n_reg_bufs; i++) {
+        uintptr_t start = (uintptr_t)s->reg_bufs[i].iov_base;
+
+        if (base >= start &&
+            base + qiov->iov[0].iov_len <= start + s->reg_bufs[i].iov_len) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 /**
  * luring_resubmit:
  *
@@ -92,6 +253,15 @@ static void luring_resubmit_short_read(LuringState *s, LuringAIOCB *luringcb,
     luringcb->total_read = nread;
     remaining = luringcb->qiov->size - luringcb->total_read;
 
+    if (luringcb->sqeq.opcode == IORING_OP_READ_FIXED) {
+        /* The remainder stays within the registered chunk; advance in place */
+        luringcb->sqeq.off += nread;
+        luringcb->sqeq.addr += nread;
+        luringcb->sqeq.len = remaining;
+        luring_resubmit(s, luringcb);
+        return;
+    }
+
     /* Shorten qiov */
     resubmit_qiov = &luringcb->resubmit_qiov;
     if (resubmit_qiov->iov == NULL) {
@@ -342,15 +512,37 @@ static int luring_do_submit(int fd, LuringAIOCB *luringcb, LuringState *s,
 {
     int ret;
     struct io_uring_sqe *sqes = &luringcb->sqeq;
+    int fixed_fd = luring_fixed_fd(s, fd);
+    int buf_index;
+
+    if (fixed_fd >= 0) {
+        fd = fixed_fd;
+    }
 
     switch (type) {
     case QEMU_AIO_WRITE:
-        io_uring_prep_writev(sqes, fd, luringcb->qiov->iov,
-                             luringcb->qiov->niov, offset);
+        buf_index = luring_fixed_buf_index(s, luringcb->qiov);
+        if (buf_index >= 0) {
+            io_uring_prep_write_fixed(sqes, fd,
+                                      luringcb->qiov->iov[0].iov_base,
+                                      luringcb->qiov->iov[0].iov_len,
+                                      offset, buf_index);
+        } else {
+            io_uring_prep_writev(sqes, fd, luringcb->qiov->iov,
+                                 luringcb->qiov->niov, offset);
+        }
         break;
     case QEMU_AIO_READ:
-        io_uring_prep_readv(sqes, fd, luringcb->qiov->iov,
-                            luringcb->qiov->niov, offset);
+        buf_index = luring_fixed_buf_index(s, luringcb->qiov);
+        if (buf_index >= 0) {
+            io_uring_prep_read_fixed(sqes, fd,
+                                     luringcb->qiov->iov[0].iov_base,
+                                     luringcb->qiov->iov[0].iov_len,
+                                     offset, buf_index);
+        } else {
+            io_uring_prep_readv(sqes, fd, luringcb->qiov->iov,
+                                luringcb->qiov->niov, offset);
+        }
         break;
     case QEMU_AIO_FLUSH:
         io_uring_prep_fsync(sqes, fd, IORING_FSYNC_DATASYNC);
@@ -360,6 +552,9 @@ static int luring_do_submit(int fd, LuringAIOCB *luringcb, LuringState *s,
                         __func__, type);
         abort();
     }
+    if (fixed_fd >= 0) {
+        io_uring_sqe_set_flags(sqes, IOSQE_FIXED_FILE);
+    }
     io_uring_sqe_set_data(sqes, luringcb);
 
     QSIMPLEQ_INSERT_TAIL(&s->io_q.submit_queue, luringcb, next);
@@ -432,6 +627,8 @@ LuringState *luring_init(Error **errp)
     }
 
     ioq_init(&s->io_q);
+    luring_register_buffers(s);
+    luring_register_files(s);
     return s;
 
 }
@@ -587,11 +587,35 @@ static inline bool iscsi_allocmap_is_valid(IscsiLun *iscsilun,
                                offset / iscsilun->cluster_size) == size);
 }
 
+/*
+ * Called with QemuMutex held, but not from within iscsi_service() (libiscsi
+ * is not re-entrant).  Push any queued PDUs to the socket right away
+ * instead of waiting for the event loop to notice the fd became writable;
+ * commands queued by several coroutines in one iteration go out in one
+ * burst, and the common case saves a full event loop round trip per
+ * command.
+ */
+static void iscsi_kick_writes(IscsiLun *iscsilun)
+{
+    if (iscsi_which_events(iscsilun->iscsi) & POLLOUT) {
+        iscsi_service(iscsilun->iscsi, POLLOUT);
+    }
+    iscsi_set_events(iscsilun);
+}
+
 static void coroutine_fn iscsi_co_wait_for_task(IscsiTask *iTask,
                                                 IscsiLun *iscsilun)
 {
+    bool first = true;
+
     while (!iTask->complete) {
-        iscsi_set_events(iscsilun);
+        if (first) {
+            /* flush the freshly queued command */
+            iscsi_kick_writes(iscsilun);
+            first = false;
+        } else {
+            iscsi_set_events(iscsilun);
+        }
         qemu_mutex_unlock(&iscsilun->mutex);
         qemu_coroutine_yield();
         qemu_mutex_lock(&iscsilun->mutex);
@@ -1120,7 +1144,7 @@ static BlockAIOCB *iscsi_aio_ioctl(BlockDriverState *bs,
         }
     }
 
-    iscsi_set_events(iscsilun);
+    iscsi_kick_writes(iscsilun);
     qemu_mutex_unlock(&iscsilun->mutex);
 
     return &acb->common;
@@ -54,6 +54,9 @@ typedef struct MirrorBlockJob {
     BlockMirrorBackingMode backing_mode;
     /* Whether the target image requires explicit zero-initialization */
     bool zero_target;
+    /* The dirty bitmap driving sync=bitmap mode, NULL otherwise */
+    BdrvDirtyBitmap *sync_bitmap;
+    BitmapSyncMode bitmap_mode;
     MirrorCopyMode copy_mode;
     BlockdevOnError on_source_error, on_target_error;
     bool synced;
@@ -633,6 +636,34 @@ static void coroutine_fn mirror_wait_for_all_io(MirrorBlockJob *s)
     }
 }
 
+static void mirror_cleanup_sync_bitmap(MirrorBlockJob *s, int ret)
+{
+    BdrvDirtyBitmap *bm;
+    bool sync = (((ret == 0) || (s->bitmap_mode == BITMAP_SYNC_MODE_ALWAYS)) \
+                 && (s->bitmap_mode != BITMAP_SYNC_MODE_NEVER));
+
+    if (sync) {
+        /*
+         * We succeeded, or we always intended to sync the bitmap.
+         * Delete this bitmap and install the child.
+         */
+        bm = bdrv_dirty_bitmap_abdicate(s->sync_bitmap, NULL);
+    } else {
+        /*
+         * We failed, or we never intended to sync the bitmap anyway.
+         * Merge the successor back into the parent, keeping all data.
+         */
+        bm = bdrv_reclaim_dirty_bitmap(s->sync_bitmap, NULL);
+    }
+
+    assert(bm);
+
+    if (ret < 0 && s->bitmap_mode == BITMAP_SYNC_MODE_ALWAYS) {
+        /* If we failed and synced, merge in the bits we didn't copy: */
+        bdrv_dirty_bitmap_merge_internal(bm, s->dirty_bitmap, NULL, true);
+    }
+}
+
 /**
  * mirror_exit_common: handle both abort() and prepare() cases.
  * for .prepare, returns 0 on success and -errno on failure.
@@ -665,6 +696,9 @@ static int mirror_exit_common(Job *job)
         bdrv_unfreeze_backing_chain(mirror_top_bs, target_bs);
     }
 
+    if (s->sync_bitmap) {
+        mirror_cleanup_sync_bitmap(s, job->ret);
+    }
     bdrv_release_dirty_bitmap(s->dirty_bitmap);
 
     /* Make sure that the source BDS doesn't go away during bdrv_replace_node,
@@ -815,6 +849,18 @@ static int coroutine_fn mirror_dirty_init(MirrorBlockJob *s)
     int ret;
     int64_t count;
 
+    if (s->sync_bitmap) {
+        /*
+         * Only the extents recorded in the user's bitmap need copying;
+         * merging its (frozen) contents replaces the whole-device
+         * allocation scan below.  Writes racing with the job go to the
+         * bitmap's successor and are picked up by the active layer.
+         */
+        bdrv_dirty_bitmap_merge_internal(s->dirty_bitmap, s->sync_bitmap,
+                                         NULL, true);
+        return 0;
+    }
+
     if (s->zero_target) {
         if (!bdrv_can_write_zeroes_with_unmap(target_bs)) {
             bdrv_set_dirty_bitmap(s->dirty_bitmap, 0, s->bdev_length);
@@ -1581,6 +1627,8 @@ static BlockJob *mirror_start_job(
                              uint32_t granularity, int64_t buf_size,
                              BlockMirrorBackingMode backing_mode,
                              bool zero_target,
+                             BdrvDirtyBitmap *sync_bitmap,
+                             BitmapSyncMode bitmap_mode,
                              BlockdevOnError on_source_error,
                              BlockdevOnError on_target_error,
                              bool unmap,
@@ -1600,11 +1648,20 @@ static BlockJob *mirror_start_job(
     int ret;
 
     if (granularity == 0) {
-        granularity = bdrv_get_default_bitmap_granularity(target);
+        granularity = sync_bitmap ? bdrv_dirty_bitmap_granularity(sync_bitmap)
+                                  : bdrv_get_default_bitmap_granularity(target);
     }
 
     assert(is_power_of_2(granularity));
 
+    if (sync_bitmap) {
+        /* If we need to write to this bitmap, check that we can: */
+        if (bitmap_mode != BITMAP_SYNC_MODE_NEVER &&
+            bdrv_dirty_bitmap_check(sync_bitmap, BDRV_BITMAP_DEFAULT, errp)) {
+            return NULL;
+        }
+    }
+
     if (buf_size < 0) {
         error_setg(errp, "Invalid parameter 'buf-size'");
         return NULL;
@@ -1753,6 +1810,15 @@ static BlockJob *mirror_start_job(
         s->should_complete = true;
     }
 
+    if (sync_bitmap) {
+        /* Freeze the bitmap; writes during the job go to its successor */
+        if (bdrv_dirty_bitmap_create_successor(sync_bitmap, errp) < 0) {
+            goto fail;
+        }
+        s->sync_bitmap = sync_bitmap;
+        s->bitmap_mode = bitmap_mode;
+    }
+
     s->dirty_bitmap = bdrv_create_dirty_bitmap(bs, granularity, NULL, errp);
     if (!s->dirty_bitmap) {
         goto fail;
@@ -1838,6 +1904,9 @@ fail:
         if (s->dirty_bitmap) {
             bdrv_release_dirty_bitmap(s->dirty_bitmap);
         }
+        if (s->sync_bitmap) {
+            bdrv_reclaim_dirty_bitmap(s->sync_bitmap, NULL);
+        }
         job_early_fail(&s->common.job);
     }
 
@@ -1857,6 +1926,7 @@ void mirror_start(const char *job_id, BlockDriverState *bs,
                   uint32_t granularity, int64_t buf_size,
                   MirrorSyncMode mode, BlockMirrorBackingMode backing_mode,
                   bool zero_target,
+                  BdrvDirtyBitmap *bitmap, BitmapSyncMode bitmap_mode,
                   BlockdevOnError on_source_error,
                   BlockdevOnError on_target_error,
                   bool unmap, const char *filter_node_name,
@@ -1865,16 +1935,21 @@ void mirror_start(const char *job_id, BlockDriverState *bs,
     bool is_none_mode;
     BlockDriverState *base;
 
-    if ((mode == MIRROR_SYNC_MODE_INCREMENTAL) ||
-        (mode == MIRROR_SYNC_MODE_BITMAP)) {
+    if (mode == MIRROR_SYNC_MODE_INCREMENTAL) {
         error_setg(errp, "Sync mode '%s' not supported",
                    MirrorSyncMode_str(mode));
         return;
     }
+    if ((mode == MIRROR_SYNC_MODE_BITMAP) != (bitmap != NULL)) {
+        error_setg(errp, "Sync mode '%s' requires a dirty bitmap and vice "
+                   "versa", MirrorSyncMode_str(mode));
+        return;
+    }
     is_none_mode = mode == MIRROR_SYNC_MODE_NONE;
     base = mode == MIRROR_SYNC_MODE_TOP ? bdrv_backing_chain_next(bs) : NULL;
     mirror_start_job(job_id, bs, creation_flags, target, replaces,
                      speed, granularity, buf_size, backing_mode, zero_target,
+                     bitmap, bitmap_mode,
                      on_source_error, on_target_error, unmap, NULL, NULL,
                      &mirror_job_driver, is_none_mode, base, false,
                      filter_node_name, true, copy_mode, errp);
@@ -1901,6 +1976,7 @@ BlockJob *commit_active_start(const char *job_id, BlockDriverState *bs,
     job = mirror_start_job(
                      job_id, bs, creation_flags, base, NULL, speed, 0, 0,
                      MIRROR_LEAVE_BACKING_CHAIN, false,
+                     NULL, 0,
                      on_error, on_error, true, cb, opaque,
                      &commit_active_job_driver, false, base, auto_complete,
                      filter_node_name, false, MIRROR_COPY_MODE_BACKGROUND,
@@ -79,6 +79,7 @@ typedef struct BDRVNBDState {
     bool drained;
     bool wait_drained_end;
     int in_flight;
+    uint64_t requests_completed;
     NBDClientState state;
     bool wait_in_flight;
 
@@ -612,17 +613,11 @@ static int nbd_co_send_request(BlockDriverState *bs,
     assert(s->ioc);
 
     if (qiov) {
-        qio_channel_set_cork(s->ioc, true);
-        rc = nbd_send_request(s->ioc, request);
-        if (nbd_client_connected(s) && rc >= 0) {
-            if (qio_channel_writev_all(s->ioc, qiov->iov, qiov->niov,
-                                       NULL) < 0) {
-                rc = -EIO;
-            }
-        } else if (rc >= 0) {
+        rc = nbd_send_request_with_payload(s->ioc, request,
+                                           qiov->iov, qiov->niov);
+        if (rc >= 0 && !nbd_client_connected(s)) {
             rc = -EIO;
         }
-        qio_channel_set_cork(s->ioc, false);
     } else {
         rc = nbd_send_request(s->ioc, request);
     }
@@ -1146,6 +1141,7 @@ static bool nbd_reply_chunk_iter_receive(BDRVNBDState *s,
 
 break_loop:
     s->requests[HANDLE_TO_INDEX(s, handle)].coroutine = NULL;
+    s->requests_completed++;
 
     qemu_co_mutex_lock(&s->send_mutex);
     s->in_flight--;
@@ -1564,6 +1560,14 @@ static void nbd_yank(void *opaque)
     qio_channel_shutdown(QIO_CHANNEL(s->ioc), QIO_CHANNEL_SHUTDOWN_BOTH, NULL);
 }
 
+static uint64_t nbd_yank_progress(void *opaque)
+{
+    BlockDriverState *bs = opaque;
+    BDRVNBDState *s = (BDRVNBDState *)bs->opaque;
+
+    return s->requests_completed;
+}
+
 static void nbd_client_close(BlockDriverState *bs)
 {
     BDRVNBDState *s = (BDRVNBDState *)bs->opaque;
@@ -1973,6 +1977,8 @@ static int nbd_open(BlockDriverState *bs, QDict *options, int flags,
     if (!yank_register_instance(BLOCKDEV_YANK_INSTANCE(bs->node_name), errp)) {
         return -EEXIST;
     }
+    yank_register_progress(BLOCKDEV_YANK_INSTANCE(bs->node_name),
+                           nbd_yank_progress, bs);
 
     ret = nbd_process_options(bs, options, errp);
     if (ret < 0) {
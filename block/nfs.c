@@ -51,11 +51,26 @@
 #define QEMU_NFS_MAX_READAHEAD_SIZE 1048576
 #define QEMU_NFS_MAX_PAGECACHE_SIZE (8388608 / NFS_BLKSIZE)
 #define QEMU_NFS_MAX_DEBUG_LEVEL 2
+#define QEMU_NFS_MAX_CONNECTIONS 16
 
-typedef struct NFSClient {
+typedef struct NFSClient NFSClient;
+
+/*
+ * One libnfs context with its own TCP connection and RPC slot table.
+ * Requests are striped across connections to get past the throughput
+ * of a single stream, like the Linux client's nconnect mount option.
+ */
+typedef struct NFSConnection {
     struct nfs_context *context;
     struct nfsfh *fh;
     int events;
+    uint64_t in_flight;
+    NFSClient *client;
+} NFSConnection;
+
+struct NFSClient {
+    NFSConnection *conn;
+    unsigned int num_conns;
     bool has_zero_init;
     AioContext *aio_context;
     QemuMutex mutex;
@@ -64,7 +79,7 @@ typedef struct NFSClient {
     NFSServer *server;
     char *path;
     int64_t uid, gid, tcp_syncnt, readahead, pagecache, debug;
-} NFSClient;
+};
 
 typedef struct NFSRPC {
     BlockDriverState *bs;
@@ -74,6 +89,7 @@ typedef struct NFSRPC {
     struct stat *st;
     Coroutine *co;
     NFSClient *client;
+    NFSConnection *conn;
 } NFSRPC;
 
 static int nfs_parse_uri(const char *filename, QDict *options, Error **errp)
@@ -136,6 +152,8 @@ static int nfs_parse_uri(const char *filename, QDict *options, Error **errp)
             qdict_put_str(options, "page-cache-size", qp->p[i].value);
         } else if (!strcmp(qp->p[i].name, "debug")) {
             qdict_put_str(options, "debug", qp->p[i].value);
+        } else if (!strcmp(qp->p[i].name, "nconnect")) {
+            qdict_put_str(options, "nconnect", qp->p[i].value);
         } else {
             error_setg(errp, "Unknown NFS parameter name: %s",
                        qp->p[i].name);
@@ -164,6 +182,7 @@ static bool nfs_has_filename_options_conflict(QDict *options, Error **errp)
             !strcmp(qe->key, "readahead-size") ||
             !strcmp(qe->key, "page-cache-size") ||
             !strcmp(qe->key, "debug") ||
+            !strcmp(qe->key, "nconnect") ||
             strstart(qe->key, "server.", NULL))
         {
             error_setg(errp, "Option %s cannot be used with a filename",
@@ -189,37 +208,58 @@ static void nfs_process_read(void *arg);
 static void nfs_process_write(void *arg);
 
 /* Called with QemuMutex held.  */
-static void nfs_set_events(NFSClient *client)
+static void nfs_set_events(NFSConnection *conn)
 {
-    int ev = nfs_which_events(client->context);
-    if (ev != client->events) {
-        aio_set_fd_handler(client->aio_context, nfs_get_fd(client->context),
+    NFSClient *client = conn->client;
+    int ev = nfs_which_events(conn->context);
+    if (ev != conn->events) {
+        aio_set_fd_handler(client->aio_context, nfs_get_fd(conn->context),
                            false,
                            (ev & POLLIN) ? nfs_process_read : NULL,
                            (ev & POLLOUT) ? nfs_process_write : NULL,
-                           NULL, client);
+                           NULL, conn);
+
+    }
+    conn->events = ev;
+}
+
+/*
+ * Called with QemuMutex held.  Pick the connection with the emptiest RPC
+ * window so that each TCP stream stays busy before any one of them queues.
+ */
+static NFSConnection *nfs_get_connection(NFSClient *client)
+{
+    NFSConnection *conn = &client->conn[0];
+    unsigned int i;
 
+    for (i = 1; i < client->num_conns; i++) {
+        if (client->conn[i].in_flight < conn->in_flight) {
+            conn = &client->conn[i];
+        }
     }
-    client->events = ev;
+
+    return conn;
 }
 
 static void nfs_process_read(void *arg)
 {
-    NFSClient *client = arg;
+    NFSConnection *conn = arg;
+    NFSClient *client = conn->client;
 
     qemu_mutex_lock(&client->mutex);
-    nfs_service(client->context, POLLIN);
-    nfs_set_events(client);
+    nfs_service(conn->context, POLLIN);
+    nfs_set_events(conn);
     qemu_mutex_unlock(&client->mutex);
 }
 
 static void nfs_process_write(void *arg)
 {
-    NFSClient *client = arg;
+    NFSConnection *conn = arg;
+    NFSClient *client = conn->client;
 
     qemu_mutex_lock(&client->mutex);
-    nfs_service(client->context, POLLOUT);
-    nfs_set_events(client);
+    nfs_service(conn->context, POLLOUT);
+    nfs_set_events(conn);
     qemu_mutex_unlock(&client->mutex);
 }
 
@@ -248,6 +288,7 @@ nfs_co_generic_cb(int ret, struct nfs_context *nfs, void *data,
     NFSRPC *task = private_data;
     task->ret = ret;
     assert(!task->st);
+    task->conn->in_flight--;
     if (task->ret > 0 && task->iov) {
         if (task->ret <= task->iov->size) {
             qemu_iovec_from_buf(task->iov, 0, data, task->ret);
@@ -273,12 +314,16 @@ static int coroutine_fn nfs_co_preadv(BlockDriverState *bs, uint64_t offset,
     task.iov = iov;
 
     WITH_QEMU_LOCK_GUARD(&client->mutex) {
-        if (nfs_pread_async(client->context, client->fh,
+        NFSConnection *conn = nfs_get_connection(client);
+
+        task.conn = conn;
+        if (nfs_pread_async(conn->context, conn->fh,
                             offset, bytes, nfs_co_generic_cb, &task) != 0) {
             return -ENOMEM;
         }
 
-        nfs_set_events(client);
+        conn->in_flight++;
+        nfs_set_events(conn);
     }
     while (!task.complete) {
         qemu_coroutine_yield();
@@ -319,7 +364,10 @@ static int coroutine_fn nfs_co_pwritev(BlockDriverState *bs, uint64_t offset,
     }
 
     WITH_QEMU_LOCK_GUARD(&client->mutex) {
-        if (nfs_pwrite_async(client->context, client->fh,
+        NFSConnection *conn = nfs_get_connection(client);
+
+        task.conn = conn;
+        if (nfs_pwrite_async(conn->context, conn->fh,
                              offset, bytes, buf,
                              nfs_co_generic_cb, &task) != 0) {
             if (my_buffer) {
@@ -328,7 +376,8 @@ static int coroutine_fn nfs_co_pwritev(BlockDriverState *bs, uint64_t offset,
             return -ENOMEM;
         }
 
-        nfs_set_events(client);
+        conn->in_flight++;
+        nfs_set_events(conn);
     }
     while (!task.complete) {
         qemu_coroutine_yield();
@@ -353,12 +402,21 @@ static int coroutine_fn nfs_co_flush(BlockDriverState *bs)
     nfs_co_init_task(bs, &task);
 
     WITH_QEMU_LOCK_GUARD(&client->mutex) {
-        if (nfs_fsync_async(client->context, client->fh, nfs_co_generic_cb,
+        /*
+         * NFS COMMIT applies to the file on the server, not to a particular
+         * connection, so flushing through one connection covers writes
+         * submitted on all of them.
+         */
+        NFSConnection *conn = nfs_get_connection(client);
+
+        task.conn = conn;
+        if (nfs_fsync_async(conn->context, conn->fh, nfs_co_generic_cb,
                             &task) != 0) {
             return -ENOMEM;
         }
 
-        nfs_set_events(client);
+        conn->in_flight++;
+        nfs_set_events(conn);
     }
     while (!task.complete) {
         qemu_coroutine_yield();
@@ -370,38 +428,56 @@ static int coroutine_fn nfs_co_flush(BlockDriverState *bs)
 static void nfs_detach_aio_context(BlockDriverState *bs)
 {
     NFSClient *client = bs->opaque;
+    unsigned int i;
 
-    aio_set_fd_handler(client->aio_context, nfs_get_fd(client->context),
-                       false, NULL, NULL, NULL, NULL);
-    client->events = 0;
+    for (i = 0; i < client->num_conns; i++) {
+        NFSConnection *conn = &client->conn[i];
+
+        aio_set_fd_handler(client->aio_context, nfs_get_fd(conn->context),
+                           false, NULL, NULL, NULL, NULL);
+        conn->events = 0;
+    }
 }
 
 static void nfs_attach_aio_context(BlockDriverState *bs,
                                    AioContext *new_context)
 {
     NFSClient *client = bs->opaque;
+    unsigned int i;
 
     client->aio_context = new_context;
-    nfs_set_events(client);
+    for (i = 0; i < client->num_conns; i++) {
+        nfs_set_events(&client->conn[i]);
+    }
 }
 
 static void nfs_client_close(NFSClient *client)
 {
-    if (client->context) {
+    unsigned int i;
+
+    for (i = 0; i < client->num_conns; i++) {
+        NFSConnection *conn = &client->conn[i];
+
+        if (!conn->context) {
+            continue;
+        }
         qemu_mutex_lock(&client->mutex);
-        aio_set_fd_handler(client->aio_context, nfs_get_fd(client->context),
+        aio_set_fd_handler(client->aio_context, nfs_get_fd(conn->context),
                            false, NULL, NULL, NULL, NULL);
         qemu_mutex_unlock(&client->mutex);
-        if (client->fh) {
-            nfs_close(client->context, client->fh);
-            client->fh = NULL;
+        if (conn->fh) {
+            nfs_close(conn->context, conn->fh);
+            conn->fh = NULL;
         }
 #ifdef LIBNFS_FEATURE_UMOUNT
-        nfs_umount(client->context);
+        nfs_umount(conn->context);
 #endif
-        nfs_destroy_context(client->context);
-        client->context = NULL;
+        nfs_destroy_context(conn->context);
+        conn->context = NULL;
     }
+    g_free(client->conn);
+    client->conn = NULL;
+    client->num_conns = 0;
     g_free(client->path);
     qemu_mutex_destroy(&client->mutex);
     qapi_free_NFSServer(client->server);
@@ -414,12 +490,75 @@ static void nfs_file_close(BlockDriverState *bs)
     nfs_client_close(client);
 }
 
+/*
+ * Create, configure and mount one libnfs context according to the options
+ * already validated into @client.
+ */
+static struct nfs_context *nfs_connection_setup(NFSClient *client,
+                                                BlockdevOptionsNfs *opts,
+                                                Error **errp)
+{
+    struct nfs_context *context = nfs_init_context();
+    int ret;
+
+    if (context == NULL) {
+        error_setg(errp, "Failed to init NFS context");
+        return NULL;
+    }
+
+    if (opts->has_user) {
+        nfs_set_uid(context, client->uid);
+    }
+
+    if (opts->has_group) {
+        nfs_set_gid(context, client->gid);
+    }
+
+    if (opts->has_tcp_syn_count) {
+        nfs_set_tcp_syncnt(context, client->tcp_syncnt);
+    }
+
+#ifdef LIBNFS_FEATURE_READAHEAD
+    if (opts->has_readahead_size) {
+        nfs_set_readahead(context, client->readahead);
+#ifdef LIBNFS_FEATURE_PAGECACHE
+        nfs_set_pagecache_ttl(context, 0);
+#endif
+    }
+#endif
+
+#ifdef LIBNFS_FEATURE_PAGECACHE
+    if (opts->has_page_cache_size) {
+        nfs_set_pagecache(context, client->pagecache);
+        nfs_set_pagecache_ttl(context, 0);
+    }
+#endif
+
+#ifdef LIBNFS_FEATURE_DEBUG
+    if (opts->has_debug) {
+        nfs_set_debug(context, client->debug);
+    }
+#endif
+
+    ret = nfs_mount(context, client->server->host, client->path);
+    if (ret < 0) {
+        error_setg(errp, "Failed to mount nfs share: %s",
+                   nfs_get_error(context));
+        nfs_destroy_context(context);
+        return NULL;
+    }
+
+    return context;
+}
+
 static int64_t nfs_client_open(NFSClient *client, BlockdevOptionsNfs *opts,
                                int flags, int open_flags, Error **errp)
 {
     int64_t ret = -EINVAL;
     struct stat st;
     char *file = NULL, *strp = NULL;
+    unsigned int nconnect = 1;
+    unsigned int i;
 
     qemu_mutex_init(&client->mutex);
 
@@ -438,25 +577,25 @@ static int64_t nfs_client_open(NFSClient *client, BlockdevOptionsNfs *opts,
     client->server = opts->server;
     opts->server = NULL;
 
-    client->context = nfs_init_context();
-    if (client->context == NULL) {
-        error_setg(errp, "Failed to init NFS context");
-        goto fail;
+    if (opts->has_nconnect) {
+        if (opts->nconnect < 1 || opts->nconnect > QEMU_NFS_MAX_CONNECTIONS) {
+            error_setg(errp, "nconnect must be between 1 and %d",
+                       QEMU_NFS_MAX_CONNECTIONS);
+            goto fail;
+        }
+        nconnect = opts->nconnect;
     }
 
     if (opts->has_user) {
         client->uid = opts->user;
-        nfs_set_uid(client->context, client->uid);
     }
 
     if (opts->has_group) {
         client->gid = opts->group;
-        nfs_set_gid(client->context, client->gid);
     }
 
     if (opts->has_tcp_syn_count) {
         client->tcp_syncnt = opts->tcp_syn_count;
-        nfs_set_tcp_syncnt(client->context, client->tcp_syncnt);
     }
 
 #ifdef LIBNFS_FEATURE_READAHEAD
@@ -472,10 +611,6 @@ static int64_t nfs_client_open(NFSClient *client, BlockdevOptionsNfs *opts,
                         QEMU_NFS_MAX_READAHEAD_SIZE);
             client->readahead = QEMU_NFS_MAX_READAHEAD_SIZE;
         }
-        nfs_set_readahead(client->context, client->readahead);
-#ifdef LIBNFS_FEATURE_PAGECACHE
-        nfs_set_pagecache_ttl(client->context, 0);
-#endif
         client->cache_used = true;
     }
 #endif
@@ -493,8 +628,6 @@ static int64_t nfs_client_open(NFSClient *client, BlockdevOptionsNfs *opts,
                         QEMU_NFS_MAX_PAGECACHE_SIZE);
             client->pagecache = QEMU_NFS_MAX_PAGECACHE_SIZE;
         }
-        nfs_set_pagecache(client->context, client->pagecache);
-        nfs_set_pagecache_ttl(client->context, 0);
         client->cache_used = true;
     }
 #endif
@@ -509,37 +642,45 @@ static int64_t nfs_client_open(NFSClient *client, BlockdevOptionsNfs *opts,
                         QEMU_NFS_MAX_DEBUG_LEVEL);
             client->debug = QEMU_NFS_MAX_DEBUG_LEVEL;
         }
-        nfs_set_debug(client->context, client->debug);
     }
 #endif
 
-    ret = nfs_mount(client->context, client->server->host, client->path);
-    if (ret < 0) {
-        error_setg(errp, "Failed to mount nfs share: %s",
-                   nfs_get_error(client->context));
-        goto fail;
-    }
+    client->conn = g_new0(NFSConnection, nconnect);
+    client->num_conns = nconnect;
 
-    if (flags & O_CREAT) {
-        ret = nfs_creat(client->context, file, 0600, &client->fh);
-        if (ret < 0) {
-            error_setg(errp, "Failed to create file: %s",
-                       nfs_get_error(client->context));
+    for (i = 0; i < client->num_conns; i++) {
+        NFSConnection *conn = &client->conn[i];
+
+        conn->client = client;
+        conn->context = nfs_connection_setup(client, opts, errp);
+        if (conn->context == NULL) {
+            ret = -EINVAL;
             goto fail;
         }
-    } else {
-        ret = nfs_open(client->context, file, flags, &client->fh);
-        if (ret < 0) {
-            error_setg(errp, "Failed to open file : %s",
-                       nfs_get_error(client->context));
-            goto fail;
+
+        if (i == 0 && (flags & O_CREAT)) {
+            ret = nfs_creat(conn->context, file, 0600, &conn->fh);
+            if (ret < 0) {
+                error_setg(errp, "Failed to create file: %s",
+                           nfs_get_error(conn->context));
+                goto fail;
+            }
+        } else {
+            /* Additional connections open the file the first one created */
+            ret = nfs_open(conn->context, file,
+                           (flags & O_CREAT) ? O_RDWR : flags, &conn->fh);
+            if (ret < 0) {
+                error_setg(errp, "Failed to open file : %s",
+                           nfs_get_error(conn->context));
+                goto fail;
+            }
         }
     }
 
-    ret = nfs_fstat(client->context, client->fh, &st);
+    ret = nfs_fstat(client->conn[0].context, client->conn[0].fh, &st);
     if (ret < 0) {
         error_setg(errp, "Failed to fstat file: %s",
-                   nfs_get_error(client->context));
+                   nfs_get_error(client->conn[0].context));
         goto fail;
     }
 
@@ -651,7 +792,8 @@ static int nfs_file_co_create(BlockdevCreateOptions *options, Error **errp)
     if (ret < 0) {
         goto out;
     }
-    ret = nfs_ftruncate(client->context, client->fh, opts->size);
+    ret = nfs_ftruncate(client->conn[0].context, client->conn[0].fh,
+                        opts->size);
     nfs_client_close(client);
 
 out:
@@ -740,12 +882,12 @@ static int64_t nfs_get_allocated_file_size(BlockDriverState *bs)
 
     task.bs = bs;
     task.st = &st;
-    if (nfs_fstat_async(client->context, client->fh, nfs_get_allocated_file_size_cb,
-                        &task) != 0) {
+    if (nfs_fstat_async(client->conn[0].context, client->conn[0].fh,
+                        nfs_get_allocated_file_size_cb, &task) != 0) {
         return -ENOMEM;
     }
 
-    nfs_set_events(client);
+    nfs_set_events(&client->conn[0]);
     BDRV_POLL_WHILE(bs, !task.complete);
 
     return (task.ret < 0 ? task.ret : st.st_blocks * 512);
@@ -766,7 +908,7 @@ nfs_file_co_truncate(BlockDriverState *bs, int64_t offset, bool exact,
         return -ENOTSUP;
     }
 
-    ret = nfs_ftruncate(client->context, client->fh, offset);
+    ret = nfs_ftruncate(client->conn[0].context, client->conn[0].fh, offset);
     if (ret < 0) {
         error_setg_errno(errp, -ret, "Failed to truncate file");
         return ret;
@@ -797,10 +939,10 @@ static int nfs_reopen_prepare(BDRVReopenState *state,
 
     /* Update cache for read-only reopens */
     if (!(state->flags & BDRV_O_RDWR)) {
-        ret = nfs_fstat(client->context, client->fh, &st);
+        ret = nfs_fstat(client->conn[0].context, client->conn[0].fh, &st);
         if (ret < 0) {
             error_setg(errp, "Failed to fstat file: %s",
-                       nfs_get_error(client->context));
+                       nfs_get_error(client->conn[0].context));
             return ret;
         }
 #if !defined(_WIN32)
@@ -852,7 +994,11 @@ static void coroutine_fn nfs_co_invalidate_cache(BlockDriverState *bs,
                                                  Error **errp)
 {
     NFSClient *client = bs->opaque;
-    nfs_pagecache_invalidate(client->context, client->fh);
+    unsigned int i;
+
+    for (i = 0; i < client->num_conns; i++) {
+        nfs_pagecache_invalidate(client->conn[i].context, client->conn[i].fh);
+    }
 }
 #endif
 
@@ -74,6 +74,8 @@ typedef struct {
     /* Read from I/O code path, initialized under BQL */
     BDRVNVMeState   *s;
     int             index;
+    /* The AioContext this queue pair is dedicated to */
+    AioContext      *aio_context;
 
     /* Fields protected by BQL */
     uint8_t     *prp_list_pages;
@@ -234,6 +236,7 @@ static NVMeQueuePair *nvme_create_queue_pair(BDRVNVMeState *s,
     qemu_mutex_init(&q->lock);
     q->s = s;
     q->index = idx;
+    q->aio_context = aio_context;
     qemu_co_queue_init(&q->free_req_queue);
     q->completion_bh = aio_bh_new(aio_context, nvme_process_completion_bh, q);
     r = qemu_vfio_dma_map(s->vfio, q->prp_list_pages, bytes,
@@ -648,7 +651,8 @@ static void nvme_handle_event(EventNotifier *n)
     nvme_poll_queues(s);
 }
 
-static bool nvme_add_io_queue(BlockDriverState *bs, Error **errp)
+static bool nvme_add_io_queue(BlockDriverState *bs, AioContext *aio_context,
+                              Error **errp)
 {
     BDRVNVMeState *s = bs->opaque;
     unsigned n = s->queue_count;
@@ -657,8 +661,7 @@ static bool nvme_add_io_queue(BlockDriverState *bs, Error **errp)
     unsigned queue_size = NVME_QUEUE_SIZE;
 
     assert(n <= UINT16_MAX);
-    q = nvme_create_queue_pair(s, bdrv_get_aio_context(bs),
-                               n, queue_size, errp);
+    q = nvme_create_queue_pair(s, aio_context, n, queue_size, errp);
     if (!q) {
         return false;
     }
@@ -691,13 +694,44 @@ out_error:
     return false;
 }
 
+/* Find the I/O queue pair dedicated to @aio_context, if there is one */
+static NVMeQueuePair *nvme_ctx_io_queue(BDRVNVMeState *s,
+                                        AioContext *aio_context)
+{
+    for (unsigned i = INDEX_IO(0); i < s->queue_count; i++) {
+        if (s->queues[i]->aio_context == aio_context) {
+            return s->queues[i];
+        }
+    }
+    return NULL;
+}
+
+/* Return the I/O queue pair to submit requests to */
+static NVMeQueuePair *nvme_get_io_queue(BDRVNVMeState *s)
+{
+    NVMeQueuePair *q = nvme_ctx_io_queue(s, s->aio_context);
+
+    return q ?: s->queues[INDEX_IO(0)];
+}
+
 static bool nvme_poll_cb(void *opaque)
 {
     EventNotifier *e = opaque;
     BDRVNVMeState *s = container_of(e, BDRVNVMeState,
                                     irq_notifier[MSIX_SHARED_IRQ_IDX]);
+    bool progress = false;
 
-    return nvme_poll_queues(s);
+    /*
+     * Unlike nvme_handle_event(), skip the admin queue: its commands are
+     * rare and always reaped via the interrupt path, so polling it would
+     * only add lock traffic to the latency-sensitive I/O poll loop.
+     */
+    for (unsigned i = INDEX_IO(0); i < s->queue_count; i++) {
+        if (nvme_poll_queue(s->queues[i])) {
+            progress = true;
+        }
+    }
+    return progress;
 }
 
 static int nvme_init(BlockDriverState *bs, const char *device, int namespace,
@@ -840,7 +874,7 @@ static int nvme_init(BlockDriverState *bs, const char *device, int namespace,
     }
 
     /* Set up command queues. */
-    if (!nvme_add_io_queue(bs, errp)) {
+    if (!nvme_add_io_queue(bs, aio_context, errp)) {
         ret = -EIO;
     }
 out:
@@ -1141,7 +1175,7 @@ static coroutine_fn int nvme_co_prw_aligned(BlockDriverState *bs,
 {
     int r;
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
 
     uint32_t cdw12 = (((bytes >> s->blkshift) - 1) & 0xFFFF) |
@@ -1259,7 +1293,7 @@ static coroutine_fn int nvme_co_pwritev(BlockDriverState *bs,
 static coroutine_fn int nvme_co_flush(BlockDriverState *bs)
 {
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
     NvmeCmd cmd = {
         .opcode = NVME_CMD_FLUSH,
@@ -1290,7 +1324,7 @@ static coroutine_fn int nvme_co_pwrite_zeroes(BlockDriverState *bs,
                                               BdrvRequestFlags flags)
 {
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
 
     uint32_t cdw12 = ((bytes >> s->blkshift) - 1) & 0xFFFF;
@@ -1343,7 +1377,7 @@ static int coroutine_fn nvme_co_pdiscard(BlockDriverState *bs,
                                          int bytes)
 {
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
     NvmeDsmRange *buf;
     QEMUIOVector local_qiov;
@@ -1495,6 +1529,22 @@ static void nvme_attach_aio_context(BlockDriverState *bs,
         q->completion_bh =
             aio_bh_new(new_context, nvme_process_completion_bh, q);
     }
+
+    /*
+     * Give each AioContext a dedicated SQ/CQ pair, so switching between
+     * iothreads does not serialize submissions behind the lock of a queue
+     * pair set up for another context.  Queue pairs are kept until close
+     * and reused when a context is re-attached.  If the controller is out
+     * of queues, fall back to sharing the first I/O queue.
+     */
+    if (!nvme_ctx_io_queue(s, new_context)) {
+        Error *local_err = NULL;
+
+        if (!nvme_add_io_queue(bs, new_context, &local_err)) {
+            error_reportf_err(local_err,
+                              "Failed to add I/O queue for new AioContext: ");
+        }
+    }
 }
 
 static void nvme_aio_plug(BlockDriverState *bs)
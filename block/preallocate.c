@@ -30,8 +30,15 @@
 #include "qemu/module.h"
 #include "qemu/option.h"
 #include "qemu/units.h"
+#include "qemu/timer.h"
+#include "qemu/coroutine.h"
 #include "block/block_int.h"
 
+/* Upper bound for the predicted background preallocation */
+#define PREALLOCATE_MAX_LOOKAHEAD (1 * GiB)
+
+/* Weight of a new sample in the append rate EWMA is 1/8 */
+#define PREALLOCATE_RATE_EWMA_SHIFT 3
 
 typedef struct PreallocateOpts {
     int64_t prealloc_size;
@@ -74,6 +81,20 @@ typedef struct BDRVPreallocateState {
      * be invalid (< 0) when we don't have both exclusive BLK_PERM_RESIZE and
      * BLK_PERM_WRITE permissions on file child.
      */
+
+    /*
+     * End of the preallocation running in the background, or < 0 when none
+     * is in flight.  The region [@file_end, @prealloc_pending_end) is being
+     * zeroed; writes into it are ordered after the zeroes by the block
+     * layer, as the zero request is serialising.
+     */
+    int64_t prealloc_pending_end;
+
+    /* EWMA of the append rate in bytes per second, for growth prediction */
+    int64_t append_rate;
+    int64_t last_append_ns;
+
+    CoQueue prealloc_wait;      /* woken when background preallocation ends */
 } BDRVPreallocateState;
 
 #define PREALLOCATE_OPT_PREALLOC_ALIGN "prealloc-align"
@@ -140,6 +161,8 @@ static int preallocate_open(BlockDriverState *bs, QDict *options, int flags,
      * For this to work, mark them invalid.
      */
     s->file_end = s->zero_start = s->data_end = -EINVAL;
+    s->prealloc_pending_end = -1;
+    qemu_co_queue_init(&s->prealloc_wait);
 
     bs->file = bdrv_open_child(NULL, options, "file", bs, &child_of_bds,
                                BDRV_CHILD_FILTERED | BDRV_CHILD_PRIMARY,
@@ -261,6 +284,84 @@ static bool has_prealloc_perms(BlockDriverState *bs)
     return false;
 }
 
+typedef struct PreallocateBgTask {
+    BlockDriverState *bs;
+    int64_t start;
+    int64_t bytes;
+} PreallocateBgTask;
+
+static void coroutine_fn preallocate_bg_entry(void *opaque)
+{
+    PreallocateBgTask *task = opaque;
+    BlockDriverState *bs = task->bs;
+    BDRVPreallocateState *s = bs->opaque;
+    int ret;
+
+    ret = bdrv_co_pwrite_zeroes(
+            bs->file, task->start, task->bytes,
+            BDRV_REQ_NO_FALLBACK | BDRV_REQ_SERIALISING | BDRV_REQ_NO_WAIT);
+    if (ret < 0) {
+        s->file_end = ret;
+    } else if (s->file_end >= 0) {
+        /* Permissions may have been lost in the meantime, don't resurrect */
+        s->file_end = MAX(s->file_end, task->start + task->bytes);
+    }
+
+    s->prealloc_pending_end = -1;
+    qemu_co_queue_restart_all(&s->prealloc_wait);
+
+    bdrv_dec_in_flight(bs);
+    g_free(task);
+}
+
+/*
+ * Predicted amount to keep preallocated ahead of the writer: a quarter
+ * second of appends at the smoothed rate, at least one prealloc-size.
+ */
+static int64_t preallocate_lookahead(BDRVPreallocateState *s)
+{
+    return CLAMP(s->append_rate / 4, s->opts.prealloc_size,
+                 PREALLOCATE_MAX_LOOKAHEAD);
+}
+
+/*
+ * Start a background preallocation when the writer gets close to the
+ * preallocated end, so that the next boundary crossing finds the file
+ * already grown and does not stall a guest write.
+ */
+static void coroutine_fn preallocate_bg_kick(BlockDriverState *bs)
+{
+    BDRVPreallocateState *s = bs->opaque;
+    PreallocateBgTask *task;
+    Coroutine *co;
+    int64_t lookahead, new_end;
+
+    if (s->prealloc_pending_end >= 0 || s->data_end < 0 || s->file_end < 0) {
+        return;
+    }
+
+    lookahead = preallocate_lookahead(s);
+    if (s->file_end - s->data_end > lookahead / 2) {
+        return;
+    }
+
+    new_end = QEMU_ALIGN_UP(s->data_end + lookahead, s->opts.prealloc_align);
+    if (new_end <= s->file_end) {
+        return;
+    }
+
+    task = g_new(PreallocateBgTask, 1);
+    task->bs = bs;
+    task->start = s->file_end;
+    task->bytes = new_end - s->file_end;
+    s->prealloc_pending_end = new_end;
+
+    /* keep drained sections waiting for the zeroes still in flight */
+    bdrv_inc_in_flight(bs);
+    co = qemu_coroutine_create(preallocate_bg_entry, task);
+    qemu_coroutine_enter(co);
+}
+
 /*
  * Call on each write. Returns true if @want_merge_zero is true and the region
  * [offset, offset + bytes) is zeroed (as a result of this call or earlier
@@ -275,6 +376,7 @@ static bool coroutine_fn handle_write(BlockDriverState *bs, int64_t offset,
     BDRVPreallocateState *s = bs->opaque;
     int64_t end = offset + bytes;
     int64_t prealloc_start, prealloc_end;
+    int64_t now_ns;
     int ret;
 
     if (!has_prealloc_perms(bs)) {
@@ -299,6 +401,20 @@ static bool coroutine_fn handle_write(BlockDriverState *bs, int64_t offset,
 
     /* We have valid s->data_end, and request writes beyond it. */
 
+    now_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    if (s->last_append_ns && now_ns > s->last_append_ns) {
+        int64_t rate = (end - s->data_end) * NANOSECONDS_PER_SECOND /
+                       (now_ns - s->last_append_ns);
+
+        if (!s->append_rate) {
+            s->append_rate = rate;
+        } else {
+            s->append_rate += (rate - s->append_rate) >>
+                              PREALLOCATE_RATE_EWMA_SHIFT;
+        }
+    }
+    s->last_append_ns = now_ns;
+
     s->data_end = end;
     if (s->zero_start < 0 || !want_merge_zero) {
         s->zero_start = end;
@@ -314,13 +430,31 @@ static bool coroutine_fn handle_write(BlockDriverState *bs, int64_t offset,
     /* Now s->data_end, s->zero_start and s->file_end are valid. */
 
     if (end <= s->file_end) {
-        /* No preallocation needed. */
-        return want_merge_zero && offset >= s->zero_start;
+        /* No preallocation needed, but keep running ahead of the writer */
+        preallocate_bg_kick(bs);
+        return want_merge_zero && offset >= s->zero_start &&
+               s->prealloc_pending_end < 0;
+    }
+
+    if (s->prealloc_pending_end >= 0 && end <= s->prealloc_pending_end) {
+        /*
+         * Covered by the background preallocation.  The write is ordered
+         * after the serialising zero request by the block layer; don't claim
+         * the region is zeroed before the zeroes have actually landed.
+         */
+        return false;
     }
 
     /* Now we want new preallocation, as request writes beyond s->file_end. */
 
-    prealloc_start = want_merge_zero ? MIN(offset, s->file_end) : s->file_end;
+    if (s->prealloc_pending_end >= 0) {
+        /* extend only beyond the background preallocation already running */
+        prealloc_start = s->prealloc_pending_end;
+        want_merge_zero = false;
+    } else {
+        prealloc_start = want_merge_zero ? MIN(offset, s->file_end)
+                                         : s->file_end;
+    }
     prealloc_end = QEMU_ALIGN_UP(end + s->opts.prealloc_size,
                                  s->opts.prealloc_align);
 
@@ -332,7 +466,7 @@ static bool coroutine_fn handle_write(BlockDriverState *bs, int64_t offset,
         return false;
     }
 
-    s->file_end = prealloc_end;
+    s->file_end = MAX(s->file_end, prealloc_end);
     return want_merge_zero;
 }
 
@@ -370,6 +504,11 @@ preallocate_co_truncate(BlockDriverState *bs, int64_t offset,
     BDRVPreallocateState *s = bs->opaque;
     int ret;
 
+    /* Let a background preallocation settle before changing the file size */
+    while (s->prealloc_pending_end >= 0) {
+        qemu_co_queue_wait(&s->prealloc_wait, NULL);
+    }
+
     if (s->data_end >= 0 && offset > s->data_end) {
         if (s->file_end < 0) {
             s->file_end = bdrv_getlength(bs->file->bs);
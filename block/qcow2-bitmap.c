@@ -89,6 +89,8 @@ typedef struct Qcow2Bitmap {
     char *name;
 
     BdrvDirtyBitmap *dirty_bitmap;
+    bool unchanged; /* in-memory bitmap still matches the stored data, only
+                       the directory entry needs refreshing */
 
     QSIMPLEQ_ENTRY(Qcow2Bitmap) entry;
 } Qcow2Bitmap;
@@ -1015,6 +1017,9 @@ bool qcow2_load_dirty_bitmaps(BlockDriverState *bs, bool *header_updated,
         if (!(bm->flags & BME_FLAG_AUTO)) {
             bdrv_disable_dirty_bitmap(bitmap);
         }
+        /* Deserializing counted as a modification; at this point the
+         * in-memory bitmap exactly matches the stored data. */
+        bdrv_dirty_bitmap_set_modified(bitmap, false);
         created_dirty_bitmaps =
             g_slist_append(created_dirty_bitmaps, bitmap);
     }
@@ -1599,10 +1604,16 @@ bool qcow2_store_persistent_dirty_bitmaps(BlockDriverState *bs,
                            name);
                 goto fail;
             }
-            tb = g_memdup(&bm->table, sizeof(bm->table));
-            bm->table.offset = 0;
-            bm->table.size = 0;
-            QSIMPLEQ_INSERT_TAIL(&drop_tables, tb, entry);
+            if (!bdrv_dirty_bitmap_modified(bitmap)) {
+                /* The stored data still matches the in-memory bitmap, so
+                 * keep its table and only refresh the directory entry. */
+                bm->unchanged = true;
+            } else {
+                tb = g_memdup(&bm->table, sizeof(bm->table));
+                bm->table.offset = 0;
+                bm->table.size = 0;
+                QSIMPLEQ_INSERT_TAIL(&drop_tables, tb, entry);
+            }
         }
         bm->flags = bdrv_dirty_bitmap_enabled(bitmap) ? BME_FLAG_AUTO : 0;
         bm->granularity_bits = ctz32(bdrv_dirty_bitmap_granularity(bitmap));
@@ -1622,7 +1633,9 @@ bool qcow2_store_persistent_dirty_bitmaps(BlockDriverState *bs,
     QSIMPLEQ_FOREACH(bm, bm_list, entry) {
         BdrvDirtyBitmap *bitmap = bm->dirty_bitmap;
 
-        if (bitmap == NULL || bdrv_dirty_bitmap_readonly(bitmap)) {
+        if (bitmap == NULL || bdrv_dirty_bitmap_readonly(bitmap) ||
+            bm->unchanged)
+        {
             continue;
         }
 
@@ -1638,6 +1651,15 @@ bool qcow2_store_persistent_dirty_bitmaps(BlockDriverState *bs,
         goto fail;
     }
 
+    /* The stored copies are now in sync with the in-memory bitmaps */
+    QSIMPLEQ_FOREACH(bm, bm_list, entry) {
+        if (bm->dirty_bitmap != NULL &&
+            !bdrv_dirty_bitmap_readonly(bm->dirty_bitmap))
+        {
+            bdrv_dirty_bitmap_set_modified(bm->dirty_bitmap, false);
+        }
+    }
+
     /* Bitmap directory was successfully updated, so, old data can be dropped.
      * TODO it is better to reuse these clusters */
     QSIMPLEQ_FOREACH_SAFE(tb, &drop_tables, entry, tb_next) {
@@ -1662,7 +1684,7 @@ success:
 fail:
     QSIMPLEQ_FOREACH(bm, bm_list, entry) {
         if (bm->dirty_bitmap == NULL || bm->table.offset == 0 ||
-            bdrv_dirty_bitmap_readonly(bm->dirty_bitmap))
+            bm->unchanged || bdrv_dirty_bitmap_readonly(bm->dirty_bitmap))
         {
             continue;
         }
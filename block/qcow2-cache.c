@@ -23,6 +23,8 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/atomic.h"
+#include "qemu/memusage.h"
 #include "qcow2.h"
 #include "trace.h"
 
@@ -42,6 +44,8 @@ struct Qcow2Cache {
     void                   *table_array;
     uint64_t                lru_counter;
     uint64_t                cache_clean_lru_counter;
+    /* Maps table offset (key: &entries[i].offset) to index + 1 */
+    GHashTable             *table_map;
 };
 
 static inline void *qcow2_cache_get_table_addr(Qcow2Cache *c, int table)
@@ -49,6 +53,26 @@ static inline void *qcow2_cache_get_table_addr(Qcow2Cache *c, int table)
     return (uint8_t *) c->table_array + (size_t) table * c->table_size;
 }
 
+static void qcow2_cache_map_insert(Qcow2Cache *c, int i)
+{
+    g_hash_table_insert(c->table_map, &c->entries[i].offset,
+                        GINT_TO_POINTER(i + 1));
+}
+
+/* Must be called before entries[i].offset is cleared or overwritten */
+static void qcow2_cache_map_remove(Qcow2Cache *c, int i)
+{
+    if (c->entries[i].offset != 0) {
+        g_hash_table_remove(c->table_map, &c->entries[i].offset);
+    }
+}
+
+/* Returns the index of the entry caching @offset, or -1 if not cached */
+static int qcow2_cache_map_lookup(Qcow2Cache *c, uint64_t offset)
+{
+    return GPOINTER_TO_INT(g_hash_table_lookup(c->table_map, &offset)) - 1;
+}
+
 static inline int qcow2_cache_get_table_idx(Qcow2Cache *c, void *table)
 {
     ptrdiff_t table_offset = (uint8_t *) table - (uint8_t *) c->table_array;
@@ -104,6 +128,7 @@ void qcow2_cache_clean_unused(Qcow2Cache *c)
 
         /* And count how many we can clean in a row */
         while (i < c->size && can_clean_entry(c, i)) {
+            qcow2_cache_map_remove(c, i);
             c->entries[i].offset = 0;
             c->entries[i].lru_counter = 0;
             i++;
@@ -118,6 +143,42 @@ void qcow2_cache_clean_unused(Qcow2Cache *c)
     c->cache_clean_lru_counter = c->lru_counter;
 }
 
+/*
+ * All qcow2 caches aggregated, for query-memory-usage.  Caches come and
+ * go with block devices, so the provider reports global counters rather
+ * than tracking individual caches.
+ */
+static uint64_t qcow2_cache_total_bytes;
+static uint64_t qcow2_cache_peak_bytes;
+
+static void qcow2_cache_mem_usage(MemUsageEmitFn emit, void *emit_opaque,
+                                  void *opaque)
+{
+    emit("block/qcow2-cache", qatomic_read(&qcow2_cache_total_bytes),
+         qatomic_read(&qcow2_cache_peak_bytes), MEM_USAGE_UNKNOWN,
+         emit_opaque);
+}
+
+static void qcow2_cache_account(int64_t diff)
+{
+    static bool registered;
+    uint64_t total;
+
+    if (!qatomic_xchg(&registered, true)) {
+        mem_usage_register(qcow2_cache_mem_usage, NULL);
+    }
+
+    total = qatomic_fetch_add(&qcow2_cache_total_bytes, diff) + diff;
+    while (diff > 0) {
+        uint64_t peak = qatomic_read(&qcow2_cache_peak_bytes);
+
+        if (total <= peak ||
+            qatomic_cmpxchg(&qcow2_cache_peak_bytes, peak, total) == peak) {
+            break;
+        }
+    }
+}
+
 Qcow2Cache *qcow2_cache_create(BlockDriverState *bs, int num_tables,
                                unsigned table_size)
 {
@@ -140,9 +201,12 @@ Qcow2Cache *qcow2_cache_create(BlockDriverState *bs, int num_tables,
         qemu_vfree(c->table_array);
         g_free(c->entries);
         g_free(c);
-        c = NULL;
+        return NULL;
     }
 
+    c->table_map = g_hash_table_new(g_int64_hash, g_int64_equal);
+    qcow2_cache_account((int64_t) num_tables * c->table_size);
+
     return c;
 }
 
@@ -154,8 +218,10 @@ int qcow2_cache_destroy(Qcow2Cache *c)
         assert(c->entries[i].ref == 0);
     }
 
+    g_hash_table_destroy(c->table_map);
     qemu_vfree(c->table_array);
     g_free(c->entries);
+    qcow2_cache_account(-(int64_t) c->size * c->table_size);
     g_free(c);
 
     return 0;
@@ -305,6 +371,7 @@ int qcow2_cache_empty(BlockDriverState *bs, Qcow2Cache *c)
 
     for (i = 0; i < c->size; i++) {
         assert(c->entries[i].ref == 0);
+        qcow2_cache_map_remove(c, i);
         c->entries[i].offset = 0;
         c->entries[i].lru_counter = 0;
     }
@@ -322,7 +389,6 @@ static int qcow2_cache_do_get(BlockDriverState *bs, Qcow2Cache *c,
     BDRVQcow2State *s = bs->opaque;
     int i;
     int ret;
-    int lookup_index;
     uint64_t min_lru_counter = UINT64_MAX;
     int min_lru_index = -1;
 
@@ -339,20 +405,19 @@ static int qcow2_cache_do_get(BlockDriverState *bs, Qcow2Cache *c,
     }
 
     /* Check if the table is already cached */
-    i = lookup_index = (offset / c->table_size * 4) % c->size;
-    do {
+    i = qcow2_cache_map_lookup(c, offset);
+    if (i >= 0) {
+        goto found;
+    }
+
+    /* Find the least recently used entry to replace */
+    for (i = 0; i < c->size; i++) {
         const Qcow2CachedTable *t = &c->entries[i];
-        if (t->offset == offset) {
-            goto found;
-        }
         if (t->ref == 0 && t->lru_counter < min_lru_counter) {
             min_lru_counter = t->lru_counter;
             min_lru_index = i;
         }
-        if (++i == c->size) {
-            i = 0;
-        }
-    } while (i != lookup_index);
+    }
 
     if (min_lru_index == -1) {
         /* This can't happen in current synchronous code, but leave the check
@@ -372,6 +437,7 @@ static int qcow2_cache_do_get(BlockDriverState *bs, Qcow2Cache *c,
 
     trace_qcow2_cache_get_read(qemu_coroutine_self(),
                                c == s->l2_table_cache, i);
+    qcow2_cache_map_remove(c, i);
     c->entries[i].offset = 0;
     if (read_from_disk) {
         if (c == s->l2_table_cache) {
@@ -387,6 +453,7 @@ static int qcow2_cache_do_get(BlockDriverState *bs, Qcow2Cache *c,
     }
 
     c->entries[i].offset = offset;
+    qcow2_cache_map_insert(c, i);
 
     /* And return the right table */
 found:
@@ -434,14 +501,9 @@ void qcow2_cache_entry_mark_dirty(Qcow2Cache *c, void *table)
 
 void *qcow2_cache_is_table_offset(Qcow2Cache *c, uint64_t offset)
 {
-    int i;
+    int i = qcow2_cache_map_lookup(c, offset);
 
-    for (i = 0; i < c->size; i++) {
-        if (c->entries[i].offset == offset) {
-            return qcow2_cache_get_table_addr(c, i);
-        }
-    }
-    return NULL;
+    return i >= 0 ? qcow2_cache_get_table_addr(c, i) : NULL;
 }
 
 void qcow2_cache_discard(Qcow2Cache *c, void *table)
@@ -450,6 +512,7 @@ void qcow2_cache_discard(Qcow2Cache *c, void *table)
 
     assert(c->entries[i].ref == 0);
 
+    qcow2_cache_map_remove(c, i);
     c->entries[i].offset = 0;
     c->entries[i].lru_counter = 0;
     c->entries[i].dirty = false;
@@ -4550,78 +4550,133 @@ fail:
     return ret;
 }
 
+typedef struct Qcow2CompressedCluster {
+    uint64_t offset;        /* guest offset */
+    uint64_t bytes;
+    /* Compressed data, or NULL when the cluster is incompressible */
+    uint8_t *out_buf;
+    ssize_t out_len;
+} Qcow2CompressedCluster;
+
+typedef struct Qcow2CompressTask {
+    AioTask task;
+    BlockDriverState *bs;
+    QEMUIOVector *qiov;
+    size_t qiov_offset;
+    Qcow2CompressedCluster *cc;
+} Qcow2CompressTask;
+
 static coroutine_fn int
-qcow2_co_pwritev_compressed_task(BlockDriverState *bs,
-                                 uint64_t offset, uint64_t bytes,
-                                 QEMUIOVector *qiov, size_t qiov_offset)
+qcow2_co_compress_task(BlockDriverState *bs, Qcow2CompressedCluster *cc,
+                       QEMUIOVector *qiov, size_t qiov_offset)
 {
     BDRVQcow2State *s = bs->opaque;
-    int ret;
-    ssize_t out_len;
-    uint8_t *buf, *out_buf;
-    uint64_t cluster_offset;
+    uint8_t *buf;
 
-    assert(bytes == s->cluster_size || (bytes < s->cluster_size &&
-           (offset + bytes == bs->total_sectors << BDRV_SECTOR_BITS)));
+    assert(cc->bytes == s->cluster_size || (cc->bytes < s->cluster_size &&
+           (cc->offset + cc->bytes == bs->total_sectors << BDRV_SECTOR_BITS)));
 
     buf = qemu_blockalign(bs, s->cluster_size);
-    if (bytes < s->cluster_size) {
+    if (cc->bytes < s->cluster_size) {
         /* Zero-pad last write if image size is not cluster aligned */
-        memset(buf + bytes, 0, s->cluster_size - bytes);
+        memset(buf + cc->bytes, 0, s->cluster_size - cc->bytes);
     }
-    qemu_iovec_to_buf(qiov, qiov_offset, buf, bytes);
+    qemu_iovec_to_buf(qiov, qiov_offset, buf, cc->bytes);
 
-    out_buf = g_malloc(s->cluster_size);
+    cc->out_buf = g_malloc(s->cluster_size);
+    cc->out_len = qcow2_co_compress(bs, cc->out_buf, s->cluster_size - 1,
+                                    buf, s->cluster_size);
+    qemu_vfree(buf);
 
-    out_len = qcow2_co_compress(bs, out_buf, s->cluster_size - 1,
-                                buf, s->cluster_size);
-    if (out_len == -ENOMEM) {
-        /* could not compress: write normal cluster */
-        ret = qcow2_co_pwritev_part(bs, offset, bytes, qiov, qiov_offset, 0);
-        if (ret < 0) {
-            goto fail;
+    if (cc->out_len < 0) {
+        g_free(cc->out_buf);
+        cc->out_buf = NULL;
+        if (cc->out_len != -ENOMEM) {
+            return -EINVAL;
         }
-        goto success;
-    } else if (out_len < 0) {
-        ret = -EINVAL;
-        goto fail;
+        /* Could not compress: the caller writes a normal cluster instead */
     }
 
-    qemu_co_mutex_lock(&s->lock);
-    ret = qcow2_alloc_compressed_cluster_offset(bs, offset, out_len,
-                                                &cluster_offset);
-    if (ret < 0) {
-        qemu_co_mutex_unlock(&s->lock);
-        goto fail;
-    }
+    return 0;
+}
 
-    ret = qcow2_pre_write_overlap_check(bs, 0, cluster_offset, out_len, true);
-    qemu_co_mutex_unlock(&s->lock);
-    if (ret < 0) {
-        goto fail;
-    }
+static coroutine_fn int qcow2_co_compress_task_entry(AioTask *task)
+{
+    Qcow2CompressTask *t = container_of(task, Qcow2CompressTask, task);
 
-    BLKDBG_EVENT(s->data_file, BLKDBG_WRITE_COMPRESSED);
-    ret = bdrv_co_pwrite(s->data_file, cluster_offset, out_len, out_buf, 0);
-    if (ret < 0) {
-        goto fail;
-    }
-success:
-    ret = 0;
-fail:
-    qemu_vfree(buf);
-    g_free(out_buf);
-    return ret;
+    return qcow2_co_compress_task(t->bs, t->cc, t->qiov, t->qiov_offset);
 }
 
-static coroutine_fn int qcow2_co_pwritev_compressed_task_entry(AioTask *task)
+/*
+ * Allocate space for the compressed clusters of @ccs in order and write the
+ * data out, merging physically contiguous allocations into a single vectored
+ * request.  The allocator packs compressed clusters tightly, so a batch
+ * normally results in one write.  Incompressible clusters (out_buf == NULL)
+ * are written uncompressed through the normal write path.
+ *
+ * @qiov_offset corresponds to guest offset ccs[0].offset.
+ */
+static coroutine_fn int
+qcow2_co_compressed_batch_flush(BlockDriverState *bs,
+                                Qcow2CompressedCluster *ccs, unsigned n,
+                                QEMUIOVector *qiov, size_t qiov_offset)
 {
-    Qcow2AioTask *t = container_of(task, Qcow2AioTask, task);
+    BDRVQcow2State *s = bs->opaque;
+    QEMUIOVector hd_qiov;
+    uint64_t run_offset = 0;
+    int ret = 0;
+    unsigned i;
+
+    qemu_iovec_init(&hd_qiov, n);
+
+    for (i = 0; i < n && ret == 0; i++) {
+        Qcow2CompressedCluster *cc = &ccs[i];
+        uint64_t cluster_offset;
+
+        if (!cc->out_buf) {
+            ret = qcow2_co_pwritev_part(bs, cc->offset, cc->bytes, qiov,
+                                        qiov_offset +
+                                        (cc->offset - ccs[0].offset), 0);
+            continue;
+        }
+
+        qemu_co_mutex_lock(&s->lock);
+        ret = qcow2_alloc_compressed_cluster_offset(bs, cc->offset,
+                                                    cc->out_len,
+                                                    &cluster_offset);
+        if (ret == 0) {
+            ret = qcow2_pre_write_overlap_check(bs, 0, cluster_offset,
+                                                cc->out_len, true);
+        }
+        qemu_co_mutex_unlock(&s->lock);
+        if (ret < 0) {
+            break;
+        }
 
-    assert(!t->subcluster_type && !t->l2meta);
+        if (hd_qiov.niov && cluster_offset != run_offset + hd_qiov.size) {
+            /* Discontiguous allocation: write out the current run */
+            BLKDBG_EVENT(s->data_file, BLKDBG_WRITE_COMPRESSED);
+            ret = bdrv_co_pwritev(s->data_file, run_offset, hd_qiov.size,
+                                  &hd_qiov, 0);
+            qemu_iovec_reset(&hd_qiov);
+            if (ret < 0) {
+                break;
+            }
+        }
+        if (!hd_qiov.niov) {
+            run_offset = cluster_offset;
+        }
+        qemu_iovec_add(&hd_qiov, cc->out_buf, cc->out_len);
+    }
+
+    if (ret == 0 && hd_qiov.niov) {
+        BLKDBG_EVENT(s->data_file, BLKDBG_WRITE_COMPRESSED);
+        ret = bdrv_co_pwritev(s->data_file, run_offset, hd_qiov.size,
+                              &hd_qiov, 0);
+    }
 
-    return qcow2_co_pwritev_compressed_task(t->bs, t->offset, t->bytes, t->qiov,
-                                            t->qiov_offset);
+    qemu_iovec_destroy(&hd_qiov);
+    return ret;
 }
 
 /*
@@ -4634,7 +4689,6 @@ qcow2_co_pwritev_compressed_part(BlockDriverState *bs,
                                  QEMUIOVector *qiov, size_t qiov_offset)
 {
     BDRVQcow2State *s = bs->opaque;
-    AioTaskPool *aio = NULL;
     int ret = 0;
 
     if (has_data_file(bs)) {
@@ -4663,29 +4717,61 @@ qcow2_co_pwritev_compressed_part(BlockDriverState *bs,
         return -EINVAL;
     }
 
-    while (bytes && aio_task_pool_status(aio) == 0) {
-        uint64_t chunk_size = MIN(bytes, s->cluster_size);
+    while (bytes && ret == 0) {
+        Qcow2CompressedCluster ccs[QCOW2_MAX_WORKERS] = {};
+        AioTaskPool *aio = NULL;
+        size_t batch_qiov_offset = qiov_offset;
+        unsigned n = 0;
+        unsigned i;
 
-        if (!aio && chunk_size != bytes) {
-            aio = aio_task_pool_new(QCOW2_MAX_WORKERS);
+        /* Compress up to QCOW2_MAX_WORKERS clusters in parallel */
+        while (bytes && n < QCOW2_MAX_WORKERS && ret == 0) {
+            uint64_t chunk_size = MIN(bytes, s->cluster_size);
+            Qcow2CompressedCluster *cc = &ccs[n++];
+
+            cc->offset = offset;
+            cc->bytes = chunk_size;
+
+            if (!aio && chunk_size != bytes) {
+                aio = aio_task_pool_new(QCOW2_MAX_WORKERS);
+            }
+
+            if (!aio) {
+                ret = qcow2_co_compress_task(bs, cc, qiov, qiov_offset);
+            } else {
+                Qcow2CompressTask *task = g_new(Qcow2CompressTask, 1);
+
+                *task = (Qcow2CompressTask) {
+                    .task.func = qcow2_co_compress_task_entry,
+                    .bs = bs,
+                    .qiov = qiov,
+                    .qiov_offset = qiov_offset,
+                    .cc = cc,
+                };
+                aio_task_pool_start_task(aio, &task->task);
+            }
+
+            qiov_offset += chunk_size;
+            offset += chunk_size;
+            bytes -= chunk_size;
         }
 
-        ret = qcow2_add_task(bs, aio, qcow2_co_pwritev_compressed_task_entry,
-                             0, 0, offset, chunk_size, qiov, qiov_offset, NULL);
-        if (ret < 0) {
-            break;
+        if (aio) {
+            aio_task_pool_wait_all(aio);
+            if (ret == 0) {
+                ret = aio_task_pool_status(aio);
+            }
+            g_free(aio);
         }
-        qiov_offset += chunk_size;
-        offset += chunk_size;
-        bytes -= chunk_size;
-    }
 
-    if (aio) {
-        aio_task_pool_wait_all(aio);
         if (ret == 0) {
-            ret = aio_task_pool_status(aio);
+            ret = qcow2_co_compressed_batch_flush(bs, ccs, n, qiov,
+                                                  batch_qiov_offset);
+        }
+
+        for (i = 0; i < n; i++) {
+            g_free(ccs[i].out_buf);
         }
-        g_free(aio);
     }
 
     return ret;
@@ -17,6 +17,7 @@
 #include "qemu/cutils.h"
 #include "qemu/module.h"
 #include "qemu/option.h"
+#include "qemu/timer.h"
 #include "block/block_int.h"
 #include "block/coroutines.h"
 #include "block/qdict.h"
@@ -32,6 +33,17 @@
 
 #define INDEXSTR_LEN 32
 
+/* Weight of a new sample in the per-child read latency EWMA is 1/8 */
+#define QUORUM_LATENCY_EWMA_SHIFT 3
+
+/* A fifo read is duplicated onto the next child once it has been outstanding
+ * for this multiple of its child's smoothed latency.
+ */
+#define QUORUM_HEDGE_DELAY_MULT   2
+
+/* Hedge deadline used while a child has no latency sample yet */
+#define QUORUM_HEDGE_DELAY_DEFAULT (50 * SCALE_MS)
+
 #define QUORUM_OPT_VOTE_THRESHOLD "vote-threshold"
 #define QUORUM_OPT_BLKVERIFY      "blkverify"
 #define QUORUM_OPT_REWRITE        "rewrite-corrupted"
@@ -91,6 +103,11 @@ typedef struct BDRVQuorumState {
                             */
 
     QuorumReadPattern read_pattern;
+
+    int64_t *child_latency_ns; /* per-child EWMA of successful read latency,
+                                * 0 until the child has completed a read.
+                                * Orders the children for fifo reads.
+                                */
 } BDRVQuorumState;
 
 typedef struct QuorumAIOCB QuorumAIOCB;
@@ -642,23 +659,181 @@ static int read_quorum_children(QuorumAIOCB *acb)
     return acb->vote_ret;
 }
 
+typedef struct QuorumHedgeState QuorumHedgeState;
+
+/* One hedged read issued to a single child.  It owns a bounce buffer so that
+ * a request that loses the race can keep running after the caller has
+ * already been completed with the winner's data.
+ */
+typedef struct QuorumHedgeChild {
+    QuorumHedgeState *hs;
+    BdrvChild *child;
+    int idx;                    /* index in s->children and the latency table */
+    QEMUIOVector qiov;
+    uint8_t *buf;
+} QuorumHedgeChild;
+
+/* Shared state of one hedged fifo read.  It is kept alive until the last
+ * child request has finished, which may be after the caller returned.
+ */
+struct QuorumHedgeState {
+    BlockDriverState *bs;
+    uint64_t offset;
+    uint64_t bytes;
+    QEMUIOVector *qiov;         /* caller's iovec, valid until done is set */
+    QemuCoSleep sleep;          /* the waiting caller, woken on completion */
+    int completed;              /* children that have answered */
+    int remaining;              /* child requests not yet torn down */
+    int winner;                 /* first child that succeeded, -1 while none */
+    int ret;
+    bool done;                  /* the caller has returned */
+};
+
+static void quorum_update_child_latency(BDRVQuorumState *s, int idx,
+                                        int64_t elapsed_ns)
+{
+    int64_t ewma = s->child_latency_ns[idx];
+
+    if (!ewma) {
+        ewma = elapsed_ns;
+    } else {
+        ewma += (elapsed_ns - ewma) >> QUORUM_LATENCY_EWMA_SHIFT;
+    }
+    /* never drop back to 0, that means "no sample yet" */
+    s->child_latency_ns[idx] = MAX(ewma, 1);
+}
+
+/* Sort the child indexes by smoothed read latency, fastest first.  Children
+ * that have not been read from yet sort first so that they get a sample.
+ */
+static void quorum_order_children(BDRVQuorumState *s, int *order)
+{
+    int i, j;
+
+    for (i = 0; i < s->num_children; i++) {
+        int64_t lat = s->child_latency_ns[i];
+
+        for (j = i; j > 0 && s->child_latency_ns[order[j - 1]] > lat; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+}
+
+static void quorum_hedge_read_entry(void *opaque)
+{
+    QuorumHedgeChild *hc = opaque;
+    QuorumHedgeState *hs = hc->hs;
+    BDRVQuorumState *s = hs->bs->opaque;
+    int64_t start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    int ret;
+
+    ret = bdrv_co_preadv(hc->child, hs->offset, hs->bytes, &hc->qiov, 0);
+
+    if (ret == 0) {
+        quorum_update_child_latency(s, hc->idx,
+                                    qemu_clock_get_ns(QEMU_CLOCK_REALTIME) -
+                                    start_ns);
+        if (!hs->done && hs->winner < 0) {
+            hs->winner = hc->idx;
+            hs->ret = 0;
+            quorum_copy_qiov(hs->qiov, &hc->qiov);
+        }
+    } else {
+        quorum_report_bad(QUORUM_OP_TYPE_READ, hs->offset, hs->bytes,
+                          hc->child->bs->node_name, ret);
+        if (hs->winner < 0) {
+            hs->ret = ret;
+        }
+    }
+
+    hs->completed++;
+    qemu_co_sleep_wake(&hs->sleep);
+
+    qemu_vfree(hc->buf);
+    qemu_iovec_destroy(&hc->qiov);
+    g_free(hc);
+
+    bdrv_dec_in_flight(hs->bs);
+    if (--hs->remaining == 0 && hs->done) {
+        g_free(hs);
+    }
+}
+
+static void quorum_hedge_launch(QuorumHedgeState *hs, int idx)
+{
+    BDRVQuorumState *s = hs->bs->opaque;
+    QuorumHedgeChild *hc = g_new0(QuorumHedgeChild, 1);
+    Coroutine *co;
+
+    hc->hs = hs;
+    hc->idx = idx;
+    hc->child = s->children[idx];
+    hc->buf = qemu_blockalign(hc->child->bs, hs->qiov->size);
+    qemu_iovec_init(&hc->qiov, hs->qiov->niov);
+    qemu_iovec_clone(&hc->qiov, hs->qiov, hc->buf);
+
+    /* keep drained sections waiting for this read after the caller returned */
+    bdrv_inc_in_flight(hs->bs);
+    hs->remaining++;
+
+    co = qemu_coroutine_create(quorum_hedge_read_entry, hc);
+    qemu_coroutine_enter(co);
+}
+
+/* Read a single child, hedging onto the others when it is slow.
+ *
+ * The children are tried in order of their smoothed read latency instead of
+ * configuration order.  A read that has been outstanding for a multiple of
+ * its child's expected latency is duplicated onto the next child and the
+ * first successful answer completes the request; losing requests finish on
+ * their own into private bounce buffers.  A failed child triggers the next
+ * one immediately, as the plain fifo pattern did.
+ */
 static int read_fifo_child(QuorumAIOCB *acb)
 {
     BDRVQuorumState *s = acb->bs->opaque;
-    int n, ret;
-
-    /* We try to read the next child in FIFO order if we failed to read */
-    do {
-        n = acb->children_read++;
-        acb->qcrs[n].bs = s->children[n]->bs;
-        ret = bdrv_co_preadv(s->children[n], acb->offset, acb->bytes,
-                             acb->qiov, 0);
-        if (ret < 0) {
-            quorum_report_bad_acb(&acb->qcrs[n], ret);
+    QuorumHedgeState *hs = g_new0(QuorumHedgeState, 1);
+    int *order = g_new(int, s->num_children);
+    int launched = 0;
+    int ret;
+
+    hs->bs = acb->bs;
+    hs->offset = acb->offset;
+    hs->bytes = acb->bytes;
+    hs->qiov = acb->qiov;
+    hs->winner = -1;
+
+    quorum_order_children(s, order);
+
+    while (hs->winner < 0 && launched < s->num_children) {
+        quorum_hedge_launch(hs, order[launched++]);
+        if (hs->winner >= 0 || hs->completed == launched) {
+            /* answered synchronously: done, or fail over right away */
+            continue;
+        }
+        if (launched < s->num_children) {
+            int64_t ewma = s->child_latency_ns[order[launched - 1]];
+            int64_t delay = ewma ? ewma * QUORUM_HEDGE_DELAY_MULT
+                                 : QUORUM_HEDGE_DELAY_DEFAULT;
+
+            qemu_co_sleep_ns_wakeable(&hs->sleep, QEMU_CLOCK_REALTIME, delay);
         }
-    } while (ret < 0 && acb->children_read < s->num_children);
+    }
 
-    /* FIXME: rewrite failed children if acb->children_read > 1? */
+    /* every child is either busy or has failed: wait for the first answer */
+    while (hs->winner < 0 && hs->completed < launched) {
+        qemu_co_sleep(&hs->sleep);
+    }
+
+    acb->children_read = launched;
+    ret = hs->winner >= 0 ? 0 : hs->ret;
+
+    hs->done = true;
+    if (hs->remaining == 0) {
+        g_free(hs);
+    }
+    g_free(order);
 
     return ret;
 }
@@ -997,6 +1172,7 @@ static int quorum_open(BlockDriverState *bs, QDict *options, int flags,
 
     /* allocate the children array */
     s->children = g_new0(BdrvChild *, s->num_children);
+    s->child_latency_ns = g_new0(int64_t, s->num_children);
     opened = g_new0(bool, s->num_children);
 
     for (i = 0; i < s->num_children; i++) {
@@ -1031,6 +1207,7 @@ close_exit:
         bdrv_unref_child(bs, s->children[i]);
     }
     g_free(s->children);
+    g_free(s->child_latency_ns);
     g_free(opened);
 exit:
     qemu_opts_del(opts);
@@ -1047,6 +1224,7 @@ static void quorum_close(BlockDriverState *bs)
     }
 
     g_free(s->children);
+    g_free(s->child_latency_ns);
 }
 
 static void quorum_add_child(BlockDriverState *bs, BlockDriverState *child_bs,
@@ -1088,6 +1266,9 @@ static void quorum_add_child(BlockDriverState *bs, BlockDriverState *child_bs,
         goto out;
     }
     s->children = g_renew(BdrvChild *, s->children, s->num_children + 1);
+    s->child_latency_ns = g_renew(int64_t, s->child_latency_ns,
+                                  s->num_children + 1);
+    s->child_latency_ns[s->num_children] = 0;
     s->children[s->num_children++] = child;
     quorum_refresh_flags(bs);
 
@@ -1131,7 +1312,11 @@ static void quorum_del_child(BlockDriverState *bs, BdrvChild *child,
     /* We can safely remove this child now */
     memmove(&s->children[i], &s->children[i + 1],
             (s->num_children - i - 1) * sizeof(BdrvChild *));
+    memmove(&s->child_latency_ns[i], &s->child_latency_ns[i + 1],
+            (s->num_children - i - 1) * sizeof(int64_t));
     s->children = g_renew(BdrvChild *, s->children, --s->num_children);
+    s->child_latency_ns = g_renew(int64_t, s->child_latency_ns,
+                                  s->num_children);
     bdrv_unref_child(bs, child);
 
     quorum_refresh_flags(bs);
@@ -15,6 +15,7 @@
 #include "qemu/osdep.h"
 #include "qemu/module.h"
 #include "qemu/option.h"
+#include "qemu/timer.h"
 #include "block/nbd.h"
 #include "block/blockjob.h"
 #include "block/block_int.h"
@@ -45,12 +46,29 @@ typedef struct BDRVReplicationState {
     bool orig_hidden_read_only;
     bool orig_secondary_read_only;
     int error;
+    /*
+     * Statistics for query-block-replication-stats.  Guest flushes on
+     * the secondary are deferred and issued once per checkpoint epoch:
+     * the active and hidden disks are emptied at every checkpoint
+     * anyway, so only the secondary disk has to reach stable storage,
+     * and only when the epoch is sealed.
+     */
+    bool flush_pending;
+    uint64_t writes;
+    uint64_t write_bytes;
+    uint64_t epoch_writes;
+    uint64_t epoch_write_bytes;
+    uint64_t flushes_deferred;
+    uint64_t checkpoints;
+    int64_t last_checkpoint_ms;
 } BDRVReplicationState;
 
 static void replication_start(ReplicationState *rs, ReplicationMode mode,
                               Error **errp);
 static void replication_do_checkpoint(ReplicationState *rs, Error **errp);
 static void replication_get_error(ReplicationState *rs, Error **errp);
+static void replication_get_stats(ReplicationState *rs,
+                                  ReplicationStats *stats);
 static void replication_stop(ReplicationState *rs, bool failover,
                              Error **errp);
 
@@ -76,6 +94,7 @@ static ReplicationOps replication_ops = {
     .start = replication_start,
     .checkpoint = replication_do_checkpoint,
     .get_error = replication_get_error,
+    .get_stats = replication_get_stats,
     .stop = replication_stop,
 };
 
@@ -269,6 +288,12 @@ static coroutine_fn int replication_co_writev(BlockDriverState *bs,
     if (ret == 0) {
         ret = bdrv_co_pwritev(top, sector_num * BDRV_SECTOR_SIZE,
                               remaining_sectors * BDRV_SECTOR_SIZE, qiov, 0);
+        if (ret == 0) {
+            s->writes++;
+            s->write_bytes += remaining_sectors * BDRV_SECTOR_SIZE;
+            s->epoch_writes++;
+            s->epoch_write_bytes += remaining_sectors * BDRV_SECTOR_SIZE;
+        }
         return replication_return_value(s, ret);
     }
 
@@ -311,6 +336,25 @@ out:
     return ret;
 }
 
+static coroutine_fn int replication_co_flush(BlockDriverState *bs)
+{
+    BDRVReplicationState *s = bs->opaque;
+
+    /*
+     * On a running secondary, a checkpoint already makes the epoch
+     * recoverable; defer the flush to secondary_do_checkpoint() so that
+     * each epoch pays for at most one flush of the secondary disk.
+     */
+    if (s->mode == REPLICATION_MODE_SECONDARY &&
+        s->stage == BLOCK_REPLICATION_RUNNING) {
+        s->flush_pending = true;
+        s->flushes_deferred++;
+        return 0;
+    }
+
+    return bdrv_co_flush(bs->file->bs);
+}
+
 static void secondary_do_checkpoint(BlockDriverState *bs, Error **errp)
 {
     BDRVReplicationState *s = bs->opaque;
@@ -350,6 +394,20 @@ static void secondary_do_checkpoint(BlockDriverState *bs, Error **errp)
     if (ret < 0) {
         return;
     }
+
+    if (s->flush_pending) {
+        ret = bdrv_flush(s->secondary_disk->bs);
+        if (ret < 0) {
+            error_setg_errno(errp, -ret, "Could not flush secondary disk");
+            return;
+        }
+        s->flush_pending = false;
+    }
+
+    s->checkpoints++;
+    s->epoch_writes = 0;
+    s->epoch_write_bytes = 0;
+    s->last_checkpoint_ms = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
 }
 
 /* This function is supposed to be called twice:
@@ -644,6 +702,30 @@ static void replication_do_checkpoint(ReplicationState *rs, Error **errp)
     aio_context_release(aio_context);
 }
 
+static void replication_get_stats(ReplicationState *rs,
+                                  ReplicationStats *stats)
+{
+    BlockDriverState *bs = rs->opaque;
+    BDRVReplicationState *s;
+    AioContext *aio_context;
+
+    aio_context = bdrv_get_aio_context(bs);
+    aio_context_acquire(aio_context);
+    s = bs->opaque;
+
+    stats->writes += s->writes;
+    stats->write_bytes += s->write_bytes;
+    stats->epoch_writes += s->epoch_writes;
+    stats->epoch_write_bytes += s->epoch_write_bytes;
+    stats->flushes_deferred += s->flushes_deferred;
+    stats->checkpoints += s->checkpoints;
+    if (s->checkpoints && s->last_checkpoint_ms > stats->last_checkpoint_ms) {
+        stats->last_checkpoint_ms = s->last_checkpoint_ms;
+    }
+
+    aio_context_release(aio_context);
+}
+
 static void replication_get_error(ReplicationState *rs, Error **errp)
 {
     BlockDriverState *bs = rs->opaque;
@@ -767,6 +849,7 @@ static BlockDriver bdrv_replication = {
     .bdrv_getlength             = replication_getlength,
     .bdrv_co_readv              = replication_co_readv,
     .bdrv_co_writev             = replication_co_writev,
+    .bdrv_co_flush              = replication_co_flush,
 
     .is_filter                  = true,
 
@@ -21,15 +21,7 @@
 #include "qemu/ratelimit.h"
 #include "sysemu/block-backend.h"
 #include "block/copy-on-read.h"
-
-enum {
-    /*
-     * Maximum chunk size to feed to copy-on-read.  This should be
-     * large enough to process multiple clusters in a single call, so
-     * that populating contiguous regions of the image is efficient.
-     */
-    STREAM_CHUNK = 512 * 1024, /* in bytes */
-};
+#include "block/copy-window.h"
 
 typedef struct StreamBlockJob {
     BlockJob common;
@@ -50,6 +42,14 @@ static int coroutine_fn stream_populate(BlockBackend *blk,
     return blk_co_preadv(blk, offset, bytes, NULL, BDRV_REQ_PREFETCH);
 }
 
+static int coroutine_fn stream_copy_cb(void *opaque, int64_t offset,
+                                       int64_t bytes, bool *error_is_read)
+{
+    StreamBlockJob *s = opaque;
+
+    return stream_populate(s->common.blk, offset, bytes);
+}
+
 static int stream_prepare(Job *job)
 {
     StreamBlockJob *s = container_of(job, StreamBlockJob, common.job);
@@ -105,10 +105,11 @@ static void stream_clean(Job *job)
 static int coroutine_fn stream_run(Job *job, Error **errp)
 {
     StreamBlockJob *s = container_of(job, StreamBlockJob, common.job);
-    BlockBackend *blk = s->common.blk;
     BlockDriverState *unfiltered_bs = bdrv_skip_filters(s->target_bs);
+    CopyWindow *cw;
     int64_t len;
     int64_t offset = 0;
+    int64_t counted = 0;
     uint64_t delay_ns = 0;
     int error = 0;
     int64_t n = 0; /* bytes */
@@ -124,9 +125,12 @@ static int coroutine_fn stream_run(Job *job, Error **errp)
     }
     job_progress_set_remaining(&s->common.job, len);
 
-    for ( ; offset < len; offset += n) {
+    cw = copy_window_new(&s->common.job, stream_copy_cb, s);
+
+    for ( ; ; offset += n) {
         bool copy;
         int ret;
+        int64_t error_offset;
 
         /* Note that even when no rate limit is applied we need to yield
          * with no pending I/O here so that bdrv_drain_all() returns.
@@ -137,8 +141,38 @@ static int coroutine_fn stream_run(Job *job, Error **errp)
         }
 
         copy = false;
+        n = 0;
+        delay_ns = 0;
+
+        /* Surface errors of copies that completed in the background */
+        if (offset >= len) {
+            /* The scan is done, wait for the copies still in flight */
+            ret = copy_window_co_drain(cw, &error_offset, NULL);
+        } else {
+            ret = copy_window_error(cw, &error_offset, NULL);
+        }
+        if (ret < 0) {
+            BlockErrorAction action =
+                block_job_error_action(&s->common, s->on_error, true, -ret);
+            if (action == BLOCK_ERROR_ACTION_STOP) {
+                /* Retry from the failed chunk once the job is resumed */
+                offset = MIN(offset, error_offset);
+                continue;
+            }
+            if (error == 0) {
+                error = ret;
+            }
+            if (action == BLOCK_ERROR_ACTION_REPORT) {
+                break;
+            }
+            continue;
+        }
+        if (offset >= len) {
+            break;
+        }
 
-        ret = bdrv_is_allocated(unfiltered_bs, offset, STREAM_CHUNK, &n);
+        ret = bdrv_is_allocated(unfiltered_bs, offset, copy_window_chunk(cw),
+                                &n);
         if (ret == 1) {
             /* Allocated in the top, no need to copy.  */
         } else if (ret >= 0) {
@@ -155,9 +189,6 @@ static int coroutine_fn stream_run(Job *job, Error **errp)
             copy = (ret > 0);
         }
         trace_stream_one_iteration(s, offset, n, ret);
-        if (copy) {
-            ret = stream_populate(blk, offset, n);
-        }
         if (ret < 0) {
             BlockErrorAction action =
                 block_job_error_action(&s->common, s->on_error, true, -ret);
@@ -172,16 +203,26 @@ static int coroutine_fn stream_run(Job *job, Error **errp)
                 break;
             }
         }
-
-        /* Publish progress */
-        job_progress_update(&s->common.job, n);
         if (copy) {
+            copy_window_co_submit(cw, offset, n);
             delay_ns = block_job_ratelimit_get_delay(&s->common, n);
-        } else {
-            delay_ns = 0;
+        }
+
+        /* Publish progress.  Copied chunks are published when they complete,
+         * and a region that was rescanned after an error must not be counted
+         * a second time.
+         */
+        if (offset + n > counted) {
+            if (!copy) {
+                job_progress_update(&s->common.job,
+                                    offset + n - MAX(offset, counted));
+            }
+            counted = offset + n;
         }
     }
 
+    copy_window_co_free(cw);
+
     /* Do not remove the backing file if an error was there but ignored. */
     return error;
 }
@@ -77,6 +77,14 @@ struct ThrottleGroup {
     bool any_timer_armed[2];
     QEMUClockType clock_type;
 
+    /* Credit handed to a member per refill of its batched accounting
+     * fast path, zero if the fast path is disabled for that direction.
+     * Written under the lock; the generation is bumped on every config
+     * change and read with atomics by the fast path. */
+    int64_t batch_bytes[2];
+    int64_t batch_ops[2];
+    unsigned batch_generation;
+
     /* This field is protected by the global QEMU mutex */
     QTAILQ_ENTRY(ThrottleGroup) list;
 };
@@ -254,6 +262,83 @@ static ThrottleGroupMember *next_throttle_token(ThrottleGroupMember *tgm,
     return token;
 }
 
+/* Size of the credit batch handed to a member on each refill of the
+ * accounting fast path, expressed in seconds worth of traffic at the
+ * configured limit. */
+#define THROTTLE_BATCH_WINDOW 0.01
+
+/* Recompute the per-refill fast path credit from the current
+ * configuration and invalidate the credit that is already handed out.
+ *
+ * This assumes that tg->lock is held (or that the group is not yet
+ * visible to other threads).
+ */
+static void throttle_group_update_batch(ThrottleGroup *tg)
+{
+    static const BucketType bps_types[2][2] = {
+        { THROTTLE_BPS_TOTAL, THROTTLE_BPS_READ },
+        { THROTTLE_BPS_TOTAL, THROTTLE_BPS_WRITE }
+    };
+    static const BucketType ops_types[2][2] = {
+        { THROTTLE_OPS_TOTAL, THROTTLE_OPS_READ },
+        { THROTTLE_OPS_TOTAL, THROTTLE_OPS_WRITE }
+    };
+    ThrottleConfig *cfg = &tg->ts.cfg;
+    unsigned rw, i;
+
+    for (rw = 0; rw < 2; rw++) {
+        double bps = 0, iops = 0;
+        bool burst = false;
+
+        for (i = 0; i < 2; i++) {
+            LeakyBucket *b = &cfg->buckets[bps_types[rw][i]];
+            LeakyBucket *u = &cfg->buckets[ops_types[rw][i]];
+
+            if (b->avg && (!bps || b->avg < bps)) {
+                bps = b->avg;
+            }
+            if (u->avg && (!iops || u->avg < iops)) {
+                iops = u->avg;
+            }
+            burst |= b->max || u->max;
+        }
+
+        if (burst) {
+            /* Explicit burst limits need precise accounting */
+            tg->batch_bytes[rw] = 0;
+            tg->batch_ops[rw] = 0;
+        } else {
+            tg->batch_bytes[rw] = bps ?
+                MAX((int64_t)(bps * THROTTLE_BATCH_WINDOW), 1) : INT64_MAX;
+            tg->batch_ops[rw] = iops ?
+                MAX((int64_t)(iops * THROTTLE_BATCH_WINDOW), 1) : INT64_MAX;
+        }
+    }
+
+    qatomic_set(&tg->batch_generation, tg->batch_generation + 1);
+}
+
+/* Charge the traffic that the fast path admitted to the shared bucket.
+ *
+ * This assumes that tg->lock is held and that no request of @tgm can be
+ * in the fast path concurrently (it runs from the member's home thread,
+ * or the member is drained).
+ */
+static void throttle_group_flush_unaccounted(ThrottleGroupMember *tgm)
+{
+    unsigned rw;
+
+    for (rw = 0; rw < 2; rw++) {
+        if (tgm->unaccounted_bytes[rw] || tgm->unaccounted_units[rw]) {
+            throttle_account_batch(tgm->throttle_state, rw,
+                                   tgm->unaccounted_bytes[rw],
+                                   tgm->unaccounted_units[rw]);
+            tgm->unaccounted_bytes[rw] = 0;
+            tgm->unaccounted_units[rw] = 0;
+        }
+    }
+}
+
 /* Check if the next I/O request for a ThrottleGroupMember needs to be
  * throttled or not. If there's no timer set in this group, set one and update
  * the token accordingly.
@@ -365,16 +450,43 @@ void coroutine_fn throttle_group_co_io_limits_intercept(ThrottleGroupMember *tgm
     ThrottleGroupMember *token;
     ThrottleGroup *tg = container_of(tgm->throttle_state, ThrottleGroup, ts);
 
+    bool waited;
+
     assert(bytes >= 0);
 
+    /* Fast path: consume pre-admitted credit without taking the group
+     * lock.  The traffic is charged to the shared bucket in one go the
+     * next time this member takes the slow path, so other members see
+     * it with a delay of at most one credit batch.
+     */
+    if (tgm->batch_credit_ops[is_write] > 0 &&
+        tgm->batch_credit_bytes[is_write] >= bytes &&
+        !tgm->pending_reqs[is_write] &&
+        qatomic_read(&tg->batch_generation) == tgm->batch_generation) {
+        tgm->batch_credit_ops[is_write]--;
+        tgm->batch_credit_bytes[is_write] -= bytes;
+        tgm->unaccounted_bytes[is_write] += bytes;
+        if (tgm->batch_op_size && bytes > tgm->batch_op_size) {
+            tgm->unaccounted_units[is_write] +=
+                (double) bytes / tgm->batch_op_size;
+        } else {
+            tgm->unaccounted_units[is_write] += 1.0;
+        }
+        return;
+    }
+
     qemu_mutex_lock(&tg->lock);
 
+    /* Catch up on the traffic that the fast path admitted */
+    throttle_group_flush_unaccounted(tgm);
+
     /* First we check if this I/O has to be throttled. */
     token = next_throttle_token(tgm, is_write);
     must_wait = throttle_group_schedule_timer(token, is_write);
 
     /* Wait if there's a timer set or queued requests of this type */
-    if (must_wait || tgm->pending_reqs[is_write]) {
+    waited = must_wait || tgm->pending_reqs[is_write];
+    if (waited) {
         tgm->pending_reqs[is_write]++;
         qemu_mutex_unlock(&tg->lock);
         qemu_co_mutex_lock(&tgm->throttled_reqs_lock);
@@ -391,6 +503,20 @@ void coroutine_fn throttle_group_co_io_limits_intercept(ThrottleGroupMember *tgm
     /* Schedule the next request */
     schedule_next_request(tgm, is_write);
 
+    /* Refill the fast-path credit, but only while the group is not
+     * saturated: under throttling pressure every request must go
+     * through the precise slow path accounting above.
+     */
+    if (!waited && !tg->any_timer_armed[is_write]) {
+        tgm->batch_credit_bytes[is_write] = tg->batch_bytes[is_write];
+        tgm->batch_credit_ops[is_write] = tg->batch_ops[is_write];
+    } else {
+        tgm->batch_credit_bytes[is_write] = 0;
+        tgm->batch_credit_ops[is_write] = 0;
+    }
+    tgm->batch_op_size = tg->ts.cfg.op_size;
+    tgm->batch_generation = qatomic_read(&tg->batch_generation);
+
     qemu_mutex_unlock(&tg->lock);
 }
 
@@ -475,6 +601,7 @@ void throttle_group_config(ThrottleGroupMember *tgm, ThrottleConfig *cfg)
     ThrottleGroup *tg = container_of(ts, ThrottleGroup, ts);
     qemu_mutex_lock(&tg->lock);
     throttle_config(ts, tg->clock_type, cfg);
+    throttle_group_update_batch(tg);
     qemu_mutex_unlock(&tg->lock);
 
     throttle_group_restart_tgm(tgm);
@@ -596,6 +723,8 @@ void throttle_group_unregister_tgm(ThrottleGroupMember *tgm)
     AIO_WAIT_WHILE(tgm->aio_context, qatomic_read(&tgm->restart_pending) > 0);
 
     WITH_QEMU_LOCK_GUARD(&tg->lock) {
+        /* The member is drained, settle its fast-path accounting */
+        throttle_group_flush_unaccounted(tgm);
         for (i = 0; i < 2; i++) {
             assert(tgm->pending_reqs[i] == 0);
             assert(qemu_co_queue_empty(&tgm->throttled_reqs[i]));
@@ -789,6 +918,7 @@ static void throttle_group_obj_complete(UserCreatable *obj, Error **errp)
         return;
     }
     throttle_config(&tg->ts, tg->clock_type, &cfg);
+    throttle_group_update_batch(tg);
     QTAILQ_INSERT_TAIL(&throttle_groups, tg, list);
     tg->is_initialized = true;
 }
@@ -900,6 +1030,7 @@ static void throttle_group_set_limits(Object *obj, Visitor *v,
         goto unlock;
     }
     throttle_config(&tg->ts, tg->clock_type, &cfg);
+    throttle_group_update_batch(tg);
 
 unlock:
     qemu_mutex_unlock(&tg->lock);
@@ -35,6 +35,7 @@
 #include "qemu/bswap.h"
 #include "migration/blocker.h"
 #include "qemu/cutils.h"
+#include "block/thread-pool.h"
 #include <zlib.h>
 
 #define VMDK3_MAGIC (('C' << 24) | ('O' << 16) | ('W' << 8) | 'D')
@@ -130,6 +131,8 @@ typedef struct VMDKSESparseVolatileHeader {
 } QEMU_PACKED VMDKSESparseVolatileHeader;
 
 #define L2_CACHE_SIZE 16
+/* number of decompressed grains kept around for compressed extents */
+#define GRAIN_CACHE_SIZE 16
 
 typedef struct VmdkExtent {
     BdrvChild *file;
@@ -157,6 +160,16 @@ typedef struct VmdkExtent {
     uint32_t l2_cache_offsets[L2_CACHE_SIZE];
     uint32_t l2_cache_counts[L2_CACHE_SIZE];
 
+    /*
+     * Most recently decompressed grains, keyed by the file offset of the
+     * compressed grain and replaced with the same usage-count scheme as
+     * the L2 cache.  Allocated on first compressed read.
+     */
+    uint8_t *grain_cache;
+    int64_t grain_cache_offsets[GRAIN_CACHE_SIZE];
+    uint32_t grain_cache_counts[GRAIN_CACHE_SIZE];
+    uint32_t grain_cache_lens[GRAIN_CACHE_SIZE];
+
     int64_t cluster_sectors;
     int64_t next_cluster_sector;
     char *type;
@@ -270,6 +283,7 @@ static void vmdk_free_extents(BlockDriverState *bs)
         e = &s->extents[i];
         g_free(e->l1_table);
         g_free(e->l2_cache);
+        g_free(e->grain_cache);
         g_free(e->l1_backup_table);
         g_free(e->type);
         if (e->file != bs->file) {
@@ -1787,6 +1801,18 @@ static int vmdk_write_extent(VmdkExtent *extent, int64_t cluster_offset,
         n_bytes = buf_len + sizeof(VmdkGrainMarker);
         qemu_iovec_init_buf(&local_qiov, data, n_bytes);
 
+        /* drop a stale decompressed copy of this grain, if any */
+        if (extent->grain_cache) {
+            int i;
+
+            for (i = 0; i < GRAIN_CACHE_SIZE; i++) {
+                if (extent->grain_cache_offsets[i] == cluster_offset) {
+                    extent->grain_cache_offsets[i] = 0;
+                    extent->grain_cache_counts[i] = 0;
+                }
+            }
+        }
+
         BLKDBG_EVENT(extent->file, BLKDBG_WRITE_COMPRESSED);
     } else {
         qemu_iovec_init(&local_qiov, qiov->niov);
@@ -1820,16 +1846,34 @@ static int vmdk_write_extent(VmdkExtent *extent, int64_t cluster_offset,
     return ret;
 }
 
+typedef struct VmdkUncompressData {
+    uint8_t *dest;
+    uLongf dest_len;
+    const uint8_t *src;
+    uint32_t src_len;
+} VmdkUncompressData;
+
+static int vmdk_uncompress_worker(void *opaque)
+{
+    VmdkUncompressData *data = opaque;
+
+    return uncompress(data->dest, &data->dest_len, data->src, data->src_len);
+}
+
 static int vmdk_read_extent(VmdkExtent *extent, int64_t cluster_offset,
                             int64_t offset_in_cluster, QEMUIOVector *qiov,
                             int bytes)
 {
     int ret;
+    int i, j, min_index = 0;
+    uint32_t min_count = UINT_MAX;
     int cluster_bytes, buf_bytes;
     uint8_t *cluster_buf, *compressed_data;
     uint8_t *uncomp_buf;
     uint32_t data_len;
     VmdkGrainMarker *marker;
+    VmdkUncompressData udata;
+    ThreadPool *pool;
     uLongf buf_len;
 
 
@@ -1844,6 +1888,32 @@ static int vmdk_read_extent(VmdkExtent *extent, int64_t cluster_offset,
         return 0;
     }
     cluster_bytes = extent->cluster_sectors * 512;
+
+    /*
+     * Serve repeated (e.g. sub-grain random) reads of the same grain
+     * from the decompressed grain cache.  No yield happens between the
+     * lookup and the copy-out, so the entry cannot be replaced under us.
+     */
+    if (extent->grain_cache) {
+        for (i = 0; i < GRAIN_CACHE_SIZE; i++) {
+            if (extent->grain_cache_offsets[i] == cluster_offset) {
+                if (++extent->grain_cache_counts[i] == UINT32_MAX) {
+                    for (j = 0; j < GRAIN_CACHE_SIZE; j++) {
+                        extent->grain_cache_counts[j] >>= 1;
+                    }
+                }
+                if (offset_in_cluster < 0 ||
+                    offset_in_cluster + bytes > extent->grain_cache_lens[i]) {
+                    return -EINVAL;
+                }
+                qemu_iovec_from_buf(qiov, 0,
+                                    extent->grain_cache + i * cluster_bytes
+                                    + offset_in_cluster, bytes);
+                return 0;
+            }
+        }
+    }
+
     /* Read two clusters in case GrainMarker + compressed data > one cluster */
     buf_bytes = cluster_bytes * 2;
     cluster_buf = g_malloc(buf_bytes);
@@ -1867,18 +1937,49 @@ static int vmdk_read_extent(VmdkExtent *extent, int64_t cluster_offset,
         ret = -EINVAL;
         goto out;
     }
-    ret = uncompress(uncomp_buf, &buf_len, compressed_data, data_len);
+    /*
+     * Decompress in a worker thread, so concurrent reads of different
+     * grains inflate in parallel instead of serializing on the
+     * iothread.  The private bounce buffer keeps the worker from ever
+     * touching the shared grain cache.
+     */
+    udata = (VmdkUncompressData) {
+        .dest = uncomp_buf,
+        .dest_len = buf_len,
+        .src = compressed_data,
+        .src_len = data_len,
+    };
+    pool = aio_get_thread_pool(bdrv_get_aio_context(extent->file->bs));
+    ret = thread_pool_submit_co(pool, vmdk_uncompress_worker, &udata);
     if (ret != Z_OK) {
         ret = -EINVAL;
         goto out;
 
     }
+    buf_len = udata.dest_len;
     if (offset_in_cluster < 0 ||
             offset_in_cluster + bytes > buf_len) {
         ret = -EINVAL;
         goto out;
     }
     qemu_iovec_from_buf(qiov, 0, uncomp_buf + offset_in_cluster, bytes);
+
+    /* Install the grain in the cache, replacing the least used entry */
+    if (!extent->grain_cache) {
+        extent->grain_cache = g_malloc((size_t)cluster_bytes *
+                                       GRAIN_CACHE_SIZE);
+    }
+    for (i = 0; i < GRAIN_CACHE_SIZE; i++) {
+        if (extent->grain_cache_counts[i] < min_count) {
+            min_count = extent->grain_cache_counts[i];
+            min_index = i;
+        }
+    }
+    memcpy(extent->grain_cache + min_index * cluster_bytes,
+           uncomp_buf, buf_len);
+    extent->grain_cache_offsets[min_index] = cluster_offset;
+    extent->grain_cache_counts[min_index] = 1;
+    extent->grain_cache_lens[min_index] = buf_len;
     ret = 0;
 
  out:
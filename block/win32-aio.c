@@ -29,6 +29,7 @@
 #include "block/raw-aio.h"
 #include "qemu/event_notifier.h"
 #include "qemu/iov.h"
+#include "qemu/queue.h"
 #include <windows.h>
 #include <winioctl.h>
 
@@ -36,23 +37,33 @@
 #define FTYPE_CD     1
 #define FTYPE_HARDDISK 2
 
+/* completion entries dequeued per GetQueuedCompletionStatusEx() call */
+#define WIN32_AIO_COMPLETION_BATCH 128
+
+typedef struct QEMUWin32AIOCB QEMUWin32AIOCB;
+
 struct QEMUWin32AIOState {
     HANDLE hIOCP;
     EventNotifier e;
     int count;
     AioContext *aio_ctx;
+    /* requests queued while plugged, submitted at unplug */
+    unsigned int plugged;
+    QSIMPLEQ_HEAD(, QEMUWin32AIOCB) pending;
 };
 
-typedef struct QEMUWin32AIOCB {
+struct QEMUWin32AIOCB {
     BlockAIOCB common;
     struct QEMUWin32AIOState *ctx;
+    HANDLE hfile;
     int nbytes;
     OVERLAPPED ov;
     QEMUIOVector *qiov;
     void *buf;
     bool is_read;
     bool is_linear;
-} QEMUWin32AIOCB;
+    QSIMPLEQ_ENTRY(QEMUWin32AIOCB) pending;
+};
 
 /*
  * Completes an AIO request (calls the callback and frees the ACB).
@@ -93,15 +104,26 @@ static void win32_aio_process_completion(QEMUWin32AIOState *s,
 static void win32_aio_completion_cb(EventNotifier *e)
 {
     QEMUWin32AIOState *s = container_of(e, QEMUWin32AIOState, e);
-    DWORD count;
-    ULONG_PTR key;
-    OVERLAPPED *ov;
+    OVERLAPPED_ENTRY entries[WIN32_AIO_COMPLETION_BATCH];
+    ULONG num, i;
 
     event_notifier_test_and_clear(&s->e);
-    while (GetQueuedCompletionStatus(s->hIOCP, &count, &key, &ov, 0)) {
-        QEMUWin32AIOCB *waiocb = container_of(ov, QEMUWin32AIOCB, ov);
+    /*
+     * Drain the port in batches instead of one syscall per completion.
+     * Unlike GetQueuedCompletionStatus(), the Ex variant also dequeues
+     * failed requests; win32_aio_process_completion() picks the error
+     * up from ov.Internal.
+     */
+    while (GetQueuedCompletionStatusEx(s->hIOCP, entries,
+                                       WIN32_AIO_COMPLETION_BATCH, &num, 0,
+                                       FALSE) && num > 0) {
+        for (i = 0; i < num; i++) {
+            OVERLAPPED *ov = entries[i].lpOverlapped;
+            QEMUWin32AIOCB *waiocb = container_of(ov, QEMUWin32AIOCB, ov);
 
-        win32_aio_process_completion(s, waiocb, count);
+            win32_aio_process_completion(s, waiocb,
+                entries[i].dwNumberOfBytesTransferred);
+        }
     }
 }
 
@@ -109,15 +131,45 @@ static const AIOCBInfo win32_aiocb_info = {
     .aiocb_size         = sizeof(QEMUWin32AIOCB),
 };
 
+static int win32_aio_do_submit(QEMUWin32AIOState *aio, QEMUWin32AIOCB *waiocb)
+{
+    DWORD rc;
+
+    if (waiocb->is_read) {
+        rc = ReadFile(waiocb->hfile, waiocb->buf, waiocb->nbytes, NULL,
+                      &waiocb->ov);
+    } else {
+        rc = WriteFile(waiocb->hfile, waiocb->buf, waiocb->nbytes, NULL,
+                       &waiocb->ov);
+    }
+    if (rc == 0 && GetLastError() != ERROR_IO_PENDING) {
+        return -EIO;
+    }
+    return 0;
+}
+
+static void win32_aio_submit_failed_bh(void *opaque)
+{
+    QEMUWin32AIOCB *waiocb = opaque;
+
+    waiocb->ctx->count--;
+    if (!waiocb->is_linear) {
+        qemu_vfree(waiocb->buf);
+    }
+    waiocb->common.cb(waiocb->common.opaque, -EIO);
+    qemu_aio_unref(waiocb);
+}
+
 BlockAIOCB *win32_aio_submit(BlockDriverState *bs,
         QEMUWin32AIOState *aio, HANDLE hfile,
         uint64_t offset, uint64_t bytes, QEMUIOVector *qiov,
         BlockCompletionFunc *cb, void *opaque, int type)
 {
     struct QEMUWin32AIOCB *waiocb;
-    DWORD rc;
 
     waiocb = qemu_aio_get(&win32_aiocb_info, bs, cb, opaque);
+    waiocb->ctx = aio;
+    waiocb->hfile = hfile;
     waiocb->nbytes = bytes;
     waiocb->qiov = qiov;
     waiocb->is_read = (type == QEMU_AIO_READ);
@@ -143,12 +195,12 @@ BlockAIOCB *win32_aio_submit(BlockDriverState *bs,
 
     aio->count++;
 
-    if (type & QEMU_AIO_READ) {
-        rc = ReadFile(hfile, waiocb->buf, waiocb->nbytes, NULL, &waiocb->ov);
-    } else {
-        rc = WriteFile(hfile, waiocb->buf, waiocb->nbytes, NULL, &waiocb->ov);
+    if (aio->plugged) {
+        QSIMPLEQ_INSERT_TAIL(&aio->pending, waiocb, pending);
+        return &waiocb->common;
     }
-    if(rc == 0 && GetLastError() != ERROR_IO_PENDING) {
+
+    if (win32_aio_do_submit(aio, waiocb) < 0) {
         goto out_dec_count;
     }
     return &waiocb->common;
@@ -160,6 +212,36 @@ out:
     return NULL;
 }
 
+void win32_aio_io_plug(QEMUWin32AIOState *aio)
+{
+    aio->plugged++;
+}
+
+void win32_aio_io_unplug(QEMUWin32AIOState *aio)
+{
+    assert(aio->plugged);
+    if (--aio->plugged > 0) {
+        return;
+    }
+
+    while (!QSIMPLEQ_EMPTY(&aio->pending)) {
+        QEMUWin32AIOCB *waiocb = QSIMPLEQ_FIRST(&aio->pending);
+
+        QSIMPLEQ_REMOVE_HEAD(&aio->pending, pending);
+        if (win32_aio_do_submit(aio, waiocb) < 0) {
+            /*
+             * The BlockAIOCB was already returned to the caller, so the
+             * error has to be delivered through the completion callback.
+             * Do that from a bottom half like a normal completion; the
+             * caller of bdrv_io_unplug() does not expect callbacks to
+             * run here.
+             */
+            aio_bh_schedule_oneshot(aio->aio_ctx, win32_aio_submit_failed_bh,
+                                    waiocb);
+        }
+    }
+}
+
 int win32_aio_attach(QEMUWin32AIOState *aio, HANDLE hfile)
 {
     if (CreateIoCompletionPort(hfile, aio->hIOCP, (ULONG_PTR) 0, 0) == NULL) {
@@ -198,6 +280,8 @@ QEMUWin32AIOState *win32_aio_init(void)
         goto out_close_efd;
     }
 
+    QSIMPLEQ_INIT(&s->pending);
+
     return s;
 
 out_close_efd:
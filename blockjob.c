@@ -59,6 +59,75 @@ static bool is_block_job(Job *job)
            job_type(job) == JOB_TYPE_STREAM;
 }
 
+/*
+ * Jobs whose main node is the same share one token bucket, so that they
+ * split the bandwidth of the resource they compete for instead of each
+ * applying its speed limit independently.  The aggregate quota is the
+ * largest speed set among the members.
+ *
+ * The registry is only accessed from the main loop (job creation, speed
+ * changes, job deletion), like the job list itself; the token bucket has
+ * its own lock and may be used from any AioContext.
+ */
+struct BlockJobRateGroup {
+    BlockDriverState *bs;
+    RateLimit limit;
+    int refcnt;
+    QLIST_ENTRY(BlockJobRateGroup) list;
+};
+
+static QLIST_HEAD(, BlockJobRateGroup) block_job_rate_groups =
+    QLIST_HEAD_INITIALIZER(block_job_rate_groups);
+
+static BlockJobRateGroup *block_job_rate_group_ref(BlockDriverState *bs)
+{
+    BlockJobRateGroup *group;
+
+    QLIST_FOREACH(group, &block_job_rate_groups, list) {
+        if (group->bs == bs) {
+            group->refcnt++;
+            return group;
+        }
+    }
+
+    group = g_new0(BlockJobRateGroup, 1);
+    group->bs = bs;
+    group->refcnt = 1;
+    ratelimit_init(&group->limit);
+    QLIST_INSERT_HEAD(&block_job_rate_groups, group, list);
+    return group;
+}
+
+/* Recompute the aggregate quota from the speeds of all member jobs */
+static void block_job_rate_group_update_speed(BlockJobRateGroup *group)
+{
+    BlockJob *member;
+    int64_t speed = 0;
+
+    for (member = block_job_next(NULL); member;
+         member = block_job_next(member)) {
+        if (member->rate_group == group) {
+            speed = MAX(speed, member->speed);
+        }
+    }
+    ratelimit_set_speed(&group->limit, speed, BLOCK_JOB_SLICE_TIME);
+}
+
+static void block_job_rate_group_unref(BlockJob *job)
+{
+    BlockJobRateGroup *group = job->rate_group;
+
+    job->rate_group = NULL;
+    if (--group->refcnt > 0) {
+        /* This job's speed no longer counts towards the quota */
+        block_job_rate_group_update_speed(group);
+        return;
+    }
+    QLIST_REMOVE(group, list);
+    ratelimit_destroy(&group->limit);
+    g_free(group);
+}
+
 BlockJob *block_job_next(BlockJob *bjob)
 {
     Job *job = bjob ? &bjob->job : NULL;
@@ -87,7 +156,7 @@ void block_job_free(Job *job)
 
     block_job_remove_all_bdrv(bjob);
     blk_unref(bjob->blk);
-    ratelimit_destroy(&bjob->limit);
+    block_job_rate_group_unref(bjob);
     error_free(bjob->blocker);
 }
 
@@ -280,9 +349,8 @@ bool block_job_set_speed(BlockJob *job, int64_t speed, Error **errp)
         return false;
     }
 
-    ratelimit_set_speed(&job->limit, speed, BLOCK_JOB_SLICE_TIME);
-
     job->speed = speed;
+    block_job_rate_group_update_speed(job->rate_group);
 
     if (drv->set_speed) {
         drv->set_speed(job, speed);
@@ -300,7 +368,13 @@ bool block_job_set_speed(BlockJob *job, int64_t speed, Error **errp)
 
 int64_t block_job_ratelimit_get_delay(BlockJob *job, uint64_t n)
 {
-    return ratelimit_calculate_delay(&job->limit, n);
+    job->job.io_bytes += n;
+    return ratelimit_calculate_delay(&job->rate_group->limit, n);
+}
+
+RateLimit *block_job_rate_limit(BlockJob *job)
+{
+    return &job->rate_group->limit;
 }
 
 BlockJobInfo *block_job_query(BlockJob *job, Error **errp)
@@ -456,7 +530,7 @@ void *block_job_create(const char *job_id, const BlockJobDriver *driver,
     assert(job->job.driver->free == &block_job_free);
     assert(job->job.driver->user_resume == &block_job_user_resume);
 
-    ratelimit_init(&job->limit);
+    job->rate_group = block_job_rate_group_ref(bs);
 
     job->blk = blk;
 
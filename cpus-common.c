@@ -123,12 +123,23 @@ struct qemu_work_item {
 
 static void queue_work_on_cpu(CPUState *cpu, struct qemu_work_item *wi)
 {
+    bool was_empty;
+
     qemu_mutex_lock(&cpu->work_mutex);
+    was_empty = QSIMPLEQ_EMPTY(&cpu->work_list);
     QSIMPLEQ_INSERT_TAIL(&cpu->work_list, wi, node);
     wi->done = false;
     qemu_mutex_unlock(&cpu->work_mutex);
 
-    qemu_cpu_kick(cpu);
+    /*
+     * If the list was non-empty, the vCPU has already been kicked for the
+     * earlier item and process_queued_cpu_work() drains the whole list in
+     * one pass (re-checking it under work_mutex), so callers posting a
+     * burst of work items pay for a single wakeup IPI.
+     */
+    if (was_empty) {
+        qemu_cpu_kick(cpu);
+    }
 }
 
 void do_run_on_cpu(CPUState *cpu, run_on_cpu_func func, run_on_cpu_data data,
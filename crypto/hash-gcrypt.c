@@ -111,6 +111,63 @@ qcrypto_gcrypt_hash_bytesv(QCryptoHashAlgorithm alg,
 }
 
 
+static int
+qcrypto_gcrypt_hash_batchv(QCryptoHashAlgorithm alg,
+                           const struct iovec *bufs,
+                           size_t nbufs,
+                           uint8_t *results,
+                           size_t resultlen,
+                           Error **errp)
+{
+    size_t i;
+    int ret;
+    gcry_md_hd_t md;
+    unsigned char *digest;
+
+    if (!qcrypto_hash_supports(alg)) {
+        error_setg(errp,
+                   "Unknown hash algorithm %d",
+                   alg);
+        return -1;
+    }
+
+    ret = gcry_md_get_algo_dlen(qcrypto_hash_alg_map[alg]);
+    if (ret <= 0 || resultlen != ret) {
+        error_setg(errp,
+                   "Result buffer size %zu does not match hash %d",
+                   resultlen, ret);
+        return -1;
+    }
+
+    ret = gcry_md_open(&md, qcrypto_hash_alg_map[alg], 0);
+    if (ret < 0) {
+        error_setg(errp,
+                   "Unable to initialize hash algorithm: %s",
+                   gcry_strerror(ret));
+        return -1;
+    }
+
+    for (i = 0; i < nbufs; i++) {
+        gcry_md_write(md, bufs[i].iov_base, bufs[i].iov_len);
+
+        digest = gcry_md_read(md, 0);
+        if (!digest) {
+            error_setg(errp,
+                       "No digest produced");
+            gcry_md_close(md);
+            return -1;
+        }
+        memcpy(results + i * resultlen, digest, resultlen);
+
+        gcry_md_reset(md);
+    }
+
+    gcry_md_close(md);
+    return 0;
+}
+
+
 QCryptoHashDriver qcrypto_hash_lib_driver = {
     .hash_bytesv = qcrypto_gcrypt_hash_bytesv,
+    .hash_batchv = qcrypto_gcrypt_hash_batchv,
 };
@@ -95,6 +95,48 @@ qcrypto_glib_hash_bytesv(QCryptoHashAlgorithm alg,
 }
 
 
+static int
+qcrypto_glib_hash_batchv(QCryptoHashAlgorithm alg,
+                         const struct iovec *bufs,
+                         size_t nbufs,
+                         uint8_t *results,
+                         size_t resultlen,
+                         Error **errp)
+{
+    size_t i;
+    GChecksum *cs;
+
+    if (!qcrypto_hash_supports(alg)) {
+        error_setg(errp,
+                   "Unknown hash algorithm %d",
+                   alg);
+        return -1;
+    }
+
+    if (resultlen != g_checksum_type_get_length(qcrypto_hash_alg_map[alg])) {
+        error_setg(errp,
+                   "Result buffer size %zu does not match hash %d",
+                   resultlen,
+                   g_checksum_type_get_length(qcrypto_hash_alg_map[alg]));
+        return -1;
+    }
+
+    cs = g_checksum_new(qcrypto_hash_alg_map[alg]);
+
+    for (i = 0; i < nbufs; i++) {
+        gsize len = resultlen;
+
+        g_checksum_update(cs, bufs[i].iov_base, bufs[i].iov_len);
+        g_checksum_get_digest(cs, results + i * resultlen, &len);
+        g_checksum_reset(cs);
+    }
+
+    g_checksum_free(cs);
+    return 0;
+}
+
+
 QCryptoHashDriver qcrypto_hash_lib_driver = {
     .hash_bytesv = qcrypto_glib_hash_bytesv,
+    .hash_batchv = qcrypto_glib_hash_batchv,
 };
@@ -99,6 +99,53 @@ qcrypto_gnutls_hash_bytesv(QCryptoHashAlgorithm alg,
 }
 
 
+static int
+qcrypto_gnutls_hash_batchv(QCryptoHashAlgorithm alg,
+                           const struct iovec *bufs,
+                           size_t nbufs,
+                           uint8_t *results,
+                           size_t resultlen,
+                           Error **errp)
+{
+    size_t i;
+    int ret;
+    gnutls_hash_hd_t hash;
+
+    if (!qcrypto_hash_supports(alg)) {
+        error_setg(errp,
+                   "Unknown hash algorithm %d",
+                   alg);
+        return -1;
+    }
+
+    ret = gnutls_hash_get_len(qcrypto_hash_alg_map[alg]);
+    if (resultlen != ret) {
+        error_setg(errp,
+                   "Result buffer size %zu does not match hash %d",
+                   resultlen, ret);
+        return -1;
+    }
+
+    ret = gnutls_hash_init(&hash, qcrypto_hash_alg_map[alg]);
+    if (ret < 0) {
+        error_setg(errp,
+                   "Unable to initialize hash algorithm: %s",
+                   gnutls_strerror(ret));
+        return -1;
+    }
+
+    /* gnutls_hash_output() resets the context for the next buffer */
+    for (i = 0; i < nbufs; i++) {
+        gnutls_hash(hash, bufs[i].iov_base, bufs[i].iov_len);
+        gnutls_hash_output(hash, results + i * resultlen);
+    }
+
+    gnutls_hash_deinit(hash, NULL);
+    return 0;
+}
+
+
 QCryptoHashDriver qcrypto_hash_lib_driver = {
     .hash_bytesv = qcrypto_gnutls_hash_bytesv,
+    .hash_batchv = qcrypto_gnutls_hash_batchv,
 };
@@ -156,6 +156,55 @@ qcrypto_nettle_hash_bytesv(QCryptoHashAlgorithm alg,
 }
 
 
+static int
+qcrypto_nettle_hash_batchv(QCryptoHashAlgorithm alg,
+                           const struct iovec *bufs,
+                           size_t nbufs,
+                           uint8_t *results,
+                           size_t resultlen,
+                           Error **errp)
+{
+    size_t i;
+    union qcrypto_hash_ctx ctx;
+
+    if (!qcrypto_hash_supports(alg)) {
+        error_setg(errp,
+                   "Unknown hash algorithm %d",
+                   alg);
+        return -1;
+    }
+
+    if (resultlen != qcrypto_hash_alg_map[alg].len) {
+        error_setg(errp,
+                   "Result buffer size %zu does not match hash %zu",
+                   resultlen, qcrypto_hash_alg_map[alg].len);
+        return -1;
+    }
+
+    /*
+     * Nettle contexts are plain stack structs with no allocations
+     * behind them, so re-initializing per buffer costs nothing.
+     */
+    for (i = 0; i < nbufs; i++) {
+        size_t len = bufs[i].iov_len;
+        uint8_t *base = bufs[i].iov_base;
+
+        qcrypto_hash_alg_map[alg].init(&ctx);
+        while (len) {
+            size_t shortlen = MIN(len, UINT_MAX);
+            qcrypto_hash_alg_map[alg].write(&ctx, shortlen, base);
+            len -= shortlen;
+            base += shortlen;
+        }
+        qcrypto_hash_alg_map[alg].result(&ctx, resultlen,
+                                         results + i * resultlen);
+    }
+
+    return 0;
+}
+
+
 QCryptoHashDriver qcrypto_hash_lib_driver = {
     .hash_bytesv = qcrypto_nettle_hash_bytesv,
+    .hash_batchv = qcrypto_nettle_hash_batchv,
 };
@@ -65,6 +65,46 @@ int qcrypto_hash_bytesv(QCryptoHashAlgorithm alg,
 }
 
 
+int qcrypto_hash_batchv(QCryptoHashAlgorithm alg,
+                        const struct iovec *bufs,
+                        size_t nbufs,
+                        uint8_t *results,
+                        size_t resultlen,
+                        Error **errp)
+{
+    size_t i;
+
+    if (resultlen != qcrypto_hash_digest_len(alg)) {
+        error_setg(errp,
+                   "Result buffer size %zu does not match digest size %zu",
+                   resultlen, qcrypto_hash_digest_len(alg));
+        return -1;
+    }
+
+    /*
+     * Unlike qcrypto_hash_bytesv(), the AF_ALG driver is not tried
+     * here: one kernel round trip per buffer is exactly the per-call
+     * overhead that batching is meant to amortize.
+     */
+    if (qcrypto_hash_lib_driver.hash_batchv) {
+        return qcrypto_hash_lib_driver.hash_batchv(alg, bufs, nbufs,
+                                                   results, resultlen,
+                                                   errp);
+    }
+
+    for (i = 0; i < nbufs; i++) {
+        uint8_t *result = results + i * resultlen;
+        size_t len = resultlen;
+
+        if (qcrypto_hash_bytesv(alg, &bufs[i], 1, &result, &len, errp) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 int qcrypto_hash_bytes(QCryptoHashAlgorithm alg,
                        const char *buf,
                        size_t len,
@@ -24,6 +24,18 @@ struct QCryptoHashDriver {
                        uint8_t **result,
                        size_t *resultlen,
                        Error **errp);
+    /*
+     * Optional: compute one digest per buffer in a single call,
+     * reusing the hash context across buffers (or processing several
+     * buffers in lockstep if the library supports it). May be NULL,
+     * in which case the core falls back to hash_bytesv per buffer.
+     */
+    int (*hash_batchv)(QCryptoHashAlgorithm alg,
+                       const struct iovec *bufs,
+                       size_t nbufs,
+                       uint8_t *results,
+                       size_t resultlen,
+                       Error **errp);
 };
 
 extern QCryptoHashDriver qcrypto_hash_lib_driver;
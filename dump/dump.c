@@ -28,6 +28,7 @@
 #include "qapi/qmp/qerror.h"
 #include "qemu/error-report.h"
 #include "qemu/main-loop.h"
+#include "qemu/thread.h"
 #include "hw/misc/vmcoreinfo.h"
 
 #ifdef TARGET_X86_64
@@ -1297,20 +1298,199 @@ static inline bool is_zero_page(const uint8_t *buf, size_t page_size)
     return buffer_is_zero(buf, page_size);
 }
 
+/*
+ * Page compression is CPU bound and independent per page, so it is spread
+ * over a small pool of worker threads.  Pages are handed out in fixed-size
+ * batches; the workers compress their share of a batch in parallel while
+ * the dump (main or detached) thread remains the only writer, so the
+ * page_desc/page_data layout in the vmcore is unchanged.
+ */
+
+/* pages per batch; also bounds the per-slot output buffer memory */
+#define DUMP_COMPRESS_BATCH 64
+
+/* matches the default of migration's compress-threads parameter */
+#define DUMP_COMPRESS_NR_THREADS 8
+
+typedef struct DumpCompressSlot {
+    const uint8_t *in;  /* raw page, points into guest memory */
+    uint8_t *out;       /* compressed data, len_buf_out bytes */
+    size_t size_out;    /* bytes to write: @out if compressed, @in if not */
+    uint32_t flags;     /* DUMP_DH_COMPRESSED_* used, 0 for plaintext */
+    bool zero;          /* page is all 0, nothing was compressed */
+} DumpCompressSlot;
+
+typedef struct DumpCompressWorker {
+    struct DumpCompressPool *pool;
+    QemuThread thread;
+    QemuSemaphore start;
+    int id;
+#ifdef CONFIG_LZO
+    lzo_bytep wrkmem;
+#endif
+} DumpCompressWorker;
+
+typedef struct DumpCompressPool {
+    DumpState *s;
+    DumpCompressSlot slots[DUMP_COMPRESS_BATCH];
+    int n_slots;
+    int n_workers;
+    bool exit;
+    QemuSemaphore done;
+    DumpCompressWorker workers[DUMP_COMPRESS_NR_THREADS];
+} DumpCompressPool;
+
+static void dump_compress_slot(DumpState *s, DumpCompressSlot *slot,
+                               DumpCompressWorker *worker)
+{
+    size_t page_size = s->dump_info.page_size;
+    size_t size_out = get_len_buf_out(page_size, s->flag_compress);
+
+    if (is_zero_page(slot->in, page_size)) {
+        slot->zero = true;
+        return;
+    }
+    slot->zero = false;
+
+    /*
+     * only one compression format will be used here, for
+     * s->flag_compress is set. But when compression fails to work,
+     * we fall back to save in plaintext.
+     */
+    if ((s->flag_compress & DUMP_DH_COMPRESSED_ZLIB) &&
+            (compress2(slot->out, (uLongf *)&size_out, slot->in,
+                       page_size, Z_BEST_SPEED) == Z_OK) &&
+            (size_out < page_size)) {
+        slot->flags = DUMP_DH_COMPRESSED_ZLIB;
+        slot->size_out = size_out;
+#ifdef CONFIG_LZO
+    } else if ((s->flag_compress & DUMP_DH_COMPRESSED_LZO) &&
+            (lzo1x_1_compress(slot->in, page_size, slot->out,
+            (lzo_uint *)&size_out, worker->wrkmem) == LZO_E_OK) &&
+            (size_out < page_size)) {
+        slot->flags = DUMP_DH_COMPRESSED_LZO;
+        slot->size_out = size_out;
+#endif
+#ifdef CONFIG_SNAPPY
+    } else if ((s->flag_compress & DUMP_DH_COMPRESSED_SNAPPY) &&
+            (snappy_compress((const char *)slot->in, page_size,
+            (char *)slot->out, &size_out) == SNAPPY_OK) &&
+            (size_out < page_size)) {
+        slot->flags = DUMP_DH_COMPRESSED_SNAPPY;
+        slot->size_out = size_out;
+#endif
+    } else {
+        /*
+         * fall back to save in plaintext, size_out should be
+         * assigned the target's page size
+         */
+        slot->flags = 0;
+        slot->size_out = page_size;
+    }
+}
+
+static void *dump_compress_worker_thread(void *opaque)
+{
+    DumpCompressWorker *worker = opaque;
+    DumpCompressPool *pool = worker->pool;
+    int i;
+
+    for (;;) {
+        qemu_sem_wait(&worker->start);
+        if (pool->exit) {
+            break;
+        }
+
+        for (i = worker->id; i < pool->n_slots; i += pool->n_workers) {
+            dump_compress_slot(pool->s, &pool->slots[i], worker);
+        }
+
+        qemu_sem_post(&pool->done);
+    }
+
+    return NULL;
+}
+
+static void dump_compress_pool_init(DumpCompressPool *pool, DumpState *s,
+                                    size_t len_buf_out)
+{
+    int i;
+
+    pool->s = s;
+    pool->n_slots = 0;
+    pool->n_workers = DUMP_COMPRESS_NR_THREADS;
+    pool->exit = false;
+    qemu_sem_init(&pool->done, 0);
+
+    for (i = 0; i < DUMP_COMPRESS_BATCH; i++) {
+        pool->slots[i].out = g_malloc(len_buf_out);
+    }
+
+    for (i = 0; i < pool->n_workers; i++) {
+        DumpCompressWorker *worker = &pool->workers[i];
+
+        worker->pool = pool;
+        worker->id = i;
+        qemu_sem_init(&worker->start, 0);
+#ifdef CONFIG_LZO
+        worker->wrkmem = g_malloc(LZO1X_1_MEM_COMPRESS);
+#endif
+        qemu_thread_create(&worker->thread, "dump_compress",
+                           dump_compress_worker_thread, worker,
+                           QEMU_THREAD_JOINABLE);
+    }
+}
+
+static void dump_compress_pool_cleanup(DumpCompressPool *pool)
+{
+    int i;
+
+    pool->exit = true;
+    for (i = 0; i < pool->n_workers; i++) {
+        qemu_sem_post(&pool->workers[i].start);
+    }
+    for (i = 0; i < pool->n_workers; i++) {
+        DumpCompressWorker *worker = &pool->workers[i];
+
+        qemu_thread_join(&worker->thread);
+        qemu_sem_destroy(&worker->start);
+#ifdef CONFIG_LZO
+        g_free(worker->wrkmem);
+#endif
+    }
+
+    for (i = 0; i < DUMP_COMPRESS_BATCH; i++) {
+        g_free(pool->slots[i].out);
+    }
+    qemu_sem_destroy(&pool->done);
+}
+
+/* compress the current batch on the worker threads and wait for them */
+static void dump_compress_pool_run(DumpCompressPool *pool)
+{
+    int i;
+
+    for (i = 0; i < pool->n_workers; i++) {
+        qemu_sem_post(&pool->workers[i].start);
+    }
+    for (i = 0; i < pool->n_workers; i++) {
+        qemu_sem_wait(&pool->done);
+    }
+}
+
 static void write_dump_pages(DumpState *s, Error **errp)
 {
     int ret = 0;
     DataCache page_desc, page_data;
-    size_t len_buf_out, size_out;
-#ifdef CONFIG_LZO
-    lzo_bytep wrkmem = NULL;
-#endif
-    uint8_t *buf_out = NULL;
+    size_t len_buf_out;
     off_t offset_desc, offset_data;
     PageDescriptor pd, pd_zero;
     uint8_t *buf;
     GuestPhysBlock *block_iter = NULL;
     uint64_t pfn_iter;
+    DumpCompressPool pool;
+    bool more = true;
+    int i;
 
     /* get offset of page_desc and page_data in dump file */
     offset_desc = s->offset_page;
@@ -1319,15 +1499,11 @@ static void write_dump_pages(DumpState *s, Error **errp)
     prepare_data_cache(&page_desc, s, offset_desc);
     prepare_data_cache(&page_data, s, offset_data);
 
-    /* prepare buffer to store compressed data */
+    /* prepare buffers to store compressed data */
     len_buf_out = get_len_buf_out(s->dump_info.page_size, s->flag_compress);
     assert(len_buf_out != 0);
 
-#ifdef CONFIG_LZO
-    wrkmem = g_malloc(LZO1X_1_MEM_COMPRESS);
-#endif
-
-    buf_out = g_malloc(len_buf_out);
+    dump_compress_pool_init(&pool, s, len_buf_out);
 
     /*
      * init zero page's page_desc and page_data, because every zero page
@@ -1348,100 +1524,65 @@ static void write_dump_pages(DumpState *s, Error **errp)
     offset_data += s->dump_info.page_size;
 
     /*
-     * dump memory to vmcore page by page. zero page will all be resided in the
-     * first page of page section
+     * dump memory to vmcore batch by batch. The workers compress (and
+     * zero-check) the pages of a batch in parallel, then the results are
+     * written out in page order, so the layout matches the serial one:
+     * zero pages all share the first page of the page section.
      */
-    while (get_next_page(&block_iter, &pfn_iter, &buf, s)) {
-        /* check zero page */
-        if (is_zero_page(buf, s->dump_info.page_size)) {
-            ret = write_cache(&page_desc, &pd_zero, sizeof(PageDescriptor),
-                              false);
-            if (ret < 0) {
-                error_setg(errp, "dump: failed to write page desc");
-                goto out;
-            }
-        } else {
-            /*
-             * not zero page, then:
-             * 1. compress the page
-             * 2. write the compressed page into the cache of page_data
-             * 3. get page desc of the compressed page and write it into the
-             *    cache of page_desc
-             *
-             * only one compression format will be used here, for
-             * s->flag_compress is set. But when compression fails to work,
-             * we fall back to save in plaintext.
-             */
-             size_out = len_buf_out;
-             if ((s->flag_compress & DUMP_DH_COMPRESSED_ZLIB) &&
-                    (compress2(buf_out, (uLongf *)&size_out, buf,
-                               s->dump_info.page_size, Z_BEST_SPEED) == Z_OK) &&
-                    (size_out < s->dump_info.page_size)) {
-                pd.flags = cpu_to_dump32(s, DUMP_DH_COMPRESSED_ZLIB);
-                pd.size  = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf_out, size_out, false);
-                if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
-                    goto out;
-                }
-#ifdef CONFIG_LZO
-            } else if ((s->flag_compress & DUMP_DH_COMPRESSED_LZO) &&
-                    (lzo1x_1_compress(buf, s->dump_info.page_size, buf_out,
-                    (lzo_uint *)&size_out, wrkmem) == LZO_E_OK) &&
-                    (size_out < s->dump_info.page_size)) {
-                pd.flags = cpu_to_dump32(s, DUMP_DH_COMPRESSED_LZO);
-                pd.size  = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf_out, size_out, false);
-                if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
-                    goto out;
-                }
-#endif
-#ifdef CONFIG_SNAPPY
-            } else if ((s->flag_compress & DUMP_DH_COMPRESSED_SNAPPY) &&
-                    (snappy_compress((char *)buf, s->dump_info.page_size,
-                    (char *)buf_out, &size_out) == SNAPPY_OK) &&
-                    (size_out < s->dump_info.page_size)) {
-                pd.flags = cpu_to_dump32(s, DUMP_DH_COMPRESSED_SNAPPY);
-                pd.size  = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf_out, size_out, false);
+    while (more) {
+        pool.n_slots = 0;
+        while (pool.n_slots < DUMP_COMPRESS_BATCH &&
+               (more = get_next_page(&block_iter, &pfn_iter, &buf, s))) {
+            pool.slots[pool.n_slots++].in = buf;
+        }
+        if (pool.n_slots == 0) {
+            break;
+        }
+
+        dump_compress_pool_run(&pool);
+
+        for (i = 0; i < pool.n_slots; i++) {
+            DumpCompressSlot *slot = &pool.slots[i];
+
+            if (slot->zero) {
+                ret = write_cache(&page_desc, &pd_zero,
+                                  sizeof(PageDescriptor), false);
                 if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
+                    error_setg(errp, "dump: failed to write page desc");
                     goto out;
                 }
-#endif
             } else {
                 /*
-                 * fall back to save in plaintext, size_out should be
-                 * assigned the target's page size
+                 * not zero page, then:
+                 * 1. write the compressed (or, on compression failure,
+                 *    plaintext) page into the cache of page_data
+                 * 2. get page desc of the page and write it into the
+                 *    cache of page_desc
                  */
-                pd.flags = cpu_to_dump32(s, 0);
-                size_out = s->dump_info.page_size;
-                pd.size = cpu_to_dump32(s, size_out);
+                pd.flags = cpu_to_dump32(s, slot->flags);
+                pd.size  = cpu_to_dump32(s, slot->size_out);
 
-                ret = write_cache(&page_data, buf,
-                                  s->dump_info.page_size, false);
+                ret = write_cache(&page_data,
+                                  slot->flags ? slot->out : slot->in,
+                                  slot->size_out, false);
                 if (ret < 0) {
                     error_setg(errp, "dump: failed to write page data");
                     goto out;
                 }
-            }
 
-            /* get and write page desc here */
-            pd.page_flags = cpu_to_dump64(s, 0);
-            pd.offset = cpu_to_dump64(s, offset_data);
-            offset_data += size_out;
+                pd.page_flags = cpu_to_dump64(s, 0);
+                pd.offset = cpu_to_dump64(s, offset_data);
+                offset_data += slot->size_out;
 
-            ret = write_cache(&page_desc, &pd, sizeof(PageDescriptor), false);
-            if (ret < 0) {
-                error_setg(errp, "dump: failed to write page desc");
-                goto out;
+                ret = write_cache(&page_desc, &pd, sizeof(PageDescriptor),
+                                  false);
+                if (ret < 0) {
+                    error_setg(errp, "dump: failed to write page desc");
+                    goto out;
+                }
             }
+            s->written_size += s->dump_info.page_size;
         }
-        s->written_size += s->dump_info.page_size;
     }
 
     ret = write_cache(&page_desc, NULL, 0, true);
@@ -1456,14 +1597,9 @@ static void write_dump_pages(DumpState *s, Error **errp)
     }
 
 out:
+    dump_compress_pool_cleanup(&pool);
     free_data_cache(&page_desc);
     free_data_cache(&page_data);
-
-#ifdef CONFIG_LZO
-    g_free(wrkmem);
-#endif
-
-    g_free(buf_out);
 }
 
 static void create_kdump_vmcore(DumpState *s, Error **errp)
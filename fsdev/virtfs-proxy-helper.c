@@ -164,15 +164,29 @@ static int socket_write(int sockfd, void *buff, ssize_t size)
 
 static int read_request(int sockfd, struct iovec *iovec, ProxyHeader *header)
 {
+    ssize_t total = 0;
     int retval;
 
     /*
-     * read the request header.
+     * Read the request header.  QEMU writes header and payload with a
+     * single write and sends one request at a time, so read as much as
+     * the buffer holds: in the common case the payload arrives together
+     * with the header and the second read() is not needed.
      */
     iovec->iov_len = 0;
-    retval = socket_read(sockfd, iovec->iov_base, PROXY_HDR_SZ);
-    if (retval < 0) {
-        return retval;
+    while (total < PROXY_HDR_SZ) {
+        retval = read(sockfd, iovec->iov_base + total,
+                      PROXY_MAX_IO_SZ + PROXY_HDR_SZ - total);
+        if (retval == 0) {
+            return -EIO;
+        }
+        if (retval < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        total += retval;
     }
     iovec->iov_len = PROXY_HDR_SZ;
     retval = proxy_unmarshal(iovec, 0, "dd", &header->type, &header->size);
@@ -186,9 +200,13 @@ static int read_request(int sockfd, struct iovec *iovec, ProxyHeader *header)
     if (header->size > PROXY_MAX_IO_SZ) {
         return -ENOBUFS;
     }
-    retval = socket_read(sockfd, iovec->iov_base + PROXY_HDR_SZ, header->size);
-    if (retval < 0) {
-        return retval;
+    if (total - PROXY_HDR_SZ < header->size) {
+        retval = socket_read(sockfd,
+                             iovec->iov_base + total,
+                             header->size - (total - PROXY_HDR_SZ));
+        if (retval < 0) {
+            return retval;
+        }
     }
     iovec->iov_len += header->size;
     return 0;
@@ -362,6 +362,8 @@ typedef struct GDBState {
     Chardev *mon_chr;
 #endif
     bool multiprocess;
+    /* negotiated with QStartNoAckMode: no '+'/'-' protocol acks */
+    bool noack_mode;
     GDBProcess *processes;
     int process_num;
     char syscall_buf[256];
@@ -673,6 +675,9 @@ static int put_packet_binary(const char *buf, int len, bool dump)
                    gdbserver_state.last_packet->len);
 
 #ifdef CONFIG_USER_ONLY
+        if (gdbserver_state.noack_mode) {
+            break;
+        }
         i = get_char();
         if (i < 0)
             return -1;
@@ -2178,10 +2183,21 @@ static void handle_query_supported(GArray *params, void *user_ctx)
         gdbserver_state.multiprocess = true;
     }
 
-    g_string_append(gdbserver_state.str_buf, ";vContSupported+;multiprocess+");
+    g_string_append(gdbserver_state.str_buf,
+                    ";vContSupported+;multiprocess+;QStartNoAckMode+");
     put_strbuf();
 }
 
+static void handle_set_start_no_ack_mode(GArray *params, void *user_ctx)
+{
+    /*
+     * The "OK" below is still acknowledged by gdb; the ack-less
+     * protocol starts with the following packet.
+     */
+    put_packet("OK");
+    gdbserver_state.noack_mode = true;
+}
+
 static void handle_query_xfer_features(GArray *params, void *user_ctx)
 {
     GDBProcess *process;
@@ -2417,6 +2433,10 @@ static const GdbCmdParseEntry gdb_gen_query_table[] = {
 
 static const GdbCmdParseEntry gdb_gen_set_table[] = {
     /* Order is important if has same prefix */
+    {
+        .handler = handle_set_start_no_ack_mode,
+        .cmd = "StartNoAckMode",
+    },
     {
         .handler = handle_set_qemu_sstep,
         .cmd = "qemu.sstep:",
@@ -2931,7 +2951,7 @@ static void gdb_read_byte(uint8_t ch)
     if (gdbserver_state.last_packet->len) {
         /* Waiting for a response to the last packet.  If we see the start
            of a new command then abandon the previous response.  */
-        if (ch == '-') {
+        if (ch == '-' && !gdbserver_state.noack_mode) {
             trace_gdbstub_err_got_nack();
             put_buffer(gdbserver_state.last_packet->data,
                        gdbserver_state.last_packet->len);
@@ -3053,14 +3073,18 @@ static void gdb_read_byte(uint8_t ch)
 
             if (gdbserver_state.line_csum != (gdbserver_state.line_sum & 0xff)) {
                 trace_gdbstub_err_checksum_incorrect(gdbserver_state.line_sum, gdbserver_state.line_csum);
-                /* send NAK reply */
-                reply = '-';
-                put_buffer(&reply, 1);
+                if (!gdbserver_state.noack_mode) {
+                    /* send NAK reply */
+                    reply = '-';
+                    put_buffer(&reply, 1);
+                }
                 gdbserver_state.state = RS_IDLE;
             } else {
-                /* send ACK reply */
-                reply = '+';
-                put_buffer(&reply, 1);
+                if (!gdbserver_state.noack_mode) {
+                    /* send ACK reply */
+                    reply = '+';
+                    put_buffer(&reply, 1);
+                }
                 gdbserver_state.state = gdb_handle_packet(gdbserver_state.line_buf);
             }
             break;
@@ -3380,6 +3404,8 @@ static void gdb_chr_event(void *opaque, QEMUChrEvent event)
         vm_stop(RUN_STATE_PAUSED);
         replay_gdb_attached();
         gdb_has_xml = false;
+        /* a fresh connection starts with acks enabled again */
+        s->noack_mode = false;
         break;
     default:
         break;
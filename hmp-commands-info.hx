@@ -604,6 +604,20 @@ SRST
     Show QOM composition tree.
 ERST
 
+    {
+        .name       = "qom-churn",
+        .args_type  = "",
+        .params     = "",
+        .help       = "show per-type QOM instance creation statistics",
+        .cmd        = hmp_info_qom_churn,
+        .flags      = "p",
+    },
+
+SRST
+  ``info qom-churn``
+    Show per-type QOM instance creation statistics.
+ERST
+
     {
         .name       = "roms",
         .args_type  = "",
@@ -112,6 +112,43 @@ static ssize_t socket_read(int sockfd, void *buff, size_t size)
     return total;
 }
 
+/*
+ * Read a reply header into @reply, opportunistically accepting the
+ * payload bytes that the helper writes back-to-back with it.  The
+ * protocol is strictly serialized (one request, one reply), so any
+ * extra bytes can only belong to this reply.  In the common case the
+ * whole reply arrives in one read() instead of one per part.
+ *
+ * On success *recvd is the number of payload bytes already in the
+ * buffer.  Returns < 0 on transport error.
+ */
+static int v9fs_receive_header(V9fsProxy *proxy, struct iovec *reply,
+                               ProxyHeader *header, size_t *recvd)
+{
+    ssize_t retval, total = 0;
+
+    reply->iov_len = 0;
+    while (total < PROXY_HDR_SZ) {
+        retval = read(proxy->sockfd, reply->iov_base + total,
+                      PROXY_MAX_IO_SZ + PROXY_HDR_SZ - total);
+        if (retval == 0) {
+            return -EIO;
+        }
+        if (retval < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -errno;
+        }
+        total += retval;
+    }
+    reply->iov_len = PROXY_HDR_SZ;
+    retval = proxy_unmarshal(reply, 0, "dd", &header->type, &header->size);
+    assert(retval == 4 * 2);
+    *recvd = total - PROXY_HDR_SZ;
+    return 0;
+}
+
 /* Converts proxy_statfs to VFS statfs structure */
 static void prstatfs_to_statfs(struct statfs *stfs, ProxyStatFS *prstfs)
 {
@@ -164,24 +201,22 @@ static int v9fs_receive_response(V9fsProxy *proxy, int type,
                                  int *status, void *response)
 {
     int retval;
+    size_t recvd;
     ProxyHeader header;
     struct iovec *reply = &proxy->in_iovec;
 
     *status = 0;
-    reply->iov_len = 0;
-    retval = socket_read(proxy->sockfd, reply->iov_base, PROXY_HDR_SZ);
+    retval = v9fs_receive_header(proxy, reply, &header, &recvd);
     if (retval < 0) {
         return retval;
     }
-    reply->iov_len = PROXY_HDR_SZ;
-    retval = proxy_unmarshal(reply, 0, "dd", &header.type, &header.size);
-    assert(retval == 4 * 2);
     /*
      * if response size > PROXY_MAX_IO_SZ, read the response but ignore it and
      * return -ENOBUFS
      */
     if (header.size > PROXY_MAX_IO_SZ) {
         int count;
+        header.size -= recvd;
         while (header.size > 0) {
             count = MIN(PROXY_MAX_IO_SZ, header.size);
             count = socket_read(proxy->sockfd, reply->iov_base, count);
@@ -194,10 +229,13 @@ static int v9fs_receive_response(V9fsProxy *proxy, int type,
         return 0;
     }
 
-    retval = socket_read(proxy->sockfd,
-                         reply->iov_base + PROXY_HDR_SZ, header.size);
-    if (retval < 0) {
-        return retval;
+    if (recvd < header.size) {
+        retval = socket_read(proxy->sockfd,
+                             reply->iov_base + PROXY_HDR_SZ + recvd,
+                             header.size - recvd);
+        if (retval < 0) {
+            return retval;
+        }
     }
     reply->iov_len += header.size;
     /* there was an error during processing request */
@@ -276,21 +314,21 @@ static int v9fs_receive_status(V9fsProxy *proxy,
                                struct iovec *reply, int *status)
 {
     int retval;
+    size_t recvd;
     ProxyHeader header;
 
     *status = 0;
-    reply->iov_len = 0;
-    retval = socket_read(proxy->sockfd, reply->iov_base, PROXY_HDR_SZ);
+    retval = v9fs_receive_header(proxy, reply, &header, &recvd);
     if (retval < 0) {
         return retval;
     }
-    reply->iov_len = PROXY_HDR_SZ;
-    retval = proxy_unmarshal(reply, 0, "dd", &header.type, &header.size);
-    assert(retval == 4 * 2);
-    retval = socket_read(proxy->sockfd,
-                         reply->iov_base + PROXY_HDR_SZ, header.size);
-    if (retval < 0) {
-        return retval;
+    if (recvd < header.size) {
+        retval = socket_read(proxy->sockfd,
+                             reply->iov_base + PROXY_HDR_SZ + recvd,
+                             header.size - recvd);
+        if (retval < 0) {
+            return retval;
+        }
     }
     reply->iov_len += header.size;
     retval = proxy_unmarshal(reply, PROXY_HDR_SZ, "d", status);
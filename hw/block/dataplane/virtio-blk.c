@@ -184,11 +184,16 @@ int virtio_blk_data_plane_start(VirtIODevice *vdev)
 
     s->starting = true;
 
-    if (!virtio_vdev_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX)) {
-        s->batch_notifications = true;
-    } else {
-        s->batch_notifications = false;
-    }
+    /*
+     * Defer guest notifications to a bottom half so that one drain
+     * cycle raises at most one interrupt per queue, also when
+     * EVENT_IDX was negotiated: virtio_notify_irqfd() evaluates the
+     * used_event threshold at notify time, so the suppression is
+     * honored on top of the batching rather than replaced by it, and
+     * deferral means it is applied to the final used index of the
+     * cycle instead of to every intermediate one.
+     */
+    s->batch_notifications = true;
 
     /* Set up guest notifier (irq) */
     r = k->set_guest_notifiers(qbus->parent, nvqs, true);
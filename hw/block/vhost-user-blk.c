@@ -129,16 +129,24 @@ static int vhost_user_blk_start(VirtIODevice *vdev, Error **errp)
         return -ENOSYS;
     }
 
-    ret = vhost_dev_enable_notifiers(&s->dev, vdev);
-    if (ret < 0) {
-        error_setg_errno(errp, -ret, "Error enabling host notifiers");
-        return ret;
-    }
+    /*
+     * After a backend disconnect the notifiers are still wired up from
+     * the previous session; skipping their setup keeps the reconnect
+     * path down to reprogramming the new backend.
+     */
+    if (!s->notifiers_set) {
+        ret = vhost_dev_enable_notifiers(&s->dev, vdev);
+        if (ret < 0) {
+            error_setg_errno(errp, -ret, "Error enabling host notifiers");
+            return ret;
+        }
 
-    ret = k->set_guest_notifiers(qbus->parent, s->dev.nvqs, true);
-    if (ret < 0) {
-        error_setg_errno(errp, -ret, "Error binding guest notifier");
-        goto err_host_notifiers;
+        ret = k->set_guest_notifiers(qbus->parent, s->dev.nvqs, true);
+        if (ret < 0) {
+            error_setg_errno(errp, -ret, "Error binding guest notifier");
+            goto err_host_notifiers;
+        }
+        s->notifiers_set = true;
     }
 
     s->dev.acked_features = vdev->guest_features;
@@ -184,16 +192,46 @@ err_guest_notifiers:
     k->set_guest_notifiers(qbus->parent, s->dev.nvqs, false);
 err_host_notifiers:
     vhost_dev_disable_notifiers(&s->dev, vdev);
+    s->notifiers_set = false;
     return ret;
 }
 
-static void vhost_user_blk_stop(VirtIODevice *vdev)
+static void vhost_user_blk_disable_notifiers(VirtIODevice *vdev)
 {
     VHostUserBlk *s = VHOST_USER_BLK(vdev);
     BusState *qbus = BUS(qdev_get_parent_bus(DEVICE(vdev)));
     VirtioBusClass *k = VIRTIO_BUS_GET_CLASS(qbus);
     int ret;
 
+    if (!s->notifiers_set) {
+        return;
+    }
+    s->notifiers_set = false;
+
+    ret = k->set_guest_notifiers(qbus->parent, s->num_queues, false);
+    if (ret < 0) {
+        error_report("vhost guest notifier cleanup failed: %d", ret);
+        return;
+    }
+
+    /*
+     * s->dev is zeroed by vhost_dev_cleanup() after a backend disconnect,
+     * but the host notifiers are still wired up; restore the fields
+     * vhost_dev_disable_notifiers() iterates over.
+     */
+    if (!s->dev.nvqs) {
+        s->dev.nvqs = s->num_queues;
+        s->dev.vq_index = 0;
+    }
+    vhost_dev_disable_notifiers(&s->dev, vdev);
+}
+
+static void vhost_user_blk_stop(VirtIODevice *vdev)
+{
+    VHostUserBlk *s = VHOST_USER_BLK(vdev);
+    BusState *qbus = BUS(qdev_get_parent_bus(DEVICE(vdev)));
+    VirtioBusClass *k = VIRTIO_BUS_GET_CLASS(qbus);
+
     if (!s->started_vu) {
         return;
     }
@@ -205,13 +243,7 @@ static void vhost_user_blk_stop(VirtIODevice *vdev)
 
     vhost_dev_stop(&s->dev, vdev);
 
-    ret = k->set_guest_notifiers(qbus->parent, s->dev.nvqs, false);
-    if (ret < 0) {
-        error_report("vhost guest notifier cleanup failed: %d", ret);
-        return;
-    }
-
-    vhost_dev_disable_notifiers(&s->dev, vdev);
+    vhost_user_blk_disable_notifiers(vdev);
 }
 
 static void vhost_user_blk_set_status(VirtIODevice *vdev, uint8_t status)
@@ -363,7 +395,18 @@ static void vhost_user_blk_disconnect(DeviceState *dev)
     }
     s->connected = false;
 
-    vhost_user_blk_stop(vdev);
+    /*
+     * Unlike a guest-requested stop, keep the host and guest notifiers
+     * wired up: the kick fds stay armed while the backend is away, and a
+     * reconnecting backend only needs to be reprogrammed in
+     * vhost_user_blk_start(), which also hands it the still-mapped
+     * inflight region so interrupted requests are replayed rather than
+     * lost.
+     */
+    if (s->started_vu) {
+        s->started_vu = false;
+        vhost_dev_stop(&s->dev, vdev);
+    }
 
     vhost_dev_cleanup(&s->dev);
 }
@@ -545,6 +588,7 @@ static void vhost_user_blk_device_unrealize(DeviceState *dev)
     virtio_set_status(vdev, 0);
     qemu_chr_fe_set_handlers(&s->chardev,  NULL, NULL, NULL,
                              NULL, NULL, NULL, false);
+    vhost_user_blk_disable_notifiers(vdev);
     vhost_dev_cleanup(&s->dev);
     vhost_dev_free_inflight(s->inflight);
     g_free(s->vhost_vqs);
@@ -253,15 +253,8 @@ out:
 
 #endif
 
-static VirtIOBlockReq *virtio_blk_get_request(VirtIOBlock *s, VirtQueue *vq)
-{
-    VirtIOBlockReq *req = virtqueue_pop(vq, sizeof(VirtIOBlockReq));
-
-    if (req) {
-        virtio_blk_init_request(s, vq, req);
-    }
-    return req;
-}
+/* requests translated per virtqueue_pop_batch() call */
+#define VIRTIO_BLK_REQ_BATCH 32
 
 static int virtio_blk_handle_scsi_req(VirtIOBlockReq *req)
 {
@@ -770,31 +763,48 @@ static int virtio_blk_handle_request(VirtIOBlockReq *req, MultiReqBuffer *mrb)
 bool virtio_blk_handle_vq(VirtIOBlock *s, VirtQueue *vq)
 {
     VirtIOBlockReq *req;
+    VirtQueueElement *elems[VIRTIO_BLK_REQ_BATCH];
     MultiReqBuffer mrb = {};
     bool suppress_notifications = virtio_queue_get_notification(vq);
     bool progress = false;
+    bool fatal = false;
 
     aio_context_acquire(blk_get_aio_context(s->blk));
     blk_io_plug(s->blk);
 
     do {
+        size_t num, i;
+
         if (suppress_notifications) {
             virtio_queue_set_notification(vq, 0);
         }
 
-        while ((req = virtio_blk_get_request(s, vq))) {
-            progress = true;
-            if (virtio_blk_handle_request(req, &mrb)) {
-                virtqueue_detach_element(req->vq, &req->elem, 0);
-                virtio_blk_free_request(req);
-                break;
+        while (!fatal &&
+               (num = virtqueue_pop_batch(vq, sizeof(VirtIOBlockReq),
+                                          (void **)elems,
+                                          VIRTIO_BLK_REQ_BATCH))) {
+            for (i = 0; i < num; i++) {
+                req = (VirtIOBlockReq *)elems[i];
+                virtio_blk_init_request(s, vq, req);
+                progress = true;
+                if (virtio_blk_handle_request(req, &mrb)) {
+                    virtqueue_detach_element(req->vq, &req->elem, 0);
+                    virtio_blk_free_request(req);
+                    /* return the rest of the batch to the queue */
+                    while (num-- > i + 1) {
+                        virtqueue_unpop(vq, elems[num], 0);
+                        g_free(elems[num]);
+                    }
+                    fatal = true;
+                    break;
+                }
             }
         }
 
         if (suppress_notifications) {
             virtio_queue_set_notification(vq, 1);
         }
-    } while (!virtio_queue_empty(vq));
+    } while (!fatal && !virtio_queue_empty(vq));
 
     if (mrb.num_reqs) {
         virtio_blk_submit_multireq(s->blk, &mrb);
@@ -982,13 +982,27 @@ int rom_add_file(const char *file, const char *fw_dir,
     }
 
     rom->datasize = rom->romsize;
-    rom->data     = g_malloc0(rom->datasize);
-    lseek(fd, 0, SEEK_SET);
-    rc = read(fd, rom->data, rom->datasize);
-    if (rc != rom->datasize) {
-        fprintf(stderr, "rom: file %-20s: read error: rc=%d (expected %zd)\n",
-                rom->name, rc, rom->datasize);
-        goto err;
+    /*
+     * Map the file instead of reading it into anonymous memory: the
+     * mapping is private, so patching the image only dirties the pages
+     * actually written to, and all untouched pages stay shared with the
+     * page cache - and thus with every other VM on the host that loads
+     * the same firmware image.
+     */
+    rom->mapped_file = g_mapped_file_new_from_fd(fd, true, NULL);
+    if (rom->mapped_file) {
+        rom->data = (uint8_t *)g_mapped_file_get_contents(rom->mapped_file);
+    } else {
+        /* some filesystems don't support mmap, fall back to a copy */
+        rom->data = g_malloc0(rom->datasize);
+        lseek(fd, 0, SEEK_SET);
+        rc = read(fd, rom->data, rom->datasize);
+        if (rc != rom->datasize) {
+            fprintf(stderr,
+                    "rom: file %-20s: read error: rc=%d (expected %zd)\n",
+                    rom->name, rc, rom->datasize);
+            goto err;
+        }
     }
     close(fd);
     rom_insert(rom);
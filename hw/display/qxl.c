@@ -1996,10 +1996,12 @@ static void display_switch(DisplayChangeListener *dcl,
 {
     PCIQXLDevice *qxl = container_of(dcl, PCIQXLDevice, ssd.dcl);
 
-    qxl->ssd.ds = surface;
     if (qxl->mode == QXL_MODE_VGA) {
+        /* takes ssd.lock and stores the surface in ssd.ds itself */
         qemu_spice_display_switch(&qxl->ssd, surface);
+        return;
     }
+    qxl->ssd.ds = surface;
 }
 
 static void display_refresh(DisplayChangeListener *dcl)
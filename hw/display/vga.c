@@ -1443,6 +1443,18 @@ void vga_invalidate_scanlines(VGACommonState *s, int y1, int y2)
     }
 }
 
+static bool vga_scanlines_invalidated(VGACommonState *s)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(s->invalidated_y_table); i++) {
+        if (s->invalidated_y_table[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static bool vga_scanline_invalidated(VGACommonState *s, int y)
 {
     if (y >= VGA_MAX_HEIGHT) {
@@ -1470,6 +1482,7 @@ static void vga_draw_graphic(VGACommonState *s, int full_update)
     int y1, y, update, linesize, y_start, double_scan, mask, depth;
     int width, height, shift_control, bwidth, bits;
     ram_addr_t page0, page1, region_start, region_end;
+    hwaddr dirty_first = 0, dirty_last = 0;
     DirtyBitmapSnapshot *snap = NULL;
     int disp_width, multi_scan, multi_run;
     uint8_t *d;
@@ -1664,6 +1677,14 @@ static void vga_draw_graphic(VGACommonState *s, int full_update)
         snap = memory_region_snapshot_and_clear_dirty(&s->vram, region_start,
                                                       region_end - region_start,
                                                       DIRTY_MEMORY_VGA);
+        if (!memory_region_snapshot_get_dirty_extent(&s->vram, snap,
+                                                     &dirty_first,
+                                                     &dirty_last) &&
+            !vga_scanlines_invalidated(s)) {
+            /* nothing changed since the last refresh */
+            g_free(snap);
+            return;
+        }
     }
 
     for(y = 0; y < height; y++) {
@@ -1688,6 +1709,9 @@ static void vga_draw_graphic(VGACommonState *s, int full_update)
                                                       page0, s->vbe_size - page0);
             update |= memory_region_snapshot_get_dirty(&s->vram, snap,
                                                        0, page1);
+        } else if (page1 < dirty_first || page0 >= dirty_last) {
+            /* scanline lies outside the dirty extent */
+            update = 0;
         } else {
             update = memory_region_snapshot_get_dirty(&s->vram, snap,
                                                       page0, page1 - page0);
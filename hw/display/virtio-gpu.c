@@ -510,18 +510,6 @@ static void virtio_gpu_resource_flush(VirtIOGPU *g,
         return;
     }
 
-    if (res->blob) {
-        for (i = 0; i < g->parent_obj.conf.max_outputs; i++) {
-            scanout = &g->parent_obj.scanout[i];
-            if (scanout->resource_id == res->resource_id &&
-                console_has_gl(scanout->con)) {
-                dpy_gl_update(scanout->con, 0, 0, scanout->width,
-                              scanout->height);
-                return;
-            }
-        }
-    }
-
     if (!res->blob &&
         (rf.r.x > res->width ||
         rf.r.y > res->height ||
@@ -556,10 +544,18 @@ static void virtio_gpu_resource_flush(VirtIOGPU *g,
         pixman_region_translate(&finalregion, -scanout->x, -scanout->y);
         extents = pixman_region_extents(&finalregion);
         /* work out the area we need to update for each console */
-        dpy_gfx_update(g->parent_obj.scanout[i].con,
-                       extents->x1, extents->y1,
-                       extents->x2 - extents->x1,
-                       extents->y2 - extents->y1);
+        if (res->blob && console_has_gl(scanout->con)) {
+            /* the blob is scanned out as a dmabuf, flush just the damage */
+            dpy_gl_update(scanout->con,
+                          extents->x1, extents->y1,
+                          extents->x2 - extents->x1,
+                          extents->y2 - extents->y1);
+        } else {
+            dpy_gfx_update(scanout->con,
+                           extents->x1, extents->y1,
+                           extents->x2 - extents->x1,
+                           extents->y2 - extents->y1);
+        }
 
         pixman_region_fini(&region);
         pixman_region_fini(&finalregion);
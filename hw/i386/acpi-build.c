@@ -2397,8 +2397,27 @@ struct AcpiBuildState {
     void *rsdp;
     MemoryRegion *rsdp_mr;
     MemoryRegion *linker_mr;
+    /* Pristine copy of the last build, valid while cache_gen is current */
+    GArray *table_cache;
+    GArray *rsdp_cache;
+    GArray *linker_cache;
+    unsigned cache_gen;
 } AcpiBuildState;
 
+/*
+ * Bumped whenever the machine configuration that feeds acpi_build()
+ * changes (device hotplug/unplug).  While it matches
+ * AcpiBuildState::cache_gen the tables in the cache are still valid and
+ * reset-time guest accesses can be served from them instead of rerunning
+ * the whole build pipeline.
+ */
+static unsigned acpi_build_config_gen = 1;
+
+void acpi_build_invalidate(void)
+{
+    acpi_build_config_gen++;
+}
+
 static bool acpi_get_mcfg(AcpiMcfgInfo *mcfg)
 {
     Object *pci_host;
@@ -2669,6 +2688,28 @@ static void acpi_ram_update(MemoryRegion *mr, GArray *data)
     memory_region_set_dirty(mr, 0, size);
 }
 
+static GArray *acpi_cache_blob(GArray *cache, GArray *data)
+{
+    if (!cache) {
+        cache = g_array_new(false, true /* clear */, 1);
+    }
+    g_array_set_size(cache, data->len);
+    memcpy(cache->data, data->data, data->len);
+    return cache;
+}
+
+static void acpi_build_cache_update(AcpiBuildState *build_state,
+                                    AcpiBuildTables *tables)
+{
+    build_state->table_cache = acpi_cache_blob(build_state->table_cache,
+                                               tables->table_data);
+    build_state->rsdp_cache = acpi_cache_blob(build_state->rsdp_cache,
+                                              tables->rsdp);
+    build_state->linker_cache = acpi_cache_blob(build_state->linker_cache,
+                                                tables->linker->cmd_blob);
+    build_state->cache_gen = acpi_build_config_gen;
+}
+
 static void acpi_build_update(void *build_opaque)
 {
     AcpiBuildState *build_state = build_opaque;
@@ -2680,6 +2721,25 @@ static void acpi_build_update(void *build_opaque)
     }
     build_state->patched = 1;
 
+    if (build_state->cache_gen == acpi_build_config_gen) {
+        /*
+         * Nothing was hotplugged since the tables were last built, so
+         * the build would reproduce them bit for bit.  Restore the
+         * cached pristine copy instead.
+         */
+        acpi_ram_update(build_state->table_mr, build_state->table_cache);
+
+        if (build_state->rsdp) {
+            memcpy(build_state->rsdp, build_state->rsdp_cache->data,
+                   acpi_data_len(build_state->rsdp_cache));
+        } else {
+            acpi_ram_update(build_state->rsdp_mr, build_state->rsdp_cache);
+        }
+
+        acpi_ram_update(build_state->linker_mr, build_state->linker_cache);
+        return;
+    }
+
     acpi_build_tables_init(&tables);
 
     acpi_build(&tables, MACHINE(qdev_get_machine()));
@@ -2693,6 +2753,7 @@ static void acpi_build_update(void *build_opaque)
     }
 
     acpi_ram_update(build_state->linker_mr, tables.linker->cmd_blob);
+    acpi_build_cache_update(build_state, &tables);
     acpi_build_tables_cleanup(&tables, true);
 }
 
@@ -2797,6 +2858,8 @@ void acpi_setup(void)
                                                  ACPI_BUILD_RSDP_FILE);
     }
 
+    acpi_build_cache_update(build_state, &tables);
+
     qemu_register_reset(acpi_build_reset, build_state);
     acpi_build_reset(build_state);
     vmstate_register(NULL, 0, &vmstate_acpi_build, build_state);
@@ -198,12 +198,18 @@ static guint vtd_uint64_hash(gconstpointer v)
     return (guint)*(const uint64_t *)v;
 }
 
-static gboolean vtd_hash_remove_by_domain(gpointer key, gpointer value,
-                                          gpointer user_data)
+/*
+ * Current invalidation generation of a domain. IOTLB entries tagged
+ * with an older generation are dead; bumping the generation in
+ * vtd_iotlb_domain_invalidate() thus flushes a whole domain without
+ * scanning the hash table. Must be called with IOMMU lock held.
+ */
+static uint32_t vtd_iotlb_domain_gen(IntelIOMMUState *s, uint16_t domain_id)
 {
-    VTDIOTLBEntry *entry = (VTDIOTLBEntry *)value;
-    uint16_t domain_id = *(uint16_t *)user_data;
-    return entry->domain_id == domain_id;
+    gpointer v = g_hash_table_lookup(s->iotlb_domain_gen,
+                                     GUINT_TO_POINTER(domain_id));
+
+    return GPOINTER_TO_UINT(v);
 }
 
 /* The shift of an addr for a certain level of paging structure */
@@ -261,6 +267,7 @@ static void vtd_reset_iotlb_locked(IntelIOMMUState *s)
 {
     assert(s->iotlb);
     g_hash_table_remove_all(s->iotlb);
+    g_hash_table_remove_all(s->iotlb_domain_gen);
 }
 
 static void vtd_reset_iotlb(IntelIOMMUState *s)
@@ -303,6 +310,13 @@ static VTDIOTLBEntry *vtd_lookup_iotlb(IntelIOMMUState *s, uint16_t source_id,
                                 source_id, level);
         entry = g_hash_table_lookup(s->iotlb, &key);
         if (entry) {
+            /* Entries from before the last domain invalidation are dead */
+            if (entry->domain_gen !=
+                vtd_iotlb_domain_gen(s, entry->domain_id)) {
+                g_hash_table_remove(s->iotlb, &key);
+                entry = NULL;
+                continue;
+            }
             goto out;
         }
     }
@@ -328,6 +342,7 @@ static void vtd_update_iotlb(IntelIOMMUState *s, uint16_t source_id,
 
     entry->gfn = gfn;
     entry->domain_id = domain_id;
+    entry->domain_gen = vtd_iotlb_domain_gen(s, domain_id);
     entry->slpte = slpte;
     entry->access_flags = access_flags;
     entry->mask = vtd_slpt_level_page_mask(level);
@@ -1960,12 +1975,19 @@ static void vtd_iotlb_domain_invalidate(IntelIOMMUState *s, uint16_t domain_id)
 {
     VTDContextEntry ce;
     VTDAddressSpace *vtd_as;
+    uint32_t gen;
 
     trace_vtd_inv_desc_iotlb_domain(domain_id);
 
     vtd_iommu_lock(s);
-    g_hash_table_foreach_remove(s->iotlb, vtd_hash_remove_by_domain,
-                                &domain_id);
+    /*
+     * Invalidate the whole domain in O(1) by bumping its generation;
+     * stale entries are reclaimed lazily on lookup or when the IOTLB
+     * size limit triggers a full reset.
+     */
+    gen = vtd_iotlb_domain_gen(s, domain_id) + 1;
+    g_hash_table_replace(s->iotlb_domain_gen, GUINT_TO_POINTER(domain_id),
+                         GUINT_TO_POINTER(gen));
     vtd_iommu_unlock(s);
 
     QLIST_FOREACH(vtd_as, &s->vtd_as_with_notifiers, next) {
@@ -3838,6 +3860,7 @@ static void vtd_realize(DeviceState *dev, Error **errp)
     /* No corresponding destroy */
     s->iotlb = g_hash_table_new_full(vtd_uint64_hash, vtd_uint64_equal,
                                      g_free, g_free);
+    s->iotlb_domain_gen = g_hash_table_new(NULL, NULL);
     s->vtd_as_by_busptr = g_hash_table_new_full(vtd_uint64_hash, vtd_uint64_equal,
                                               g_free, g_free);
     vtd_init(s);
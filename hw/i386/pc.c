@@ -1389,6 +1389,9 @@ static void pc_machine_device_plug_cb(HotplugHandler *hotplug_dev,
                object_dynamic_cast(OBJECT(dev), TYPE_VIRTIO_MEM_PCI)) {
         pc_virtio_md_pci_plug(hotplug_dev, dev, errp);
     }
+
+    /* The ACPI tables depend on the plugged devices, drop any cached build */
+    acpi_build_invalidate();
 }
 
 static void pc_machine_device_unplug_request_cb(HotplugHandler *hotplug_dev,
@@ -1421,6 +1424,8 @@ static void pc_machine_device_unplug_cb(HotplugHandler *hotplug_dev,
         error_setg(errp, "acpi: device unplug for not supported device"
                    " type: %s", object_get_typename(OBJECT(dev)));
     }
+
+    acpi_build_invalidate();
 }
 
 static HotplugHandler *pc_get_hotplug_handler(MachineState *machine,
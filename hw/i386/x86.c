@@ -849,6 +849,12 @@ void x86_load_linux(X86MachineState *x86ms,
 
                 initrd_data = g_mapped_file_get_contents(mapped_file);
                 initrd_size = g_mapped_file_get_length(mapped_file);
+                /*
+                 * Kick off readahead now so the pages are warm (and, with
+                 * several VMs booting the same initrd, shared in the page
+                 * cache) by the time the firmware pulls them over fw_cfg.
+                 */
+                qemu_madvise(initrd_data, initrd_size, QEMU_MADV_WILLNEED);
                 initrd_max = x86ms->below_4g_mem_size - acpi_data_size - 1;
                 if (initrd_size >= initrd_max) {
                     fprintf(stderr, "qemu: initrd is too large, cannot support."
@@ -993,6 +999,8 @@ void x86_load_linux(X86MachineState *x86ms,
 
         initrd_data = g_mapped_file_get_contents(mapped_file);
         initrd_size = g_mapped_file_get_length(mapped_file);
+        /* start readahead early, the DMA read below wants warm pages */
+        qemu_madvise(initrd_data, initrd_size, QEMU_MADV_WILLNEED);
         if (initrd_size >= initrd_max) {
             fprintf(stderr, "qemu: initrd is too large, cannot support."
                     "(max: %"PRIu32", need %"PRId64")\n",
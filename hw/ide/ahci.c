@@ -39,6 +39,13 @@
 
 #include "trace.h"
 
+/*
+ * Guest drivers recycle a small set of I/O buffers, so a modest number
+ * of cached translations covers the PRDT entries of all 32 command
+ * slots in steady state.
+ */
+#define AHCI_DMA_SG_CACHE_SIZE 128
+
 static void check_cmd(AHCIState *s, int port);
 static int handle_cmd(AHCIState *s, int port, uint8_t slot);
 static void ahci_reset_port(AHCIState *s, int port);
@@ -972,6 +979,7 @@ static int ahci_populate_sglist(AHCIDevice *ad, QEMUSGList *sglist,
 
         qemu_sglist_init(sglist, qbus->parent, (prdtl - off_idx),
                          ad->hba->as);
+        qemu_sglist_set_map_cache(sglist, ad->hba->map_cache);
         qemu_sglist_add(sglist, le64_to_cpu(tbl[off_idx].addr) + off_pos,
                         MIN(prdt_tbl_entry_size(&tbl[off_idx]) - off_pos,
                             limit));
@@ -1541,6 +1549,7 @@ void ahci_realize(AHCIState *s, DeviceState *qdev, AddressSpace *as, int ports)
     int i;
 
     s->as = as;
+    s->map_cache = dma_sg_cache_new(as, AHCI_DMA_SG_CACHE_SIZE);
     s->ports = ports;
     s->dev = g_new0(AHCIDevice, ports);
     ahci_reg_init(s);
@@ -1575,6 +1584,7 @@ void ahci_uninit(AHCIState *s)
         object_unparent(OBJECT(&ad->port));
     }
 
+    dma_sg_cache_free(s->map_cache);
     g_free(s->dev);
 }
 
@@ -1491,6 +1491,11 @@ e1000e_write_packet_to_guest(E1000ECore *core, struct NetRxPkt *pkt,
     PCIDevice *d = core->owner;
     dma_addr_t base;
     uint8_t desc[E1000_MAX_RX_DESC_LEN];
+    /* Batched descriptor writeback state: up to 16 contiguous
+     * completed descriptors are flushed with a single DMA write. */
+    uint8_t desc_wb[E1000_MAX_RX_DESC_LEN * 16];
+    dma_addr_t wb_base = 0;
+    size_t wb_len = 0;
     size_t desc_size;
     size_t desc_offset = 0;
     size_t iov_ofs = 0;
@@ -1517,6 +1522,9 @@ e1000e_write_packet_to_guest(E1000ECore *core, struct NetRxPkt *pkt,
         }
 
         if (e1000e_ring_empty(core, rxi)) {
+            if (wb_len) {
+                pci_dma_write(d, wb_base, desc_wb, wb_len);
+            }
             return;
         }
 
@@ -1598,13 +1606,29 @@ e1000e_write_packet_to_guest(E1000ECore *core, struct NetRxPkt *pkt,
 
         e1000e_write_rx_descr(core, desc, is_last ? core->rx_pkt : NULL,
                            rss_info, do_ps ? ps_hdr_len : 0, &bastate.written);
-        pci_dma_write(d, base, &desc, core->rx_desc_len);
+
+        /* Flush the writeback batch if this descriptor is not adjacent
+         * to it (ring wrap) or it would not fit. */
+        if (wb_len && (base != wb_base + wb_len ||
+                       wb_len + core->rx_desc_len > sizeof(desc_wb))) {
+            pci_dma_write(d, wb_base, desc_wb, wb_len);
+            wb_len = 0;
+        }
+        if (wb_len == 0) {
+            wb_base = base;
+        }
+        memcpy(desc_wb + wb_len, desc, core->rx_desc_len);
+        wb_len += core->rx_desc_len;
 
         e1000e_ring_advance(core, rxi,
                             core->rx_desc_len / E1000_MIN_RX_DESC_LEN);
 
     } while (desc_offset < total_size);
 
+    if (wb_len) {
+        pci_dma_write(d, wb_base, desc_wb, wb_len);
+    }
+
     e1000e_update_rx_stats(core, size, total_size);
 }
 
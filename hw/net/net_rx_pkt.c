@@ -21,6 +21,20 @@
 #include "net/checksum.h"
 #include "net/tap.h"
 
+/* the longest RSS input is an IPv6 5-tuple: 2 * 16 + 2 * 2 bytes */
+#define RSS_INPUT_MAX_LEN 36
+/* the key must cover one 32-bit window past the last input byte */
+#define RSS_KEY_LEN (RSS_INPUT_MAX_LEN + sizeof(uint32_t))
+/* per packet steering cache, direct mapped, power of two entries */
+#define RSS_CACHE_SIZE 256
+
+typedef struct NetRxPktRssCacheEntry {
+    uint8_t input[RSS_INPUT_MAX_LEN];
+    /* input length in bytes, 0 for an unused entry */
+    uint8_t len;
+    uint32_t hash;
+} NetRxPktRssCacheEntry;
+
 struct NetRxPkt {
     struct virtio_net_hdr virt_hdr;
     uint8_t ehdr_buf[sizeof(struct eth_header) + sizeof(struct vlan_header)];
@@ -46,6 +60,14 @@ struct NetRxPkt {
     eth_ip6_hdr_info ip6hdr_info;
     eth_ip4_hdr_info ip4hdr_info;
     eth_l4_hdr_info  l4hdr_info;
+
+    /* RSS acceleration state, allocated on the first hash request */
+    /* key the Toeplitz table below was built for */
+    uint8_t rss_key[RSS_KEY_LEN];
+    bool rss_key_valid;
+    /* per input position precomputed Toeplitz terms for every byte */
+    uint32_t (*rss_table)[256];
+    NetRxPktRssCacheEntry *rss_cache;
 };
 
 void net_rx_pkt_init(struct NetRxPkt **pkt, bool has_virt_hdr)
@@ -63,6 +85,8 @@ void net_rx_pkt_uninit(struct NetRxPkt *pkt)
         g_free(pkt->vec);
     }
 
+    g_free(pkt->rss_table);
+    g_free(pkt->rss_cache);
     g_free(pkt);
 }
 
@@ -321,15 +345,62 @@ _net_rx_rss_prepare_udp(uint8_t *rss_input,
                           &udphdr->uh_dport, sizeof(uint16_t));
 }
 
+/*
+ * The Toeplitz hash is linear over GF(2): the hash of an input is the
+ * XOR of the contributions of each input byte at its position.  Build
+ * a table of those contributions for every position and byte value,
+ * which turns the per packet bit loop into one table load per input
+ * byte.  The table only has to be rebuilt when the key changes.
+ */
+static void net_rx_pkt_rss_build_table(struct NetRxPkt *pkt, uint8_t *key)
+{
+    int i, v;
+
+    if (!pkt->rss_table) {
+        pkt->rss_table = g_new(uint32_t[256], RSS_INPUT_MAX_LEN);
+        pkt->rss_cache = g_new(NetRxPktRssCacheEntry, RSS_CACHE_SIZE);
+    }
+
+    for (i = 0; i < RSS_INPUT_MAX_LEN; i++) {
+        for (v = 0; v < 256; v++) {
+            net_toeplitz_key key_data;
+            uint32_t hash = 0;
+            uint8_t byte = v;
+
+            net_toeplitz_key_init(&key_data, &key[i]);
+            net_toeplitz_add(&hash, &byte, 1, &key_data);
+            pkt->rss_table[i][v] = hash;
+        }
+    }
+
+    memcpy(pkt->rss_key, key, RSS_KEY_LEN);
+    pkt->rss_key_valid = true;
+    /* the cached hashes were computed with the previous key */
+    memset(pkt->rss_cache, 0, RSS_CACHE_SIZE * sizeof(*pkt->rss_cache));
+}
+
+static NetRxPktRssCacheEntry *
+net_rx_pkt_rss_cache_entry(struct NetRxPkt *pkt, const uint8_t *input,
+                           size_t len)
+{
+    uint32_t bucket = len;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        bucket = bucket * 31 + input[i];
+    }
+    return &pkt->rss_cache[bucket & (RSS_CACHE_SIZE - 1)];
+}
+
 uint32_t
 net_rx_pkt_calc_rss_hash(struct NetRxPkt *pkt,
                          NetRxPktRssType type,
                          uint8_t *key)
 {
-    uint8_t rss_input[36];
+    uint8_t rss_input[RSS_INPUT_MAX_LEN];
     size_t rss_length = 0;
     uint32_t rss_hash = 0;
-    net_toeplitz_key key_data;
+    NetRxPktRssCacheEntry *entry;
 
     switch (type) {
     case NetPktRssIpV4:
@@ -394,8 +465,26 @@ net_rx_pkt_calc_rss_hash(struct NetRxPkt *pkt,
         break;
     }
 
-    net_toeplitz_key_init(&key_data, key);
-    net_toeplitz_add(&rss_hash, rss_input, rss_length, &key_data);
+    if (!pkt->rss_key_valid || memcmp(pkt->rss_key, key, RSS_KEY_LEN)) {
+        net_rx_pkt_rss_build_table(pkt, key);
+    }
+
+    entry = net_rx_pkt_rss_cache_entry(pkt, rss_input, rss_length);
+    if (entry->len == rss_length &&
+        !memcmp(entry->input, rss_input, rss_length)) {
+        /* same flow as last time, steer it without rehashing */
+        rss_hash = entry->hash;
+        trace_net_rx_pkt_rss_cache_hit(rss_hash);
+    } else {
+        size_t i;
+
+        for (i = 0; i < rss_length; i++) {
+            rss_hash ^= pkt->rss_table[i][rss_input[i]];
+        }
+        memcpy(entry->input, rss_input, rss_length);
+        entry->len = rss_length;
+        entry->hash = rss_hash;
+    }
 
     trace_net_rx_pkt_rss_hash(rss_length, rss_hash);
 
@@ -31,6 +31,7 @@
 #include "net/announce.h"
 #include "hw/virtio/virtio-bus.h"
 #include "qapi/error.h"
+#include "qapi/qapi-commands-net.h"
 #include "qapi/qapi-events-net.h"
 #include "hw/qdev-properties.h"
 #include "qapi/qapi-types-migration.h"
@@ -399,7 +400,8 @@ static void virtio_net_set_status(struct VirtIODevice *vdev, uint8_t status)
         } else {
             if (q->tx_timer) {
                 timer_del(q->tx_timer);
-            } else {
+            }
+            if (q->tx_bh) {
                 qemu_bh_cancel(q->tx_bh);
             }
             if ((n->status & VIRTIO_NET_S_LINK_UP) == 0 &&
@@ -2488,11 +2490,41 @@ static void virtio_net_tx_complete(NetClientState *nc, ssize_t len)
 }
 
 /* TX */
+
+/* tx descriptor chains translated per virtqueue_pop_batch() call */
+#define VIRTIO_NET_TX_BATCH 32
+
+static void virtio_net_tx_return_batch(VirtQueue *vq, VirtQueueElement **elems,
+                                       size_t next, size_t batch)
+{
+    /* undo in reverse order so the avail index unwinds correctly */
+    while (batch-- > next) {
+        virtqueue_unpop(vq, elems[batch], 0);
+        g_free(elems[batch]);
+    }
+}
+
+static void virtio_net_tx_account(VirtIONetQueue *q, int32_t num_packets)
+{
+    size_t bucket = 0;
+    int32_t rest = num_packets;
+
+    while (rest > 0 && bucket < VIRTIO_NET_TX_BATCH_HIST_SIZE - 1) {
+        bucket++;
+        rest >>= 1;
+    }
+    q->tx_batch_hist[bucket]++;
+    /* EWMA with alpha = 1/8 */
+    q->tx_ewma += (num_packets * 16 - (int32_t)q->tx_ewma) / 8;
+}
+
 static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
 {
     VirtIONet *n = q->n;
     VirtIODevice *vdev = VIRTIO_DEVICE(n);
     VirtQueueElement *elem;
+    VirtQueueElement *elems[VIRTIO_NET_TX_BATCH];
+    size_t batch = 0, next = 0;
     int32_t num_packets = 0;
     int queue_index = vq2q(virtio_get_queue_index(q->tx_vq));
     if (!(vdev->status & VIRTIO_CONFIG_S_DRIVER_OK)) {
@@ -2510,10 +2542,19 @@ static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
         struct iovec sg[VIRTQUEUE_MAX_SIZE], sg2[VIRTQUEUE_MAX_SIZE + 1], *out_sg;
         struct virtio_net_hdr_mrg_rxbuf mhdr;
 
-        elem = virtqueue_pop(q->tx_vq, sizeof(VirtQueueElement));
-        if (!elem) {
-            break;
+        if (next == batch) {
+            /* cap at the burst budget, but always make progress */
+            size_t want = MIN(ARRAY_SIZE(elems),
+                              (size_t)MAX(n->tx_burst - num_packets, 1));
+
+            batch = virtqueue_pop_batch(q->tx_vq, sizeof(VirtQueueElement),
+                                        (void **)elems, want);
+            next = 0;
+            if (!batch) {
+                break;
+            }
         }
+        elem = elems[next++];
 
         out_num = elem->out_num;
         out_sg = elem->out_sg;
@@ -2521,6 +2562,7 @@ static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
             virtio_error(vdev, "virtio-net header not in first element");
             virtqueue_detach_element(q->tx_vq, elem, 0);
             g_free(elem);
+            virtio_net_tx_return_batch(q->tx_vq, elems, next, batch);
             return -EINVAL;
         }
 
@@ -2530,6 +2572,7 @@ static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
                 virtio_error(vdev, "virtio-net header incorrect");
                 virtqueue_detach_element(q->tx_vq, elem, 0);
                 g_free(elem);
+                virtio_net_tx_return_batch(q->tx_vq, elems, next, batch);
                 return -EINVAL;
             }
             if (n->needs_vnet_hdr_swap) {
@@ -2568,6 +2611,7 @@ static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
         if (ret == 0) {
             virtio_queue_set_notification(q->tx_vq, 0);
             q->async_tx.elem = elem;
+            virtio_net_tx_return_batch(q->tx_vq, elems, next, batch);
             return -EBUSY;
         }
 
@@ -2580,6 +2624,7 @@ drop:
             break;
         }
     }
+    virtio_net_tx_account(q, num_packets);
     return num_packets;
 }
 
@@ -2636,6 +2681,57 @@ static void virtio_net_handle_tx_bh(VirtIODevice *vdev, VirtQueue *vq)
     qemu_bh_schedule(q->tx_bh);
 }
 
+/*
+ * Thresholds, in average packets per flush, for moving a queue between
+ * immediate flush, bottom half and timer coalescing.
+ */
+#define VIRTIO_NET_TX_ADAPTIVE_BH    2
+#define VIRTIO_NET_TX_ADAPTIVE_TIMER 32
+
+static void virtio_net_handle_tx_adaptive(VirtIODevice *vdev, VirtQueue *vq)
+{
+    VirtIONet *n = VIRTIO_NET(vdev);
+    VirtIONetQueue *q = &n->vqs[vq2q(virtio_get_queue_index(vq))];
+    uint32_t avg;
+
+    if (unlikely((n->status & VIRTIO_NET_S_LINK_UP) == 0)) {
+        virtio_net_drop_tx_queue_data(vdev, vq);
+        return;
+    }
+
+    /* This happens when device was stopped but VCPU wasn't. */
+    if (!vdev->vm_running) {
+        q->tx_waiting = 1;
+        return;
+    }
+
+    if (unlikely(q->tx_waiting)) {
+        return;
+    }
+
+    avg = q->tx_ewma / 16;
+    if (avg >= VIRTIO_NET_TX_ADAPTIVE_TIMER) {
+        /*
+         * The guest is streaming; wait for more packets to accumulate
+         * before taking a pass over the ring.
+         */
+        virtio_queue_set_notification(vq, 0);
+        timer_mod(q->tx_timer,
+                  qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + n->tx_timeout);
+        q->tx_waiting = 1;
+    } else if (avg >= VIRTIO_NET_TX_ADAPTIVE_BH) {
+        virtio_queue_set_notification(vq, 0);
+        q->tx_waiting = 1;
+        qemu_bh_schedule(q->tx_bh);
+    } else {
+        /*
+         * Kicks are carrying single packets; flushing directly from the
+         * vcpu thread keeps the latency down to one pass over the ring.
+         */
+        virtio_net_flush_tx(q);
+    }
+}
+
 static void virtio_net_tx_timer(void *opaque)
 {
     VirtIONetQueue *q = opaque;
@@ -2722,6 +2818,14 @@ static void virtio_net_add_queue(VirtIONet *n, int index)
         n->vqs[index].tx_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL,
                                               virtio_net_tx_timer,
                                               &n->vqs[index]);
+    } else if (n->net_conf.tx && !strcmp(n->net_conf.tx, "adaptive")) {
+        n->vqs[index].tx_vq =
+            virtio_add_queue(vdev, n->net_conf.tx_queue_size,
+                             virtio_net_handle_tx_adaptive);
+        n->vqs[index].tx_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL,
+                                              virtio_net_tx_timer,
+                                              &n->vqs[index]);
+        n->vqs[index].tx_bh = qemu_bh_new(virtio_net_tx_bh, &n->vqs[index]);
     } else {
         n->vqs[index].tx_vq =
             virtio_add_queue(vdev, n->net_conf.tx_queue_size,
@@ -2745,7 +2849,8 @@ static void virtio_net_del_queue(VirtIONet *n, int index)
     if (q->tx_timer) {
         timer_free(q->tx_timer);
         q->tx_timer = NULL;
-    } else {
+    }
+    if (q->tx_bh) {
         qemu_bh_delete(q->tx_bh);
         q->tx_bh = NULL;
     }
@@ -3147,6 +3252,44 @@ static NetClientInfo net_virtio_info = {
     .announce = virtio_net_announce,
 };
 
+VirtioNetTxBatchStatsList *qmp_x_query_virtio_net_tx_batch(const char *name,
+                                                           Error **errp)
+{
+    NetClientState *ncs[MAX_QUEUE_NUM];
+    VirtioNetTxBatchStatsList *stats = NULL, **tail = &stats;
+    VirtIONet *n;
+    int queues, i, j;
+
+    queues = qemu_find_net_clients_except(name, ncs,
+                                          NET_CLIENT_DRIVER__MAX,
+                                          MAX_QUEUE_NUM);
+    if (queues == 0) {
+        error_set(errp, ERROR_CLASS_DEVICE_NOT_FOUND,
+                  "Device '%s' not found", name);
+        return NULL;
+    }
+    if (ncs[0]->info != &net_virtio_info) {
+        error_setg(errp, "Device '%s' is not a virtio-net device", name);
+        return NULL;
+    }
+
+    n = qemu_get_nic_opaque(ncs[0]);
+    for (i = 0; i < n->max_queues; i++) {
+        VirtIONetQueue *q = &n->vqs[i];
+        VirtioNetTxBatchStats *s = g_new0(VirtioNetTxBatchStats, 1);
+        uint64List **htail = &s->histogram;
+
+        s->queue = i;
+        s->avg_batch = q->tx_ewma / 16;
+        for (j = 0; j < VIRTIO_NET_TX_BATCH_HIST_SIZE; j++) {
+            QAPI_LIST_APPEND(htail, q->tx_batch_hist[j]);
+        }
+        QAPI_LIST_APPEND(tail, s);
+    }
+
+    return stats;
+}
+
 static bool virtio_net_guest_notifier_pending(VirtIODevice *vdev, int idx)
 {
     VirtIONet *n = VIRTIO_NET(vdev);
@@ -3381,9 +3524,11 @@ static void virtio_net_device_realize(DeviceState *dev, Error **errp)
     n->tx_timeout = n->net_conf.txtimer;
 
     if (n->net_conf.tx && strcmp(n->net_conf.tx, "timer")
-                       && strcmp(n->net_conf.tx, "bh")) {
+                       && strcmp(n->net_conf.tx, "bh")
+                       && strcmp(n->net_conf.tx, "adaptive")) {
         warn_report("virtio-net: "
-                    "Unknown option tx=%s, valid options: \"timer\" \"bh\"",
+                    "Unknown option tx=%s, valid options: "
+                    "\"timer\" \"bh\" \"adaptive\"",
                     n->net_conf.tx);
         error_printf("Defaulting to \"bh\"");
     }
@@ -19,6 +19,7 @@
 static char *scsibus_get_dev_path(DeviceState *dev);
 static char *scsibus_get_fw_dev_path(DeviceState *dev);
 static void scsi_req_dequeue(SCSIRequest *req);
+static void scsi_req_pool_drain(SCSIDevice *d);
 static uint8_t *scsi_target_alloc_buf(SCSIRequest *req, size_t len);
 static void scsi_target_free_buf(SCSIRequest *req);
 
@@ -279,6 +280,7 @@ static void scsi_qdev_realize(DeviceState *qdev, Error **errp)
     }
 
     QTAILQ_INIT(&dev->requests);
+    QTAILQ_INIT(&dev->free_requests);
     scsi_device_realize(dev, &local_err);
     if (local_err) {
         error_propagate(errp, local_err);
@@ -297,6 +299,7 @@ static void scsi_qdev_unrealize(DeviceState *qdev)
     }
 
     scsi_device_purge_requests(dev, SENSE_CODE(NO_SENSE));
+    scsi_req_pool_drain(dev);
 
     scsi_device_unrealize(dev);
 
@@ -674,6 +677,46 @@ static const struct SCSIReqOps reqops_target_command = {
 };
 
 
+/* Upper bound on requests cached per device for reuse */
+#define SCSI_REQ_POOL_SIZE 64
+
+static SCSIRequest *scsi_req_pool_get(SCSIDevice *d, const SCSIReqOps *reqops)
+{
+    SCSIRequest *req = QTAILQ_FIRST(&d->free_requests);
+
+    if (!req) {
+        return NULL;
+    }
+    QTAILQ_REMOVE(&d->free_requests, req, next);
+    d->nfree_requests--;
+    if (req->alloc_size < reqops->size) {
+        g_free(req);
+        return NULL;
+    }
+    return req;
+}
+
+static void scsi_req_pool_put(SCSIDevice *d, SCSIRequest *req)
+{
+    if (d->nfree_requests >= SCSI_REQ_POOL_SIZE) {
+        g_free(req);
+        return;
+    }
+    QTAILQ_INSERT_HEAD(&d->free_requests, req, next);
+    d->nfree_requests++;
+}
+
+static void scsi_req_pool_drain(SCSIDevice *d)
+{
+    SCSIRequest *req;
+
+    while ((req = QTAILQ_FIRST(&d->free_requests))) {
+        QTAILQ_REMOVE(&d->free_requests, req, next);
+        g_free(req);
+    }
+    d->nfree_requests = 0;
+}
+
 SCSIRequest *scsi_req_alloc(const SCSIReqOps *reqops, SCSIDevice *d,
                             uint32_t tag, uint32_t lun, void *hba_private)
 {
@@ -683,7 +726,11 @@ SCSIRequest *scsi_req_alloc(const SCSIReqOps *reqops, SCSIDevice *d,
     const int memset_off = offsetof(SCSIRequest, sense)
                            + sizeof(req->sense);
 
-    req = g_malloc(reqops->size);
+    req = scsi_req_pool_get(d, reqops);
+    if (!req) {
+        req = g_malloc(reqops->size);
+        req->alloc_size = reqops->size;
+    }
     memset((uint8_t *)req + memset_off, 0, reqops->size - memset_off);
     req->refcount = 1;
     req->bus = bus;
@@ -1373,9 +1420,9 @@ void scsi_req_unref(SCSIRequest *req)
         if (req->ops->free_req) {
             req->ops->free_req(req);
         }
+        scsi_req_pool_put(req->dev, req);
         object_unref(OBJECT(req->dev));
         object_unref(OBJECT(qbus->parent));
-        g_free(req);
     }
 }
 
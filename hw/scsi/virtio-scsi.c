@@ -29,6 +29,9 @@
 #include "hw/virtio/virtio-access.h"
 #include "trace.h"
 
+/* Pop up to this many command requests with one avail index fetch */
+#define VIRTIO_SCSI_REQ_BATCH 32
+
 static inline int virtio_scsi_get_lun(uint8_t *lun)
 {
     return ((lun[2] << 8) | lun[3]) & 0x3FFF;
@@ -674,7 +677,10 @@ static void virtio_scsi_handle_cmd_req_submit(VirtIOSCSI *s, VirtIOSCSIReq *req)
 
 bool virtio_scsi_handle_cmd_vq(VirtIOSCSI *s, VirtQueue *vq)
 {
+    VirtIOSCSICommon *vs = (VirtIOSCSICommon *)s;
+    VirtQueueElement *elems[VIRTIO_SCSI_REQ_BATCH];
     VirtIOSCSIReq *req, *next;
+    size_t n, i;
     int ret = 0;
     bool suppress_notifications = virtio_queue_get_notification(vq);
     bool progress = false;
@@ -686,20 +692,33 @@ bool virtio_scsi_handle_cmd_vq(VirtIOSCSI *s, VirtQueue *vq)
             virtio_queue_set_notification(vq, 0);
         }
 
-        while ((req = virtio_scsi_pop_req(s, vq))) {
-            progress = true;
-            ret = virtio_scsi_handle_cmd_req_prepare(s, req);
-            if (!ret) {
-                QTAILQ_INSERT_TAIL(&reqs, req, next);
-            } else if (ret == -EINVAL) {
-                /* The device is broken and shouldn't process any request */
-                while (!QTAILQ_EMPTY(&reqs)) {
-                    req = QTAILQ_FIRST(&reqs);
-                    QTAILQ_REMOVE(&reqs, req, next);
-                    blk_io_unplug(req->sreq->dev->conf.blk);
-                    scsi_req_unref(req->sreq);
-                    virtqueue_detach_element(req->vq, &req->elem, 0);
-                    virtio_scsi_free_req(req);
+        while (ret != -EINVAL &&
+               (n = virtqueue_pop_batch(vq,
+                                        sizeof(VirtIOSCSIReq) + vs->cdb_size,
+                                        (void **)elems,
+                                        VIRTIO_SCSI_REQ_BATCH))) {
+            for (i = 0; i < n; i++) {
+                req = (VirtIOSCSIReq *)elems[i];
+                virtio_scsi_init_req(s, vq, req);
+                progress = true;
+                ret = virtio_scsi_handle_cmd_req_prepare(s, req);
+                if (!ret) {
+                    QTAILQ_INSERT_TAIL(&reqs, req, next);
+                } else if (ret == -EINVAL) {
+                    /* The device is broken and shouldn't process any request */
+                    while (++i < n) {
+                        virtqueue_detach_element(vq, elems[i], 0);
+                        g_free(elems[i]);
+                    }
+                    while (!QTAILQ_EMPTY(&reqs)) {
+                        req = QTAILQ_FIRST(&reqs);
+                        QTAILQ_REMOVE(&reqs, req, next);
+                        blk_io_unplug(req->sreq->dev->conf.blk);
+                        scsi_req_unref(req->sreq);
+                        virtqueue_detach_element(req->vq, &req->elem, 0);
+                        virtio_scsi_free_req(req);
+                    }
+                    break;
                 }
             }
         }
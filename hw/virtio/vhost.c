@@ -17,6 +17,7 @@
 #include "qapi/error.h"
 #include "hw/virtio/vhost.h"
 #include "qemu/atomic.h"
+#include "qemu/cutils.h"
 #include "qemu/range.h"
 #include "qemu/error-report.h"
 #include "qemu/memfd.h"
@@ -60,6 +61,11 @@ bool vhost_has_free_slot(void)
     return slots_limit > used_memslots;
 }
 
+static int vhost_dev_has_iommu(struct vhost_dev *dev);
+
+/* Size, in log chunks, of the zero probes over clean parts of the log */
+#define VHOST_LOG_ZERO_WORDS 256
+
 static void vhost_dev_sync_region(struct vhost_dev *dev,
                                   MemoryRegionSection *section,
                                   uint64_t mfirst, uint64_t mlast,
@@ -79,29 +85,48 @@ static void vhost_dev_sync_region(struct vhost_dev *dev,
     assert(end / VHOST_LOG_CHUNK < dev->log_size);
     assert(start / VHOST_LOG_CHUNK < dev->log_size);
 
-    for (;from < to; ++from) {
-        vhost_log_chunk_t log;
-        /* We first check with non-atomic: much cheaper,
-         * and we expect non-dirty to be the common case. */
-        if (!*from) {
-            addr += VHOST_LOG_CHUNK;
+    while (from < to) {
+        vhost_log_chunk_t *block_end =
+            from + MIN((size_t)(to - from), (size_t)VHOST_LOG_ZERO_WORDS);
+
+        /*
+         * The log is mostly clean on each iteration; probing whole
+         * blocks with the vectorized buffer_is_zero() skips them at
+         * memory bandwidth instead of one chunk at a time.
+         */
+        if (block_end - from > 1 && !*from &&
+            buffer_is_zero(from, (block_end - from) * sizeof(*from))) {
+            addr += (block_end - from) * VHOST_LOG_CHUNK;
+            from = block_end;
             continue;
         }
-        /* Data must be read atomically. We don't really need barrier semantics
-         * but it's easier to use atomic_* than roll our own. */
-        log = qatomic_xchg(from, 0);
-        while (log) {
-            int bit = ctzl(log);
-            hwaddr page_addr;
-            hwaddr section_offset;
-            hwaddr mr_offset;
-            page_addr = addr + bit * VHOST_LOG_PAGE;
-            section_offset = page_addr - section->offset_within_address_space;
-            mr_offset = section_offset + section->offset_within_region;
-            memory_region_set_dirty(section->mr, mr_offset, VHOST_LOG_PAGE);
-            log &= ~(0x1ull << bit);
+
+        for (; from < block_end; ++from) {
+            vhost_log_chunk_t log;
+            /* We first check with non-atomic: much cheaper,
+             * and we expect non-dirty to be the common case. */
+            if (!*from) {
+                addr += VHOST_LOG_CHUNK;
+                continue;
+            }
+            /* Data must be read atomically. We don't really need barrier
+             * semantics but it's easier to use atomic_* than roll our own. */
+            log = qatomic_xchg(from, 0);
+            while (log) {
+                int bit = ctzl(log);
+                hwaddr page_addr;
+                hwaddr section_offset;
+                hwaddr mr_offset;
+                page_addr = addr + bit * VHOST_LOG_PAGE;
+                section_offset = page_addr -
+                    section->offset_within_address_space;
+                mr_offset = section_offset + section->offset_within_region;
+                memory_region_set_dirty(section->mr, mr_offset,
+                                        VHOST_LOG_PAGE);
+                log &= ~(0x1ull << bit);
+            }
+            addr += VHOST_LOG_CHUNK;
         }
-        addr += VHOST_LOG_CHUNK;
     }
 }
 
@@ -129,15 +154,26 @@ static int vhost_sync_dirty_bitmap(struct vhost_dev *dev,
                               range_get_last(reg->guest_phys_addr,
                                              reg->memory_size));
     }
-    for (i = 0; i < dev->nvqs; ++i) {
-        struct vhost_virtqueue *vq = dev->vqs + i;
+    /*
+     * Without a vIOMMU the used rings live in guest memory and their
+     * log_guest_addr falls inside the regions scanned above, so a
+     * second pass over them would only re-read words that were already
+     * collected.  With a vIOMMU, used_phys is an IOVA that the region
+     * scan does not cover.
+     */
+    if (vhost_dev_has_iommu(dev)) {
+        for (i = 0; i < dev->nvqs; ++i) {
+            struct vhost_virtqueue *vq = dev->vqs + i;
 
-        if (!vq->used_phys && !vq->used_size) {
-            continue;
-        }
+            if (!vq->used_phys && !vq->used_size) {
+                continue;
+            }
 
-        vhost_dev_sync_region(dev, section, start_addr, end_addr, vq->used_phys,
-                              range_get_last(vq->used_phys, vq->used_size));
+            vhost_dev_sync_region(dev, section, start_addr, end_addr,
+                                  vq->used_phys,
+                                  range_get_last(vq->used_phys,
+                                                 vq->used_size));
+        }
     }
     return 0;
 }
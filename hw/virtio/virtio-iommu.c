@@ -185,26 +185,79 @@ static void virtio_iommu_notify_unmap(IOMMUMemoryRegion *mr, hwaddr virt_start,
     }
 }
 
+/*
+ * State for coalescing contiguous mappings into a single notifier
+ * event while walking a domain's mapping tree in order. vhost and
+ * vfio consumers pay a fixed cost per event, so replaying adjacent 4k
+ * mappings one by one serializes device startup.
+ */
+typedef struct VirtIOIOMMUNotifySpan {
+    IOMMUMemoryRegion *mr;
+    bool valid;
+    hwaddr virt_low;
+    hwaddr virt_high;
+    hwaddr phys;
+    uint32_t flags;
+} VirtIOIOMMUNotifySpan;
+
+static void virtio_iommu_span_flush_unmap(VirtIOIOMMUNotifySpan *span)
+{
+    if (span->valid) {
+        virtio_iommu_notify_unmap(span->mr, span->virt_low, span->virt_high);
+        span->valid = false;
+    }
+}
+
 static gboolean virtio_iommu_notify_unmap_cb(gpointer key, gpointer value,
                                              gpointer data)
 {
     VirtIOIOMMUInterval *interval = (VirtIOIOMMUInterval *) key;
-    IOMMUMemoryRegion *mr = (IOMMUMemoryRegion *) data;
+    VirtIOIOMMUNotifySpan *span = (VirtIOIOMMUNotifySpan *) data;
 
-    virtio_iommu_notify_unmap(mr, interval->low, interval->high);
+    if (span->valid && interval->low == span->virt_high + 1) {
+        span->virt_high = interval->high;
+        return false;
+    }
+
+    virtio_iommu_span_flush_unmap(span);
+    span->valid = true;
+    span->virt_low = interval->low;
+    span->virt_high = interval->high;
 
     return false;
 }
 
+static void virtio_iommu_span_flush_map(VirtIOIOMMUNotifySpan *span)
+{
+    if (span->valid) {
+        virtio_iommu_notify_map(span->mr, span->virt_low, span->virt_high,
+                                span->phys, span->flags);
+        span->valid = false;
+    }
+}
+
 static gboolean virtio_iommu_notify_map_cb(gpointer key, gpointer value,
                                            gpointer data)
 {
     VirtIOIOMMUMapping *mapping = (VirtIOIOMMUMapping *) value;
     VirtIOIOMMUInterval *interval = (VirtIOIOMMUInterval *) key;
-    IOMMUMemoryRegion *mr = (IOMMUMemoryRegion *) data;
+    VirtIOIOMMUNotifySpan *span = (VirtIOIOMMUNotifySpan *) data;
+
+    /* grow the span while virt and phys stay contiguous */
+    if (span->valid && mapping->flags == span->flags &&
+        interval->low == span->virt_high + 1 &&
+        mapping->phys_addr ==
+        span->phys + (span->virt_high + 1 - span->virt_low)) {
+        span->virt_high = interval->high;
+        return false;
+    }
 
-    virtio_iommu_notify_map(mr, interval->low, interval->high,
-                            mapping->phys_addr, mapping->flags);
+    virtio_iommu_span_flush_map(span);
+    span->valid = true;
+    span->virt_low = interval->low;
+    span->virt_high = interval->high;
+    span->phys = mapping->phys_addr;
+    span->flags = mapping->flags;
 
     return false;
 }
@@ -212,12 +265,13 @@ static gboolean virtio_iommu_notify_map_cb(gpointer key, gpointer value,
 static void virtio_iommu_detach_endpoint_from_domain(VirtIOIOMMUEndpoint *ep)
 {
     VirtIOIOMMUDomain *domain = ep->domain;
+    VirtIOIOMMUNotifySpan span = { .mr = ep->iommu_mr };
 
     if (!ep->domain) {
         return;
     }
-    g_tree_foreach(domain->mappings, virtio_iommu_notify_unmap_cb,
-                   ep->iommu_mr);
+    g_tree_foreach(domain->mappings, virtio_iommu_notify_unmap_cb, &span);
+    virtio_iommu_span_flush_unmap(&span);
     QLIST_REMOVE(ep, next);
     ep->domain = NULL;
 }
@@ -333,6 +387,7 @@ static int virtio_iommu_attach(VirtIOIOMMU *s,
 {
     uint32_t domain_id = le32_to_cpu(req->domain);
     uint32_t ep_id = le32_to_cpu(req->endpoint);
+    VirtIOIOMMUNotifySpan span = {};
     VirtIOIOMMUDomain *domain;
     VirtIOIOMMUEndpoint *ep;
 
@@ -361,8 +416,9 @@ static int virtio_iommu_attach(VirtIOIOMMU *s,
     ep->domain = domain;
 
     /* Replay domain mappings on the associated memory region */
-    g_tree_foreach(domain->mappings, virtio_iommu_notify_map_cb,
-                   ep->iommu_mr);
+    span.mr = ep->iommu_mr;
+    g_tree_foreach(domain->mappings, virtio_iommu_notify_map_cb, &span);
+    virtio_iommu_span_flush_map(&span);
 
     return VIRTIO_IOMMU_S_OK;
 }
@@ -455,6 +511,8 @@ static int virtio_iommu_unmap(VirtIOIOMMU *s,
     VirtIOIOMMUInterval interval, *iter_key;
     VirtIOIOMMUDomain *domain;
     VirtIOIOMMUEndpoint *ep;
+    uint64_t unmapped_low = 0, unmapped_high = 0;
+    bool unmapped = false;
     int ret = VIRTIO_IOMMU_S_OK;
 
     trace_virtio_iommu_unmap(domain_id, virt_start, virt_end);
@@ -472,9 +530,13 @@ static int virtio_iommu_unmap(VirtIOIOMMU *s,
         uint64_t current_high = iter_key->high;
 
         if (interval.low <= current_low && interval.high >= current_high) {
-            QLIST_FOREACH(ep, &domain->endpoint_list, next) {
-                virtio_iommu_notify_unmap(ep->iommu_mr, current_low,
-                                          current_high);
+            if (unmapped) {
+                unmapped_low = MIN(unmapped_low, current_low);
+                unmapped_high = MAX(unmapped_high, current_high);
+            } else {
+                unmapped_low = current_low;
+                unmapped_high = current_high;
+                unmapped = true;
             }
             g_tree_remove(domain->mappings, iter_key);
             trace_virtio_iommu_unmap_done(domain_id, current_low, current_high);
@@ -483,6 +545,17 @@ static int virtio_iommu_unmap(VirtIOIOMMU *s,
             break;
         }
     }
+
+    /*
+     * A single notification covers the whole removed extent; any holes
+     * in it were not mapped, so consumers have nothing to drop there.
+     */
+    if (unmapped) {
+        QLIST_FOREACH(ep, &domain->endpoint_list, next) {
+            virtio_iommu_notify_unmap(ep->iommu_mr, unmapped_low,
+                                      unmapped_high);
+        }
+    }
     return ret;
 }
 
@@ -530,12 +530,9 @@ static void vring_packed_desc_read(VirtIODevice *vdev,
         smp_rmb();
     }
 
-    address_space_read_cached(cache, off + offsetof(VRingPackedDesc, addr),
-                              &desc->addr, sizeof(desc->addr));
-    address_space_read_cached(cache, off + offsetof(VRingPackedDesc, id),
-                              &desc->id, sizeof(desc->id));
-    address_space_read_cached(cache, off + offsetof(VRingPackedDesc, len),
-                              &desc->len, sizeof(desc->len));
+    /* addr, len and id are contiguous, fetch them with a single read */
+    address_space_read_cached(cache, off, &desc->addr,
+                              offsetof(VRingPackedDesc, flags));
     virtio_tswap64s(vdev, &desc->addr);
     virtio_tswap16s(vdev, &desc->id);
     virtio_tswap32s(vdev, &desc->len);
@@ -546,17 +543,16 @@ static void vring_packed_desc_write_data(VirtIODevice *vdev,
                                          MemoryRegionCache *cache,
                                          int i)
 {
-    hwaddr off_id = i * sizeof(VRingPackedDesc) +
-                    offsetof(VRingPackedDesc, id);
     hwaddr off_len = i * sizeof(VRingPackedDesc) +
                     offsetof(VRingPackedDesc, len);
 
     virtio_tswap32s(vdev, &desc->len);
     virtio_tswap16s(vdev, &desc->id);
-    address_space_write_cached(cache, off_id, &desc->id, sizeof(desc->id));
-    address_space_cache_invalidate(cache, off_id, sizeof(desc->id));
-    address_space_write_cached(cache, off_len, &desc->len, sizeof(desc->len));
-    address_space_cache_invalidate(cache, off_len, sizeof(desc->len));
+    /* len and id are contiguous, push them with a single write */
+    address_space_write_cached(cache, off_len, &desc->len,
+                               sizeof(desc->len) + sizeof(desc->id));
+    address_space_cache_invalidate(cache, off_len,
+                                   sizeof(desc->len) + sizeof(desc->id));
 }
 
 static void vring_packed_desc_write_flags(VirtIODevice *vdev,
@@ -1410,7 +1406,9 @@ static void *virtqueue_alloc_element(size_t sz, unsigned out_num, unsigned in_nu
     return elem;
 }
 
-static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
+/* Called within rcu_read_lock(), after the avail index has been read
+ * and the barrier in virtqueue_split_pop() has been issued.  */
+static void *virtqueue_split_pop_locked(VirtQueue *vq, size_t sz)
 {
     unsigned int i, head, max;
     VRingMemoryRegionCaches *caches;
@@ -1425,14 +1423,6 @@ static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
     VRingDesc desc;
     int rc;
 
-    RCU_READ_LOCK_GUARD();
-    if (virtio_queue_empty_rcu(vq)) {
-        goto done;
-    }
-    /* Needed after virtio_queue_empty(), see comment in
-     * virtqueue_num_heads(). */
-    smp_rmb();
-
     /* When we start there are none of either input nor output. */
     out_num = in_num = elem_entries = 0;
 
@@ -1547,6 +1537,19 @@ err_undo_map:
     goto done;
 }
 
+static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
+{
+    RCU_READ_LOCK_GUARD();
+    if (virtio_queue_empty_rcu(vq)) {
+        return NULL;
+    }
+    /* Needed after virtio_queue_empty(), see comment in
+     * virtqueue_num_heads(). */
+    smp_rmb();
+
+    return virtqueue_split_pop_locked(vq, sz);
+}
+
 static void *virtqueue_packed_pop(VirtQueue *vq, size_t sz)
 {
     unsigned int i, max;
@@ -1618,6 +1621,15 @@ static void *virtqueue_packed_pop(VirtQueue *vq, size_t sz)
     do {
         bool map_ok;
 
+        /*
+         * Overlap the guest memory fetch of the next descriptor with
+         * the translation work for the current one.
+         */
+        if (desc_cache->ptr && i + 1 < max) {
+            __builtin_prefetch(desc_cache->ptr +
+                               (i + 1) * sizeof(VRingPackedDesc));
+        }
+
         if (desc.flags & VRING_DESC_F_WRITE) {
             map_ok = virtqueue_map_desc(vdev, &in_num, addr + out_num,
                                         iov + out_num,
@@ -1695,6 +1707,54 @@ void *virtqueue_pop(VirtQueue *vq, size_t sz)
     }
 }
 
+size_t virtqueue_pop_batch(VirtQueue *vq, size_t sz, void **elems, size_t num)
+{
+    size_t i = 0;
+
+    if (virtio_device_disabled(vq->vdev)) {
+        return 0;
+    }
+
+    if (virtio_vdev_has_feature(vq->vdev, VIRTIO_F_RING_PACKED)) {
+        /*
+         * A packed ring carries the available state in each
+         * descriptor, there is no index fetch to amortize.
+         */
+        while (i < num) {
+            void *elem = virtqueue_packed_pop(vq, sz);
+
+            if (!elem) {
+                break;
+            }
+            elems[i++] = elem;
+        }
+        return i;
+    }
+
+    RCU_READ_LOCK_GUARD();
+    if (virtio_queue_empty_rcu(vq)) {
+        return 0;
+    }
+    /* Needed after virtio_queue_empty(), see comment in
+     * virtqueue_num_heads(). */
+    smp_rmb();
+
+    /*
+     * The avail index was fetched into shadow_avail_idx above; pop
+     * everything the guest had published by then without re-reading
+     * it or paying the barrier again.
+     */
+    while (i < num && vq->last_avail_idx != vq->shadow_avail_idx) {
+        void *elem = virtqueue_split_pop_locked(vq, sz);
+
+        if (!elem) {
+            break;
+        }
+        elems[i++] = elem;
+    }
+    return i;
+}
+
 static unsigned int virtqueue_packed_drop_all(VirtQueue *vq)
 {
     VRingMemoryRegionCaches *caches;
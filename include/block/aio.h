@@ -104,6 +104,20 @@ typedef struct {
      * Returns: true if ->wait() should be called, false otherwise.
      */
     bool (*need_wait)(AioContext *ctx);
+
+    /*
+     * flush:
+     * @ctx: the AioContext
+     *
+     * Submit buffered monitoring requests without waiting, so that
+     * ->need_wait() does not report pending work that userspace polling
+     * could otherwise run alongside.  Optional: may be NULL when the
+     * implementation has nothing to flush.
+     *
+     * Called before userspace polling starts, in the AioContext's home
+     * thread only.
+     */
+    void (*flush)(AioContext *ctx);
 } FDMonOps;
 
 /*
@@ -171,6 +185,9 @@ struct AioContext {
     /* Bottom Halves pending aio_bh_poll() processing */
     BHList bh_list;
 
+    /* Priority Bottom Halves, run before @bh_list */
+    BHList bh_prio_list;
+
     /* Chained BH list slices for each nested aio_bh_poll() call */
     QSIMPLEQ_HEAD(, BHListSlice) bh_slice_list;
 
@@ -232,6 +249,17 @@ struct AioContext {
     int64_t poll_grow;      /* polling time growth factor */
     int64_t poll_shrink;    /* polling time shrink factor */
 
+    /*
+     * Event loop statistics, reported by query-lock-stats.  Written
+     * only from the home thread; readers in other threads may see
+     * slightly stale values, which is fine for monitoring.
+     */
+    uint64_t stat_dispatched_handlers;
+    uint64_t stat_poll_success;
+    uint64_t stat_poll_fail;
+    uint64_t stat_poll_grow;
+    uint64_t stat_poll_shrink;
+
     /* AIO engine parameters */
     int64_t aio_max_batch;  /* maximum number of requests in a batch */
 
@@ -334,6 +362,26 @@ QEMUBH *aio_bh_new_full(AioContext *ctx, QEMUBHFunc *cb, void *opaque,
 #define aio_bh_new(ctx, cb, opaque) \
     aio_bh_new_full((ctx), (cb), (opaque), (stringify(cb)))
 
+/**
+ * aio_bh_new_prioritized_full: Allocate a bottom half that runs before
+ * regular bottom halves whenever both are pending.
+ *
+ * Use this for I/O completion callbacks so guest-visible completions are
+ * not queued behind housekeeping work.  No ordering is guaranteed among
+ * priority bottom halves themselves.
+ */
+QEMUBH *aio_bh_new_prioritized_full(AioContext *ctx, QEMUBHFunc *cb,
+                                    void *opaque, const char *name);
+
+/**
+ * aio_bh_new_prioritized: Allocate a prioritized bottom half structure
+ *
+ * A convenience wrapper for aio_bh_new_prioritized_full() that uses the cb
+ * as the name string.
+ */
+#define aio_bh_new_prioritized(ctx, cb, opaque) \
+    aio_bh_new_prioritized_full((ctx), (cb), (opaque), (stringify(cb)))
+
 /**
  * aio_notify: Force processing of pending events.
  *
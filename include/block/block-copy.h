@@ -17,6 +17,7 @@
 
 #include "block/block.h"
 #include "qemu/co-shared-resource.h"
+#include "qemu/ratelimit.h"
 
 /* All APIs are thread-safe */
 
@@ -39,6 +40,27 @@ int64_t block_copy_reset_unallocated(BlockCopyState *s,
 int coroutine_fn block_copy(BlockCopyState *s, int64_t offset, int64_t bytes,
                             bool ignore_ratelimit);
 
+/*
+ * Claim [offset, bytes) for an out-of-band copy: the caller reads the data
+ * itself and delivers it to the target, then reports the outcome with
+ * block_copy_staged_end().  Waits for intersecting in-flight block-copy
+ * tasks first.
+ *
+ * Returns 1 if the whole range was dirty and is now claimed, 0 if the range
+ * has no dirty bits and there is nothing to copy, and -EAGAIN if the range
+ * is only partially dirty, in which case the caller should fall back to
+ * block_copy().
+ */
+int coroutine_fn block_copy_staged_begin(BlockCopyState *s, int64_t offset,
+                                         int64_t bytes);
+
+/*
+ * Finish an out-of-band copy started with block_copy_staged_begin().
+ * On failure the range is marked dirty again.
+ */
+void coroutine_fn block_copy_staged_end(BlockCopyState *s, int64_t offset,
+                                        int64_t bytes, int ret);
+
 /*
  * Run block-copy in a coroutine, create corresponding BlockCopyCallState
  * object and return pointer to it. Never returns NULL.
@@ -73,7 +95,7 @@ bool block_copy_call_failed(BlockCopyCallState *call_state);
 bool block_copy_call_cancelled(BlockCopyCallState *call_state);
 int block_copy_call_status(BlockCopyCallState *call_state, bool *error_is_read);
 
-void block_copy_set_speed(BlockCopyState *s, uint64_t speed);
+void block_copy_set_rate_limit(BlockCopyState *s, RateLimit *limit);
 void block_copy_kick(BlockCopyCallState *call_state);
 
 /*
@@ -33,6 +33,7 @@
 #define BLOCK_JOB_SLICE_TIME 100000000ULL /* ns */
 
 typedef struct BlockJobDriver BlockJobDriver;
+typedef struct BlockJobRateGroup BlockJobRateGroup;
 
 /**
  * BlockJob:
@@ -52,8 +53,13 @@ typedef struct BlockJob {
     /** Speed that was set with @block_job_set_speed.  */
     int64_t speed;
 
-    /** Rate limiting data structure for implementing @speed. */
-    RateLimit limit;
+    /**
+     * Token bucket for implementing @speed, shared with all other jobs
+     * whose main node is the same.  The largest @speed among the members
+     * limits their aggregate throughput; individual limits are not
+     * enforced separately.
+     */
+    BlockJobRateGroup *rate_group;
 
     /** Block other operations when block job is running */
     Error *blocker;
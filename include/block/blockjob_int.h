@@ -106,6 +106,14 @@ void block_job_user_resume(Job *job);
  */
 int64_t block_job_ratelimit_get_delay(BlockJob *job, uint64_t n);
 
+/**
+ * block_job_rate_limit:
+ *
+ * Return the token bucket @job draws from.  It is shared between all jobs
+ * operating on the same main node and remains valid for the job's lifetime.
+ */
+RateLimit *block_job_rate_limit(BlockJob *job);
+
 /**
  * block_job_error_action:
  * @job: The job to signal an error for.
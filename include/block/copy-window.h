@@ -0,0 +1,53 @@
+/*
+ * Adaptive copy window for background block jobs
+ *
+ * Copyright (c) 2021 QEMU contributors
+ *
+ * This work is licensed under the terms of the GNU LGPL, version 2 or later.
+ * See the COPYING.LIB file in the top-level directory.
+ */
+
+#ifndef COPY_WINDOW_H
+#define COPY_WINDOW_H
+
+#include "qemu/coroutine.h"
+#include "qemu/job.h"
+
+/*
+ * Copy one chunk of data.  @error_is_read must be set on failure so that
+ * the job can pick the right error action for its source or target.
+ */
+typedef int coroutine_fn (*CopyWindowFunc)(void *opaque, int64_t offset,
+                                           int64_t bytes, bool *error_is_read);
+
+typedef struct CopyWindow CopyWindow;
+
+CopyWindow *copy_window_new(Job *job, CopyWindowFunc func, void *opaque);
+
+/* Preferred size of the next chunk, adapted to the observed throughput */
+int64_t copy_window_chunk(CopyWindow *cw);
+
+/*
+ * Start copying [offset, offset + bytes) in the background, waiting for a
+ * free slot if too many copies are already in flight.  Completion, progress
+ * accounting and errors are reported through copy_window_error().
+ */
+void coroutine_fn copy_window_co_submit(CopyWindow *cw, int64_t offset,
+                                        int64_t bytes);
+
+/*
+ * Return and clear the error of the first failed copy, or 0 if none failed.
+ * @error_offset (if non-NULL) is set to the offset of the failed chunk so
+ * that the caller can retry from there.
+ */
+int copy_window_error(CopyWindow *cw, int64_t *error_offset,
+                      bool *error_is_read);
+
+/* Wait for all in-flight copies, then behave like copy_window_error() */
+int coroutine_fn copy_window_co_drain(CopyWindow *cw, int64_t *error_offset,
+                                      bool *error_is_read);
+
+/* Wait for all in-flight copies and free @cw, ignoring pending errors */
+void coroutine_fn copy_window_co_free(CopyWindow *cw);
+
+#endif /* COPY_WINDOW_H */
@@ -25,9 +25,13 @@
 #ifndef BLOCK_QAPI_H
 #define BLOCK_QAPI_H
 
+#include "block/accounting.h"
 #include "block/block.h"
 #include "block/snapshot.h"
 
+void bdrv_latency_histogram_stats(BlockLatencyHistogram *hist,
+                                  bool *not_null,
+                                  BlockLatencyHistogramInfo **info);
 BlockDeviceInfo *bdrv_block_device_info(BlockBackend *blk,
                                         BlockDriverState *bs,
                                         bool flat,
@@ -68,6 +68,8 @@ void luring_detach_aio_context(LuringState *s, AioContext *old_context);
 void luring_attach_aio_context(LuringState *s, AioContext *new_context);
 void luring_io_plug(BlockDriverState *bs, LuringState *s);
 void luring_io_unplug(BlockDriverState *bs, LuringState *s);
+/* Drop @fd from the ring's fixed file table before closing it */
+void luring_fd_unregister(LuringState *s, int fd);
 #endif
 
 #ifdef _WIN32
@@ -79,6 +81,8 @@ BlockAIOCB *win32_aio_submit(BlockDriverState *bs,
         QEMUWin32AIOState *aio, HANDLE hfile,
         uint64_t offset, uint64_t bytes, QEMUIOVector *qiov,
         BlockCompletionFunc *cb, void *opaque, int type);
+void win32_aio_io_plug(QEMUWin32AIOState *aio);
+void win32_aio_io_unplug(QEMUWin32AIOState *aio);
 void win32_aio_detach_aio_context(QEMUWin32AIOState *aio,
                                   AioContext *old_context);
 void win32_aio_attach_aio_context(QEMUWin32AIOState *aio,
@@ -100,18 +100,41 @@ struct ReplicationState {
     QLIST_ENTRY(ReplicationState) node;
 };
 
+/**
+ * ReplicationStats:
+ * @writes: guest writes applied through the filter
+ * @write_bytes: bytes written through the filter
+ * @epoch_writes: writes applied since the last checkpoint
+ * @epoch_write_bytes: bytes written since the last checkpoint
+ * @flushes_deferred: guest flushes coalesced into per-checkpoint flushes
+ * @checkpoints: checkpoints completed
+ * @last_checkpoint_ms: QEMU_CLOCK_REALTIME time of the most recent
+ *                      checkpoint across all instances, or -1 if none yet
+ */
+typedef struct ReplicationStats {
+    uint64_t writes;
+    uint64_t write_bytes;
+    uint64_t epoch_writes;
+    uint64_t epoch_write_bytes;
+    uint64_t flushes_deferred;
+    uint64_t checkpoints;
+    int64_t last_checkpoint_ms;
+} ReplicationStats;
+
 /**
  * ReplicationOps:
  * @start: callback to start replication
  * @stop: callback to stop replication
  * @checkpoint: callback to do checkpoint
  * @get_error: callback to check if error occurred during replication
+ * @get_stats: optional callback to accumulate replication statistics
  */
 struct ReplicationOps {
     void (*start)(ReplicationState *rs, ReplicationMode mode, Error **errp);
     void (*stop)(ReplicationState *rs, bool failover, Error **errp);
     void (*checkpoint)(ReplicationState *rs, Error **errp);
     void (*get_error)(ReplicationState *rs, Error **errp);
+    void (*get_stats)(ReplicationState *rs, ReplicationStats *stats);
 };
 
 /**
@@ -172,4 +195,12 @@ void replication_get_error_all(Error **errp);
  */
 void replication_stop_all(bool failover, Error **errp);
 
+/**
+ * replication_get_stats_all:
+ * @stats: filled with statistics accumulated over all instances
+ *
+ * This interface is called by query-block-replication-stats
+ */
+void replication_get_stats_all(ReplicationStats *stats);
+
 #endif /* REPLICATION_H */
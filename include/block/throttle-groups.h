@@ -57,6 +57,18 @@ typedef struct ThrottleGroupMember {
     unsigned       pending_reqs[2];
     QLIST_ENTRY(ThrottleGroupMember) round_robin;
 
+    /* Batched accounting fast path.  These fields are only accessed
+     * from the member's AioContext home thread: batch_credit_* is
+     * pre-admitted credit handed out under the group lock, and
+     * unaccounted_* is traffic consumed from that credit but not yet
+     * charged to the shared ThrottleState. */
+    int64_t  batch_credit_bytes[2];
+    int64_t  batch_credit_ops[2];
+    uint64_t unaccounted_bytes[2];
+    double   unaccounted_units[2];
+    uint64_t batch_op_size;
+    unsigned batch_generation;
+
 } ThrottleGroupMember;
 
 #define TYPE_THROTTLE_GROUP "throttle-group"
@@ -72,6 +72,31 @@ int qcrypto_hash_bytesv(QCryptoHashAlgorithm alg,
                         size_t *resultlen,
                         Error **errp);
 
+/**
+ * qcrypto_hash_batchv:
+ * @alg: the hash algorithm
+ * @bufs: array of independent buffers, each producing its own digest
+ * @nbufs: the length of @bufs
+ * @results: caller-provided buffer of @nbufs * @resultlen bytes
+ * @resultlen: the digest length, must equal qcrypto_hash_digest_len(@alg)
+ * @errp: pointer to a NULL-initialized error object
+ *
+ * Computes a separate hash for each of the @nbufs memory regions
+ * in @bufs, writing the digest of @bufs[i] at @results +
+ * i * @resultlen. Unlike calling qcrypto_hash_bytesv() in a loop,
+ * the hash context setup cost is paid once per batch rather than
+ * once per buffer, and backends may process several buffers in
+ * lockstep where the underlying library supports it.
+ *
+ * Returns: 0 on success, -1 on error
+ */
+int qcrypto_hash_batchv(QCryptoHashAlgorithm alg,
+                        const struct iovec *bufs,
+                        size_t nbufs,
+                        uint8_t *results,
+                        size_t resultlen,
+                        Error **errp);
+
 /**
  * qcrypto_hash_bytes:
  * @alg: the hash algorithm
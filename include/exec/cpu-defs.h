@@ -76,8 +76,13 @@ typedef uint64_t target_ulong;
 
 #if !defined(CONFIG_USER_ONLY) && defined(CONFIG_TCG)
 
-/* use a fully associative victim tlb of 8 entries */
-#define CPU_VTLB_SIZE 8
+/*
+ * The victim tlb is a second-level, set-associative tlb behind the
+ * direct-mapped fast tlb: CPU_VTLB_WAYS entries per set, filled
+ * round-robin.  The number of sets scales with the size of the fast
+ * table; see tlb_vtlb_resize_locked().
+ */
+#define CPU_VTLB_WAYS 8
 
 #if HOST_LONG_BITS == 32 && TARGET_LONG_BITS == 32
 #define CPU_TLB_ENTRY_BITS 4
@@ -168,11 +173,13 @@ typedef struct CPUTLBDesc {
     /* maximum number of entries observed in the window */
     size_t window_max_entries;
     size_t n_used_entries;
-    /* The next index to use in the tlb victim table.  */
+    /* The next way to use when evicting into a victim tlb set.  */
     size_t vindex;
-    /* The tlb victim table, in two parts.  */
-    CPUTLBEntry vtable[CPU_VTLB_SIZE];
-    CPUIOTLBEntry viotlb[CPU_VTLB_SIZE];
+    /* Number of sets in the victim tlb.  */
+    size_t n_vsets;
+    /* The victim tlb, in two parts, n_vsets * CPU_VTLB_WAYS entries each. */
+    CPUTLBEntry *vtable;
+    CPUIOTLBEntry *viotlb;
     /* The iotlb.  */
     CPUIOTLBEntry *iotlb;
 } CPUTLBDesc;
@@ -191,9 +198,19 @@ typedef struct CPUTLBDescFast {
 /*
  * Data elements that are shared between all MMU modes.
  */
+/* Coalesced cross-vCPU page flushes; see cputlb.c. */
+typedef struct CPUTLBFlushBatch CPUTLBFlushBatch;
+
+/* Physical translation cache for guest page table walks; see cputlb.c. */
+typedef struct CPUPTWCache CPUPTWCache;
+
 typedef struct CPUTLBCommon {
     /* Serialize updates to f.table and d.vtable, and others as noted. */
     QemuSpin lock;
+    /* Pending page flushes queued by other vCPUs, allocated by tlb_init. */
+    CPUTLBFlushBatch *batch;
+    /* Host mappings of recently walked page table pages. */
+    CPUPTWCache *ptw;
     /*
      * Within dirty, for each bit N, modifications have been made to
      * mmu_idx N since the last time that mmu_idx was flushed.
@@ -320,6 +320,18 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
 void tlb_set_page(CPUState *cpu, target_ulong vaddr,
                   hwaddr paddr, int prot,
                   int mmu_idx, target_ulong size);
+/*
+ * cpu_ldq_ptw / cpu_ldl_ptw:
+ *
+ * Load a guest page table entry at physical address @addr.  Backed by
+ * a small per-CPU cache of page-table-page host mappings, so the
+ * serial dependent loads of a multi-level walk avoid one full flatview
+ * translation each.  Entry contents are never cached; only RAM-backed
+ * pages hit the fast path and anything else falls back to the memory
+ * API.
+ */
+uint64_t cpu_ldq_ptw(CPUState *cpu, hwaddr addr);
+uint32_t cpu_ldl_ptw(CPUState *cpu, hwaddr addr);
 #else
 static inline void tlb_init(CPUState *cpu)
 {
@@ -503,6 +515,7 @@ struct TranslationBlock {
 #define CF_USE_ICOUNT    0x00020000
 #define CF_INVALID       0x00040000 /* TB is stale. Set with @jmp_lock held */
 #define CF_PARALLEL      0x00080000 /* Generate code for a parallel context */
+#define CF_PLUGIN        0x00100000 /* TB carries plugin instrumentation */
 #define CF_CLUSTER_MASK  0xff000000 /* Top 8 bits are cluster ID */
 #define CF_CLUSTER_SHIFT 24
 
@@ -722,6 +722,7 @@ struct MemoryRegion {
     const char *name;
     unsigned ioeventfd_nb;
     MemoryRegionIoeventfd *ioeventfds;
+    GHashTable *ioeventfd_index; /* address -> first index in @ioeventfds */
     RamDiscardManager *rdm; /* Only for RAM */
 };
 
@@ -999,6 +1000,10 @@ struct AddressSpace {
 
     int ioeventfd_nb;
     struct MemoryRegionIoeventfd *ioeventfds;
+
+    /* Number of bounce buffer bytes in use by address_space_map().  */
+    size_t bounce_buffer_size;
+
     QTAILQ_HEAD(, MemoryListener) listeners;
     QTAILQ_ENTRY(AddressSpace) address_spaces_link;
 };
@@ -1949,6 +1954,28 @@ bool memory_region_snapshot_get_dirty(MemoryRegion *mr,
                                       DirtyBitmapSnapshot *snap,
                                       hwaddr addr, hwaddr size);
 
+/**
+ * memory_region_snapshot_get_dirty_extent: Get the extent covering all
+ *                                          dirty pages in a snapshot.
+ *
+ * Returns false if the snapshot recorded no dirty pages at all, which
+ * lets callers skip their update pass entirely.  Otherwise @first and
+ * @last are set to the byte range (relative to the start of the region,
+ * @last exclusive) spanning the first through the last dirty page, so
+ * callers can restrict per-scanline queries to that extent.  Due to the
+ * bitmap long rounding described for
+ * memory_region_snapshot_and_clear_dirty() the extent may be slightly
+ * wider than the pages that were actually written.
+ *
+ * @mr: the memory region being queried.
+ * @snap: the dirty bitmap snapshot
+ * @first: output, start of the dirty extent.
+ * @last: output, end of the dirty extent (exclusive).
+ */
+bool memory_region_snapshot_get_dirty_extent(MemoryRegion *mr,
+                                             DirtyBitmapSnapshot *snap,
+                                             hwaddr *first, hwaddr *last);
+
 /**
  * memory_region_reset_dirty: Mark a range of pages as clean, for a specified
  *                            client.
@@ -278,7 +278,10 @@ static inline void cpu_physical_memory_set_dirty_flag(ram_addr_t addr,
 
     blocks = qatomic_rcu_read(&ram_list.dirty_memory[client]);
 
-    set_bit_atomic(offset, blocks->blocks[idx]);
+    /* Avoid bouncing the shared cache line if the bit is already set */
+    if (!test_bit(offset, blocks->blocks[idx])) {
+        set_bit_atomic(offset, blocks->blocks[idx]);
+    }
 }
 
 static inline void cpu_physical_memory_set_dirty_range(ram_addr_t start,
@@ -429,6 +432,10 @@ bool cpu_physical_memory_snapshot_get_dirty(DirtyBitmapSnapshot *snap,
                                             ram_addr_t start,
                                             ram_addr_t length);
 
+bool cpu_physical_memory_snapshot_dirty_extent(DirtyBitmapSnapshot *snap,
+                                               ram_addr_t *first,
+                                               ram_addr_t *last);
+
 static inline void cpu_physical_memory_clear_dirty_range(ram_addr_t start,
                                                          ram_addr_t length)
 {
@@ -438,6 +445,18 @@ static inline void cpu_physical_memory_clear_dirty_range(ram_addr_t start,
 }
 
 
+/*
+ * Mark the summary levels for word @k of rb->bmap as possibly
+ * containing dirty pages.  No-op when the summary is not allocated.
+ */
+static inline void ramblock_dirty_summary_set(RAMBlock *rb, unsigned long k)
+{
+    if (rb->bmap_sum1) {
+        set_bit(k, rb->bmap_sum1);
+        set_bit(BIT_WORD(k), rb->bmap_sum2);
+    }
+}
+
 /* Called with RCU critical section */
 static inline
 uint64_t cpu_physical_memory_sync_dirty_bitmap(RAMBlock *rb,
@@ -472,6 +491,10 @@ uint64_t cpu_physical_memory_sync_dirty_bitmap(RAMBlock *rb,
                 dest[k] |= bits;
                 new_dirty &= bits;
                 num_dirty += ctpopl(new_dirty);
+                ramblock_dirty_summary_set(rb, k);
+                if (rb->hot_bmap) {
+                    rb->hot_bmap[k] |= bits;
+                }
             }
 
             if (++offset >= BITS_TO_LONGS(DIRTY_MEMORY_BLOCK_SIZE)) {
@@ -504,6 +527,10 @@ uint64_t cpu_physical_memory_sync_dirty_bitmap(RAMBlock *rb,
                 if (!test_and_set_bit(k, dest)) {
                     num_dirty++;
                 }
+                ramblock_dirty_summary_set(rb, BIT_WORD(k));
+                if (rb->hot_bmap) {
+                    set_bit(k, rb->hot_bmap);
+                }
             }
         }
     }
@@ -41,6 +41,27 @@ struct RAMBlock {
     size_t page_size;
     /* dirty bitmap used during migration */
     unsigned long *bmap;
+    /*
+     * Two-level summary over bmap, used to speed up looking for the
+     * next dirty page on large, sparsely dirtied guests.  One bit of
+     * bmap_sum1 covers one word of bmap, one bit of bmap_sum2 covers
+     * one word of bmap_sum1.  A clear bit guarantees that the covered
+     * range of the level below is clear; a set bit only means that it
+     * may contain dirty pages.  Bits are set whenever dirty bits are
+     * added to bmap and cleared lazily by the scanning code; see
+     * migration_bitmap_find_dirty().  Only allocated on the migration
+     * source (NULL e.g. for the COLO cache bitmap on the destination).
+     */
+    unsigned long *bmap_sum1;
+    unsigned long *bmap_sum2;
+    /*
+     * Pages that were re-dirtied by the guest while precopy was
+     * already running, i.e. a cheap access-frequency record.
+     * Allocated lazily from the second bitmap sync onwards when
+     * postcopy is possible; used at switchover to stream hot pages
+     * before cold ones.  See find_dirty_block().
+     */
+    unsigned long *hot_bmap;
     /* bitmap of already received pages in postcopy */
     unsigned long *receivedmap;
 
@@ -220,8 +220,15 @@ struct kvm_run;
 struct hax_vcpu_state;
 struct hvf_vcpu_state;
 
+/*
+ * The jump cache is set-associative: guest code doing indirect dispatch
+ * repeatedly alternates between targets whose low pc bits collide, and
+ * with a direct-mapped cache each such jump evicts the other target.
+ * Way 0 of each set holds the most recently used entry.
+ */
 #define TB_JMP_CACHE_BITS 12
 #define TB_JMP_CACHE_SIZE (1 << TB_JMP_CACHE_BITS)
+#define TB_JMP_CACHE_WAYS 2
 
 /* work queue */
 
@@ -301,6 +308,8 @@ struct qemu_work_item;
  *    ring is enabled.
  * @kvm_fetch_index: Keeps the index that we last fetched from the per-vCPU
  *    dirty ring structure.
+ * @dirty_pages: number of pages dirtied by this vCPU since it was created,
+ *    counted when the KVM dirty ring entries are collected.
  *
  * State of one CPU core or thread.
  */
@@ -352,7 +361,7 @@ struct CPUState {
     IcountDecr *icount_decr_ptr;
 
     /* Accessed in parallel; all accesses must be atomic */
-    TranslationBlock *tb_jmp_cache[TB_JMP_CACHE_SIZE];
+    TranslationBlock *tb_jmp_cache[TB_JMP_CACHE_SIZE * TB_JMP_CACHE_WAYS];
 
     struct GDBRegisterState *gdb_regs;
     int gdb_num_regs;
@@ -378,6 +387,7 @@ struct CPUState {
     struct kvm_run *kvm_run;
     struct kvm_dirty_gfn *kvm_dirty_gfns;
     uint32_t kvm_fetch_index;
+    uint64_t dirty_pages;
 
     /* Used for events with 'vcpu' and *without* the 'disabled' properties */
     DECLARE_BITMAP(trace_dstate_delayed, CPU_TRACE_DSTATE_MAX_EVENTS);
@@ -432,7 +442,7 @@ static inline void cpu_tb_jmp_cache_clear(CPUState *cpu)
 {
     unsigned int i;
 
-    for (i = 0; i < TB_JMP_CACHE_SIZE; i++) {
+    for (i = 0; i < TB_JMP_CACHE_SIZE * TB_JMP_CACHE_WAYS; i++) {
         qatomic_set(&cpu->tb_jmp_cache[i], NULL);
     }
 }
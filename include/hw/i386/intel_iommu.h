@@ -120,6 +120,7 @@ struct VTDBus {
 struct VTDIOTLBEntry {
     uint64_t gfn;
     uint16_t domain_id;
+    uint32_t domain_gen;
     uint64_t slpte;
     uint64_t mask;
     uint8_t access_flags;
@@ -251,6 +252,7 @@ struct IntelIOMMUState {
 
     uint32_t context_cache_gen;     /* Should be in [1,MAX] */
     GHashTable *iotlb;              /* IOTLB */
+    GHashTable *iotlb_domain_gen;   /* domain id -> invalidation generation */
 
     GHashTable *vtd_as_by_busptr;   /* VTDBus objects indexed by PCIBus* reference */
     VTDBus *vtd_as_by_bus_num[VTD_PCI_BUS_MAX]; /* VTDBus objects indexed by bus number */
@@ -26,6 +26,7 @@
 
 #include "hw/sysbus.h"
 #include "qom/object.h"
+#include "sysemu/dma.h"
 
 typedef struct AHCIDevice AHCIDevice;
 
@@ -49,6 +50,7 @@ typedef struct AHCIState {
     int32_t ports;
     qemu_irq irq;
     AddressSpace *as;
+    DMASGCache *map_cache;
 } AHCIState;
 
 
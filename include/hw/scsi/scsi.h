@@ -33,6 +33,7 @@ struct SCSIRequest {
     size_t            resid;
     SCSICommand       cmd;
     NotifierList      cancel_notifiers;
+    size_t            alloc_size;
 
     /* Note:
      * - fields before sense are initialized by scsi_req_alloc;
@@ -77,6 +78,10 @@ struct SCSIDevice
     uint8_t sense[SCSI_SENSE_BUF_SIZE];
     uint32_t sense_len;
     QTAILQ_HEAD(, SCSIRequest) requests;
+    /* Freed requests kept for reuse by scsi_req_alloc, protected like
+     * the request queue above (BQL or the device's AioContext). */
+    QTAILQ_HEAD(, SCSIRequest) free_requests;
+    uint32_t nfree_requests;
     uint32_t channel;
     uint32_t lun;
     int blocksize;
@@ -51,6 +51,12 @@ struct VHostUserBlk {
     bool connected;
     /* vhost_user_blk_start/vhost_user_blk_stop */
     bool started_vu;
+    /*
+     * Host and guest notifiers survive a backend disconnect so that a
+     * reconnecting backend only needs to be reprogrammed; they are torn
+     * down on guest stop or unrealize.
+     */
+    bool notifiers_set;
 };
 
 #endif
@@ -142,12 +142,22 @@ typedef struct VirtioNetRssData {
     uint16_t default_queue;
 } VirtioNetRssData;
 
+/*
+ * Power-of-two buckets for the tx batch size histogram: bucket 0 counts
+ * empty flushes, bucket N (N > 0) flushes of 2^(N-1)..2^N - 1 packets,
+ * with the last bucket absorbing everything larger.
+ */
+#define VIRTIO_NET_TX_BATCH_HIST_SIZE 10
+
 typedef struct VirtIONetQueue {
     VirtQueue *rx_vq;
     VirtQueue *tx_vq;
     QEMUTimer *tx_timer;
     QEMUBH *tx_bh;
     uint32_t tx_waiting;
+    /* EWMA of packets flushed per kick, in 1/16ths of a packet */
+    uint32_t tx_ewma;
+    uint64_t tx_batch_hist[VIRTIO_NET_TX_BATCH_HIST_SIZE];
     struct {
         VirtQueueElement *elem;
     } async_tx;
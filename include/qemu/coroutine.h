@@ -122,6 +122,13 @@ bool qemu_in_coroutine(void);
  */
 bool qemu_coroutine_entered(Coroutine *co);
 
+/**
+ * Sum the coroutine pool hit/miss counters over all threads.  A miss
+ * means qemu_coroutine_create() had to allocate a fresh coroutine and
+ * its stack instead of recycling a pooled one.
+ */
+void qemu_coroutine_pool_stats(uint64_t *hits, uint64_t *misses);
+
 /**
  * Provides a mutex that can be used to synchronise coroutines
  */
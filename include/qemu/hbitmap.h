@@ -340,6 +340,27 @@ bool hbitmap_next_dirty_area(const HBitmap *hb, int64_t start, int64_t end,
                              int64_t max_dirty_count,
                              int64_t *dirty_start, int64_t *dirty_count);
 
+/* A contiguous run of dirty bits, as returned by hbitmap_next_dirty_runs. */
+typedef struct HBitmapRun {
+    int64_t start;
+    int64_t count;
+} HBitmapRun;
+
+/* hbitmap_next_dirty_runs:
+ * @hb: The HBitmap to operate on
+ * @start: the offset to start from
+ * @end: end of requested area
+ * @runs: array of at least @max_runs elements to fill in
+ * @max_runs: capacity of @runs
+ *
+ * Extract up to @max_runs maximal dirty areas from [@start, @end) in
+ * ascending order and return how many were found.  A batched alternative
+ * to calling hbitmap_next_dirty_area in a loop, for callers that iterate
+ * over many extents per lock acquisition.
+ */
+unsigned hbitmap_next_dirty_runs(const HBitmap *hb, int64_t start, int64_t end,
+                                 HBitmapRun *runs, unsigned max_runs);
+
 /**
  * hbitmap_iter_next:
  * @hbi: HBitmapIter to operate on.
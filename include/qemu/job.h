@@ -120,6 +120,23 @@ typedef struct Job {
 
     ProgressMeter progress;
 
+    /**
+     * Number of payload bytes the job has dispatched through its rate
+     * limiter so far.  Stays zero for jobs that do not account their I/O
+     * this way.
+     */
+    uint64_t io_bytes;
+
+    /**
+     * Total time the job coroutine has spent running, in nanoseconds.
+     * Updated when the coroutine yields, so the currently running slice
+     * is not included.
+     */
+    int64_t cpu_ns;
+
+    /** Timestamp of the last time the job coroutine was entered. */
+    int64_t busy_start_ns;
+
     /**
      * Return code from @run and/or @prepare callback(s).
      * Not final until the job has reached the CONCLUDED status.
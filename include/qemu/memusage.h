@@ -0,0 +1,52 @@
+/*
+ * Memory usage registry
+ *
+ * Subsystems with significant allocations register a provider; the
+ * query-memory-usage QMP command walks all providers and reports one
+ * entry per consumer, so RSS growth can be attributed without external
+ * tooling.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef QEMU_MEMUSAGE_H
+#define QEMU_MEMUSAGE_H
+
+/* Value for @peak_bytes or @limit_bytes when not tracked */
+#define MEM_USAGE_UNKNOWN (-1)
+
+/**
+ * MemUsageEmitFn: report one consumer entry
+ * @name: hierarchical consumer name, components separated by '/'
+ *        (e.g. "block/qcow2-cache", "ram/pc.ram")
+ * @bytes: bytes currently allocated
+ * @peak_bytes: high watermark, or MEM_USAGE_UNKNOWN
+ * @limit_bytes: configured cap, or MEM_USAGE_UNKNOWN
+ */
+typedef void (*MemUsageEmitFn)(const char *name, uint64_t bytes,
+                               int64_t peak_bytes, int64_t limit_bytes,
+                               void *emit_opaque);
+
+/**
+ * MemUsageProviderFn: called at query time with the registry lock held;
+ * may emit any number of entries.  Must not block and must cope with
+ * being called from the monitor while the subsystem is running.
+ */
+typedef void (*MemUsageProviderFn)(MemUsageEmitFn emit, void *emit_opaque,
+                                   void *opaque);
+
+/**
+ * mem_usage_register: add a provider to the registry
+ *
+ * Thread-safe.  Providers cannot be unregistered: register once per
+ * subsystem and aggregate short-lived objects in the provider.
+ */
+void mem_usage_register(MemUsageProviderFn fn, void *opaque);
+
+/**
+ * mem_usage_query: invoke every registered provider
+ */
+void mem_usage_query(MemUsageEmitFn emit, void *emit_opaque);
+
+#endif
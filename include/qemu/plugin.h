@@ -190,6 +190,18 @@ void qemu_plugin_add_dyn_cb_arr(GArray *arr);
 
 void qemu_plugin_disable_mem_helpers(CPUState *cpu);
 
+/**
+ * qemu_plugin_sample_tb() - should the next translated TB be instrumented?
+ * @cpu: cpu requesting translation
+ *
+ * Implements TB sampling: with a sample rate of N, only every Nth TB
+ * is translated with instrumentation (the CF_PLUGIN cflag).  Because
+ * cflags take part in the TB lookup key, instrumented TBs and their
+ * uninstrumented twins coexist in the cache and no tb_flush is needed
+ * when the rate changes.
+ */
+bool qemu_plugin_sample_tb(CPUState *cpu);
+
 /**
  * qemu_plugin_user_exit(): clean-up callbacks before calling exit callbacks
  *
@@ -260,6 +272,11 @@ void qemu_plugin_add_dyn_cb_arr(GArray *arr)
 static inline void qemu_plugin_disable_mem_helpers(CPUState *cpu)
 { }
 
+static inline bool qemu_plugin_sample_tb(CPUState *cpu)
+{
+    return false;
+}
+
 static inline void qemu_plugin_user_exit(void)
 { }
 #endif /* !CONFIG_PLUGIN */
@@ -577,4 +577,51 @@ int qemu_plugin_n_max_vcpus(void);
  */
 void qemu_plugin_outs(const char *string);
 
+/**
+ * qemu_plugin_set_tb_sample_rate() - instrument only every Nth TB
+ * @rate: sample rate; 1 (the default) instruments every TB, 0 is
+ *        treated as 1
+ *
+ * Lowers instrumentation overhead by translating only every Nth
+ * translation block with plugin callbacks.  Uninstrumented twins of
+ * sampled blocks stay in the translation cache, so changing the rate
+ * does not flush translated code.  Affects all loaded plugins.
+ */
+void qemu_plugin_set_tb_sample_rate(uint32_t rate);
+
+/** struct qemu_plugin_scoreboard - Opaque handle for a scoreboard */
+struct qemu_plugin_scoreboard;
+
+/**
+ * qemu_plugin_scoreboard_new() - alloc a new scoreboard
+ * @element_size: size (in bytes) for one entry
+ *
+ * A scoreboard holds one entry per vCPU, so plugins can accumulate
+ * per-vCPU data from callbacks without atomic operations or false
+ * sharing.  It is automatically enlarged when new vCPUs come online.
+ *
+ * Returns a pointer to a new scoreboard. It must be freed with
+ * qemu_plugin_scoreboard_free().
+ */
+struct qemu_plugin_scoreboard *qemu_plugin_scoreboard_new(size_t element_size);
+
+/**
+ * qemu_plugin_scoreboard_free() - free a scoreboard
+ * @score: scoreboard to free
+ */
+void qemu_plugin_scoreboard_free(struct qemu_plugin_scoreboard *score);
+
+/**
+ * qemu_plugin_scoreboard_find() - get vCPU entry in scoreboard
+ * @score: scoreboard to query
+ * @vcpu_index: entry index
+ *
+ * The returned pointer may be invalidated when additional vCPUs come
+ * online, so do not cache it across callbacks.
+ *
+ * Returns address of a specific entry in a scoreboard.
+ */
+void *qemu_plugin_scoreboard_find(struct qemu_plugin_scoreboard *score,
+                                  unsigned int vcpu_index);
+
 #endif /* QEMU_PLUGIN_API_H */
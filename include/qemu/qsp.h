@@ -19,6 +19,18 @@ enum QSPSortBy {
 void qsp_report(size_t max, enum QSPSortBy sort_by,
                 bool callsite_coalesce);
 
+/*
+ * Called once per report entry; @callsite_at is only valid for the
+ * duration of the call.
+ */
+typedef void (*qsp_iter_fn)(const void *obj, unsigned int n_objs,
+                            const char *typename, const char *callsite_at,
+                            uint64_t wait_time_ns, uint64_t n_acqs,
+                            void *opaque);
+
+void qsp_iterate(size_t max, enum QSPSortBy sort_by, bool callsite_coalesce,
+                 qsp_iter_fn fn, void *opaque);
+
 bool qsp_is_enabled(void);
 void qsp_enable(void);
 void qsp_disable(void);
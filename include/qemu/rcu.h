@@ -135,6 +135,13 @@ struct rcu_head {
 extern void call_rcu1(struct rcu_head *head, RCUCBFunc *func);
 extern void drain_call_rcu(void);
 
+/*
+ * rcu_call_stats: report the number of callbacks queued for the call_rcu
+ * thread but not yet invoked, and the number invoked so far.  The two
+ * values are sampled separately and may be mutually inconsistent.
+ */
+extern void rcu_call_stats(uint64_t *pending, uint64_t *completed);
+
 /* The operands of the minus operator must have the same type,
  * which must be the one that we specify in the cast.
  */
@@ -187,6 +187,12 @@ void qemu_thread_create(QemuThread *thread, const char *name,
                         void *arg, int mode);
 void *qemu_thread_join(QemuThread *thread);
 void qemu_thread_get_self(QemuThread *thread);
+/*
+ * Restrict the thread to the host CPUs whose bits are set in @host_cpus.
+ * Returns 0 on success, an errno on failure, -ENOSYS where unsupported.
+ */
+int qemu_thread_set_affinity(QemuThread *thread, unsigned long *host_cpus,
+                             unsigned long nbits);
 bool qemu_thread_is_self(QemuThread *thread);
 void qemu_thread_exit(void *retval) QEMU_NORETURN;
 void qemu_thread_naming(bool enable);
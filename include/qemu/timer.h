@@ -87,6 +87,8 @@ struct QEMUTimer {
     QEMUTimerCB *cb;
     void *opaque;
     QEMUTimer *next;
+    uint64_t order;             /* arming order, breaks expire_time ties */
+    int heap_index;             /* index in the timer list heap, -1 if unarmed */
     int attributes;
     int scale;
 };
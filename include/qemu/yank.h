@@ -13,6 +13,7 @@
 #include "qapi/qapi-types-yank.h"
 
 typedef void (YankFn)(void *opaque);
+typedef uint64_t (YankProgressFn)(void *opaque);
 
 /**
  * yank_register_instance: Register a new instance.
@@ -73,6 +74,30 @@ void yank_unregister_function(const YankInstance *instance,
                               YankFn *func,
                               void *opaque);
 
+/**
+ * yank_register_progress: Attach a progress counter to an instance
+ *
+ * This registers a progress function for the instance, enabling the
+ * stall watchdog (see the yank-watchdog-set QMP command). The function
+ * must return a counter that increases whenever the instance makes
+ * forward progress (e.g. bytes transferred or requests completed); the
+ * absolute value is irrelevant, only changes are observed. It is called
+ * from a main loop timer with the internal yank lock held and must not
+ * block.
+ *
+ * The progress function is detached automatically when the instance is
+ * unregistered; @opaque must stay valid until then.
+ *
+ * This function is thread-safe.
+ *
+ * @instance: The instance.
+ * @func: The progress function.
+ * @opaque: Will be passed to the progress function.
+ */
+void yank_register_progress(const YankInstance *instance,
+                            YankProgressFn *func,
+                            void *opaque);
+
 #define BLOCKDEV_YANK_INSTANCE(the_node_name) (&(YankInstance) { \
         .type = YANK_INSTANCE_TYPE_BLOCK_NODE, \
         .u.block_node.node_name = (the_node_name) })
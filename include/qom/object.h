@@ -137,6 +137,14 @@ struct ObjectClass
     ObjectUnparent *unparent;
 
     GHashTable *properties;
+
+    /*
+     * Lazily built table of all class properties, including inherited
+     * ones, so that lookups need not walk the class hierarchy.  Rebuilt
+     * when out of date with the global class property generation.
+     */
+    GHashTable *flat_properties;
+    unsigned int flat_properties_gen;
 };
 
 /**
@@ -1946,6 +1954,20 @@ Object *container_get(Object *root, const char *path);
  */
 size_t object_type_get_instance_size(const char *typename);
 
+typedef void (*ObjectTypeChurnFn)(const char *typename, uint64_t created,
+                                  uint64_t finalized, void *opaque);
+
+/**
+ * object_type_churn_foreach:
+ * @fn: callback invoked for every type that has had instances
+ * @opaque: opaque parameter passed to @fn
+ *
+ * Report per-type instance churn: how many instances of each type have
+ * been initialized and finalized over the lifetime of the process.
+ * Types that never had an instance are skipped.
+ */
+void object_type_churn_foreach(ObjectTypeChurnFn fn, void *opaque);
+
 /**
  * object_property_help:
  * @name: the name of the property
@@ -0,0 +1,39 @@
+/*
+ * Boot phase profiling
+ *
+ * Copyright (c) 2021 QEMU contributors
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef SYSEMU_BOOT_PROFILE_H
+#define SYSEMU_BOOT_PROFILE_H
+
+/**
+ * boot_profile_stamp: record a named milestone of the init sequence
+ * @phase: milestone name, reported verbatim by query-boot-profile
+ *
+ * The timestamp is taken relative to the first stamp, so the caller in
+ * qemu_init() must record the "start" milestone before anything else.
+ * Cheap enough to call unconditionally; storage is a small growing
+ * array and no locking is needed because all stamps are taken from the
+ * main thread during startup.
+ */
+void boot_profile_stamp(const char *phase);
+
+/**
+ * boot_profile_parse_opts: apply the -boot-profile command line option
+ */
+void boot_profile_parse_opts(QemuOpts *opts);
+
+/**
+ * boot_profile_init_done: act on the -boot-profile option
+ *
+ * Called at the end of qemu_init(): prints the phase report to stderr
+ * when report=on, and exits without running the guest when exit=on so
+ * CI can measure cold start in isolation.
+ */
+void boot_profile_init_done(void);
+
+#endif
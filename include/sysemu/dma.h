@@ -16,6 +16,7 @@
 #include "block/accounting.h"
 
 typedef struct ScatterGatherEntry ScatterGatherEntry;
+typedef struct DMASGCache DMASGCache;
 
 typedef enum {
     DMA_DIRECTION_TO_DEVICE = 0,
@@ -29,6 +30,7 @@ struct QEMUSGList {
     size_t size;
     DeviceState *dev;
     AddressSpace *as;
+    DMASGCache *map_cache;
 };
 
 #ifndef CONFIG_USER_ONLY
@@ -274,6 +276,47 @@ void qemu_sglist_init(QEMUSGList *qsg, DeviceState *dev, int alloc_hint,
                       AddressSpace *as);
 void qemu_sglist_add(QEMUSGList *qsg, dma_addr_t base, dma_addr_t len);
 void qemu_sglist_destroy(QEMUSGList *qsg);
+
+/**
+ * dma_sg_cache_new: create a scatter-gather mapping cache
+ *
+ * The cache remembers guest memory translations produced while
+ * servicing dma_blk_io() requests, so devices that reuse the same
+ * guest buffers (e.g. fixed request rings) do not re-walk the
+ * flatview on every request. Cached translations reference their
+ * #MemoryRegion like #MemoryRegionCache does and are dropped when the
+ * memory topology of @as changes. Only directly accessible RAM is
+ * cached; everything else falls back to dma_memory_map().
+ *
+ * Must be called with the BQL held (it registers a memory listener),
+ * typically from the device's realize method.
+ *
+ * @as: the #AddressSpace the device uses for DMA
+ * @size: number of translations to cache
+ */
+DMASGCache *dma_sg_cache_new(AddressSpace *as, unsigned size);
+
+/**
+ * dma_sg_cache_free: free a scatter-gather mapping cache
+ *
+ * Must be called with the BQL held and no I/O in flight that still
+ * uses mappings from the cache.
+ *
+ * @cache: the cache, may be NULL
+ */
+void dma_sg_cache_free(DMASGCache *cache);
+
+/**
+ * qemu_sglist_set_map_cache: use a mapping cache for this request
+ *
+ * Makes dma_blk_io() look up (and fill) @cache when mapping the
+ * entries of @qsg. The cache must have been created for the same
+ * address space that @qsg was initialized with.
+ *
+ * @qsg: the scatter-gather list
+ * @cache: cache created with dma_sg_cache_new()
+ */
+void qemu_sglist_set_map_cache(QEMUSGList *qsg, DMASGCache *cache);
 #endif
 
 typedef BlockAIOCB *DMAIOFunc(int64_t offset, QEMUIOVector *iov,
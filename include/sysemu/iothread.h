@@ -40,6 +40,10 @@ struct IOThread {
 
     /* AioContext AIO engine parameters */
     int64_t aio_max_batch;
+
+    /* Host CPUs to pin @thread to, or NULL for no restriction */
+    unsigned long *cpu_affinity;
+    unsigned long cpu_affinity_nbits;
 };
 typedef struct IOThread IOThread;
 
@@ -50,6 +50,9 @@ extern ReplayMode replay_mode;
 /* Name of the initial VM snapshot */
 extern char *replay_snapshot;
 
+/* Interval in seconds for periodic snapshots in replay mode, 0 = disabled */
+extern int replay_snapshot_periodic_delay;
+
 /* Replay locking
  *
  * The locks are needed to protect the shared structures and log file
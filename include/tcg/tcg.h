@@ -944,6 +944,11 @@ int tcg_check_temp_count(void);
 
 int64_t tcg_cpu_exec_time(void);
 void tcg_dump_info(void);
+
+/* Statistics on gvec expansion, reported by "info jit".  */
+extern uint64_t tcg_gvec_vector_expansions;
+extern uint64_t tcg_gvec_scalar_expansions;
+extern uint64_t tcg_gvec_ool_expansions;
 void tcg_dump_op_count(void);
 
 #define TCG_CT_CONST  1 /* any constant of register size */
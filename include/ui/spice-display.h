@@ -85,27 +85,38 @@ typedef struct SimpleSpiceUpdate SimpleSpiceUpdate;
 typedef struct SimpleSpiceCursor SimpleSpiceCursor;
 
 struct SimpleSpiceDisplay {
-    DisplaySurface *ds;
     DisplayChangeListener dcl;
     void *buf;
     int bufsize;
     QXLInstance qxl;
-    uint32_t unique;
-    pixman_image_t *surface;
-    pixman_image_t *mirror;
     int32_t num_surfaces;
 
-    QXLRect dirty;
     int notify;
 
     /*
      * All struct members below this comment can be accessed from
-     * both spice server and qemu (iothread) context and any access
-     * to them must be protected by the lock.
+     * spice server, qemu (iothread) and update worker context and
+     * any access to them must be protected by the lock.
      */
     QemuMutex lock;
+    DisplaySurface *ds;
+    uint32_t unique;
+    pixman_image_t *surface;
+    pixman_image_t *mirror;
+    QXLRect dirty;
     QTAILQ_HEAD(, SimpleSpiceUpdate) updates;
 
+    /*
+     * Update worker thread: dpy_refresh only signals the worker, which
+     * mirrors the dirty region into SimpleSpiceUpdate commands off the
+     * main loop.  A new frame is only produced once the spice server
+     * has fetched the previous one, so while the client lags, dirty
+     * rectangles keep merging in @dirty instead of queueing up.
+     */
+    QemuThread update_thread;
+    QemuCond update_cond;
+    bool update_pending;
+
     /* cursor (without qxl): displaychangelistener -> spice server */
     SimpleSpiceCursor *ptr_define;
     SimpleSpiceCursor *ptr_move;
@@ -301,16 +301,37 @@ static ssize_t qio_channel_tls_writev(QIOChannel *ioc,
                                       size_t niov,
                                       int *fds,
                                       size_t nfds,
+                                      int flags,
                                       Error **errp)
 {
     QIOChannelTLS *tioc = QIO_CHANNEL_TLS(ioc);
+    uint8_t buf[16384]; /* one maximum-sized TLS record */
     size_t i;
     ssize_t done = 0;
 
     for (i = 0 ; i < niov ; i++) {
-        ssize_t ret = qcrypto_tls_session_write(tioc->session,
-                                                iov[i].iov_base,
-                                                iov[i].iov_len);
+        const char *base = iov[i].iov_base;
+        size_t len = iov[i].iov_len;
+        ssize_t ret;
+
+        /* Coalesce adjacent small elements into a single TLS record, so
+         * that a header + payload vector does not pay the per-record
+         * padding, MAC and syscall overhead twice.  Since the copy is a
+         * prefix of the remaining byte stream, partial writes still map
+         * back to the caller's vector as before.
+         */
+        if (len < sizeof(buf) && i + 1 < niov) {
+            len = 0;
+            while (i < niov && iov[i].iov_len <= sizeof(buf) - len) {
+                memcpy(buf + len, iov[i].iov_base, iov[i].iov_len);
+                len += iov[i].iov_len;
+                i++;
+            }
+            i--; /* the outer loop increments it again */
+            base = (const char *)buf;
+        }
+
+        ret = qcrypto_tls_session_write(tioc->session, base, len);
         if (ret <= 0) {
             if (errno == EAGAIN) {
                 if (done) {
@@ -325,7 +346,7 @@ static ssize_t qio_channel_tls_writev(QIOChannel *ioc,
             return -1;
         }
         done += ret;
-        if (ret < iov[i].iov_len) {
+        if (ret < len) {
             break;
         }
     }
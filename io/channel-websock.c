@@ -607,36 +607,49 @@ static gboolean qio_channel_websock_handshake_io(QIOChannel *ioc,
 }
 
 
-static void qio_channel_websock_encode(QIOChannelWebsock *ioc,
-                                       uint8_t opcode,
-                                       const struct iovec *iov,
-                                       size_t niov,
-                                       size_t size)
+typedef union QIOChannelWebsockEncodedHeader {
+    char buf[QIO_CHANNEL_WEBSOCK_HEADER_LEN_64_BIT];
+    QIOChannelWebsockHeader ws;
+} QIOChannelWebsockEncodedHeader;
+
+static size_t
+qio_channel_websock_make_header(QIOChannelWebsockEncodedHeader *header,
+                                uint8_t opcode,
+                                size_t size)
 {
     size_t header_size;
-    size_t i;
-    union {
-        char buf[QIO_CHANNEL_WEBSOCK_HEADER_LEN_64_BIT];
-        QIOChannelWebsockHeader ws;
-    } header;
-
-    assert(size <= iov_size(iov, niov));
 
-    header.ws.b0 = QIO_CHANNEL_WEBSOCK_HEADER_FIELD_FIN |
+    header->ws.b0 = QIO_CHANNEL_WEBSOCK_HEADER_FIELD_FIN |
         (opcode & QIO_CHANNEL_WEBSOCK_HEADER_FIELD_OPCODE);
     if (size < QIO_CHANNEL_WEBSOCK_PAYLOAD_LEN_THRESHOLD_7_BIT) {
-        header.ws.b1 = (uint8_t)size;
+        header->ws.b1 = (uint8_t)size;
         header_size = QIO_CHANNEL_WEBSOCK_HEADER_LEN_7_BIT;
     } else if (size < QIO_CHANNEL_WEBSOCK_PAYLOAD_LEN_THRESHOLD_16_BIT) {
-        header.ws.b1 = QIO_CHANNEL_WEBSOCK_PAYLOAD_LEN_MAGIC_16_BIT;
-        header.ws.u.s16.l16 = cpu_to_be16((uint16_t)size);
+        header->ws.b1 = QIO_CHANNEL_WEBSOCK_PAYLOAD_LEN_MAGIC_16_BIT;
+        header->ws.u.s16.l16 = cpu_to_be16((uint16_t)size);
         header_size = QIO_CHANNEL_WEBSOCK_HEADER_LEN_16_BIT;
     } else {
-        header.ws.b1 = QIO_CHANNEL_WEBSOCK_PAYLOAD_LEN_MAGIC_64_BIT;
-        header.ws.u.s64.l64 = cpu_to_be64(size);
+        header->ws.b1 = QIO_CHANNEL_WEBSOCK_PAYLOAD_LEN_MAGIC_64_BIT;
+        header->ws.u.s64.l64 = cpu_to_be64(size);
         header_size = QIO_CHANNEL_WEBSOCK_HEADER_LEN_64_BIT;
     }
-    header_size -= QIO_CHANNEL_WEBSOCK_HEADER_LEN_MASK;
+    return header_size - QIO_CHANNEL_WEBSOCK_HEADER_LEN_MASK;
+}
+
+
+static void qio_channel_websock_encode(QIOChannelWebsock *ioc,
+                                       uint8_t opcode,
+                                       const struct iovec *iov,
+                                       size_t niov,
+                                       size_t size)
+{
+    size_t header_size;
+    size_t i;
+    QIOChannelWebsockEncodedHeader header;
+
+    assert(size <= iov_size(iov, niov));
+
+    header_size = qio_channel_websock_make_header(&header, opcode, size);
 
     trace_qio_channel_websock_encode(ioc, opcode, header_size, size);
     buffer_reserve(&ioc->encoutput, header_size + size);
@@ -793,6 +806,8 @@ static int qio_channel_websock_decode_payload(QIOChannelWebsock *ioc,
 {
     size_t i;
     size_t payload_len = 0;
+    uint64_t mask64;
+    uint64_t *payload64;
     uint32_t *payload32;
 
     if (ioc->payload_remain) {
@@ -817,9 +832,16 @@ static int qio_channel_websock_decode_payload(QIOChannelWebsock *ioc,
         ioc->payload_remain -= payload_len;
 
         /* unmask frame */
-        /* process 1 frame (32 bit op) */
+        /* the 4 byte mask pattern repeats identically in a 64 bit word,
+         * regardless of host endianness */
+        mask64 = ((uint64_t)ioc->mask.u << 32) | ioc->mask.u;
+        payload64 = (uint64_t *)ioc->encinput.buffer;
+        for (i = 0; i < payload_len / 8; i++) {
+            payload64[i] ^= mask64;
+        }
+        /* process a trailing 32 bit word (if any) */
         payload32 = (uint32_t *)ioc->encinput.buffer;
-        for (i = 0; i < payload_len / 4; i++) {
+        for (i *= 2; i < payload_len / 4; i++) {
             payload32[i] ^= ioc->mask.u;
         }
         /* process the remaining bytes (if any) */
@@ -1122,11 +1144,78 @@ static ssize_t qio_channel_websock_readv(QIOChannel *ioc,
 }
 
 
+/*
+ * Send a binary frame straight from the caller's memory, skipping the
+ * copy through encoutput.  Whatever the transport does not accept is
+ * buffered so that the flush watch completes the frame later; the
+ * frame length is committed once the header is built.
+ */
+static int qio_channel_websock_write_direct(QIOChannelWebsock *ioc,
+                                            const struct iovec *iov,
+                                            size_t niov,
+                                            size_t size,
+                                            Error **errp)
+{
+    QIOChannelWebsockEncodedHeader header;
+    g_autofree struct iovec *wiov = g_new(struct iovec, niov + 1);
+    size_t header_size;
+    size_t wniov;
+    size_t done = 0;
+    size_t skip, remain;
+    size_t i;
+    ssize_t ret;
+
+    header_size = qio_channel_websock_make_header(
+        &header, QIO_CHANNEL_WEBSOCK_OPCODE_BINARY_FRAME, size);
+
+    trace_qio_channel_websock_encode(ioc, QIO_CHANNEL_WEBSOCK_OPCODE_BINARY_FRAME,
+                                     header_size, size);
+
+    wiov[0].iov_base = header.buf;
+    wiov[0].iov_len = header_size;
+    wniov = 1 + iov_copy(&wiov[1], niov, iov, niov, 0, size);
+
+    ret = qio_channel_writev(ioc->master, wiov, wniov, errp);
+    if (ret < 0) {
+        if (ret != QIO_CHANNEL_ERR_BLOCK) {
+            return -1;
+        }
+    } else {
+        done = ret;
+    }
+
+    if (done == header_size + size) {
+        return 0;
+    }
+
+    buffer_reserve(&ioc->encoutput, header_size + size - done);
+    if (done < header_size) {
+        buffer_append(&ioc->encoutput, header.buf + done, header_size - done);
+        done = header_size;
+    }
+    skip = done - header_size;
+    remain = size - skip;
+    for (i = 0; i < niov && remain != 0; i++) {
+        size_t len = iov[i].iov_len;
+        if (skip >= len) {
+            skip -= len;
+            continue;
+        }
+        len = MIN(len - skip, remain);
+        buffer_append(&ioc->encoutput, (char *)iov[i].iov_base + skip, len);
+        skip = 0;
+        remain -= len;
+    }
+    return 0;
+}
+
+
 static ssize_t qio_channel_websock_writev(QIOChannel *ioc,
                                           const struct iovec *iov,
                                           size_t niov,
                                           int *fds,
                                           size_t nfds,
+                                          int flags,
                                           Error **errp)
 {
     QIOChannelWebsock *wioc = QIO_CHANNEL_WEBSOCK(ioc);
@@ -1151,9 +1240,17 @@ static ssize_t qio_channel_websock_writev(QIOChannel *ioc,
     }
 
     if (want) {
-        qio_channel_websock_encode(wioc,
-                                   QIO_CHANNEL_WEBSOCK_OPCODE_BINARY_FRAME,
-                                   iov, niov, want);
+        if (wioc->encoutput.offset == 0) {
+            if (qio_channel_websock_write_direct(wioc, iov, niov,
+                                                 want, errp) < 0) {
+                qio_channel_websock_unset_watch(wioc);
+                return -1;
+            }
+        } else {
+            qio_channel_websock_encode(wioc,
+                                       QIO_CHANNEL_WEBSOCK_OPCODE_BINARY_FRAME,
+                                       iov, niov, want);
+        }
     }
 
     /* Even if want == 0, we'll try write_wire in case there's
@@ -14,12 +14,15 @@
 #include "qemu/osdep.h"
 #include "qom/object.h"
 #include "qom/object_interfaces.h"
+#include "qapi/qapi-builtin-visit.h"
+#include "qapi/visitor.h"
 #include "qemu/module.h"
 #include "block/aio.h"
 #include "block/block.h"
 #include "sysemu/iothread.h"
 #include "qapi/error.h"
 #include "qapi/qapi-commands-misc.h"
+#include "qemu/bitmap.h"
 #include "qemu/error-report.h"
 #include "qemu/rcu.h"
 #include "qemu/main-loop.h"
@@ -139,6 +142,8 @@ static void iothread_instance_finalize(Object *obj)
         iothread->main_loop = NULL;
     }
     qemu_sem_destroy(&iothread->init_done_sem);
+    g_free(iothread->cpu_affinity);
+    iothread->cpu_affinity = NULL;
 }
 
 static void iothread_init_gcontext(IOThread *iothread)
@@ -206,6 +211,16 @@ static void iothread_complete(UserCreatable *obj, Error **errp)
                        iothread, QEMU_THREAD_JOINABLE);
     g_free(thread_name);
 
+    if (iothread->cpu_affinity) {
+        int err = qemu_thread_set_affinity(&iothread->thread,
+                                           iothread->cpu_affinity,
+                                           iothread->cpu_affinity_nbits);
+        if (err) {
+            error_setg(errp, "Setting CPU affinity failed: %s",
+                       strerror(abs(err)));
+        }
+    }
+
     /* Wait for initialization to complete */
     while (iothread->thread_id == -1) {
         qemu_sem_wait(&iothread->init_done_sem);
@@ -311,6 +326,60 @@ static void iothread_set_aio_param(Object *obj, Visitor *v,
     }
 }
 
+static void iothread_get_cpu_affinity(Object *obj, Visitor *v,
+        const char *name, void *opaque, Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+    uint16List *cpus = NULL;
+    uint16List **tail = &cpus;
+    unsigned long value;
+
+    if (iothread->cpu_affinity) {
+        value = find_first_bit(iothread->cpu_affinity,
+                               iothread->cpu_affinity_nbits);
+        while (value < iothread->cpu_affinity_nbits) {
+            QAPI_LIST_APPEND(tail, value);
+            value = find_next_bit(iothread->cpu_affinity,
+                                  iothread->cpu_affinity_nbits, value + 1);
+        }
+    }
+
+    visit_type_uint16List(v, name, &cpus, errp);
+    qapi_free_uint16List(cpus);
+}
+
+static void iothread_set_cpu_affinity(Object *obj, Visitor *v,
+        const char *name, void *opaque, Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+    uint16List *l, *cpus = NULL;
+    unsigned long nbits = 0;
+
+    if (iothread->thread_id != -1) {
+        error_setg(errp, "cannot change property value once the thread runs");
+        return;
+    }
+
+    if (!visit_type_uint16List(v, name, &cpus, errp)) {
+        return;
+    }
+
+    for (l = cpus; l; l = l->next) {
+        nbits = MAX(nbits, l->value + 1ul);
+    }
+
+    g_free(iothread->cpu_affinity);
+    iothread->cpu_affinity = NULL;
+    iothread->cpu_affinity_nbits = nbits;
+    if (nbits) {
+        iothread->cpu_affinity = bitmap_new(nbits);
+        for (l = cpus; l; l = l->next) {
+            set_bit(l->value, iothread->cpu_affinity);
+        }
+    }
+    qapi_free_uint16List(cpus);
+}
+
 static void iothread_class_init(ObjectClass *klass, void *class_data)
 {
     UserCreatableClass *ucc = USER_CREATABLE_CLASS(klass);
@@ -332,6 +401,10 @@ static void iothread_class_init(ObjectClass *klass, void *class_data)
                               iothread_get_aio_param,
                               iothread_set_aio_param,
                               NULL, &aio_max_batch_info);
+    object_class_property_add(klass, "cpu-affinity", "int",
+                              iothread_get_cpu_affinity,
+                              iothread_set_cpu_affinity,
+                              NULL, NULL);
 }
 
 static const TypeInfo iothread_info = {
@@ -475,6 +475,8 @@ static void coroutine_fn job_do_yield(Job *job, uint64_t ns)
     if (ns != -1) {
         timer_mod(&job->sleep_timer, ns);
     }
+    job->cpu_ns += qemu_clock_get_ns(QEMU_CLOCK_REALTIME) -
+                   job->busy_start_ns;
     job->busy = false;
     job_event_idle(job);
     job_unlock();
@@ -482,6 +484,7 @@ static void coroutine_fn job_do_yield(Job *job, uint64_t ns)
 
     /* Set by job_enter_cond() before re-entering the coroutine.  */
     assert(job->busy);
+    job->busy_start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
 }
 
 void coroutine_fn job_pause_point(Job *job)
@@ -913,8 +916,11 @@ static void coroutine_fn job_co_entry(void *opaque)
     Job *job = opaque;
 
     assert(job && job->driver && job->driver->run);
+    job->busy_start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
     job_pause_point(job);
     job->ret = job->driver->run(job, &job->err);
+    job->cpu_ns += qemu_clock_get_ns(QEMU_CLOCK_REALTIME) -
+                   job->busy_start_ns;
     job->deferred_to_main_loop = true;
     job->busy = true;
     aio_bh_schedule_oneshot(qemu_get_aio_context(), job_exit, job);
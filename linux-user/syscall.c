@@ -10271,6 +10271,11 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
             if (!(dirp = lock_user(VERIFY_WRITE, arg2, count, 0)))
                 return -TARGET_EFAULT;
             ret = get_errno(sys_getdents(arg1, dirp, count));
+#ifdef BSWAP_NEEDED
+            /*
+             * The guest layout matches the host layout here, so the
+             * buffer returned by the kernel only needs byte swapping.
+             */
             if (!is_error(ret)) {
                 struct linux_dirent *de;
                 int len = ret;
@@ -10287,6 +10292,7 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
                     len -= reclen;
                 }
             }
+#endif
             unlock_user(dirp, arg2, ret);
         }
 #endif
@@ -10355,6 +10361,11 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
             if (!(dirp = lock_user(VERIFY_WRITE, arg2, count, 0)))
                 return -TARGET_EFAULT;
             ret = get_errno(sys_getdents64(arg1, dirp, count));
+#ifdef BSWAP_NEEDED
+            /*
+             * linux_dirent64 has the same layout for all targets, so the
+             * buffer returned by the kernel only needs byte swapping.
+             */
             if (!is_error(ret)) {
                 struct linux_dirent64 *de;
                 int len = ret;
@@ -10371,6 +10382,7 @@ static abi_long do_syscall1(void *cpu_env, int num, abi_long arg1,
                     len -= reclen;
                 }
             }
+#endif
             unlock_user(dirp, arg2, ret);
         }
         return ret;
@@ -261,6 +261,28 @@ ReplicationStatus *qmp_query_xen_replication_status(Error **errp)
     return s;
 }
 
+BlockReplicationStats *qmp_query_block_replication_stats(Error **errp)
+{
+    BlockReplicationStats *s = g_new0(BlockReplicationStats, 1);
+    ReplicationStats stats;
+
+    replication_get_stats_all(&stats);
+
+    s->writes = stats.writes;
+    s->write_bytes = stats.write_bytes;
+    s->epoch_writes = stats.epoch_writes;
+    s->epoch_write_bytes = stats.epoch_write_bytes;
+    s->flushes_deferred = stats.flushes_deferred;
+    s->checkpoints = stats.checkpoints;
+    if (stats.last_checkpoint_ms >= 0) {
+        s->has_ms_since_checkpoint = true;
+        s->ms_since_checkpoint = qemu_clock_get_ms(QEMU_CLOCK_REALTIME) -
+                                 stats.last_checkpoint_ms;
+    }
+
+    return s;
+}
+
 void qmp_xen_colo_do_checkpoint(Error **errp)
 {
     Error *err = NULL;
@@ -537,6 +559,8 @@ static void colo_process_checkpoint(MigrationState *s)
     }
 
     failover_init_state();
+    /* The peer has no cached device sections yet, start from full ones */
+    qemu_savevm_delta_reset();
 
     s->rp_state.from_dst_file = qemu_file_get_return_path(s->to_dst_file);
     if (!s->rp_state.from_dst_file) {
@@ -914,6 +938,7 @@ out:
     if (fb) {
         qemu_fclose(fb);
     }
+    qemu_loadvm_delta_reset();
 
     /* Hope this not to be too long to loop here */
     qemu_sem_wait(&mis->colo_incoming_sem);
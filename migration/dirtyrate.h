@@ -13,6 +13,8 @@
 #ifndef QEMU_MIGRATION_DIRTYRATE_H
 #define QEMU_MIGRATION_DIRTYRATE_H
 
+#include "qapi/qapi-types-migration.h"
+
 /*
  * Sample 512 pages per GB as default.
  */
@@ -43,8 +45,18 @@
 struct DirtyRateConfig {
     uint64_t sample_pages_per_gigabytes; /* sample pages per GB */
     int64_t sample_period_seconds; /* time duration between two sampling */
+    DirtyRateMeasureMode mode; /* mode of dirtyrate measurement */
 };
 
+/*
+ * Store vcpu dirty page count between two samplings, taken from the
+ * per-vCPU counter fed by the KVM dirty ring.
+ */
+typedef struct DirtyPageRecord {
+    uint64_t start_pages;
+    uint64_t end_pages;
+} DirtyPageRecord;
+
 /*
  * Store dirtypage info for each ramblock.
  */
@@ -69,6 +81,9 @@ struct DirtyRateStat {
     int64_t start_time; /* calculation start time in units of second */
     int64_t calc_time; /* time duration of two sampling in units of second */
     uint64_t sample_pages; /* sample pages per GB */
+    DirtyRateMeasureMode mode; /* mode of the last measurement */
+    int nvcpu; /* number of vcpus measured in dirty-ring mode */
+    DirtyRateVcpu *rates; /* array of per-vcpu rates in dirty-ring mode */
 };
 
 void *get_dirtyrate_thread(void *arg);
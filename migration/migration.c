@@ -465,6 +465,10 @@ static void qemu_start_incoming_migration(const char *uri, Error **errp)
         socket_start_incoming_migration(p ? p : uri, errp);
 #ifdef CONFIG_RDMA
     } else if (strstart(uri, "rdma:", &p)) {
+        if (migrate_use_multifd()) {
+            error_setg(errp, "RDMA migration is not compatible with multifd");
+            return;
+        }
         rdma_start_incoming_migration(p, errp);
 #endif
     } else if (strstart(uri, "exec:", &p)) {
@@ -1013,13 +1017,19 @@ static void populate_ram_info(MigrationInfo *info, MigrationState *s)
     info->ram->page_size = qemu_target_page_size();
     info->ram->multifd_bytes = ram_counters.multifd_bytes;
     info->ram->pages_per_second = s->pages_per_second;
+    info->ram->dirty_scan_time = ram_counters.dirty_scan_time;
+    info->ram->multifd_raw_bytes = ram_counters.multifd_raw_bytes;
+    info->ram->multifd_compressed_bytes = ram_counters.multifd_compressed_bytes;
 
     if (migrate_use_xbzrle()) {
         info->has_xbzrle_cache = true;
         info->xbzrle_cache = g_malloc0(sizeof(*info->xbzrle_cache));
         info->xbzrle_cache->cache_size = migrate_xbzrle_cache_size();
+        info->xbzrle_cache->current_cache_size =
+            xbzrle_counters.current_cache_size;
         info->xbzrle_cache->bytes = xbzrle_counters.bytes;
         info->xbzrle_cache->pages = xbzrle_counters.pages;
+        info->xbzrle_cache->cache_hit = xbzrle_counters.cache_hit;
         info->xbzrle_cache->cache_miss = xbzrle_counters.cache_miss;
         info->xbzrle_cache->cache_miss_rate = xbzrle_counters.cache_miss_rate;
         info->xbzrle_cache->encoding_rate = xbzrle_counters.encoding_rate;
@@ -1196,6 +1206,18 @@ static bool migrate_caps_check(bool *cap_list,
     }
 #endif
 
+    if (cap_list[MIGRATION_CAPABILITY_ZERO_COPY_SEND]) {
+#ifdef CONFIG_LINUX
+        if (!cap_list[MIGRATION_CAPABILITY_MULTIFD]) {
+            error_setg(errp, "zero-copy-send requires multifd");
+            return false;
+        }
+#else
+        error_setg(errp, "Zero copy currently only available on Linux");
+        return false;
+#endif
+    }
+
     if (cap_list[MIGRATION_CAPABILITY_POSTCOPY_RAM]) {
         /* This check is reasonably expensive, so only when it's being
          * set the first time, also it's only the destination that needs
@@ -2292,6 +2314,8 @@ void qmp_migrate(const char *uri, bool has_blk, bool blk,
         if (!yank_register_instance(MIGRATION_YANK_INSTANCE, errp)) {
             return;
         }
+        yank_register_progress(MIGRATION_YANK_INSTANCE,
+                               migration_yank_progress, NULL);
     }
 
     if (strstart(uri, "tcp:", &p) ||
@@ -2300,7 +2324,12 @@ void qmp_migrate(const char *uri, bool has_blk, bool blk,
         socket_start_outgoing_migration(s, p ? p : uri, &local_err);
 #ifdef CONFIG_RDMA
     } else if (strstart(uri, "rdma:", &p)) {
-        rdma_start_outgoing_migration(s, p, &local_err);
+        if (migrate_use_multifd()) {
+            error_setg(&local_err,
+                       "RDMA migration is not compatible with multifd");
+        } else {
+            rdma_start_outgoing_migration(s, p, &local_err);
+        }
 #endif
     } else if (strstart(uri, "exec:", &p)) {
         exec_start_outgoing_migration(s, p, &local_err);
@@ -2484,6 +2513,33 @@ bool migrate_use_multifd(void)
     return s->enabled_capabilities[MIGRATION_CAPABILITY_MULTIFD];
 }
 
+bool migrate_multifd_zero_pages(void)
+{
+    MigrationState *s;
+
+    s = migrate_get_current();
+
+    return s->enabled_capabilities[MIGRATION_CAPABILITY_MULTIFD_ZERO_PAGES];
+}
+
+bool migrate_use_zero_copy_send(void)
+{
+    MigrationState *s;
+
+    s = migrate_get_current();
+
+    return s->enabled_capabilities[MIGRATION_CAPABILITY_ZERO_COPY_SEND];
+}
+
+bool migrate_colo_device_delta(void)
+{
+    MigrationState *s;
+
+    s = migrate_get_current();
+
+    return s->enabled_capabilities[MIGRATION_CAPABILITY_X_COLO_DEVICE_DELTA];
+}
+
 bool migrate_pause_before_switchover(void)
 {
     MigrationState *s;
@@ -4206,10 +4262,15 @@ static Property migration_properties[] = {
     DEFINE_PROP_MIG_CAP("x-events", MIGRATION_CAPABILITY_EVENTS),
     DEFINE_PROP_MIG_CAP("x-postcopy-ram", MIGRATION_CAPABILITY_POSTCOPY_RAM),
     DEFINE_PROP_MIG_CAP("x-colo", MIGRATION_CAPABILITY_X_COLO),
+    DEFINE_PROP_MIG_CAP("x-colo-device-delta",
+                        MIGRATION_CAPABILITY_X_COLO_DEVICE_DELTA),
+    DEFINE_PROP_MIG_CAP("zero-copy-send", MIGRATION_CAPABILITY_ZERO_COPY_SEND),
     DEFINE_PROP_MIG_CAP("x-release-ram", MIGRATION_CAPABILITY_RELEASE_RAM),
     DEFINE_PROP_MIG_CAP("x-block", MIGRATION_CAPABILITY_BLOCK),
     DEFINE_PROP_MIG_CAP("x-return-path", MIGRATION_CAPABILITY_RETURN_PATH),
     DEFINE_PROP_MIG_CAP("x-multifd", MIGRATION_CAPABILITY_MULTIFD),
+    DEFINE_PROP_MIG_CAP("x-multifd-zero-pages",
+            MIGRATION_CAPABILITY_MULTIFD_ZERO_PAGES),
     DEFINE_PROP_MIG_CAP("x-background-snapshot",
             MIGRATION_CAPABILITY_BACKGROUND_SNAPSHOT),
 
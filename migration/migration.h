@@ -333,6 +333,9 @@ bool migrate_validate_uuid(void);
 
 bool migrate_auto_converge(void);
 bool migrate_use_multifd(void);
+bool migrate_multifd_zero_pages(void);
+bool migrate_use_zero_copy_send(void);
+bool migrate_colo_device_delta(void);
 bool migrate_pause_before_switchover(void);
 int migrate_multifd_channels(void);
 MultiFDCompression migrate_multifd_compression(void);
@@ -12,6 +12,8 @@
 
 #include "qemu/osdep.h"
 #include <zstd.h>
+#include <zdict.h>
+#include "qemu/bswap.h"
 #include "qemu/rcu.h"
 #include "exec/target_page.h"
 #include "qapi/error.h"
@@ -31,8 +33,122 @@ struct zstd_data {
     uint8_t *zbuff;
     /* size of compressed buffer */
     uint32_t zbuff_len;
+    /* send side: this channel already compresses with the trained dict */
+    bool dict_active;
+    /* recv side: dictionary received from the source, if any */
+    ZSTD_DDict *ddict;
 };
 
+/* how many page bytes to sample before training the dictionary */
+#define ZSTD_DICT_SAMPLE_BYTES (4 * 1024 * 1024)
+/* upper bound for the trained dictionary, zstd recommends ~1/100 of it */
+#define ZSTD_DICT_MAX_SIZE (64 * 1024)
+
+/*
+ * Page samples collected by the send channels during the first
+ * iteration.  Once enough pages have been seen the dictionary is
+ * trained exactly once, shared by every channel through @cdict, and
+ * shipped to the destination inside a MULTIFD_FLAG_ZSTD_DICT packet
+ * on each channel.
+ */
+static struct {
+    QemuMutex lock;
+    /* concatenated page samples, nb_samples pages of target page size */
+    uint8_t *samples;
+    size_t *sample_sizes;
+    unsigned int nb_samples;
+    size_t sample_bytes;
+    /* trained dictionary, to be sent to the destination */
+    uint8_t *dict;
+    size_t dict_size;
+    /* digested form of @dict, shared by all send channels */
+    ZSTD_CDict *cdict;
+    /* set once training has run, even if it produced no usable dict */
+    bool trained;
+} zstd_dict;
+
+static void zstd_dict_cleanup(void)
+{
+    g_free(zstd_dict.samples);
+    zstd_dict.samples = NULL;
+    g_free(zstd_dict.sample_sizes);
+    zstd_dict.sample_sizes = NULL;
+    zstd_dict.nb_samples = 0;
+    zstd_dict.sample_bytes = 0;
+    g_free(zstd_dict.dict);
+    zstd_dict.dict = NULL;
+    zstd_dict.dict_size = 0;
+    ZSTD_freeCDict(zstd_dict.cdict);
+    zstd_dict.cdict = NULL;
+    zstd_dict.trained = false;
+}
+
+/* Called with zstd_dict.lock held */
+static void zstd_dict_train(void)
+{
+    uint8_t *dict = g_malloc(ZSTD_DICT_MAX_SIZE);
+    size_t ret;
+
+    ret = ZDICT_trainFromBuffer(dict, ZSTD_DICT_MAX_SIZE,
+                                zstd_dict.samples, zstd_dict.sample_sizes,
+                                zstd_dict.nb_samples);
+    if (ZDICT_isError(ret)) {
+        /*
+         * Not enough redundancy across the samples to build a
+         * dictionary, keep compressing without one.
+         */
+        g_free(dict);
+        return;
+    }
+    zstd_dict.cdict = ZSTD_createCDict(dict, ret,
+                                       migrate_multifd_zstd_level());
+    if (!zstd_dict.cdict) {
+        g_free(dict);
+        return;
+    }
+    zstd_dict.dict = dict;
+    zstd_dict.dict_size = ret;
+}
+
+/*
+ * Feed the pages of one packet into the sample buffer, and train the
+ * dictionary once the buffer is full.  Runs in the channel threads.
+ */
+static void zstd_dict_sample(struct iovec *iov, uint32_t used)
+{
+    size_t page_size = qemu_target_page_size();
+    uint32_t i;
+
+    if (qatomic_read(&zstd_dict.trained)) {
+        return;
+    }
+    qemu_mutex_lock(&zstd_dict.lock);
+    if (zstd_dict.trained) {
+        qemu_mutex_unlock(&zstd_dict.lock);
+        return;
+    }
+    for (i = 0; i < used; i++) {
+        if (zstd_dict.sample_bytes + page_size > ZSTD_DICT_SAMPLE_BYTES) {
+            break;
+        }
+        memcpy(zstd_dict.samples + zstd_dict.sample_bytes,
+               iov[i].iov_base, page_size);
+        zstd_dict.sample_sizes[zstd_dict.nb_samples++] = page_size;
+        zstd_dict.sample_bytes += page_size;
+    }
+    if (zstd_dict.sample_bytes + page_size > ZSTD_DICT_SAMPLE_BYTES) {
+        zstd_dict_train();
+        /* the samples are not needed anymore, only the dictionary */
+        g_free(zstd_dict.samples);
+        zstd_dict.samples = NULL;
+        g_free(zstd_dict.sample_sizes);
+        zstd_dict.sample_sizes = NULL;
+        /* publishes @dict and @cdict to the other channel threads */
+        qatomic_store_release(&zstd_dict.trained, true);
+    }
+    qemu_mutex_unlock(&zstd_dict.lock);
+}
+
 /* Multifd zstd compression */
 
 /**
@@ -51,6 +167,14 @@ static int zstd_send_setup(MultiFDSendParams *p, Error **errp)
     struct zstd_data *z = g_new0(struct zstd_data, 1);
     int res;
 
+    if (p->id == 0) {
+        /* drop whatever a previous migration attempt left behind */
+        zstd_dict_cleanup();
+        zstd_dict.samples = g_malloc(ZSTD_DICT_SAMPLE_BYTES);
+        zstd_dict.sample_sizes =
+            g_new(size_t, ZSTD_DICT_SAMPLE_BYTES / qemu_target_page_size());
+    }
+
     p->data = z;
     z->zcs = ZSTD_createCStream();
     if (!z->zcs) {
@@ -97,6 +221,14 @@ static void zstd_send_cleanup(MultiFDSendParams *p, Error **errp)
     z->zbuff = NULL;
     g_free(p->data);
     p->data = NULL;
+    if (p->id == 0) {
+        /*
+         * All channel threads have been joined by the time the
+         * channels are cleaned up, so nobody references the shared
+         * dictionary anymore.
+         */
+        zstd_dict_cleanup();
+    }
 }
 
 /**
@@ -114,9 +246,17 @@ static int zstd_send_prepare(MultiFDSendParams *p, uint32_t used, Error **errp)
 {
     struct iovec *iov = p->pages->iov;
     struct zstd_data *z = p->data;
+    bool attach_dict = false;
     int ret;
     uint32_t i;
 
+    if (!z->dict_active) {
+        zstd_dict_sample(iov, used);
+        if (qatomic_load_acquire(&zstd_dict.trained) && zstd_dict.cdict) {
+            attach_dict = true;
+        }
+    }
+
     z->out.dst = z->zbuff;
     z->out.size = z->zbuff_len;
     z->out.pos = 0;
@@ -154,6 +294,44 @@ static int zstd_send_prepare(MultiFDSendParams *p, uint32_t used, Error **errp)
             return -1;
         }
     }
+
+    if (attach_dict) {
+        /*
+         * Terminate the current frame so that the next one can start
+         * with the trained dictionary, and append the dictionary
+         * itself so that the destination can do the same.
+         */
+        z->in.src = NULL;
+        z->in.size = 0;
+        z->in.pos = 0;
+        do {
+            ret = ZSTD_compressStream2(z->zcs, &z->out, &z->in, ZSTD_e_end);
+        } while (ret > 0 && (z->out.size - z->out.pos > 0));
+        if (ZSTD_isError(ret)) {
+            error_setg(errp, "multifd %d: compressStream error %s",
+                       p->id, ZSTD_getErrorName(ret));
+            return -1;
+        }
+        if (ret > 0 ||
+            z->out.size - z->out.pos < zstd_dict.dict_size + sizeof(uint32_t)) {
+            error_setg(errp, "multifd %d: compressStream buffer too small",
+                       p->id);
+            return -1;
+        }
+        ret = ZSTD_CCtx_refCDict(z->zcs, zstd_dict.cdict);
+        if (ZSTD_isError(ret)) {
+            error_setg(errp, "multifd %d: refCDict error %s",
+                       p->id, ZSTD_getErrorName(ret));
+            return -1;
+        }
+        memcpy(z->zbuff + z->out.pos, zstd_dict.dict, zstd_dict.dict_size);
+        z->out.pos += zstd_dict.dict_size;
+        stl_be_p(z->zbuff + z->out.pos, zstd_dict.dict_size);
+        z->out.pos += sizeof(uint32_t);
+        p->flags |= MULTIFD_FLAG_ZSTD_DICT;
+        z->dict_active = true;
+    }
+
     p->next_packet_size = z->out.pos;
     p->flags |= MULTIFD_FLAG_ZSTD;
 
@@ -239,6 +417,8 @@ static void zstd_recv_cleanup(MultiFDRecvParams *p)
 
     ZSTD_freeDStream(z->zds);
     z->zds = NULL;
+    ZSTD_freeDDict(z->ddict);
+    z->ddict = NULL;
     g_free(z->zbuff);
     z->zbuff = NULL;
     g_free(p->data);
@@ -264,6 +444,7 @@ static int zstd_recv_pages(MultiFDRecvParams *p, uint32_t used, Error **errp)
     uint32_t expected_size = used * qemu_target_page_size();
     uint32_t flags = p->flags & MULTIFD_FLAG_COMPRESSION_MASK;
     struct zstd_data *z = p->data;
+    uint32_t dict_size = 0;
     int ret;
     int i;
 
@@ -278,6 +459,22 @@ static int zstd_recv_pages(MultiFDRecvParams *p, uint32_t used, Error **errp)
         return ret;
     }
 
+    if (p->flags & MULTIFD_FLAG_ZSTD_DICT) {
+        /* the packet ends with the dictionary and its size */
+        if (in_size < sizeof(uint32_t)) {
+            error_setg(errp, "multifd %d: dictionary packet too short %d",
+                       p->id, in_size);
+            return -1;
+        }
+        dict_size = ldl_be_p(z->zbuff + in_size - sizeof(uint32_t));
+        if (!dict_size || dict_size > in_size - sizeof(uint32_t)) {
+            error_setg(errp, "multifd %d: invalid dictionary size %d",
+                       p->id, dict_size);
+            return -1;
+        }
+        in_size -= dict_size + sizeof(uint32_t);
+    }
+
     z->in.src = z->zbuff;
     z->in.size = in_size;
     z->in.pos = 0;
@@ -318,6 +515,46 @@ static int zstd_recv_pages(MultiFDRecvParams *p, uint32_t used, Error **errp)
                    p->id, out_size, expected_size);
         return -1;
     }
+
+    if (p->flags & MULTIFD_FLAG_ZSTD_DICT) {
+        const uint8_t *dict = z->zbuff + in_size;
+
+        /* the source terminated its frame, consume the epilogue */
+        while (ret != 0 && z->in.size - z->in.pos > 0) {
+            ZSTD_outBuffer sink = { NULL, 0, 0 };
+            size_t pos = z->in.pos;
+
+            ret = ZSTD_decompressStream(z->zds, &sink, &z->in);
+            if (ZSTD_isError(ret)) {
+                error_setg(errp, "multifd %d: decompressStream returned %s",
+                           p->id, ZSTD_getErrorName(ret));
+                return -1;
+            }
+            if (z->in.pos == pos) {
+                break;
+            }
+        }
+        if (ret != 0) {
+            error_setg(errp, "multifd %d: unterminated frame before dictionary",
+                       p->id);
+            return -1;
+        }
+        if (z->ddict) {
+            error_setg(errp, "multifd %d: dictionary received twice", p->id);
+            return -1;
+        }
+        z->ddict = ZSTD_createDDict(dict, dict_size);
+        if (!z->ddict) {
+            error_setg(errp, "multifd %d: zstd createDDict failed", p->id);
+            return -1;
+        }
+        ret = ZSTD_DCtx_refDDict(z->zds, z->ddict);
+        if (ZSTD_isError(ret)) {
+            error_setg(errp, "multifd %d: refDDict error %s",
+                       p->id, ZSTD_getErrorName(ret));
+            return -1;
+        }
+    }
     return 0;
 }
 
@@ -333,6 +570,7 @@ static MultiFDMethods multifd_zstd_ops = {
 
 static void multifd_zstd_register(void)
 {
+    qemu_mutex_init(&zstd_dict.lock);
     multifd_register_ops(MULTIFD_COMPRESSION_ZSTD, &multifd_zstd_ops);
 }
 
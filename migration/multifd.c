@@ -11,6 +11,7 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/cutils.h"
 #include "qemu/rcu.h"
 #include "exec/target_page.h"
 #include "sysemu/sysemu.h"
@@ -105,7 +106,8 @@ static int nocomp_send_prepare(MultiFDSendParams *p, uint32_t used,
  */
 static int nocomp_send_write(MultiFDSendParams *p, uint32_t used, Error **errp)
 {
-    return qio_channel_writev_all(p->c, p->pages->iov, used, errp);
+    return qio_channel_writev_full_all(p->c, p->pages->iov, used, NULL, 0,
+                                       p->write_flags, errp);
 }
 
 /**
@@ -263,6 +265,37 @@ static void multifd_pages_clear(MultiFDPages_t *pages)
     g_free(pages);
 }
 
+/**
+ * multifd_send_zero_page_detect: move zero pages out of the page batch
+ *
+ * Scans the pages queued for this channel and strips the ones that
+ * contain only zeroes: their offsets are recorded in p->zero and the
+ * remaining (normal) pages are compacted at the front of p->pages, so
+ * the send methods never see the zero pages at all.  Doing the scan
+ * here moves the buffer_is_zero() cost from the migration thread to
+ * the channel threads.
+ *
+ * @p: Params for the channel that we are using
+ */
+static void multifd_send_zero_page_detect(MultiFDSendParams *p)
+{
+    MultiFDPages_t *pages = p->pages;
+    uint32_t used = 0;
+    int i;
+
+    for (i = 0; i < pages->used; i++) {
+        if (buffer_is_zero(pages->iov[i].iov_base, pages->iov[i].iov_len)) {
+            p->zero[p->zero_num] = pages->offset[i];
+            p->zero_num++;
+            continue;
+        }
+        pages->offset[used] = pages->offset[i];
+        pages->iov[used] = pages->iov[i];
+        used++;
+    }
+    pages->used = used;
+}
+
 static void multifd_send_fill_packet(MultiFDSendParams *p)
 {
     MultiFDPacket_t *packet = p->packet;
@@ -273,6 +306,7 @@ static void multifd_send_fill_packet(MultiFDSendParams *p)
     packet->pages_used = cpu_to_be32(p->pages->used);
     packet->next_packet_size = cpu_to_be32(p->next_packet_size);
     packet->packet_num = cpu_to_be64(p->packet_num);
+    packet->zero_pages = cpu_to_be32(p->zero_num);
 
     if (p->pages->block) {
         strncpy(packet->ramblock, p->pages->block->idstr, 256);
@@ -284,6 +318,11 @@ static void multifd_send_fill_packet(MultiFDSendParams *p)
 
         packet->offset[i] = cpu_to_be64(temp);
     }
+    for (i = 0; i < p->zero_num; i++) {
+        uint64_t temp = p->zero[i];
+
+        packet->offset[p->pages->used + i] = cpu_to_be64(temp);
+    }
 }
 
 static int multifd_recv_unfill_packet(MultiFDRecvParams *p, Error **errp)
@@ -329,6 +368,7 @@ static int multifd_recv_unfill_packet(MultiFDRecvParams *p, Error **errp)
     if (packet->pages_alloc > p->pages->allocated) {
         multifd_pages_clear(p->pages);
         p->pages = multifd_pages_init(packet->pages_alloc);
+        p->zero = g_renew(void *, p->zero, packet->pages_alloc);
     }
 
     p->pages->used = be32_to_cpu(packet->pages_used);
@@ -339,10 +379,18 @@ static int multifd_recv_unfill_packet(MultiFDRecvParams *p, Error **errp)
         return -1;
     }
 
+    p->zero_num = be32_to_cpu(packet->zero_pages);
+    if (p->zero_num > packet->pages_alloc - p->pages->used) {
+        error_setg(errp, "multifd: received packet "
+                   "with %d zero pages and expected maximum zero pages are %d",
+                   p->zero_num, packet->pages_alloc - p->pages->used) ;
+        return -1;
+    }
+
     p->next_packet_size = be32_to_cpu(packet->next_packet_size);
     p->packet_num = be64_to_cpu(packet->packet_num);
 
-    if (p->pages->used == 0) {
+    if (p->pages->used == 0 && p->zero_num == 0) {
         return 0;
     }
 
@@ -368,6 +416,18 @@ static int multifd_recv_unfill_packet(MultiFDRecvParams *p, Error **errp)
         p->pages->iov[i].iov_len = qemu_target_page_size();
     }
 
+    for (i = 0; i < p->zero_num; i++) {
+        uint64_t offset = be64_to_cpu(packet->offset[p->pages->used + i]);
+
+        if (offset > (block->used_length - qemu_target_page_size())) {
+            error_setg(errp, "multifd: zero page offset too long %" PRIu64
+                       " (max " RAM_ADDR_FMT ")",
+                       offset, block->used_length);
+            return -1;
+        }
+        p->zero[i] = block->host + offset;
+    }
+
     return 0;
 }
 
@@ -557,6 +617,8 @@ void multifd_save_cleanup(void)
         p->tls_hostname = NULL;
         multifd_pages_clear(p->pages);
         p->pages = NULL;
+        g_free(p->zero);
+        p->zero = NULL;
         p->packet_len = 0;
         g_free(p->packet);
         p->packet = NULL;
@@ -615,6 +677,19 @@ void multifd_send_sync_main(QEMUFile *f)
 
         trace_multifd_send_sync_main_wait(p->id);
         qemu_sem_wait(&p->sem_sync);
+
+        /*
+         * Pages referenced by in-flight zero copy writes must not be
+         * reused before the kernel confirmed their transmission.
+         */
+        if (p->write_flags & QIO_CHANNEL_WRITE_FLAG_ZERO_COPY) {
+            Error *local_err = NULL;
+
+            if (qio_channel_flush(p->c, &local_err) < 0) {
+                error_report_err(local_err);
+                return;
+            }
+        }
     }
     trace_multifd_send_sync_main(multifd_send_state->packet_num);
 }
@@ -645,10 +720,16 @@ static void *multifd_send_thread(void *opaque)
         qemu_mutex_lock(&p->mutex);
 
         if (p->pending_job) {
-            uint32_t used = p->pages->used;
             uint64_t packet_num = p->packet_num;
+            uint32_t used;
             flags = p->flags;
 
+            p->zero_num = 0;
+            if (migrate_multifd_zero_pages()) {
+                multifd_send_zero_page_detect(p);
+            }
+            used = p->pages->used;
+
             if (used) {
                 ret = multifd_send_state->ops->send_prepare(p, used,
                                                             &local_err);
@@ -656,15 +737,27 @@ static void *multifd_send_thread(void *opaque)
                     qemu_mutex_unlock(&p->mutex);
                     break;
                 }
+                qatomic_add(&ram_counters.multifd_raw_bytes,
+                            (uint64_t)used * qemu_target_page_size());
+                qatomic_add(&ram_counters.multifd_compressed_bytes,
+                            p->next_packet_size);
             }
             multifd_send_fill_packet(p);
             p->flags = 0;
             p->num_packets++;
             p->num_pages += used;
+            p->num_zero_pages += p->zero_num;
             p->pages->used = 0;
             p->pages->block = NULL;
             qemu_mutex_unlock(&p->mutex);
 
+            /*
+             * The zero pages are not transferred; fold them into the
+             * same counter that save_zero_page() uses.  This can race
+             * with the migration thread, hence the atomic update.
+             */
+            qatomic_add(&ram_counters.duplicate, p->zero_num);
+
             trace_multifd_send(p->id, packet_num, used, flags,
                                p->next_packet_size);
 
@@ -801,6 +894,14 @@ static bool multifd_channel_connect(MultiFDSendParams *p,
             *s->parameters.tls_creds &&
             !object_dynamic_cast(OBJECT(ioc),
                                  TYPE_QIO_CHANNEL_TLS)) {
+            if (migrate_use_zero_copy_send()) {
+                /*
+                 * TLS reuses its record buffers before the kernel would
+                 * confirm transmission, so the two cannot be combined.
+                 */
+                error_report("Zero copy send is not compatible with TLS");
+                return false;
+            }
             multifd_tls_channel_connect(p, ioc, &error);
             if (!error) {
                 /*
@@ -893,6 +994,8 @@ int multifd_save_setup(Error **errp)
         p->pending_job = 0;
         p->id = i;
         p->pages = multifd_pages_init(page_count);
+        p->zero = g_new0(ram_addr_t, page_count);
+        p->zero_num = 0;
         p->packet_len = sizeof(MultiFDPacket_t)
                       + sizeof(uint64_t) * page_count;
         p->packet = g_malloc0(p->packet_len);
@@ -900,6 +1003,11 @@ int multifd_save_setup(Error **errp)
         p->packet->version = cpu_to_be32(MULTIFD_VERSION);
         p->name = g_strdup_printf("multifdsend_%d", i);
         p->tls_hostname = g_strdup(s->hostname);
+        if (migrate_use_zero_copy_send()) {
+            p->write_flags = QIO_CHANNEL_WRITE_FLAG_ZERO_COPY;
+        } else {
+            p->write_flags = 0;
+        }
         socket_send_channel_create(multifd_new_send_channel_async, p);
     }
 
@@ -999,6 +1107,8 @@ int multifd_load_cleanup(Error **errp)
         p->name = NULL;
         multifd_pages_clear(p->pages);
         p->pages = NULL;
+        g_free(p->zero);
+        p->zero = NULL;
         p->packet_len = 0;
         g_free(p->packet);
         p->packet = NULL;
@@ -1051,7 +1161,9 @@ static void *multifd_recv_thread(void *opaque)
 
     while (true) {
         uint32_t used;
+        uint32_t zero_num;
         uint32_t flags;
+        int i;
 
         if (p->quit) {
             break;
@@ -1074,6 +1186,7 @@ static void *multifd_recv_thread(void *opaque)
         }
 
         used = p->pages->used;
+        zero_num = p->zero_num;
         flags = p->flags;
         /* recv methods don't know how to handle the SYNC flag */
         p->flags &= ~MULTIFD_FLAG_SYNC;
@@ -1081,6 +1194,7 @@ static void *multifd_recv_thread(void *opaque)
                            p->next_packet_size);
         p->num_packets++;
         p->num_pages += used;
+        p->num_zero_pages += zero_num;
         qemu_mutex_unlock(&p->mutex);
 
         if (used) {
@@ -1090,6 +1204,18 @@ static void *multifd_recv_thread(void *opaque)
             }
         }
 
+        for (i = 0; i < zero_num; i++) {
+            void *page = p->zero[i];
+
+            /*
+             * The page was all zeroes on the source; don't dirty it
+             * here if it is already zero (e.g. freshly allocated).
+             */
+            if (!buffer_is_zero(page, qemu_target_page_size())) {
+                memset(page, 0, qemu_target_page_size());
+            }
+        }
+
         if (flags & MULTIFD_FLAG_SYNC) {
             qemu_sem_post(&multifd_recv_state->sem_sync);
             qemu_sem_wait(&p->sem_sync);
@@ -1134,6 +1260,8 @@ int multifd_load_setup(Error **errp)
         p->quit = false;
         p->id = i;
         p->pages = multifd_pages_init(page_count);
+        p->zero = g_new0(void *, page_count);
+        p->zero_num = 0;
         p->packet_len = sizeof(MultiFDPacket_t)
                       + sizeof(uint64_t) * page_count;
         p->packet = g_malloc0(p->packet_len);
@@ -33,6 +33,9 @@ int multifd_queue_page(QEMUFile *f, RAMBlock *block, ram_addr_t offset);
 #define MULTIFD_FLAG_ZLIB (1 << 1)
 #define MULTIFD_FLAG_ZSTD (2 << 1)
 
+/* this packet carries a trained zstd dictionary after the page data */
+#define MULTIFD_FLAG_ZSTD_DICT (1 << 4)
+
 /* This value needs to be a multiple of qemu_target_page_size() */
 #define MULTIFD_PACKET_SIZE (512 * 1024)
 
@@ -46,7 +49,10 @@ typedef struct {
     /* size of the next packet that contains pages */
     uint32_t next_packet_size;
     uint64_t packet_num;
-    uint64_t unused[4];    /* Reserved for future use */
+    /* zero pages, stored after the normal ones in offset[] */
+    uint32_t zero_pages;
+    uint32_t unused32[1];    /* Reserved for future use */
+    uint64_t unused64[3];    /* Reserved for future use */
     char ramblock[256];
     uint64_t offset[];
 } __attribute__((packed)) MultiFDPacket_t;
@@ -95,15 +101,23 @@ typedef struct {
     MultiFDPacket_t *packet;
     /* multifd flags for each packet */
     uint32_t flags;
+    /* QIO channel write flags used for the page payload */
+    int write_flags;
     /* size of the next packet that contains pages */
     uint32_t next_packet_size;
     /* global number of generated multifd packets */
     uint64_t packet_num;
     /* thread local variables */
+    /* offsets of the zero pages found in the current batch */
+    ram_addr_t *zero;
+    /* number of zero pages in the current batch */
+    uint32_t zero_num;
     /* packets sent through this channel */
     uint64_t num_packets;
     /* pages sent through this channel */
     uint64_t num_pages;
+    /* zero pages sent through this channel */
+    uint64_t num_zero_pages;
     /* syncs main thread and channels */
     QemuSemaphore sem_sync;
     /* used for compression methods */
@@ -139,10 +153,16 @@ typedef struct {
     /* thread local variables */
     /* size of the next packet that contains pages */
     uint32_t next_packet_size;
+    /* host addresses of the zero pages of the current packet */
+    void **zero;
+    /* number of zero pages in the current packet */
+    uint32_t zero_num;
     /* packets sent through this channel */
     uint64_t num_packets;
     /* pages sent through this channel */
     uint64_t num_pages;
+    /* zero pages received through this channel */
+    uint64_t num_zero_pages;
     /* syncs main thread and channels */
     QemuSemaphore sem_sync;
     /* used for de-compression methods */
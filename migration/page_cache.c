@@ -16,32 +16,83 @@
 
 #include "qapi/qmp/qerror.h"
 #include "qapi/error.h"
+#include "qemu/atomic.h"
 #include "qemu/host-utils.h"
+#include "qemu/memusage.h"
 #include "page_cache.h"
 #include "trace.h"
 
 /* the page in cache will not be replaced in two cycles */
 #define CACHED_PAGE_LIFETIME 2
 
+/* each cache set holds this many pages, eviction is CLOCK within a set */
+#define CACHE_NUM_WAYS 4
+
+/* fraction of the configured cache size the cache initially claims */
+#define CACHE_INITIAL_DIVISOR 8
+
+/* only adapt when the last interval saw at least this many lookups */
+#define CACHE_ADAPT_MIN_LOOKUPS 1024
+
+/* grow while fewer than this percentage of lookups hit the cache */
+#define CACHE_ADAPT_HIT_THRESHOLD 50
+
 typedef struct CacheItem CacheItem;
 
 struct CacheItem {
     uint64_t it_addr;
     uint64_t it_age;
     uint8_t *it_data;
+    /* CLOCK reference bit, set on hit, cleared as the hand passes */
+    bool it_ref;
 };
 
 struct PageCache {
     CacheItem *page_cache;
+    /* CLOCK hand of each set */
+    uint8_t *hands;
     size_t page_size;
-    size_t max_num_items;
+    /* number of sets, power of two */
+    size_t num_sets;
     size_t num_items;
+    size_t max_num_items;
+    /* lookups and hits since the last adaptation */
+    uint64_t lookups;
+    uint64_t hits;
 };
 
+/*
+ * Cached page data across all live caches, for query-memory-usage.
+ * Updated with atomics because caches are created and torn down from
+ * the migration thread.
+ */
+static uint64_t page_cache_data_bytes;
+static uint64_t page_cache_limit_bytes;
+
+static void page_cache_mem_usage(MemUsageEmitFn emit, void *emit_opaque,
+                                 void *opaque)
+{
+    emit("migration/page-cache", qatomic_read(&page_cache_data_bytes),
+         MEM_USAGE_UNKNOWN, qatomic_read(&page_cache_limit_bytes),
+         emit_opaque);
+}
+
+static void cache_items_reset(CacheItem *items, size_t num_items)
+{
+    size_t i;
+
+    for (i = 0; i < num_items; i++) {
+        items[i].it_data = NULL;
+        items[i].it_age = 0;
+        items[i].it_addr = -1;
+        items[i].it_ref = false;
+    }
+}
+
 PageCache *cache_init(uint64_t new_size, size_t page_size, Error **errp)
 {
-    int64_t i;
     size_t num_pages = new_size / page_size;
+    size_t num_sets;
     PageCache *cache;
 
     if (new_size < page_size) {
@@ -66,23 +117,44 @@ PageCache *cache_init(uint64_t new_size, size_t page_size, Error **errp)
     cache->page_size = page_size;
     cache->num_items = 0;
     cache->max_num_items = num_pages;
+    cache->lookups = 0;
+    cache->hits = 0;
+
+    /*
+     * Start with a fraction of the configured size and grow towards
+     * it based on the observed hit rate, see cache_adapt().
+     */
+    num_sets = num_pages / CACHE_NUM_WAYS / CACHE_INITIAL_DIVISOR;
+    if (!num_sets) {
+        num_sets = 1;
+    }
+    cache->num_sets = num_sets;
 
     trace_migration_pagecache_init(cache->max_num_items);
 
     /* We prefer not to abort if there is no memory */
-    cache->page_cache = g_try_malloc((cache->max_num_items) *
+    cache->page_cache = g_try_malloc(num_sets * CACHE_NUM_WAYS *
                                      sizeof(*cache->page_cache));
-    if (!cache->page_cache) {
+    cache->hands = g_try_malloc0(num_sets);
+    if (!cache->page_cache || !cache->hands) {
         error_setg(errp, "Failed to allocate page cache");
+        g_free(cache->page_cache);
+        g_free(cache->hands);
         g_free(cache);
         return NULL;
     }
 
-    for (i = 0; i < cache->max_num_items; i++) {
-        cache->page_cache[i].it_data = NULL;
-        cache->page_cache[i].it_age = 0;
-        cache->page_cache[i].it_addr = -1;
+    cache_items_reset(cache->page_cache, num_sets * CACHE_NUM_WAYS);
+
+    {
+        static bool registered;
+
+        if (!qatomic_xchg(&registered, true)) {
+            mem_usage_register(page_cache_mem_usage, NULL);
+        }
     }
+    qatomic_add(&page_cache_limit_bytes,
+                (uint64_t)cache->max_num_items * page_size);
 
     return cache;
 }
@@ -94,49 +166,68 @@ void cache_fini(PageCache *cache)
     g_assert(cache);
     g_assert(cache->page_cache);
 
-    for (i = 0; i < cache->max_num_items; i++) {
+    for (i = 0; i < cache->num_sets * CACHE_NUM_WAYS; i++) {
         g_free(cache->page_cache[i].it_data);
     }
+    qatomic_sub(&page_cache_data_bytes,
+                (uint64_t)cache->num_items * cache->page_size);
+    qatomic_sub(&page_cache_limit_bytes,
+                (uint64_t)cache->max_num_items * cache->page_size);
 
     g_free(cache->page_cache);
     cache->page_cache = NULL;
+    g_free(cache->hands);
+    cache->hands = NULL;
     g_free(cache);
 }
 
 static size_t cache_get_cache_pos(const PageCache *cache,
                                   uint64_t address)
 {
-    g_assert(cache->max_num_items);
-    return (address / cache->page_size) & (cache->max_num_items - 1);
+    g_assert(cache->num_sets);
+    return (address / cache->page_size) & (cache->num_sets - 1);
 }
 
 static CacheItem *cache_get_by_addr(const PageCache *cache, uint64_t addr)
 {
+    CacheItem *set;
     size_t pos;
+    int i;
 
     g_assert(cache);
     g_assert(cache->page_cache);
 
     pos = cache_get_cache_pos(cache, addr);
+    set = &cache->page_cache[pos * CACHE_NUM_WAYS];
 
-    return &cache->page_cache[pos];
+    for (i = 0; i < CACHE_NUM_WAYS; i++) {
+        if (set[i].it_addr == addr) {
+            return &set[i];
+        }
+    }
+    return NULL;
 }
 
 uint8_t *get_cached_data(const PageCache *cache, uint64_t addr)
 {
-    return cache_get_by_addr(cache, addr)->it_data;
+    CacheItem *it = cache_get_by_addr(cache, addr);
+
+    return it ? it->it_data : NULL;
 }
 
-bool cache_is_cached(const PageCache *cache, uint64_t addr,
+bool cache_is_cached(PageCache *cache, uint64_t addr,
                      uint64_t current_age)
 {
     CacheItem *it;
 
     it = cache_get_by_addr(cache, addr);
 
-    if (it->it_addr == addr) {
+    cache->lookups++;
+    if (it) {
         /* update the it_age when the cache hit */
         it->it_age = current_age;
+        it->it_ref = true;
+        cache->hits++;
         return true;
     }
     return false;
@@ -145,16 +236,49 @@ bool cache_is_cached(const PageCache *cache, uint64_t addr,
 int cache_insert(PageCache *cache, uint64_t addr, const uint8_t *pdata,
                  uint64_t current_age)
 {
-
     CacheItem *it;
+    int i;
 
-    /* actual update of entry */
     it = cache_get_by_addr(cache, addr);
 
-    if (it->it_data && it->it_addr != addr &&
-        it->it_age + CACHED_PAGE_LIFETIME > current_age) {
-        /* the cache page is fresh, don't replace it */
-        return -1;
+    if (!it) {
+        size_t pos = cache_get_cache_pos(cache, addr);
+        CacheItem *set = &cache->page_cache[pos * CACHE_NUM_WAYS];
+
+        /* prefer filling an empty way while the memory budget allows */
+        if (cache->num_items < cache->max_num_items) {
+            for (i = 0; i < CACHE_NUM_WAYS; i++) {
+                if (!set[i].it_data) {
+                    it = &set[i];
+                    break;
+                }
+            }
+        }
+        if (!it) {
+            uint8_t *hand = &cache->hands[pos];
+
+            /* CLOCK: evict the first aged way without a reference bit */
+            for (i = 0; i < CACHE_NUM_WAYS * 2; i++) {
+                CacheItem *victim = &set[*hand];
+
+                *hand = (*hand + 1) % CACHE_NUM_WAYS;
+                if (!victim->it_data ||
+                    victim->it_age + CACHED_PAGE_LIFETIME > current_age) {
+                    /* the cache page is fresh, don't replace it */
+                    continue;
+                }
+                if (victim->it_ref) {
+                    victim->it_ref = false;
+                    continue;
+                }
+                it = victim;
+                break;
+            }
+        }
+        if (!it) {
+            /* every way is either fresh or recently referenced */
+            return -1;
+        }
     }
     /* allocate page */
     if (!it->it_data) {
@@ -164,12 +288,99 @@ int cache_insert(PageCache *cache, uint64_t addr, const uint8_t *pdata,
             return -1;
         }
         cache->num_items++;
+        qatomic_add(&page_cache_data_bytes, cache->page_size);
     }
 
     memcpy(it->it_data, pdata, cache->page_size);
 
     it->it_age = current_age;
     it->it_addr = addr;
+    it->it_ref = true;
 
     return 0;
 }
+
+static bool cache_grow(PageCache *cache)
+{
+    size_t new_sets = cache->num_sets * 2;
+    CacheItem *new_cache;
+    uint8_t *new_hands;
+    size_t i;
+
+    if (new_sets * CACHE_NUM_WAYS > cache->max_num_items) {
+        return false;
+    }
+
+    /* We prefer not to abort if there is no memory */
+    new_cache = g_try_malloc(new_sets * CACHE_NUM_WAYS * sizeof(*new_cache));
+    new_hands = g_try_malloc0(new_sets);
+    if (!new_cache || !new_hands) {
+        g_free(new_cache);
+        g_free(new_hands);
+        return false;
+    }
+    cache_items_reset(new_cache, new_sets * CACHE_NUM_WAYS);
+
+    /*
+     * Every old set splits across exactly two new sets, so each page
+     * is guaranteed to find a free way in the bigger table.
+     */
+    for (i = 0; i < cache->num_sets * CACHE_NUM_WAYS; i++) {
+        CacheItem *old = &cache->page_cache[i];
+        CacheItem *set;
+        size_t pos;
+        int j;
+
+        if (!old->it_data) {
+            continue;
+        }
+        pos = (old->it_addr / cache->page_size) & (new_sets - 1);
+        set = &new_cache[pos * CACHE_NUM_WAYS];
+        for (j = 0; j < CACHE_NUM_WAYS; j++) {
+            if (!set[j].it_data) {
+                set[j] = *old;
+                break;
+            }
+        }
+    }
+
+    g_free(cache->page_cache);
+    g_free(cache->hands);
+    cache->page_cache = new_cache;
+    cache->hands = new_hands;
+    cache->num_sets = new_sets;
+
+    trace_migration_pagecache_grow(new_sets * CACHE_NUM_WAYS);
+
+    return true;
+}
+
+bool cache_adapt(PageCache *cache)
+{
+    uint64_t lookups = cache->lookups;
+    uint64_t hits = cache->hits;
+
+    cache->lookups = 0;
+    cache->hits = 0;
+
+    if (lookups < CACHE_ADAPT_MIN_LOOKUPS) {
+        return false;
+    }
+    /*
+     * A low hit rate on a mostly full cache means we are taking
+     * capacity misses; claim more memory, up to the configured cache
+     * size.  A cache that already hits well is big enough, and a
+     * mostly empty one is taking cold misses that more sets won't
+     * avoid.
+     */
+    if (hits * 100 >= lookups * CACHE_ADAPT_HIT_THRESHOLD ||
+        cache->num_items < cache->num_sets * CACHE_NUM_WAYS / 2) {
+        return false;
+    }
+    return cache_grow(cache);
+}
+
+uint64_t cache_current_size(const PageCache *cache)
+{
+    return (uint64_t)cache->num_sets * CACHE_NUM_WAYS * cache->page_size;
+}
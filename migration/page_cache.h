@@ -44,7 +44,7 @@ void cache_fini(PageCache *cache);
  * @addr: page addr
  * @current_age: current bitmap generation
  */
-bool cache_is_cached(const PageCache *cache, uint64_t addr,
+bool cache_is_cached(PageCache *cache, uint64_t addr,
                      uint64_t current_age);
 
 /**
@@ -71,4 +71,24 @@ uint8_t *get_cached_data(const PageCache *cache, uint64_t addr);
 int cache_insert(PageCache *cache, uint64_t addr, const uint8_t *pdata,
                  uint64_t current_age);
 
+/**
+ * cache_adapt: adapt the cache size to the observed hit rate
+ *
+ * Grows the cache towards the configured size when the hit rate since
+ * the last call is too low for a mostly full cache.  Meant to be
+ * called once per dirty bitmap sync.
+ *
+ * Returns %true if the cache has grown
+ *
+ * @cache pointer to the PageCache struct
+ */
+bool cache_adapt(PageCache *cache);
+
+/**
+ * cache_current_size: current cache capacity in bytes
+ *
+ * @cache pointer to the PageCache struct
+ */
+uint64_t cache_current_size(const PageCache *cache);
+
 #endif
@@ -468,6 +468,21 @@ void qemu_put_buffer(QEMUFile *f, const uint8_t *buf, size_t size)
         return;
     }
 
+    /*
+     * A large put would be chopped into IO_BUF_SIZE memcpys through
+     * f->buf.  Reference the caller's memory directly instead, and
+     * flush before returning so that the caller may still reuse the
+     * buffer as soon as we return.  Any staged bytes already sit in
+     * earlier iov entries, so ordering is preserved.
+     */
+    if (size >= IO_BUF_SIZE && qemu_file_is_writable(f)) {
+        f->bytes_xfer += size;
+        if (!add_to_iovec(f, buf, size, false)) {
+            qemu_fflush(f);
+        }
+        return;
+    }
+
     while (size > 0) {
         l = IO_BUF_SIZE - f->buf_index;
         if (l > size) {
@@ -328,6 +328,8 @@ struct RAMState {
     uint64_t xbzrle_bytes_prev;
     /* Start using XBZRLE (e.g., after the first round). */
     bool xbzrle_enabled;
+    /* Send re-dirtied (hot) pages first in the postcopy background stream */
+    bool postcopy_hot_pass;
 
     /* compression statistics since the beginning of the period */
     /* amount of count that no free thread to compress data */
@@ -713,6 +715,7 @@ static int save_xbzrle_page(RAMState *rs, uint8_t **current_data,
      * skipped page included. In this way, the encoding rate can tell if the
      * guest page is good for xbzrle encoding.
      */
+    xbzrle_counters.cache_hit++;
     xbzrle_counters.pages++;
     prev_cached_page = get_cached_data(XBZRLE.cache, current_addr);
 
@@ -766,9 +769,33 @@ static int save_xbzrle_page(RAMState *rs, uint8_t **current_data,
     return 1;
 }
 
+/* Time spent scanning the dirty bitmap, in nanoseconds */
+static uint64_t dirty_scan_time_ns;
+
+/*
+ * Mark the whole bmap summary of @block as possibly dirty.  Used
+ * whenever the dirty bitmap has been (re)filled wholesale.
+ */
+static void migration_bitmap_summary_set_all(RAMBlock *block)
+{
+    if (block->bmap_sum1) {
+        unsigned long words = BITS_TO_LONGS(block->max_length >>
+                                            TARGET_PAGE_BITS);
+
+        bitmap_set(block->bmap_sum1, 0, words);
+        bitmap_set(block->bmap_sum2, 0, BITS_TO_LONGS(words));
+    }
+}
+
 /**
  * migration_bitmap_find_dirty: find the next dirty page from start
  *
+ * Walks the summary levels built over rb->bmap (see ramblock.h)
+ * instead of doing a linear find_next_bit() over the whole bitmap, so
+ * clean ranges of a sparsely dirtied guest are skipped a summary word
+ * at a time.  Summary bits that turn out to cover no dirty pages are
+ * cleared on the way, keeping later scans cheap.
+ *
  * Returns the page offset within memory region of the start of a dirty page
  *
  * @rs: current RAM state
@@ -781,12 +808,72 @@ unsigned long migration_bitmap_find_dirty(RAMState *rs, RAMBlock *rb,
 {
     unsigned long size = rb->used_length >> TARGET_PAGE_BITS;
     unsigned long *bitmap = rb->bmap;
+    unsigned long sum1_size, sum2_size, word, found;
+    int64_t start_ns;
 
     if (ramblock_is_ignored(rb)) {
         return size;
     }
 
-    return find_next_bit(bitmap, size, start);
+    if (!rb->bmap_sum1) {
+        return find_next_bit(bitmap, size, start);
+    }
+
+    start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    found = size;
+    sum1_size = BITS_TO_LONGS(size);
+    sum2_size = BITS_TO_LONGS(sum1_size);
+    word = BIT_WORD(start);
+
+    /* finish the word that contains start */
+    if (start % BITS_PER_LONG) {
+        unsigned long end = MIN(size, (word + 1) * BITS_PER_LONG);
+        unsigned long next = find_next_bit(bitmap, end, start);
+
+        if (next < end) {
+            found = next;
+            goto out;
+        }
+        word++;
+    }
+
+    while (word < sum1_size) {
+        unsigned long sword = find_next_bit(rb->bmap_sum2, sum2_size,
+                                            BIT_WORD(word));
+        unsigned long limit;
+
+        if (sword >= sum2_size) {
+            break;
+        }
+        if (sword != BIT_WORD(word)) {
+            /* skipped clean ranges, restart at the found one */
+            word = sword * BITS_PER_LONG;
+        }
+        if (!rb->bmap_sum1[sword]) {
+            /* the covered range went clean, drop the stale bit */
+            clear_bit(sword, rb->bmap_sum2);
+            word = (sword + 1) * BITS_PER_LONG;
+            continue;
+        }
+        limit = MIN(sum1_size, (sword + 1) * BITS_PER_LONG);
+        word = find_next_bit(rb->bmap_sum1, limit, word);
+        if (word >= limit) {
+            word = (sword + 1) * BITS_PER_LONG;
+            continue;
+        }
+        if (bitmap[word]) {
+            found = find_next_bit(bitmap, size, word * BITS_PER_LONG);
+            break;
+        }
+        /* the word went clean, drop the stale bit */
+        clear_bit(word, rb->bmap_sum1);
+        word++;
+    }
+
+out:
+    dirty_scan_time_ns += qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start_ns;
+    ram_counters.dirty_scan_time = dirty_scan_time_ns / 1000000;
+    return found;
 }
 
 static void migration_clear_memory_region_dirty_bitmap(RAMState *rs,
@@ -926,6 +1013,15 @@ static void migration_update_rates(RAMState *rs, int64_t end_time)
         }
         rs->xbzrle_pages_prev = xbzrle_counters.pages;
         rs->xbzrle_bytes_prev = xbzrle_counters.bytes;
+
+        if (XBZRLE.cache) {
+            /* let the cache claim more memory if misses dominate */
+            XBZRLE_cache_lock();
+            cache_adapt(XBZRLE.cache);
+            xbzrle_counters.current_cache_size =
+                cache_current_size(XBZRLE.cache);
+            XBZRLE_cache_unlock();
+        }
     }
 
     if (migrate_use_compression()) {
@@ -995,6 +1091,17 @@ static void migration_bitmap_sync(RAMState *rs)
     qemu_mutex_lock(&rs->bitmap_mutex);
     WITH_RCU_READ_LOCK_GUARD() {
         RAMBLOCK_FOREACH_NOT_IGNORED(block) {
+            /*
+             * From the second sync on, every dirty bit we pick up is a
+             * page the guest re-dirtied while precopy was running.
+             * Record those as "hot" so the postcopy background stream
+             * can send them first.
+             */
+            if (migrate_postcopy_ram() && !block->hot_bmap &&
+                ram_counters.dirty_sync_count >= 2) {
+                block->hot_bmap = bitmap_new(block->max_length >>
+                                             TARGET_PAGE_BITS);
+            }
             ramblock_sync_dirty_bitmap(rs, block);
         }
         ram_counters.remaining = ram_bytes_remaining();
@@ -1363,12 +1470,21 @@ static bool find_dirty_block(RAMState *rs, PageSearchStatus *pss, bool *again)
     pss->page = migration_bitmap_find_dirty(rs, pss->block, pss->page);
     if (pss->complete_round && pss->block == rs->last_seen_block &&
         pss->page >= rs->last_page) {
-        /*
-         * We've been once around the RAM and haven't found anything.
-         * Give up.
-         */
-        *again = false;
-        return false;
+        if (rs->postcopy_hot_pass) {
+            /*
+             * We've sent every hot page; go around once more for the
+             * cold ones we skipped.
+             */
+            rs->postcopy_hot_pass = false;
+            pss->complete_round = false;
+        } else {
+            /*
+             * We've been once around the RAM and haven't found anything.
+             * Give up.
+             */
+            *again = false;
+            return false;
+        }
     }
     if (!offset_in_ramblock(pss->block,
                             ((ram_addr_t)pss->page) << TARGET_PAGE_BITS)) {
@@ -1400,6 +1516,13 @@ static bool find_dirty_block(RAMState *rs, PageSearchStatus *pss, bool *again)
         *again = true;
         return false;
     } else {
+        if (rs->postcopy_hot_pass && pss->block->hot_bmap &&
+            !test_bit(pss->page, pss->block->hot_bmap)) {
+            /* A cold page: leave it dirty for the second pass */
+            pss->page++;
+            *again = true;
+            return false;
+        }
         /* Can go around again, but... */
         *again = true;
         /* We've found something so probably don't need to */
@@ -1965,6 +2088,18 @@ static bool save_compress_page(RAMState *rs, RAMBlock *block, ram_addr_t offset)
     return false;
 }
 
+/*
+ * Returns true when the zero page scan is offloaded to the multifd
+ * channel threads (see multifd_send_zero_page_detect()), i.e. when the
+ * page is going to be sent through multifd anyway and the
+ * multifd-zero-pages capability is enabled.
+ */
+static bool save_zero_page_offloaded(RAMState *rs)
+{
+    return migrate_use_multifd() && migrate_multifd_zero_pages() &&
+           !save_page_use_compression(rs) && !migration_in_postcopy();
+}
+
 /**
  * ram_save_target_page: save one target page
  *
@@ -1989,18 +2124,20 @@ static int ram_save_target_page(RAMState *rs, PageSearchStatus *pss,
         return 1;
     }
 
-    res = save_zero_page(rs, block, offset);
-    if (res > 0) {
-        /* Must let xbzrle know, otherwise a previous (now 0'd) cached
-         * page would be stale
-         */
-        if (!save_page_use_compression(rs)) {
-            XBZRLE_cache_lock();
-            xbzrle_cache_zero_page(rs, block->offset + offset);
-            XBZRLE_cache_unlock();
+    if (!save_zero_page_offloaded(rs)) {
+        res = save_zero_page(rs, block, offset);
+        if (res > 0) {
+            /* Must let xbzrle know, otherwise a previous (now 0'd) cached
+             * page would be stale
+             */
+            if (!save_page_use_compression(rs)) {
+                XBZRLE_cache_lock();
+                xbzrle_cache_zero_page(rs, block->offset + offset);
+                XBZRLE_cache_unlock();
+            }
+            ram_release_pages(block->idstr, offset, res);
+            return res;
         }
-        ram_release_pages(block->idstr, offset, res);
-        return res;
     }
 
     /*
@@ -2035,6 +2172,29 @@ static int ram_save_target_page(RAMState *rs, PageSearchStatus *pss,
  * @pss: data about the page we want to send
  * @last_stage: if we are at the completion stage
  */
+/*
+ * Returns whether the page at @start falls into a range the RAMBlock's
+ * RamDiscardManager (e.g. virtio-mem) reports as discarded.  Such pages
+ * contain no guest data; sending them, or even running the zero page
+ * scan over them, is wasted work.  A range that gets plugged while
+ * migration runs is dirtied by its first guest write, so skipping here
+ * cannot lose data.
+ */
+static bool ramblock_page_is_discarded(RAMBlock *rb, ram_addr_t start)
+{
+    if (rb->mr && memory_region_has_ram_discard_manager(rb->mr)) {
+        RamDiscardManager *rdm = memory_region_get_ram_discard_manager(rb->mr);
+        MemoryRegionSection section = {
+            .mr = rb->mr,
+            .offset_within_region = start,
+            .size = int128_make64(qemu_ram_pagesize(rb)),
+        };
+
+        return !ram_discard_manager_is_populated(rdm, &section);
+    }
+    return false;
+}
+
 static int ram_save_host_page(RAMState *rs, PageSearchStatus *pss,
                               bool last_stage)
 {
@@ -2054,7 +2214,14 @@ static int ram_save_host_page(RAMState *rs, PageSearchStatus *pss,
     do {
         /* Check the pages is dirty and if it is send it */
         if (migration_bitmap_clear_dirty(rs, pss->block, pss->page)) {
-            tmppages = ram_save_target_page(rs, pss, last_stage);
+            if (ramblock_page_is_discarded(pss->block,
+                                           ((ram_addr_t)pss->page)
+                                               << TARGET_PAGE_BITS)) {
+                /* Discarded pages have no content to send */
+                tmppages = 0;
+            } else {
+                tmppages = ram_save_target_page(rs, pss, last_stage);
+            }
             if (tmppages < 0) {
                 return tmppages;
             }
@@ -2114,8 +2281,11 @@ static int ram_find_and_save_block(RAMState *rs, bool last_stage)
     }
 
     do {
+        bool postcopy_req;
+
         again = true;
         found = get_queued_page(rs, &pss);
+        postcopy_req = found && migration_in_postcopy();
 
         if (!found) {
             /* priority queue empty, so just search for something dirty */
@@ -2124,6 +2294,14 @@ static int ram_find_and_save_block(RAMState *rs, bool last_stage)
 
         if (found) {
             pages = ram_save_host_page(rs, &pss, last_stage);
+            if (pages > 0 && postcopy_req) {
+                /*
+                 * A faulting vCPU is waiting for this page; push it out
+                 * right away instead of letting it sit in the send
+                 * buffer behind background pages.
+                 */
+                qemu_fflush(rs->f);
+            }
         }
     } while (!pages && again);
 
@@ -2226,6 +2404,12 @@ static void ram_save_cleanup(void *opaque)
         block->clear_bmap = NULL;
         g_free(block->bmap);
         block->bmap = NULL;
+        g_free(block->bmap_sum1);
+        block->bmap_sum1 = NULL;
+        g_free(block->bmap_sum2);
+        block->bmap_sum2 = NULL;
+        g_free(block->hot_bmap);
+        block->hot_bmap = NULL;
     }
 
     xbzrle_cleanup();
@@ -2433,6 +2617,7 @@ static void postcopy_chunk_hostpages_pass(MigrationState *ms, RAMBlock *block)
                  * that weren't previously dirty.
                  */
                 rs->migration_dirty_pages += !test_and_set_bit(page, bitmap);
+                ramblock_dirty_summary_set(block, BIT_WORD(page));
             }
         }
 
@@ -2506,6 +2691,11 @@ int ram_postcopy_send_discard_bitmap(MigrationState *ms)
             return ret;
         }
 
+        /* If we have an access-frequency record, send hot pages first */
+        if (block->hot_bmap) {
+            rs->postcopy_hot_pass = true;
+        }
+
 #ifdef DEBUG_POSTCOPY
         ram_debug_dump_bitmap(block->bmap, true,
                               block->used_length >> TARGET_PAGE_BITS);
@@ -2627,11 +2817,24 @@ static int ram_state_init(RAMState **rsp)
      */
     (*rsp)->migration_dirty_pages = ram_bytes_total() >> TARGET_PAGE_BITS;
     ram_state_reset(*rsp);
+    dirty_scan_time_ns = 0;
 
     return 0;
 }
 
-static void ram_list_init_bitmaps(void)
+static int dirty_bitmap_set_populated(MemoryRegionSection *section,
+                                      void *opaque)
+{
+    RAMBlock *rb = section->mr->ram_block;
+    unsigned long start = section->offset_within_region >> TARGET_PAGE_BITS;
+    unsigned long npages = int128_get64(section->size) >> TARGET_PAGE_BITS;
+
+    bitmap_set(rb->bmap, start, npages);
+    *(uint64_t *)opaque += npages;
+    return 0;
+}
+
+static void ram_list_init_bitmaps(RAMState *rs)
 {
     MigrationState *ms = migrate_get_current();
     RAMBlock *block;
@@ -2663,7 +2866,34 @@ static void ram_list_init_bitmaps(void)
              * guest memory.
              */
             block->bmap = bitmap_new(pages);
-            bitmap_set(block->bmap, 0, pages);
+            if (block->mr &&
+                memory_region_has_ram_discard_manager(block->mr)) {
+                RamDiscardManager *rdm =
+                    memory_region_get_ram_discard_manager(block->mr);
+                MemoryRegionSection section = {
+                    .mr = block->mr,
+                    .offset_within_region = 0,
+                    .size = int128_make64(block->used_length),
+                };
+                uint64_t populated = 0;
+
+                /*
+                 * Discarded ranges (e.g. memory unplugged via virtio-mem)
+                 * hold no guest data; mark only the populated parts dirty
+                 * so the first iteration never visits them, and keep the
+                 * dirty page count in sync with the bitmap.
+                 */
+                ram_discard_manager_replay_populated(rdm, &section,
+                                                     dirty_bitmap_set_populated,
+                                                     &populated);
+                rs->migration_dirty_pages -=
+                    (block->used_length >> TARGET_PAGE_BITS) - populated;
+            } else {
+                bitmap_set(block->bmap, 0, pages);
+            }
+            block->bmap_sum1 = bitmap_new(BITS_TO_LONGS(pages));
+            block->bmap_sum2 = bitmap_new(BITS_TO_LONGS(BITS_TO_LONGS(pages)));
+            migration_bitmap_summary_set_all(block);
             block->clear_bmap_shift = shift;
             block->clear_bmap = bitmap_new(clear_bmap_size(pages, shift));
         }
@@ -2677,7 +2907,7 @@ static void ram_init_bitmaps(RAMState *rs)
     qemu_mutex_lock_ramlist();
 
     WITH_RCU_READ_LOCK_GUARD() {
-        ram_list_init_bitmaps();
+        ram_list_init_bitmaps(rs);
         /* We don't use dirty log with background snapshots */
         if (!migrate_background_snapshot()) {
             memory_global_dirty_log_start();
@@ -4114,6 +4344,7 @@ int ram_dirty_bitmap_reload(MigrationState *s, RAMBlock *block)
      * dirty bitmap for this ramblock.
      */
     bitmap_complement(block->bmap, block->bmap, nbits);
+    migration_bitmap_summary_set_all(block);
 
     trace_ram_dirty_bitmap_reload_complete(block->idstr);
 
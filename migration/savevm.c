@@ -248,6 +248,8 @@ typedef struct SaveStateEntry {
     const VMStateDescription *vmsd;
     void *opaque;
     CompatEntry *compat;
+    /* serialized contents sent by the last delta device snapshot (COLO) */
+    GBytes *last_state;
     int is_ram;
 } SaveStateEntry;
 
@@ -833,6 +835,7 @@ void unregister_savevm(VMStateIf *obj, const char *idstr, void *opaque)
         if (strcmp(se->idstr, id) == 0 && se->opaque == opaque) {
             savevm_state_handler_remove(se);
             g_free(se->compat);
+            g_clear_pointer(&se->last_state, g_bytes_unref);
             g_free(se);
         }
     }
@@ -897,6 +900,7 @@ void vmstate_unregister(VMStateIf *obj, const VMStateDescription *vmsd,
         if (se->vmsd == vmsd && se->opaque == opaque) {
             savevm_state_handler_remove(se);
             g_free(se->compat);
+            g_clear_pointer(&se->last_state, g_bytes_unref);
             g_free(se);
         }
     }
@@ -1611,8 +1615,72 @@ void qemu_savevm_live_state(QEMUFile *f)
     qemu_put_byte(f, QEMU_VM_EOF);
 }
 
+/*
+ * Incremental variant of a QEMU_VM_SECTION_FULL section, used for the
+ * periodic COLO checkpoints when the x-colo-device-delta capability is
+ * enabled.  The section is serialized into a scratch buffer first; if
+ * its contents are identical to what the previous checkpoint sent, a
+ * small QEMU_VM_SECTION_DELTA_REF record is emitted instead of the
+ * section itself and the destination replays its cached copy.
+ */
+static int qemu_save_section_delta(QEMUFile *f, SaveStateEntry *se)
+{
+    QIOChannelBuffer *bioc;
+    QEMUFile *scratch;
+    int ret;
+
+    bioc = qio_channel_buffer_new(4096);
+    qio_channel_set_name(QIO_CHANNEL(bioc), "savevm-delta-buffer");
+    scratch = qemu_fopen_channel_output(QIO_CHANNEL(bioc));
+
+    save_section_header(scratch, se, QEMU_VM_SECTION_FULL);
+    ret = vmstate_save(scratch, se, NULL);
+    if (!ret) {
+        save_section_footer(scratch, se);
+        qemu_fflush(scratch);
+        ret = qemu_file_get_error(scratch);
+    }
+    if (ret) {
+        goto out;
+    }
+
+    if (se->last_state &&
+        g_bytes_get_size(se->last_state) == bioc->usage &&
+        !memcmp(g_bytes_get_data(se->last_state, NULL), bioc->data,
+                bioc->usage)) {
+        qemu_put_byte(f, QEMU_VM_SECTION_DELTA_REF);
+        qemu_put_be32(f, se->section_id);
+    } else {
+        g_clear_pointer(&se->last_state, g_bytes_unref);
+        se->last_state = g_bytes_new(bioc->data, bioc->usage);
+        qemu_put_byte(f, QEMU_VM_SECTION_DELTA_FULL);
+        qemu_put_be32(f, se->section_id);
+        qemu_put_be32(f, bioc->usage);
+        qemu_put_buffer(f, bioc->data, bioc->usage);
+    }
+
+out:
+    qemu_fclose(scratch);
+    object_unref(OBJECT(bioc));
+    return ret;
+}
+
+/*
+ * Drop the cached section contents used by delta device snapshots, so
+ * that the next checkpoint session starts from full sections again.
+ */
+void qemu_savevm_delta_reset(void)
+{
+    SaveStateEntry *se;
+
+    QTAILQ_FOREACH(se, &savevm_state.handlers, entry) {
+        g_clear_pointer(&se->last_state, g_bytes_unref);
+    }
+}
+
 int qemu_save_device_state(QEMUFile *f)
 {
+    bool delta = migration_in_colo_state() && migrate_colo_device_delta();
     SaveStateEntry *se;
 
     if (!migration_in_colo_state()) {
@@ -1634,6 +1702,14 @@ int qemu_save_device_state(QEMUFile *f)
             continue;
         }
 
+        if (delta) {
+            ret = qemu_save_section_delta(f, se);
+            if (ret) {
+                return ret;
+            }
+            continue;
+        }
+
         save_section_header(f, se, QEMU_VM_SECTION_FULL);
 
         ret = vmstate_save(f, se, NULL);
@@ -2193,6 +2269,110 @@ static int loadvm_handle_cmd_packaged(MigrationIncomingState *mis)
     return ret;
 }
 
+static int qemu_loadvm_section_start_full(QEMUFile *f,
+                                          MigrationIncomingState *mis);
+
+/*
+ * Device sections cached for delta device snapshots (COLO), keyed by
+ * the section id carried in QEMU_VM_SECTION_DELTA_FULL records.
+ */
+static GHashTable *loadvm_delta_sections;
+
+/* Drop the cached device sections at the end of a checkpoint session */
+void qemu_loadvm_delta_reset(void)
+{
+    g_clear_pointer(&loadvm_delta_sections, g_hash_table_destroy);
+}
+
+/*
+ * Load one QEMU_VM_SECTION_FULL section from a cached byte buffer, the
+ * same way it would have been loaded from the migration stream.
+ */
+static int qemu_loadvm_section_from_bytes(MigrationIncomingState *mis,
+                                          GBytes *bytes)
+{
+    QIOChannelBuffer *bioc;
+    QEMUFile *file;
+    const uint8_t *data;
+    gsize len;
+    int ret;
+
+    data = g_bytes_get_data(bytes, &len);
+    bioc = qio_channel_buffer_new(len);
+    qio_channel_set_name(QIO_CHANNEL(bioc), "loadvm-delta-buffer");
+    memcpy(bioc->data, data, len);
+    bioc->usage = len;
+
+    file = qemu_fopen_channel_input(QIO_CHANNEL(bioc));
+    if (qemu_get_byte(file) != QEMU_VM_SECTION_FULL) {
+        error_report("Corrupted cached device section");
+        ret = -EINVAL;
+    } else {
+        ret = qemu_loadvm_section_start_full(file, mis);
+    }
+    qemu_fclose(file);
+    object_unref(OBJECT(bioc));
+
+    return ret;
+}
+
+/*
+ * Read a full device section sent in delta mode, cache its contents
+ * for later QEMU_VM_SECTION_DELTA_REF records and load it.
+ */
+static int loadvm_handle_delta_full(QEMUFile *f, MigrationIncomingState *mis)
+{
+    uint32_t section_id, len;
+    g_autofree uint8_t *buf = NULL;
+    GBytes *bytes;
+
+    section_id = qemu_get_be32(f);
+    len = qemu_get_be32(f);
+    if (len < 1 || len > MAX_VM_CMD_PACKAGED_SIZE) {
+        error_report("Unreasonably large delta section %u: %u bytes",
+                     section_id, len);
+        return -EINVAL;
+    }
+    buf = g_malloc(len);
+    if (qemu_get_buffer(f, buf, len) != len) {
+        error_report("Failed to read delta section %u", section_id);
+        return -EINVAL;
+    }
+
+    if (!loadvm_delta_sections) {
+        loadvm_delta_sections =
+            g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+                                  (GDestroyNotify)g_bytes_unref);
+    }
+    bytes = g_bytes_new_take(g_steal_pointer(&buf), len);
+    g_hash_table_replace(loadvm_delta_sections,
+                         GUINT_TO_POINTER(section_id), bytes);
+
+    return qemu_loadvm_section_from_bytes(mis, bytes);
+}
+
+/*
+ * The source found a device section unchanged since the previous
+ * checkpoint; replay the cached copy instead.
+ */
+static int loadvm_handle_delta_ref(QEMUFile *f, MigrationIncomingState *mis)
+{
+    uint32_t section_id;
+    GBytes *bytes = NULL;
+
+    section_id = qemu_get_be32(f);
+    if (loadvm_delta_sections) {
+        bytes = g_hash_table_lookup(loadvm_delta_sections,
+                                    GUINT_TO_POINTER(section_id));
+    }
+    if (!bytes) {
+        error_report("Delta reference to unknown section %u", section_id);
+        return -EINVAL;
+    }
+
+    return qemu_loadvm_section_from_bytes(mis, bytes);
+}
+
 /*
  * Handle request that source requests for recved_bitmap on
  * destination. Payload format:
@@ -2635,6 +2815,18 @@ retry:
                 goto out;
             }
             break;
+        case QEMU_VM_SECTION_DELTA_FULL:
+            ret = loadvm_handle_delta_full(f, mis);
+            if (ret < 0) {
+                goto out;
+            }
+            break;
+        case QEMU_VM_SECTION_DELTA_REF:
+            ret = loadvm_handle_delta_ref(f, mis);
+            if (ret < 0) {
+                goto out;
+            }
+            break;
         case QEMU_VM_COMMAND:
             ret = loadvm_process_command(f);
             trace_qemu_loadvm_state_section_command(ret);
@@ -27,6 +27,8 @@
 #define QEMU_VM_VMDESCRIPTION        0x06
 #define QEMU_VM_CONFIGURATION        0x07
 #define QEMU_VM_COMMAND              0x08
+#define QEMU_VM_SECTION_DELTA_FULL   0x09
+#define QEMU_VM_SECTION_DELTA_REF    0x0a
 #define QEMU_VM_SECTION_FOOTER       0x7e
 
 bool qemu_savevm_state_blocked(Error **errp);
@@ -60,6 +62,8 @@ void qemu_savevm_send_postcopy_ram_discard(QEMUFile *f, const char *name,
 void qemu_savevm_send_colo_enable(QEMUFile *f);
 void qemu_savevm_live_state(QEMUFile *f);
 int qemu_save_device_state(QEMUFile *f);
+void qemu_savevm_delta_reset(void);
+void qemu_loadvm_delta_reset(void);
 
 int qemu_loadvm_state(QEMUFile *f);
 void qemu_loadvm_state_cleanup(void);
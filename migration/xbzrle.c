@@ -12,6 +12,7 @@
  */
 #include "qemu/osdep.h"
 #include "qemu/cutils.h"
+#include "qemu/host-utils.h"
 #include "xbzrle.h"
 
 /*
@@ -24,8 +25,8 @@
 
   length = uleb128 encoded integer
  */
-int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
-                         uint8_t *dst, int dlen)
+static int xbzrle_encode_buffer_int(uint8_t *old_buf, uint8_t *new_buf,
+                                    int slen, uint8_t *dst, int dlen)
 {
     uint32_t zrun_len = 0, nzrun_len = 0;
     int d = 0, i = 0;
@@ -126,6 +127,148 @@ int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
     return d;
 }
 
+#ifdef CONFIG_AVX2_OPT
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#include <immintrin.h>
+
+/*
+ * Same encoder, but the zero/non-zero runs are found with 32-byte
+ * vector compares.  After a vector loop stops at a run boundary the
+ * scalar loop below it finishes the run, so the vector loops never
+ * have to deal with the tail of the buffer.
+ */
+static int xbzrle_encode_buffer_avx2(uint8_t *old_buf, uint8_t *new_buf,
+                                     int slen, uint8_t *dst, int dlen)
+{
+    uint32_t zrun_len = 0, nzrun_len = 0;
+    int d = 0, i = 0;
+    uint8_t *nzrun_start = NULL;
+
+    while (i < slen) {
+        /* overflow */
+        if (d + 2 > dlen) {
+            return -1;
+        }
+
+        /* 32 bytes at a time for speed */
+        while (i + 32 <= slen) {
+            __m256i old_data = _mm256_loadu_si256((__m256i *)(old_buf + i));
+            __m256i new_data = _mm256_loadu_si256((__m256i *)(new_buf + i));
+            uint32_t eq = _mm256_movemask_epi8(_mm256_cmpeq_epi8(old_data,
+                                                                 new_data));
+
+            if (eq != UINT32_MAX) {
+                /* the first differing byte ends the zero run */
+                uint32_t bytes = ctz32(~eq);
+
+                i += bytes;
+                zrun_len += bytes;
+                break;
+            }
+            i += 32;
+            zrun_len += 32;
+        }
+
+        /* go over the tail */
+        while (i < slen && old_buf[i] == new_buf[i]) {
+            zrun_len++;
+            i++;
+        }
+
+        /* buffer unchanged */
+        if (zrun_len == slen) {
+            return 0;
+        }
+
+        /* skip last zero run */
+        if (i == slen) {
+            return d;
+        }
+
+        d += uleb128_encode_small(dst + d, zrun_len);
+
+        zrun_len = 0;
+        nzrun_start = new_buf + i;
+
+        /* overflow */
+        if (d + 2 > dlen) {
+            return -1;
+        }
+
+        /* 32 bytes at a time for speed */
+        while (i + 32 <= slen) {
+            __m256i old_data = _mm256_loadu_si256((__m256i *)(old_buf + i));
+            __m256i new_data = _mm256_loadu_si256((__m256i *)(new_buf + i));
+            uint32_t eq = _mm256_movemask_epi8(_mm256_cmpeq_epi8(old_data,
+                                                                 new_data));
+
+            if (eq != 0) {
+                /* the first matching byte ends the non-zero run */
+                uint32_t bytes = ctz32(eq);
+
+                i += bytes;
+                nzrun_len += bytes;
+                break;
+            }
+            i += 32;
+            nzrun_len += 32;
+        }
+
+        /* go over the tail */
+        while (i < slen && old_buf[i] != new_buf[i]) {
+            i++;
+            nzrun_len++;
+        }
+
+        d += uleb128_encode_small(dst + d, nzrun_len);
+        /* overflow */
+        if (d + nzrun_len > dlen) {
+            return -1;
+        }
+        memcpy(dst + d, nzrun_start, nzrun_len);
+        d += nzrun_len;
+        nzrun_len = 0;
+    }
+
+    return d;
+}
+#pragma GCC pop_options
+#endif /* CONFIG_AVX2_OPT */
+
+static int (*xbzrle_encode_func)(uint8_t *, uint8_t *, int, uint8_t *, int)
+    = xbzrle_encode_buffer_int;
+
+#ifdef CONFIG_AVX2_OPT
+#include "qemu/cpuid.h"
+
+static void __attribute__((constructor)) init_xbzrle_encode_func(void)
+{
+    int max = __get_cpuid_max(0, NULL);
+    int a, b, c, d;
+
+    if (max >= 7) {
+        __cpuid(1, a, b, c, d);
+        /* We must check that AVX is not just available, but usable.  */
+        if ((c & bit_OSXSAVE) && (c & bit_AVX)) {
+            int bv;
+
+            __asm("xgetbv" : "=a"(bv), "=d"(d) : "c"(0));
+            __cpuid_count(7, 0, a, b, c, d);
+            if ((bv & 0x6) == 0x6 && (b & bit_AVX2)) {
+                xbzrle_encode_func = xbzrle_encode_buffer_avx2;
+            }
+        }
+    }
+}
+#endif /* CONFIG_AVX2_OPT */
+
+int xbzrle_encode_buffer(uint8_t *old_buf, uint8_t *new_buf, int slen,
+                         uint8_t *dst, int dlen)
+{
+    return xbzrle_encode_func(old_buf, new_buf, slen, dst, dlen);
+}
+
 int xbzrle_decode_buffer(uint8_t *src, int slen, uint8_t *dst, int dlen)
 {
     int i = 0, d = 0;
@@ -15,6 +15,18 @@
 #include "io/channel-socket.h"
 #include "io/channel-tls.h"
 #include "qemu-file.h"
+#include "ram.h"
+
+uint64_t migration_yank_progress(void *opaque)
+{
+    /*
+     * RAM transfer dominates a live migration; anything that moves the
+     * connection forward also moves this counter. It is updated without
+     * locking by the migration thread and read racily here, which is
+     * fine: the watchdog only looks for changes.
+     */
+    return ram_counters.transferred;
+}
 
 void migration_yank_iochannel(void *opaque)
 {
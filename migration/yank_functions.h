@@ -15,6 +15,16 @@
  * @opaque: QIOChannel to shutdown
  */
 void migration_yank_iochannel(void *opaque);
+
+/**
+ * migration_yank_progress: progress function for the migration instance
+ *
+ * Returns the number of RAM bytes transferred, for use with
+ * yank_register_progress().
+ *
+ * @opaque: ignored
+ */
+uint64_t migration_yank_progress(void *opaque);
 void migration_ioc_register_yank(QIOChannel *ioc);
 void migration_ioc_unregister_yank(QIOChannel *ioc);
 void migration_ioc_unregister_yank_from_file(QEMUFile *file);
@@ -278,12 +278,19 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
                        info->ram->normal_bytes >> 10);
         monitor_printf(mon, "dirty sync count: %" PRIu64 "\n",
                        info->ram->dirty_sync_count);
+        monitor_printf(mon, "dirty scan time: %" PRIu64 " milliseconds\n",
+                       info->ram->dirty_scan_time);
         monitor_printf(mon, "page size: %" PRIu64 " kbytes\n",
                        info->ram->page_size >> 10);
         monitor_printf(mon, "multifd bytes: %" PRIu64 " kbytes\n",
                        info->ram->multifd_bytes >> 10);
         monitor_printf(mon, "pages-per-second: %" PRIu64 "\n",
                        info->ram->pages_per_second);
+        if (info->ram->multifd_compressed_bytes) {
+            monitor_printf(mon, "multifd compression ratio: %0.2f\n",
+                           (double)info->ram->multifd_raw_bytes /
+                           info->ram->multifd_compressed_bytes);
+        }
 
         if (info->ram->dirty_pages_rate) {
             monitor_printf(mon, "dirty pages rate: %" PRIu64 " pages\n",
@@ -307,10 +314,14 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
     if (info->has_xbzrle_cache) {
         monitor_printf(mon, "cache size: %" PRIu64 " bytes\n",
                        info->xbzrle_cache->cache_size);
+        monitor_printf(mon, "current cache size: %" PRIu64 " bytes\n",
+                       info->xbzrle_cache->current_cache_size);
         monitor_printf(mon, "xbzrle transferred: %" PRIu64 " kbytes\n",
                        info->xbzrle_cache->bytes >> 10);
         monitor_printf(mon, "xbzrle pages: %" PRIu64 " pages\n",
                        info->xbzrle_cache->pages);
+        monitor_printf(mon, "xbzrle cache hit: %" PRIu64 " pages\n",
+                       info->xbzrle_cache->cache_hit);
         monitor_printf(mon, "xbzrle cache miss: %" PRIu64 " pages\n",
                        info->xbzrle_cache->cache_miss);
         monitor_printf(mon, "xbzrle cache miss rate: %0.2f\n",
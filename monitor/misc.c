@@ -183,7 +183,8 @@ static void hmp_trace_event(Monitor *mon, const QDict *qdict)
         return;
     }
 
-    qmp_trace_event_set_state(tp_name, new_state, true, true, has_vcpu, vcpu, &local_err);
+    qmp_trace_event_set_state(tp_name, new_state, true, true, has_vcpu, vcpu,
+                              false, 0, &local_err);
     if (local_err) {
         error_report_err(local_err);
     }
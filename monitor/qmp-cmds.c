@@ -15,18 +15,23 @@
 
 #include "qemu/osdep.h"
 #include "qemu-common.h"
+#include "qemu/coroutine.h"
 #include "qemu/cutils.h"
+#include "qemu/rcu.h"
+#include "qemu/thread.h"
 #include "qemu/option.h"
 #include "monitor/monitor.h"
 #include "sysemu/sysemu.h"
 #include "qemu/config-file.h"
 #include "qemu/uuid.h"
+#include "qemu/memusage.h"
 #include "chardev/char.h"
 #include "ui/qemu-spice.h"
 #include "ui/console.h"
 #include "sysemu/kvm.h"
 #include "sysemu/runstate.h"
 #include "sysemu/runstate-action.h"
+#include "sysemu/iothread.h"
 #include "sysemu/arch_init.h"
 #include "sysemu/blockdev.h"
 #include "sysemu/block-backend.h"
@@ -335,6 +340,151 @@ MemoryInfo *qmp_query_memory_size_summary(Error **errp)
     return mem_info;
 }
 
+RcuCallbackInfo *qmp_x_query_rcu(Error **errp)
+{
+    RcuCallbackInfo *info = g_malloc0(sizeof(*info));
+
+    rcu_call_stats(&info->pending, &info->completed);
+
+    return info;
+}
+
+CoroutinePoolInfo *qmp_x_query_coroutine_pool(Error **errp)
+{
+    CoroutinePoolInfo *info = g_malloc0(sizeof(*info));
+
+    qemu_coroutine_pool_stats(&info->hits, &info->misses);
+
+    return info;
+}
+
+static void sync_profile_add_entry(const void *obj, unsigned int n_objs,
+                                   const char *typename,
+                                   const char *callsite_at,
+                                   uint64_t wait_time_ns, uint64_t n_acqs,
+                                   void *opaque)
+{
+    SyncProfileEntryList ***tailp = opaque;
+    SyncProfileEntry *entry = g_malloc0(sizeof(*entry));
+
+    entry->type = g_strdup(typename);
+    if (n_objs == 1) {
+        entry->has_object = true;
+        entry->object = g_strdup_printf("%p", obj);
+    }
+    entry->call_site = g_strdup(callsite_at);
+    entry->wait_time_ns = wait_time_ns;
+    entry->count = n_acqs;
+    entry->num_objects = n_objs;
+    QAPI_LIST_APPEND(*tailp, entry);
+}
+
+SyncProfileEntryList *qmp_x_query_sync_profile(bool has_max, int64_t max,
+                                               bool has_coalesce,
+                                               bool coalesce, Error **errp)
+{
+    SyncProfileEntryList *head = NULL;
+    SyncProfileEntryList **tail = &head;
+
+    if (!has_max) {
+        max = 10;
+    }
+    if (max < 1) {
+        error_setg(errp, "max must be a positive integer");
+        return NULL;
+    }
+
+    qsp_iterate(max, QSP_SORT_BY_TOTAL_WAIT_TIME,
+                has_coalesce ? coalesce : true,
+                sync_profile_add_entry, &tail);
+    return head;
+}
+
+static AioContextStats *lock_stats_aio_context(const char *id,
+                                               AioContext *ctx)
+{
+    AioContextStats *stats = g_new0(AioContextStats, 1);
+
+    stats->id = g_strdup(id);
+    stats->poll_ns = ctx->poll_ns;
+    stats->poll_max_ns = ctx->poll_max_ns;
+    stats->poll_success = ctx->stat_poll_success;
+    stats->poll_fail = ctx->stat_poll_fail;
+    stats->poll_grow_events = ctx->stat_poll_grow;
+    stats->poll_shrink_events = ctx->stat_poll_shrink;
+    stats->handler_dispatches = ctx->stat_dispatched_handlers;
+    return stats;
+}
+
+static int lock_stats_query_iothread(Object *object, void *opaque)
+{
+    AioContextStatsList ***tailp = opaque;
+    IOThread *iothread;
+
+    iothread = (IOThread *)object_dynamic_cast(object, TYPE_IOTHREAD);
+    if (iothread) {
+        g_autofree char *id = iothread_get_id(iothread);
+
+        QAPI_LIST_APPEND(*tailp,
+                         lock_stats_aio_context(id,
+                             iothread_get_aio_context(iothread)));
+    }
+    return 0;
+}
+
+LockStatsInfo *qmp_query_lock_stats(Error **errp)
+{
+    LockStatsInfo *info = g_new0(LockStatsInfo, 1);
+    SyncProfileEntryList **sp_tail = &info->sync_profile;
+    AioContextStatsList **aio_tail = &info->aio_contexts;
+
+    info->sync_profile_enabled = qsp_is_enabled();
+    /*
+     * qsp_iterate() preallocates the report array, so pass a cap that
+     * is comfortably above the number of profiled call sites instead
+     * of SIZE_MAX.
+     */
+    qsp_iterate(1000, QSP_SORT_BY_TOTAL_WAIT_TIME, true,
+                sync_profile_add_entry, &sp_tail);
+
+    QAPI_LIST_APPEND(aio_tail,
+                     lock_stats_aio_context("main", qemu_get_aio_context()));
+    object_child_foreach(object_get_objects_root(),
+                         lock_stats_query_iothread, &aio_tail);
+
+    return info;
+}
+
+static void memory_usage_emit(const char *name, uint64_t bytes,
+                              int64_t peak_bytes, int64_t limit_bytes,
+                              void *emit_opaque)
+{
+    MemoryConsumerInfoList ***tailp = emit_opaque;
+    MemoryConsumerInfo *info = g_new0(MemoryConsumerInfo, 1);
+
+    info->name = g_strdup(name);
+    info->bytes = bytes;
+    if (peak_bytes >= 0) {
+        info->has_peak_bytes = true;
+        info->peak_bytes = peak_bytes;
+    }
+    if (limit_bytes >= 0) {
+        info->has_limit_bytes = true;
+        info->limit_bytes = limit_bytes;
+    }
+    QAPI_LIST_APPEND(*tailp, info);
+}
+
+MemoryConsumerInfoList *qmp_query_memory_usage(Error **errp)
+{
+    MemoryConsumerInfoList *head = NULL;
+    MemoryConsumerInfoList **tail = &head;
+
+    mem_usage_query(memory_usage_emit, &tail);
+
+    return head;
+}
+
 void qmp_display_reload(DisplayReloadOptions *arg, Error **errp)
 {
     switch (arg->type) {
@@ -1345,10 +1345,8 @@ int nbd_disconnect(int fd)
 
 #endif /* __linux__ */
 
-int nbd_send_request(QIOChannel *ioc, NBDRequest *request)
+static void nbd_setup_request(uint8_t *buf, const NBDRequest *request)
 {
-    uint8_t buf[NBD_REQUEST_SIZE];
-
     trace_nbd_send_request(request->from, request->len, request->handle,
                            request->flags, request->type,
                            nbd_cmd_lookup(request->type));
@@ -1359,10 +1357,39 @@ int nbd_send_request(QIOChannel *ioc, NBDRequest *request)
     stq_be_p(buf + 8, request->handle);
     stq_be_p(buf + 16, request->from);
     stl_be_p(buf + 24, request->len);
+}
+
+int nbd_send_request(QIOChannel *ioc, NBDRequest *request)
+{
+    uint8_t buf[NBD_REQUEST_SIZE];
+
+    nbd_setup_request(buf, request);
 
     return nbd_write(ioc, buf, sizeof(buf), NULL);
 }
 
+/* nbd_send_request_with_payload
+ * Send a request header followed by a payload in a single writev, so that
+ * the two do not end up in separate TCP segments.
+ */
+int nbd_send_request_with_payload(QIOChannel *ioc, NBDRequest *request,
+                                  struct iovec *payload, unsigned int niov)
+{
+    uint8_t buf[NBD_REQUEST_SIZE];
+    g_autofree struct iovec *iov = g_new(struct iovec, niov + 1);
+    unsigned int i;
+
+    nbd_setup_request(buf, request);
+
+    iov[0].iov_base = buf;
+    iov[0].iov_len = sizeof(buf);
+    for (i = 0; i < niov; i++) {
+        iov[i + 1] = payload[i];
+    }
+
+    return qio_channel_writev_all(ioc, iov, niov + 1, NULL) < 0 ? -EIO : 0;
+}
+
 /* nbd_receive_simple_reply
  * Read simple reply except magic field (which should be already read).
  * Payload is not read (payload is possible for CMD_READ, but here we even
@@ -80,9 +80,13 @@ struct NBDRequestData {
     QSIMPLEQ_ENTRY(NBDRequestData) entry;
     NBDClient *client;
     uint8_t *data;
+    uint32_t data_size; /* allocated size of @data, may exceed request len */
     bool complete;
 };
 
+/* Largest released data buffer that is kept for reuse rather than freed */
+#define NBD_RECYCLED_BUFFER_MAX (1024 * 1024)
+
 struct NBDExport {
     BlockExport common;
 
@@ -141,6 +145,13 @@ struct NBDClient {
 
     uint32_t check_align; /* If non-zero, check for aligned client requests */
 
+    /* A released request buffer kept around for the next request, so that
+     * a stream of similarly-sized reads and writes does not allocate and
+     * free a buffer per request.
+     */
+    uint8_t *recycled_data;
+    uint32_t recycled_size;
+
     bool structured_reply;
     NBDExportMetaContexts export_meta;
 
@@ -1467,6 +1478,7 @@ void nbd_client_put(NBDClient *client)
             blk_exp_unref(&client->exp->common);
         }
         g_free(client->export_meta.bitmaps);
+        qemu_vfree(client->recycled_data);
         g_free(client);
     }
 }
@@ -1509,7 +1521,13 @@ static void nbd_request_put(NBDRequestData *req)
     NBDClient *client = req->client;
 
     if (req->data) {
-        qemu_vfree(req->data);
+        if (!client->recycled_data && req->data_size > 0 &&
+            req->data_size <= NBD_RECYCLED_BUFFER_MAX) {
+            client->recycled_data = req->data;
+            client->recycled_size = req->data_size;
+        } else {
+            qemu_vfree(req->data);
+        }
     }
     g_free(req);
 
@@ -1693,6 +1711,13 @@ static int nbd_export_create(BlockExport *blk_exp, BlockExportOptions *exp_args,
     } else {
         exp->nbdflags |= (NBD_FLAG_SEND_TRIM | NBD_FLAG_SEND_WRITE_ZEROES |
                           NBD_FLAG_SEND_FAST_ZERO);
+        /* All connections share one BlockBackend, so a flush on any
+         * connection is visible on the others, which is what advertising
+         * multi-conn for a writable export promises.
+         */
+        if (arg->has_multi_conn && arg->multi_conn) {
+            exp->nbdflags |= NBD_FLAG_CAN_MULTI_CONN;
+        }
     }
     exp->size = QEMU_ALIGN_DOWN(size, BDRV_SECTOR_SIZE);
 
@@ -1978,6 +2003,10 @@ static int coroutine_fn nbd_co_send_sparse_read(NBDClient *client,
     NBDExport *exp = client->exp;
     size_t progress = 0;
 
+    /* Hold back the partial chunks so that a fragmented reply leaves in as
+     * few TCP segments as possible; the final uncork flushes them.
+     */
+    qio_channel_set_cork(client->ioc, true);
     while (progress < size) {
         int64_t pnum;
         int status = bdrv_block_status_above(blk_bs(exp->common.blk), NULL,
@@ -1993,7 +2022,7 @@ static int coroutine_fn nbd_co_send_sparse_read(NBDClient *client,
             ret = nbd_co_send_structured_error(client, handle, -status, msg,
                                                errp);
             g_free(msg);
-            return ret;
+            break;
         }
         assert(pnum && pnum <= size - progress);
         final = progress + pnum == size;
@@ -2028,6 +2057,7 @@ static int coroutine_fn nbd_co_send_sparse_read(NBDClient *client,
         }
         progress += pnum;
     }
+    qio_channel_set_cork(client->ioc, false);
     return ret;
 }
 
@@ -2307,11 +2337,20 @@ static int nbd_co_receive_request(NBDRequestData *req, NBDRequest *request,
         }
 
         if (request->type != NBD_CMD_CACHE) {
-            req->data = blk_try_blockalign(client->exp->common.blk,
-                                           request->len);
-            if (req->data == NULL) {
-                error_setg(errp, "No memory");
-                return -ENOMEM;
+            if (client->recycled_data &&
+                client->recycled_size >= request->len) {
+                req->data = client->recycled_data;
+                req->data_size = client->recycled_size;
+                client->recycled_data = NULL;
+                client->recycled_size = 0;
+            } else {
+                req->data = blk_try_blockalign(client->exp->common.blk,
+                                               request->len);
+                if (req->data == NULL) {
+                    error_setg(errp, "No memory");
+                    return -ENOMEM;
+                }
+                req->data_size = request->len;
             }
         }
     }
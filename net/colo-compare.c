@@ -19,6 +19,7 @@
 #include "qapi/error.h"
 #include "net/net.h"
 #include "net/eth.h"
+#include "net/checksum.h"
 #include "qom/object_interfaces.h"
 #include "qemu/iov.h"
 #include "qom/object.h"
@@ -344,6 +345,30 @@ static int colo_compare_packet_payload(Packet *ppkt,
     return memcmp(ppkt->data + poffset, spkt->data + soffset, len);
 }
 
+/*
+ * Cheap prefilter for the secondary-list search of the non-TCP
+ * protocols: compare cached payload checksums before paying for a full
+ * memcmp.  Most candidates in the scan do not match, and the checksum
+ * of a queued packet is computed once and reused for every comparison
+ * against it.  Equal checksums still need the memcmp to confirm.
+ */
+static bool colo_compare_packet_payload_may_match(Packet *ppkt, Packet *spkt,
+                                                  uint16_t offset)
+{
+    if (ppkt->payload_csum_offset != offset) {
+        ppkt->payload_csum = net_checksum_add_cont(ppkt->size - offset,
+                                                   ppkt->data + offset, 0);
+        ppkt->payload_csum_offset = offset;
+    }
+    if (spkt->payload_csum_offset != offset) {
+        spkt->payload_csum = net_checksum_add_cont(spkt->size - offset,
+                                                   spkt->data + offset, 0);
+        spkt->payload_csum_offset = offset;
+    }
+
+    return ppkt->payload_csum == spkt->payload_csum;
+}
+
 /*
  * return true means that the payload is consist and
  * need to make the next comparison, false means do
@@ -526,6 +551,9 @@ static int colo_packet_compare_udp(Packet *spkt, Packet *ppkt)
         trace_colo_compare_main("UDP: payload size of packets are different");
         return -1;
     }
+    if (!colo_compare_packet_payload_may_match(ppkt, spkt, offset)) {
+        return -1;
+    }
     if (colo_compare_packet_payload(ppkt, spkt, offset, offset,
                                     ppkt->size - offset)) {
         trace_colo_compare_udp_miscompare("primary pkt size", ppkt->size);
@@ -565,6 +593,9 @@ static int colo_packet_compare_icmp(Packet *spkt, Packet *ppkt)
         trace_colo_compare_main("ICMP: payload size of packets are different");
         return -1;
     }
+    if (!colo_compare_packet_payload_may_match(ppkt, spkt, offset)) {
+        return -1;
+    }
     if (colo_compare_packet_payload(ppkt, spkt, offset, offset,
                                     ppkt->size - offset)) {
         trace_colo_compare_icmp_miscompare("primary pkt size",
@@ -594,6 +625,9 @@ static int colo_packet_compare_other(Packet *spkt, Packet *ppkt)
         trace_colo_compare_main("Other: payload size of packets are different");
         return -1;
     }
+    if (!colo_compare_packet_payload_may_match(ppkt, spkt, offset)) {
+        return -1;
+    }
     return colo_compare_packet_payload(ppkt, spkt, offset, offset,
                                        ppkt->size - offset);
 }
@@ -163,6 +163,7 @@ Packet *packet_new(const void *data, int size, int vnet_hdr_len)
     pkt->size = size;
     pkt->creation_ms = qemu_clock_get_ms(QEMU_CLOCK_HOST);
     pkt->vnet_hdr_len = vnet_hdr_len;
+    pkt->payload_csum_offset = -1;
 
     return pkt;
 }
@@ -179,6 +180,7 @@ Packet *packet_new_nocopy(void *data, int size, int vnet_hdr_len)
     pkt->size = size;
     pkt->creation_ms = qemu_clock_get_ms(QEMU_CLOCK_HOST);
     pkt->vnet_hdr_len = vnet_hdr_len;
+    pkt->payload_csum_offset = -1;
 
     return pkt;
 }
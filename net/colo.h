@@ -54,6 +54,10 @@ typedef struct Packet {
     /* record the payload offset(the length that has been compared) */
     uint16_t offset;
     uint8_t flags; /* Flags(aka Control bits) */
+    /* cached payload checksum used by colo-compare as a miscompare
+     * prefilter; valid when payload_csum_offset >= 0 */
+    uint32_t payload_csum;
+    int32_t payload_csum_offset;
 } Packet;
 
 typedef struct ConnectionKey {
@@ -40,6 +40,9 @@ struct MirrorState {
     CharBackend chr_out;
     SocketReadState rs;
     bool vnet_hdr;
+    /* staging buffer for outgoing frames, grown on demand and reused */
+    uint8_t *send_buf;
+    size_t send_buf_size;
 };
 
 static int filter_send(MirrorState *s,
@@ -49,19 +52,29 @@ static int filter_send(MirrorState *s,
     NetFilterState *nf = NETFILTER(s);
     int ret = 0;
     ssize_t size = 0;
+    size_t hdr_len = 0;
     uint32_t len = 0;
-    char *buf;
+    uint8_t *buf;
 
     size = iov_size(iov, iovcnt);
     if (!size) {
         return 0;
     }
 
-    len = htonl(size);
-    ret = qemu_chr_fe_write_all(&s->chr_out, (uint8_t *)&len, sizeof(len));
-    if (ret != sizeof(len)) {
-        goto err;
+    /*
+     * Stage the length header(s) and the packet in one reusable buffer
+     * so that each mirrored packet costs a single chardev write and no
+     * per-packet allocation.
+     */
+    hdr_len = s->vnet_hdr ? 2 * sizeof(len) : sizeof(len);
+    if (hdr_len + size > s->send_buf_size) {
+        s->send_buf_size = hdr_len + size;
+        s->send_buf = g_realloc(s->send_buf, s->send_buf_size);
     }
+    buf = s->send_buf;
+
+    len = htonl(size);
+    memcpy(buf, &len, sizeof(len));
 
     if (s->vnet_hdr) {
         /*
@@ -74,17 +87,12 @@ static int filter_send(MirrorState *s,
         vnet_hdr_len = nf->netdev->vnet_hdr_len;
 
         len = htonl(vnet_hdr_len);
-        ret = qemu_chr_fe_write_all(&s->chr_out, (uint8_t *)&len, sizeof(len));
-        if (ret != sizeof(len)) {
-            goto err;
-        }
+        memcpy(buf + sizeof(len), &len, sizeof(len));
     }
 
-    buf = g_malloc(size);
-    iov_to_buf(iov, iovcnt, 0, buf, size);
-    ret = qemu_chr_fe_write_all(&s->chr_out, (uint8_t *)buf, size);
-    g_free(buf);
-    if (ret != size) {
+    iov_to_buf(iov, iovcnt, 0, buf + hdr_len, size);
+    ret = qemu_chr_fe_write_all(&s->chr_out, buf, hdr_len + size);
+    if (ret != (ssize_t)(hdr_len + size)) {
         goto err;
     }
 
@@ -421,6 +429,7 @@ static void filter_mirror_fini(Object *obj)
     MirrorState *s = FILTER_MIRROR(obj);
 
     g_free(s->outdev);
+    g_free(s->send_buf);
 }
 
 static void filter_redirector_fini(Object *obj)
@@ -429,6 +438,7 @@ static void filter_redirector_fini(Object *obj)
 
     g_free(s->indev);
     g_free(s->outdev);
+    g_free(s->send_buf);
 }
 
 static const TypeInfo filter_redirector_info = {
@@ -37,6 +37,7 @@
 #include "hub.h"
 #include "monitor/monitor.h"
 #include "qemu/error-report.h"
+#include "qemu/iov.h"
 #include "qemu/sockets.h"
 #include <libslirp.h>
 #include "chardev/char-fe.h"
@@ -95,6 +96,7 @@ typedef struct SlirpState {
     gchar *smb_dir;
 #endif
     GSList *fwd;
+    uint8_t *rx_buf; /* linearization buffer for net_slirp_receive_iov() */
 } SlirpState;
 
 static struct slirp_config_str *slirp_configs;
@@ -138,6 +140,32 @@ static ssize_t net_slirp_receive(NetClientState *nc, const uint8_t *buf, size_t
     return size;
 }
 
+static ssize_t net_slirp_receive_iov(NetClientState *nc,
+                                     const struct iovec *iov, int iovcnt)
+{
+    SlirpState *s = DO_UPCAST(SlirpState, nc, nc);
+    size_t size = iov_size(iov, iovcnt);
+
+    if (iovcnt == 1) {
+        slirp_input(s->slirp, iov[0].iov_base, size);
+        return size;
+    }
+
+    /* Linearize into a buffer that is reused for every packet, rather
+     * than going through the per-packet allocation in nc_sendv_compat().
+     */
+    if (size > NET_BUFSIZE) {
+        return size; /* drop */
+    }
+    if (!s->rx_buf) {
+        s->rx_buf = g_malloc(NET_BUFSIZE);
+    }
+    iov_to_buf(iov, iovcnt, 0, s->rx_buf, size);
+    slirp_input(s->slirp, s->rx_buf, size);
+
+    return size;
+}
+
 static void slirp_smb_exit(Notifier *n, void *data)
 {
     SlirpState *s = container_of(n, SlirpState, exit_notifier);
@@ -157,6 +185,7 @@ static void net_slirp_cleanup(NetClientState *nc)
     SlirpState *s = DO_UPCAST(SlirpState, nc, nc);
 
     g_slist_free_full(s->fwd, slirp_free_fwd);
+    g_free(s->rx_buf);
     main_loop_poll_remove_notifier(&s->poll_notifier);
     unregister_savevm(NULL, "slirp", s->slirp);
     slirp_cleanup(s->slirp);
@@ -171,6 +200,7 @@ static NetClientInfo net_slirp_info = {
     .type = NET_CLIENT_DRIVER_USER,
     .size = sizeof(SlirpState),
     .receive = net_slirp_receive,
+    .receive_iov = net_slirp_receive_iov,
     .cleanup = net_slirp_cleanup,
 };
 
@@ -211,6 +211,25 @@ plugin_register_cb_udata(qemu_plugin_id_t id, enum qemu_plugin_event ev,
     do_plugin_register_cb(id, ev, func, udata);
 }
 
+/*
+ * Grow all scoreboards to cover @cpu. Entries may move, so plugins must
+ * re-fetch pointers with qemu_plugin_scoreboard_find() on every use.
+ */
+static void plugin_grow_scoreboards__locked(CPUState *cpu)
+{
+    struct qemu_plugin_scoreboard *score;
+
+    if (cpu->cpu_index < plugin.scoreboard_alloc_size) {
+        return;
+    }
+    while (cpu->cpu_index >= plugin.scoreboard_alloc_size) {
+        plugin.scoreboard_alloc_size *= 2;
+    }
+    QLIST_FOREACH(score, &plugin.scoreboards, entry) {
+        g_array_set_size(score->data, plugin.scoreboard_alloc_size);
+    }
+}
+
 void qemu_plugin_vcpu_init_hook(CPUState *cpu)
 {
     bool success;
@@ -220,6 +239,7 @@ void qemu_plugin_vcpu_init_hook(CPUState *cpu)
     success = g_hash_table_insert(plugin.cpu_ht, &cpu->cpu_index,
                                   &cpu->cpu_index);
     g_assert(success);
+    plugin_grow_scoreboards__locked(cpu);
     qemu_rec_mutex_unlock(&plugin.lock);
 
     plugin_vcpu_cb__simple(cpu, QEMU_PLUGIN_EV_VCPU_INIT);
@@ -536,6 +556,50 @@ void qemu_plugin_disable_mem_helpers(CPUState *cpu)
     cpu->plugin_mem_cbs = NULL;
 }
 
+bool qemu_plugin_sample_tb(CPUState *cpu)
+{
+    static __thread uint32_t counter;
+    uint32_t rate;
+
+    if (!test_bit(QEMU_PLUGIN_EV_VCPU_TB_TRANS, cpu->plugin_mask)) {
+        return false;
+    }
+    rate = qatomic_read(&plugin.tb_sample_rate);
+    if (rate <= 1) {
+        return true;
+    }
+    return counter++ % rate == 0;
+}
+
+void plugin_set_tb_sample_rate(uint32_t rate)
+{
+    qatomic_set(&plugin.tb_sample_rate, rate ? rate : 1);
+}
+
+struct qemu_plugin_scoreboard *plugin_scoreboard_new(size_t element_size)
+{
+    struct qemu_plugin_scoreboard *score =
+        g_new0(struct qemu_plugin_scoreboard, 1);
+
+    score->data = g_array_new(FALSE, TRUE, element_size);
+    qemu_rec_mutex_lock(&plugin.lock);
+    g_array_set_size(score->data, plugin.scoreboard_alloc_size);
+    QLIST_INSERT_HEAD(&plugin.scoreboards, score, entry);
+    qemu_rec_mutex_unlock(&plugin.lock);
+
+    return score;
+}
+
+void plugin_scoreboard_free(struct qemu_plugin_scoreboard *score)
+{
+    qemu_rec_mutex_lock(&plugin.lock);
+    QLIST_REMOVE(score, entry);
+    qemu_rec_mutex_unlock(&plugin.lock);
+
+    g_array_free(score->data, TRUE);
+    g_free(score);
+}
+
 static bool plugin_dyn_cb_arr_cmp(const void *ap, const void *bp)
 {
     return ap == bp;
@@ -549,9 +613,12 @@ static void __attribute__((__constructor__)) plugin_init(void)
         QLIST_INIT(&plugin.cb_lists[i]);
     }
     qemu_rec_mutex_init(&plugin.lock);
+    plugin.tb_sample_rate = 1;
     plugin.id_ht = g_hash_table_new(g_int64_hash, g_int64_equal);
     plugin.cpu_ht = g_hash_table_new(g_int_hash, g_int_equal);
     QTAILQ_INIT(&plugin.ctxs);
+    QLIST_INIT(&plugin.scoreboards);
+    plugin.scoreboard_alloc_size = 16; /* avoid frequent reallocation */
     qht_init(&plugin.dyn_cb_arr_ht, plugin_dyn_cb_arr_cmp, 16,
              QHT_MODE_AUTO_RESIZE);
     atexit(qemu_plugin_atexit_cb);
@@ -32,6 +32,8 @@ struct qemu_plugin_state {
      */
     GHashTable *cpu_ht;
     DECLARE_BITMAP(mask, QEMU_PLUGIN_EV_MAX);
+    /* instrument every Nth TB; 1 instruments everything (the default) */
+    uint32_t tb_sample_rate;
     /*
      * @lock protects the struct as well as ctx->uninstalling.
      * The lock must be acquired by all API ops.
@@ -44,6 +46,18 @@ struct qemu_plugin_state {
      * the code cache is flushed.
      */
     struct qht dyn_cb_arr_ht;
+    /*
+     * Scoreboards are per-vCPU arrays handed out to plugins; they are
+     * all resized together when a vCPU index beyond the current
+     * allocation comes online. Protected by @lock.
+     */
+    QLIST_HEAD(, qemu_plugin_scoreboard) scoreboards;
+    size_t scoreboard_alloc_size;
+};
+
+struct qemu_plugin_scoreboard {
+    GArray *data;
+    QLIST_ENTRY(qemu_plugin_scoreboard) entry;
 };
 
 
@@ -64,6 +78,8 @@ struct qemu_plugin_ctx {
 
 struct qemu_plugin_ctx *plugin_id_to_ctx_locked(qemu_plugin_id_t id);
 
+void plugin_set_tb_sample_rate(uint32_t rate);
+
 void plugin_register_inline_op(GArray **arr,
                                enum qemu_plugin_mem_rw rw,
                                enum qemu_plugin_op op, void *ptr,
@@ -97,4 +113,8 @@ void plugin_register_vcpu_mem_cb(GArray **arr,
 
 void exec_inline_op(struct qemu_plugin_dyn_cb *cb);
 
+struct qemu_plugin_scoreboard *plugin_scoreboard_new(size_t element_size);
+
+void plugin_scoreboard_free(struct qemu_plugin_scoreboard *score);
+
 #endif /* _PLUGIN_INTERNAL_H_ */
@@ -4186,13 +4186,13 @@ SRST
 ERST
 
 DEF("icount", HAS_ARG, QEMU_OPTION_icount, \
-    "-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=<filename>[,rrsnapshot=<snapshot>]]\n" \
+    "-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=<filename>[,rrsnapshot=<snapshot>][,rrperiod=<seconds>]]\n" \
     "                enable virtual instruction counter with 2^N clock ticks per\n" \
     "                instruction, enable aligning the host and virtual clocks\n" \
     "                or disable real time cpu sleeping, and optionally enable\n" \
     "                record-and-replay mode\n", QEMU_ARCH_ALL)
 SRST
-``-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=filename[,rrsnapshot=snapshot]]``
+``-icount [shift=N|auto][,align=on|off][,sleep=on|off][,rr=record|replay,rrfile=filename[,rrsnapshot=snapshot][,rrperiod=seconds]]``
     Enable virtual instruction counter. The virtual cpu will execute one
     instruction every 2^N ns of virtual time. If ``auto`` is specified
     then the virtual cpu speed will be automatically adjusted to keep
@@ -4234,6 +4234,10 @@ SRST
     name. In record mode, a new VM snapshot with the given name is created
     at the start of execution recording. In replay mode this option
     specifies the snapshot name used to load the initial VM state.
+    If the ``rrperiod`` option is given then additional VM snapshots are
+    created every ``seconds`` seconds of real time while replaying. They
+    reduce the amount of execution that has to be repeated when seeking
+    in the replay log, e.g. for the reverse debugging commands.
 ERST
 
 DEF("watchdog", HAS_ARG, QEMU_OPTION_watchdog, \
@@ -4593,6 +4597,21 @@ SRST
     file in file
 ERST
 
+DEF("boot-profile", HAS_ARG, QEMU_OPTION_boot_profile,
+    "-boot-profile [report=on|off][,exit=on|off]\n"
+    "                report boot phase timings to stderr when initialization\n"
+    "                completes; with exit=on, exit instead of running the\n"
+    "                guest (boot time benchmarking)\n",
+    QEMU_ARCH_ALL)
+SRST
+``-boot-profile [report=on|off][,exit=on|off]``
+    Print a report of the initialization phase timestamps (also
+    available at runtime through the query-boot-profile QMP command) to
+    stderr once initialization completes. With ``exit=on`` QEMU exits
+    at that point instead of running the guest, so cold start time can
+    be measured in isolation.
+ERST
+
 DEF("enable-sync-profile", 0, QEMU_OPTION_enable_sync_profile,
     "-enable-sync-profile\n"
     "                enable synchronization profiling\n",
@@ -147,7 +147,28 @@ static GuestExecInfo *guest_exec_info_find(int64_t pid_numeric)
     return NULL;
 }
 
-GuestExecStatus *qmp_guest_exec_status(int64_t pid, Error **errp)
+/*
+ * Base64-encode and release the output captured so far, resetting the
+ * buffer so the output watch can start accumulating again.
+ */
+static char *guest_exec_take_output(GuestExecIOData *p)
+{
+    char *encoded = NULL;
+
+    if (p->length > 0) {
+        encoded = g_base64_encode(p->data, p->length);
+    }
+    g_free(p->data);
+    p->data = NULL;
+    p->size = 0;
+    p->length = 0;
+
+    return encoded;
+}
+
+GuestExecStatus *qmp_guest_exec_status(int64_t pid,
+                                       bool has_consume_output,
+                                       bool consume_output, Error **errp)
 {
     GuestExecInfo *gei;
     GuestExecStatus *ges;
@@ -207,20 +228,19 @@ GuestExecStatus *qmp_guest_exec_status(int64_t pid, Error **errp)
             ges->signal = WTERMSIG(gei->status);
         }
 #endif
-        if (gei->out.length > 0) {
-            ges->has_out_data = true;
-            ges->out_data = g_base64_encode(gei->out.data, gei->out.length);
-            g_free(gei->out.data);
-            ges->has_out_truncated = gei->out.truncated;
-        }
+    }
 
-        if (gei->err.length > 0) {
-            ges->has_err_data = true;
-            ges->err_data = g_base64_encode(gei->err.data, gei->err.length);
-            g_free(gei->err.data);
-            ges->has_err_truncated = gei->err.truncated;
-        }
+    if (finished || (has_consume_output && consume_output)) {
+        ges->out_data = guest_exec_take_output(&gei->out);
+        ges->has_out_data = ges->out_data != NULL;
+        ges->has_out_truncated = gei->out.truncated;
 
+        ges->err_data = guest_exec_take_output(&gei->err);
+        ges->has_err_data = ges->err_data != NULL;
+        ges->has_err_truncated = gei->err.truncated;
+    }
+
+    if (finished) {
         QTAILQ_REMOVE(&guest_exec_state.processes, gei, next);
         g_free(gei);
     }
@@ -228,6 +248,35 @@ GuestExecStatus *qmp_guest_exec_status(int64_t pid, Error **errp)
     return ges;
 }
 
+void qmp_guest_exec_cancel(int64_t pid, Error **errp)
+{
+    GuestExecInfo *gei;
+
+    slog("guest-exec-cancel called, pid: %u", (uint32_t)pid);
+
+    gei = guest_exec_info_find(pid);
+    if (gei == NULL) {
+        error_setg(errp, QERR_INVALID_PARAMETER, "pid");
+        return;
+    }
+
+    if (qatomic_mb_read(&gei->finished)) {
+        /* Already exited; guest-exec-status will reap it */
+        return;
+    }
+
+#ifdef G_OS_WIN32
+    if (!TerminateProcess(gei->pid, 1)) {
+        error_setg(errp, QERR_QGA_COMMAND_FAILED,
+                   "failed to terminate process");
+    }
+#else
+    if (kill(gei->pid, SIGKILL) < 0 && errno != ESRCH) {
+        error_setg_errno(errp, errno, "failed to kill process");
+    }
+#endif
+}
+
 /* Get environment variables or arguments array for execve(). */
 static char **guest_exec_get_args(const strList *entry, bool log)
 {
@@ -585,3 +634,48 @@ GuestFileRead *qmp_guest_file_read(int64_t handle, bool has_count,
 
     return read_data;
 }
+
+GuestFileReadList *qmp_guest_file_read_batch(int64_t handle,
+                                             bool has_count, int64_t count,
+                                             bool has_chunks, int64_t chunks,
+                                             Error **errp)
+{
+    GuestFileHandle *gfh = guest_file_handle_find(handle, errp);
+    GuestFileReadList *head = NULL, **tail = &head;
+    int64_t i;
+
+    if (!gfh) {
+        return NULL;
+    }
+    if (!has_count) {
+        count = QGA_READ_COUNT_DEFAULT;
+    } else if (count < 0 || count > GUEST_FILE_READ_COUNT_MAX) {
+        error_setg(errp, "value '%" PRId64 "' is invalid for argument count",
+                   count);
+        return NULL;
+    }
+    if (!has_chunks) {
+        chunks = 1;
+    } else if (chunks < 1 || chunks > GUEST_FILE_READ_COUNT_MAX ||
+               count * chunks > GUEST_FILE_READ_COUNT_MAX) {
+        error_setg(errp, "value '%" PRId64 "' is invalid for argument chunks",
+                   chunks);
+        return NULL;
+    }
+
+    for (i = 0; i < chunks; i++) {
+        GuestFileRead *read_data = guest_file_read_unsafe(gfh, count, errp);
+
+        if (!read_data) {
+            slog("guest-file-read-batch failed, handle: %" PRId64, handle);
+            qapi_free_GuestFileReadList(head);
+            return NULL;
+        }
+        QAPI_LIST_APPEND(tail, read_data);
+        if (read_data->eof) {
+            break;
+        }
+    }
+
+    return head;
+}
@@ -71,6 +71,19 @@ struct TypeImpl
 
     int num_interfaces;
     InterfaceImpl interfaces[MAX_INTERFACES];
+
+    /*
+     * Freelist of instance allocations, linked through their first word.
+     * instance_size is fixed per type, so freed instances can be handed
+     * straight to the next object_new() of the same type instead of going
+     * back to the allocator.
+     */
+    void *instance_freelist;
+    unsigned int instance_free_count;
+
+    /* Instance churn counters, see object_type_churn_foreach() */
+    uint64_t instances_created;
+    uint64_t instances_finalized;
 };
 
 static Type type_interface;
@@ -511,6 +524,7 @@ static void object_initialize_with_type(Object *obj, size_t size, TypeImpl *type
 
     memset(obj, 0, type->instance_size);
     obj->class = type->class;
+    type->instances_created++;
     object_ref(obj);
     object_class_property_init_all(obj);
     obj->properties = g_hash_table_new_full(g_str_hash, g_str_equal,
@@ -689,6 +703,7 @@ static void object_finalize(void *data)
 
     g_assert(obj->ref == 0);
     g_assert(obj->parent == NULL);
+    ti->instances_finalized++;
     if (obj->free) {
         obj->free(obj);
     }
@@ -706,6 +721,24 @@ typedef union {
 } qemu_max_align_t;
 #endif
 
+/* Bounds per-type freelist length, and with it the memory kept around */
+#define OBJECT_INSTANCE_FREELIST_MAX 64
+
+static void object_free_to_freelist(void *data)
+{
+    Object *obj = data;
+    TypeImpl *ti = obj->class->type;
+
+    if (ti->instance_free_count >= OBJECT_INSTANCE_FREELIST_MAX) {
+        g_free(obj);
+        return;
+    }
+
+    *(void **)obj = ti->instance_freelist;
+    ti->instance_freelist = obj;
+    ti->instance_free_count++;
+}
+
 static Object *object_new_with_type(Type type)
 {
     Object *obj;
@@ -723,8 +756,14 @@ static Object *object_new_with_type(Type type)
      * implementation, extra alignment implies extra overhead.
      */
     if (likely(align <= __alignof__(qemu_max_align_t))) {
-        obj = g_malloc(size);
-        obj_free = g_free;
+        if (type->instance_freelist) {
+            obj = type->instance_freelist;
+            type->instance_freelist = *(void **)obj;
+            type->instance_free_count--;
+        } else {
+            obj = g_malloc(size);
+        }
+        obj_free = object_free_to_freelist;
     } else {
         obj = qemu_memalign(align, size);
         obj_free = qemu_vfree;
@@ -1093,6 +1132,32 @@ void object_class_foreach(void (*fn)(ObjectClass *klass, void *opaque),
     enumerating_types = false;
 }
 
+typedef struct OTCData
+{
+    ObjectTypeChurnFn fn;
+    void *opaque;
+} OTCData;
+
+static void object_type_churn_foreach_tramp(gpointer key, gpointer value,
+                                            gpointer opaque)
+{
+    OTCData *data = opaque;
+    TypeImpl *type = value;
+
+    if (type->instances_created) {
+        data->fn(type->name, type->instances_created,
+                 type->instances_finalized, data->opaque);
+    }
+}
+
+void object_type_churn_foreach(ObjectTypeChurnFn fn, void *opaque)
+{
+    OTCData data = { fn, opaque };
+
+    g_hash_table_foreach(type_table_get(), object_type_churn_foreach_tramp,
+                         &data);
+}
+
 static int do_object_child_foreach(Object *obj,
                                    int (*fn)(Object *child, void *opaque),
                                    void *opaque, bool recurse)
@@ -1250,6 +1315,76 @@ object_property_add(Object *obj, const char *name, const char *type,
                                    opaque, &error_abort);
 }
 
+/*
+ * Bumped whenever a class property is added anywhere, so that the flat
+ * per-class lookup tables know when they are out of date.  Starts at 1
+ * because a freshly allocated class has flat_properties_gen == 0.
+ */
+static unsigned int class_property_generation = 1;
+
+/*
+ * Cache of absolute canonical path -> object resolutions.  The whole cache
+ * is invalidated (via the generation counter) whenever the composition
+ * tree changes: a child property is added or removed, a property is
+ * deleted, or a link is retargeted.  Entries do not hold references;
+ * an object can only go away together with a tree mutation, which clears
+ * the cache first.
+ */
+static GHashTable *resolve_path_cache;
+static unsigned int composition_tree_generation = 1;
+static unsigned int resolve_path_cache_gen;
+
+static void object_composition_tree_changed(void)
+{
+    composition_tree_generation++;
+}
+
+static ObjectProperty *object_class_property_find_uncached(ObjectClass *klass,
+                                                           const char *name)
+{
+    ObjectClass *parent_klass;
+
+    parent_klass = object_class_get_parent(klass);
+    if (parent_klass) {
+        ObjectProperty *prop =
+            object_class_property_find_uncached(parent_klass, name);
+        if (prop) {
+            return prop;
+        }
+    }
+
+    return g_hash_table_lookup(klass->properties, name);
+}
+
+static GHashTable *object_class_flat_properties(ObjectClass *klass)
+{
+    ObjectClass *c;
+
+    if (klass->flat_properties &&
+        klass->flat_properties_gen == class_property_generation) {
+        return klass->flat_properties;
+    }
+
+    if (klass->flat_properties) {
+        g_hash_table_destroy(klass->flat_properties);
+    }
+    /* Keys and values are borrowed from the per-class tables */
+    klass->flat_properties = g_hash_table_new(g_str_hash, g_str_equal);
+
+    for (c = klass; c; c = object_class_get_parent(c)) {
+        GHashTableIter iter;
+        gpointer key, value;
+
+        g_hash_table_iter_init(&iter, c->properties);
+        while (g_hash_table_iter_next(&iter, &key, &value)) {
+            g_hash_table_insert(klass->flat_properties, key, value);
+        }
+    }
+    klass->flat_properties_gen = class_property_generation;
+
+    return klass->flat_properties;
+}
+
 ObjectProperty *
 object_class_property_add(ObjectClass *klass,
                           const char *name,
@@ -1261,7 +1396,8 @@ object_class_property_add(ObjectClass *klass,
 {
     ObjectProperty *prop;
 
-    assert(!object_class_property_find(klass, name));
+    /* Don't churn the flat tables while classes fill their properties */
+    assert(!object_class_property_find_uncached(klass, name));
 
     prop = g_malloc0(sizeof(*prop));
 
@@ -1274,6 +1410,7 @@ object_class_property_add(ObjectClass *klass,
     prop->opaque = opaque;
 
     g_hash_table_insert(klass->properties, prop->name, prop);
+    class_property_generation++;
 
     return prop;
 }
@@ -1331,18 +1468,7 @@ void object_class_property_iter_init(ObjectPropertyIterator *iter,
 
 ObjectProperty *object_class_property_find(ObjectClass *klass, const char *name)
 {
-    ObjectClass *parent_klass;
-
-    parent_klass = object_class_get_parent(klass);
-    if (parent_klass) {
-        ObjectProperty *prop =
-            object_class_property_find(parent_klass, name);
-        if (prop) {
-            return prop;
-        }
-    }
-
-    return g_hash_table_lookup(klass->properties, name);
+    return g_hash_table_lookup(object_class_flat_properties(klass), name);
 }
 
 ObjectProperty *object_class_property_find_err(ObjectClass *klass,
@@ -1365,6 +1491,7 @@ void object_property_del(Object *obj, const char *name)
         prop->release(obj, name, prop->opaque);
     }
     g_hash_table_remove(obj->properties, name);
+    object_composition_tree_changed();
 }
 
 bool object_property_get(Object *obj, const char *name, Visitor *v,
@@ -1728,6 +1855,7 @@ static void object_finalize_child_property(Object *obj, const char *name,
         (child->class->unparent)(child);
     }
     child->parent = NULL;
+    object_composition_tree_changed();
     object_unref(child);
 }
 
@@ -1751,6 +1879,7 @@ object_property_try_add_child(Object *obj, const char *name,
     op->resolve = object_resolve_child_property;
     object_ref(child);
     child->parent = obj;
+    object_composition_tree_changed();
     return op;
 }
 
@@ -1885,6 +2014,7 @@ static void object_set_link_property(Object *obj, Visitor *v,
         object_ref(new_target);
         object_unref(old_target);
     }
+    object_composition_tree_changed();
 }
 
 static Object *object_resolve_link_property(Object *parent, void *opaque,
@@ -2078,6 +2208,33 @@ static Object *object_resolve_abs_path(Object *parent,
     return object_resolve_abs_path(child, parts + 1, typename);
 }
 
+static Object *object_resolve_abs_path_cached(const char *path, char **parts)
+{
+    Object *obj;
+
+    if (resolve_path_cache &&
+        resolve_path_cache_gen == composition_tree_generation) {
+        obj = g_hash_table_lookup(resolve_path_cache, path);
+        if (obj) {
+            return obj;
+        }
+    } else {
+        if (resolve_path_cache) {
+            g_hash_table_destroy(resolve_path_cache);
+        }
+        resolve_path_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                   g_free, NULL);
+        resolve_path_cache_gen = composition_tree_generation;
+    }
+
+    obj = object_resolve_abs_path(object_get_root(), parts, TYPE_OBJECT);
+    if (obj) {
+        g_hash_table_insert(resolve_path_cache, g_strdup(path), obj);
+    }
+
+    return obj;
+}
+
 static Object *object_resolve_partial_path(Object *parent,
                                            char **parts,
                                            const char *typename,
@@ -2132,7 +2289,10 @@ Object *object_resolve_path_type(const char *path, const char *typename,
             *ambiguousp = ambiguous;
         }
     } else {
-        obj = object_resolve_abs_path(object_get_root(), parts + 1, typename);
+        obj = object_resolve_abs_path_cached(path, parts + 1);
+        if (obj) {
+            obj = object_dynamic_cast(obj, typename);
+        }
     }
 
     g_strfreev(parts);
@@ -150,3 +150,19 @@ void hmp_info_qom_tree(Monitor *mon, const QDict *dict)
     }
     print_qom_composition(mon, obj, 0);
 }
+
+static void print_type_churn(const char *typename, uint64_t created,
+                             uint64_t finalized, void *opaque)
+{
+    Monitor *mon = opaque;
+
+    monitor_printf(mon, "%-40s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 "\n",
+                   typename, created, finalized, created - finalized);
+}
+
+void hmp_info_qom_churn(Monitor *mon, const QDict *dict)
+{
+    monitor_printf(mon, "%-40s %10s %10s %10s\n",
+                   "type", "created", "finalized", "live");
+    object_type_churn_foreach(print_type_churn, mon);
+}
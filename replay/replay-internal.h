@@ -195,4 +195,9 @@ void *replay_event_net_load(void);
    to make cached timers available for post_load functions. */
 void replay_vmstate_register(void);
 
+/*! Sets up the timer for periodic snapshots in replay mode. */
+void replay_periodic_snapshot_init(void);
+/*! Stops the periodic snapshot timer. */
+void replay_periodic_snapshot_cleanup(void);
+
 #endif
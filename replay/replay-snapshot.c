@@ -12,10 +12,12 @@
 #include "qemu/osdep.h"
 #include "qapi/error.h"
 #include "sysemu/replay.h"
+#include "sysemu/runstate.h"
 #include "replay-internal.h"
 #include "monitor/monitor.h"
 #include "qapi/qmp/qstring.h"
 #include "qemu/error-report.h"
+#include "qemu/timer.h"
 #include "migration/vmstate.h"
 #include "migration/snapshot.h"
 
@@ -98,3 +100,61 @@ bool replay_can_snapshot(void)
     return replay_mode == REPLAY_MODE_NONE
         || !replay_has_events();
 }
+
+/* Timer for periodic snapshots in replay mode */
+static QEMUTimer *replay_snapshot_timer;
+
+static void replay_snapshot_timer_cb(void *opaque)
+{
+    Error *err = NULL;
+    char *name;
+
+    /*
+     * Skip the round if there are queued async events: the vmstate
+     * cannot be saved in the middle of their processing. The nearest
+     * older snapshot is still found for seeking, the interval just
+     * grows for this once.
+     */
+    if (replay_can_snapshot() && runstate_is_running()) {
+        name = g_strdup_printf("replay-%"PRIu64,
+                               replay_get_current_icount());
+        if (!save_snapshot(name, true, NULL, false, NULL, &err)) {
+            error_report_err(err);
+            error_report("Could not create periodic snapshot "
+                         "for icount replay");
+        }
+        g_free(name);
+    }
+
+    timer_mod(replay_snapshot_timer,
+              qemu_clock_get_ms(QEMU_CLOCK_REALTIME)
+                  + replay_snapshot_periodic_delay * 1000LL);
+}
+
+void replay_periodic_snapshot_init(void)
+{
+    /*
+     * Periodic snapshots bound the distance that reverse-step and
+     * reverse-continue have to re-execute from the nearest snapshot.
+     * They are only useful when replaying: in record mode the initial
+     * rrsnapshot is enough to replay the log from the beginning later.
+     */
+    if (replay_mode != REPLAY_MODE_PLAY
+        || replay_snapshot_periodic_delay <= 0) {
+        return;
+    }
+
+    replay_snapshot_timer = timer_new_ms(QEMU_CLOCK_REALTIME,
+                                         replay_snapshot_timer_cb, NULL);
+    timer_mod(replay_snapshot_timer,
+              qemu_clock_get_ms(QEMU_CLOCK_REALTIME)
+                  + replay_snapshot_periodic_delay * 1000LL);
+}
+
+void replay_periodic_snapshot_cleanup(void)
+{
+    if (replay_snapshot_timer) {
+        timer_free(replay_snapshot_timer);
+        replay_snapshot_timer = NULL;
+    }
+}
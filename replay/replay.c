@@ -28,6 +28,8 @@
 
 ReplayMode replay_mode = REPLAY_MODE_NONE;
 char *replay_snapshot;
+/* Interval in seconds for periodic snapshots in replay mode, 0 = disabled */
+int replay_snapshot_periodic_delay;
 
 /* Name of replay file  */
 static char *replay_filename;
@@ -325,6 +327,7 @@ void replay_configure(QemuOpts *opts)
     }
 
     replay_snapshot = g_strdup(qemu_opt_get(opts, "rrsnapshot"));
+    replay_snapshot_periodic_delay = qemu_opt_get_number(opts, "rrperiod", 0);
     replay_vmstate_register();
     replay_enable(fname, mode);
 
@@ -347,7 +350,7 @@ void replay_start(void)
         exit(1);
     }
 
-    /* Timer for snapshotting will be set up here. */
+    replay_periodic_snapshot_init();
 
     replay_enable_events();
 }
@@ -360,6 +363,8 @@ void replay_finish(void)
 
     replay_save_instructions();
 
+    replay_periodic_snapshot_cleanup();
+
     /* finalize the file */
     if (replay_file) {
         if (replay_mode == REPLAY_MODE_RECORD) {
@@ -90,6 +90,20 @@ void replication_get_error_all(Error **errp)
     }
 }
 
+void replication_get_stats_all(ReplicationStats *stats)
+{
+    ReplicationState *rs, *next;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->last_checkpoint_ms = -1;
+
+    QLIST_FOREACH_SAFE(rs, &replication_states, node, next) {
+        if (rs->ops && rs->ops->get_stats) {
+            rs->ops->get_stats(rs, stats);
+        }
+    }
+}
+
 void replication_stop_all(bool failover, Error **errp)
 {
     ReplicationState *rs, *next;
@@ -121,14 +121,81 @@ def gen_marshal_decl(name: str) -> str:
                  proto=build_marshal_proto(name))
 
 
+def gen_marshal_no_args(name: str,
+                        ret_type: Optional[QAPISchemaType]) -> str:
+    ret = mcgen('''
+
+%(proto)s
+{
+    Error *err = NULL;
+    Visitor *v;
+''',
+                proto=build_marshal_proto(name))
+
+    if ret_type:
+        ret += mcgen('''
+    %(c_type)s retval;
+''',
+                     c_type=ret_type.c_type())
+
+    ret += mcgen('''
+
+    if (unlikely(qdict_size(args))) {
+        /*
+         * The command takes no arguments; visit them anyway to
+         * generate the usual error for the unexpected members.
+         */
+        v = qobject_input_visitor_new_qmp(QOBJECT(args));
+        if (visit_start_struct(v, NULL, NULL, 0, errp)) {
+            visit_check_struct(v, errp);
+            visit_end_struct(v, NULL);
+        }
+        visit_free(v);
+        return;
+    }
+''')
+
+    if ret_type:
+        ret += mcgen('''
+
+    retval = qmp_%(c_name)s(&err);
+    error_propagate(errp, err);
+    if (err) {
+        return;
+    }
+
+    qmp_marshal_output_%(ret_c_name)s(retval, ret, errp);
+}
+''',
+                     c_name=c_name(name), ret_c_name=ret_type.c_name())
+    else:
+        ret += mcgen('''
+
+    qmp_%(c_name)s(&err);
+    error_propagate(errp, err);
+}
+''',
+                     c_name=c_name(name))
+    return ret
+
+
 def gen_marshal(name: str,
                 arg_type: Optional[QAPISchemaObjectType],
                 boxed: bool,
                 ret_type: Optional[QAPISchemaType]) -> str:
     have_args = boxed or (arg_type and not arg_type.is_empty())
-    if have_args:
-        assert arg_type is not None
-        arg_type_c_name = arg_type.c_name()
+    if not have_args:
+        # Allocation-free fast path: no argument struct to fill in or
+        # free, so visitors are only needed to reject stray arguments.
+        return gen_marshal_no_args(name, ret_type)
+
+    assert arg_type is not None
+    arg_type_c_name = arg_type.c_name()
+    # An argument struct whose members are all scalars owns no heap
+    # memory, so the deallocation visit below can be omitted.
+    need_dealloc = (boxed or arg_type.base or
+                    any('*' in memb.type.c_type()
+                        for memb in arg_type.members))
 
     ret = mcgen('''
 
@@ -146,11 +213,10 @@ def gen_marshal(name: str,
 ''',
                      c_type=ret_type.c_type())
 
-    if have_args:
-        ret += mcgen('''
+    ret += mcgen('''
     %(c_name)s arg = {0};
 ''',
-                     c_name=arg_type_c_name)
+                 c_name=arg_type_c_name)
 
     ret += mcgen('''
 
@@ -160,17 +226,12 @@ def gen_marshal(name: str,
     }
 ''')
 
-    if have_args:
-        ret += mcgen('''
+    ret += mcgen('''
     if (visit_type_%(c_arg_type)s_members(v, &arg, errp)) {
         ok = visit_check_struct(v, errp);
     }
 ''',
-                     c_arg_type=arg_type_c_name)
-    else:
-        ret += mcgen('''
-    ok = visit_check_struct(v, errp);
-''')
+                 c_arg_type=arg_type_c_name)
 
     ret += mcgen('''
     visit_end_struct(v, NULL);
@@ -187,21 +248,15 @@ out:
     visit_free(v);
 ''')
 
-    ret += mcgen('''
+    if need_dealloc:
+        ret += mcgen('''
     v = qapi_dealloc_visitor_new();
     visit_start_struct(v, NULL, NULL, 0, NULL);
-''')
-
-    if have_args:
-        ret += mcgen('''
     visit_type_%(c_arg_type)s_members(v, &arg, NULL);
-''',
-                     c_arg_type=arg_type_c_name)
-
-    ret += mcgen('''
     visit_end_struct(v, NULL);
     visit_free(v);
-''')
+''',
+                     c_arg_type=arg_type_c_name)
 
     ret += mcgen('''
 }
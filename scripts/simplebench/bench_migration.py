@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+#
+# Benchmark live migration
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+import argparse
+import json
+import os
+import socket
+import sys
+import threading
+import time
+
+sys.path.append(os.path.join(os.path.dirname(__file__), '..', '..', 'python'))
+from qemu.machine import QEMUMachine
+from qemu.machine.qtest import QEMUQtestMachine
+
+import simplebench
+from results_to_text import results_to_text
+
+
+def free_port():
+    """Reserve a loopback TCP port for the incoming side."""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    sock.bind(('127.0.0.1', 0))
+    port = sock.getsockname()[1]
+    sock.close()
+    return port
+
+
+class DirtyWorkload(threading.Thread):
+    """Dirty guest RAM through the qtest socket while migration runs.
+
+    The source VM runs with the qtest accelerator and '-machine none',
+    which gives one synthetic RAMBlock at guest address 0 and no guest
+    code at all, so every dirty page is produced here: the thread sweeps
+    a working set in 1 MiB chunks, paced to the requested rate, writing
+    zeroes for the configured fraction of chunks so the zero-page path
+    is exercised too.
+    """
+
+    CHUNK = 1024 * 1024
+
+    def __init__(self, vm, rate_mb, working_set_mb, zero_ratio):
+        super().__init__()
+        self.vm = vm
+        self.rate_mb = rate_mb
+        self.working_set = working_set_mb * 1024 * 1024
+        self.zero_ratio = zero_ratio
+        self.stop = False
+
+    def run(self):
+        offset = 0
+        chunks = 0
+        zero_chunks = 0
+        start = time.time()
+        written = 0
+
+        while not self.stop:
+            if self.zero_ratio and \
+                    zero_chunks < (chunks + 1) * self.zero_ratio:
+                pattern = 0
+                zero_chunks += 1
+            else:
+                pattern = 0x5a
+            self.vm.qtest('memset 0x{:x} 0x{:x} 0x{:02x}'.format(
+                offset, self.CHUNK, pattern))
+            chunks += 1
+
+            offset += self.CHUNK
+            if offset + self.CHUNK > self.working_set:
+                offset = 0
+
+            written += self.CHUNK
+            elapsed = time.time() - start
+            ahead = written / (self.rate_mb * 1024 * 1024) - elapsed
+            if ahead > 0:
+                time.sleep(ahead)
+
+
+def bench_migration(qemu_binary, mem_mb=512, dirty_rate_mb=0,
+                    working_set_mb=None, zero_ratio=0.0,
+                    multifd_channels=0, downtime_limit_ms=300):
+    """Migrate a synthetic RAMBlock set between two QEMU processes.
+
+    qemu_binary       -- path to QEMU binary
+    mem_mb            -- RAM size of the migrated machine
+    dirty_rate_mb     -- how many MiB/s the workload generator dirties,
+                        0 for a static migration
+    working_set_mb    -- size of the dirtied region, defaults to all RAM
+    zero_ratio        -- fraction of dirtied chunks that are zero pages
+    multifd_channels  -- number of multifd channels, 0 to disable multifd
+    downtime_limit_ms -- 'downtime-limit' migration parameter
+
+    Returns {'seconds': float, ...} on success and {'error': str} on
+    failure, compatible with the simplebench lib.  Additional fields
+    carry the query-migrate counters: downtime and setup time in
+    milliseconds, the number of dirty-sync iterations, transferred and
+    zero-page totals and the throughput QEMU itself measured.
+    """
+
+    if working_set_mb is None:
+        working_set_mb = mem_mb
+
+    port = free_port()
+    machine_args = ['-machine', 'none', '-m', str(mem_mb), '-nodefaults']
+
+    src = QEMUQtestMachine(qemu_binary, args=machine_args,
+                           name='bench-migration-src-%d' % os.getpid())
+    dst = QEMUMachine(qemu_binary,
+                      args=machine_args + ['-incoming',
+                                           'tcp:127.0.0.1:%d' % port],
+                      name='bench-migration-dst-%d' % os.getpid())
+    workload = None
+
+    try:
+        src.launch()
+        dst.launch()
+    except OSError as e:
+        return {'error': 'popen failed: ' + str(e)}
+
+    try:
+        caps = []
+        if multifd_channels:
+            caps.append({'capability': 'multifd', 'state': True})
+        for vm in (src, dst):
+            if caps:
+                res = vm.qmp('migrate-set-capabilities', capabilities=caps)
+                if res != {'return': {}}:
+                    return {'error': 'migrate-set-capabilities failed: ' +
+                            str(res)}
+            params = {'downtime-limit': downtime_limit_ms,
+                      'max-bandwidth': 0}
+            if multifd_channels:
+                params['multifd-channels'] = multifd_channels
+            res = vm.qmp('migrate-set-parameters', **params)
+            if res != {'return': {}}:
+                return {'error': 'migrate-set-parameters failed: ' + str(res)}
+
+        if dirty_rate_mb:
+            workload = DirtyWorkload(src, dirty_rate_mb, working_set_mb,
+                                     zero_ratio)
+            workload.start()
+
+        start = time.time()
+        res = src.qmp('migrate', uri='tcp:127.0.0.1:%d' % port)
+        if res != {'return': {}}:
+            return {'error': '"migrate" command failed: ' + str(res)}
+
+        while True:
+            e = src.event_wait('MIGRATION', timeout=600.0)
+            if e is None:
+                return {'error': 'timeout waiting for migration to finish'}
+            status = e['data']['status']
+            if status == 'completed':
+                break
+            if status in ('failed', 'cancelled'):
+                return {'error': 'migration ' + status,
+                        'vm-log': src.get_log()}
+        seconds = time.time() - start
+
+        info = src.qmp('query-migrate')['return']
+    finally:
+        if workload:
+            workload.stop = True
+            workload.join()
+        src.shutdown()
+        dst.shutdown()
+
+    ram = info.get('ram', {})
+    return {
+        'seconds': seconds,
+        'downtime-ms': info.get('downtime'),
+        'setup-ms': info.get('setup-time'),
+        'iterations': ram.get('dirty-sync-count'),
+        'transferred-mb': ram.get('transferred', 0) / (1024 * 1024),
+        'zero-pages': ram.get('duplicate'),
+        'normal-pages': ram.get('normal'),
+        'qemu-mbps': ram.get('mbps'),
+    }
+
+
+def bench_func(env, case):
+    """ Handle one "cell" of benchmarking table. """
+    return bench_migration(env['qemu-binary'], **case['args'])
+
+
+if __name__ == '__main__':
+    p = argparse.ArgumentParser(
+        'Migration benchmark',
+        epilog='Compares migration of a synthetic RAMBlock set between '
+               'QEMU binaries over loopback, for a matrix of dirty-page '
+               'rates and multifd channel counts.')
+    p.add_argument('envs', nargs='+',
+                   help='QEMU binaries to compare, optionally labelled '
+                        'as label:path')
+    p.add_argument('--mem', type=int, default=512,
+                   help='RAM size in MiB (default 512)')
+    p.add_argument('--dirty-rates', default='0,64,256',
+                   help='comma-separated dirty rates in MiB/s '
+                        '(default 0,64,256)')
+    p.add_argument('--multifd', default='0,4',
+                   help='comma-separated multifd channel counts, 0 '
+                        'disables multifd (default 0,4)')
+    p.add_argument('--zero-ratio', type=float, default=0.0,
+                   help='fraction of dirtied chunks that are zeroes')
+    p.add_argument('--working-set', type=int,
+                   help='dirtied region in MiB (default: all RAM)')
+    p.add_argument('--count', type=int, default=3,
+                   help='runs per cell (default 3)')
+    args = p.parse_args()
+
+    test_envs = []
+    for i, q in enumerate(args.envs):
+        if ':' in q:
+            label, path = q.split(':', 1)
+        else:
+            label, path = 'q{}'.format(i), q
+        test_envs.append({'id': label, 'qemu-binary': path})
+
+    test_cases = []
+    for rate in [int(r) for r in args.dirty_rates.split(',')]:
+        for channels in [int(c) for c in args.multifd.split(',')]:
+            case_id = 'dirty-{}'.format(rate)
+            if channels:
+                case_id += ' multifd-{}'.format(channels)
+            test_cases.append({
+                'id': case_id,
+                'args': {
+                    'mem_mb': args.mem,
+                    'dirty_rate_mb': rate,
+                    'working_set_mb': args.working_set,
+                    'zero_ratio': args.zero_ratio,
+                    'multifd_channels': channels,
+                }
+            })
+
+    result = simplebench.bench(bench_func, test_envs, test_cases,
+                               count=args.count, initial_run=False)
+    with open('results.json', 'w') as f:
+        json.dump(result, f, indent=4)
+    print(results_to_text(result))
@@ -84,7 +84,7 @@ def generate_c(event, group):
         '        return;',
         '    }',
         '',
-        '    if (trace_record_start(&rec, %(event_obj)s.id, %(size_str)s)) {',
+        '    if (trace_record_start(&rec, &%(event_obj)s, %(size_str)s)) {',
         '        return; /* Trace Buffer Full, Event Dropped ! */',
         '    }',
         cond=cond,
@@ -24,6 +24,7 @@
 #include "chardev/char.h"
 #include "chardev/char-fe.h"
 #include "qemu/main-loop.h"
+#include "qemu/timer.h"
 #include "qapi/error.h"
 #include "qemu/fifo8.h"
 
@@ -37,6 +38,35 @@ int qemu_semihosting_log_out(const char *s, int len)
     }
 }
 
+/*
+ * Firmware often implements its console with SYS_WRITEC, which would
+ * cost a host write (or a chardev round-trip) for every single
+ * character. Collect characters here instead and flush on newline,
+ * when the buffer fills up, or shortly after output stops arriving.
+ * Access is protected by the BQL.
+ */
+#define OUT_BUF_SIZE        1024
+#define OUT_FLUSH_DELAY_MS  10
+
+static uint8_t console_out_buf[OUT_BUF_SIZE];
+static unsigned int console_out_len;
+static QEMUTimer *console_out_flush_timer;
+
+static void console_out_flush(void)
+{
+    unsigned int len = console_out_len;
+
+    console_out_len = 0;
+    if (len) {
+        qemu_semihosting_log_out((const char *) console_out_buf, len);
+    }
+}
+
+static void console_out_flush_timer_cb(void *opaque)
+{
+    console_out_flush();
+}
+
 /*
  * A re-implementation of lock_user_string that we can use locally
  * instead of relying on softmmu-semi. Hopefully we can deprecate that
@@ -80,6 +110,7 @@ int qemu_semihosting_console_outs(CPUArchState *env, target_ulong addr)
     if (use_gdb_syscalls()) {
         gdb_do_syscall(semihosting_cb, "write,2,%x,%x", addr, s->len);
     } else {
+        console_out_flush();
         out = qemu_semihosting_log_out(s->str, s->len);
     }
 
@@ -96,7 +127,14 @@ void qemu_semihosting_console_outc(CPUArchState *env, target_ulong addr)
         if (use_gdb_syscalls()) {
             gdb_do_syscall(semihosting_cb, "write,2,%x,%x", addr, 1);
         } else {
-            qemu_semihosting_log_out((const char *) &c, 1);
+            console_out_buf[console_out_len++] = c;
+            if (c == '\n' || console_out_len == OUT_BUF_SIZE) {
+                console_out_flush();
+            } else if (console_out_flush_timer) {
+                timer_mod(console_out_flush_timer,
+                          qemu_clock_get_ms(QEMU_CLOCK_REALTIME)
+                          + OUT_FLUSH_DELAY_MS);
+            }
         }
     } else {
         qemu_log_mask(LOG_GUEST_ERROR,
@@ -166,6 +204,11 @@ void qemu_semihosting_console_init(void)
 {
     Chardev *chr = semihosting_get_chardev();
 
+    console_out_flush_timer = timer_new_ms(QEMU_CLOCK_REALTIME,
+                                           console_out_flush_timer_cb, NULL);
+    /* don't lose a trailing partial line when the guest exits */
+    atexit(console_out_flush);
+
     if  (chr) {
         fifo8_create(&console.fifo, FIFO_SIZE);
         qemu_chr_fe_init(&console.backend, chr, &error_abort);
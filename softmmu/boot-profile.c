@@ -0,0 +1,100 @@
+/*
+ * Boot phase profiling
+ *
+ * Records named timestamps along the init sequence in softmmu/vl.c and
+ * reports them through query-boot-profile, or to stderr with the
+ * -boot-profile command line option.
+ *
+ * Copyright (c) 2021 QEMU contributors
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/option.h"
+#include "qemu/timer.h"
+#include "qapi/qapi-commands-machine.h"
+#include "sysemu/boot-profile.h"
+
+typedef struct BootPhase {
+    const char *name;
+    int64_t ns;
+} BootPhase;
+
+static GArray *boot_phases;
+static bool boot_profile_report;
+static bool boot_profile_exit;
+
+void boot_profile_stamp(const char *phase)
+{
+    BootPhase p = {
+        .name = phase,
+        .ns = get_clock(),
+    };
+
+    if (!boot_phases) {
+        boot_phases = g_array_new(false, false, sizeof(BootPhase));
+    }
+    g_array_append_val(boot_phases, p);
+}
+
+BootPhaseInfoList *qmp_query_boot_profile(Error **errp)
+{
+    BootPhaseInfoList *head = NULL, **tail = &head;
+    int64_t start_ns, prev_ns;
+    guint i;
+
+    if (!boot_phases || !boot_phases->len) {
+        return NULL;
+    }
+
+    start_ns = g_array_index(boot_phases, BootPhase, 0).ns;
+    prev_ns = start_ns;
+
+    for (i = 0; i < boot_phases->len; i++) {
+        BootPhase *p = &g_array_index(boot_phases, BootPhase, i);
+        BootPhaseInfo *info = g_new0(BootPhaseInfo, 1);
+
+        info->phase = g_strdup(p->name);
+        info->elapsed_us = (p->ns - start_ns) / 1000;
+        info->delta_us = (p->ns - prev_ns) / 1000;
+        prev_ns = p->ns;
+
+        QAPI_LIST_APPEND(tail, info);
+    }
+
+    return head;
+}
+
+void boot_profile_parse_opts(QemuOpts *opts)
+{
+    boot_profile_report = qemu_opt_get_bool(opts, "report", true);
+    boot_profile_exit = qemu_opt_get_bool(opts, "exit", false);
+}
+
+void boot_profile_init_done(void)
+{
+    if (boot_profile_report) {
+        int64_t start_ns, prev_ns;
+        guint i;
+
+        start_ns = g_array_index(boot_phases, BootPhase, 0).ns;
+        prev_ns = start_ns;
+
+        fprintf(stderr, "boot profile:\n");
+        for (i = 0; i < boot_phases->len; i++) {
+            BootPhase *p = &g_array_index(boot_phases, BootPhase, i);
+
+            fprintf(stderr, "  %-24s %8.3f ms (+%.3f ms)\n",
+                    p->name,
+                    (p->ns - start_ns) / 1e6,
+                    (p->ns - prev_ns) / 1e6);
+            prev_ns = p->ns;
+        }
+    }
+
+    if (boot_profile_exit) {
+        exit(0);
+    }
+}
@@ -85,19 +85,55 @@ int64_t cpu_get_clock_locked(void)
     return time;
 }
 
+/*
+ * Per-thread cache of the clock offsets.  vm_clock_seqlock's sequence
+ * doubles as the invalidation epoch: writers (vm_start/vm_stop, icount
+ * adjustment) bump it, so a reader whose cached sequence still matches
+ * can compute the clock from thread-local data.  The sequence starts
+ * odd so a freshly zero-initialized cache is never considered valid.
+ */
+typedef struct {
+    unsigned sequence;
+    bool ticks_enabled;
+    int64_t clock_offset;
+} CPUClockCache;
+
+static __thread CPUClockCache cpu_clock_cache = { .sequence = 1 };
+
 /*
  * Return the monotonic time elapsed in VM, i.e.,
  * the time between vm_start and vm_stop
  */
 int64_t cpu_get_clock(void)
 {
+    CPUClockCache *cache = &cpu_clock_cache;
     int64_t ti;
     unsigned start;
 
+    start = seqlock_read_begin(&timers_state.vm_clock_seqlock);
+    if (likely(start == cache->sequence)) {
+        ti = cache->clock_offset;
+        if (cache->ticks_enabled) {
+            ti += get_clock();
+        }
+        /*
+         * The final check keeps the clock monotonic when a writer is
+         * freezing it concurrently; without it a stale offset could
+         * briefly run past the stop time.
+         */
+        if (likely(!seqlock_read_retry(&timers_state.vm_clock_seqlock,
+                                       start))) {
+            return ti;
+        }
+    }
+
     do {
         start = seqlock_read_begin(&timers_state.vm_clock_seqlock);
+        cache->clock_offset = timers_state.cpu_clock_offset;
+        cache->ticks_enabled = timers_state.cpu_ticks_enabled;
         ti = cpu_get_clock_locked();
     } while (seqlock_read_retry(&timers_state.vm_clock_seqlock, start));
+    cache->sequence = start;
 
     return ti;
 }
@@ -11,6 +11,7 @@
 #include "sysemu/block-backend.h"
 #include "sysemu/dma.h"
 #include "trace/trace-root.h"
+#include "qemu/lockable.h"
 #include "qemu/thread.h"
 #include "qemu/main-loop.h"
 #include "sysemu/cpu-timers.h"
@@ -40,6 +41,184 @@ MemTxResult dma_memory_set(AddressSpace *as, dma_addr_t addr,
     return error;
 }
 
+/*
+ * A cached translation of one guest buffer. The embedded
+ * MemoryRegionCache holds a reference on the memory region, so the
+ * host pointer stays valid while the entry is alive; @refcnt counts
+ * in-flight requests using it. Entries that are evicted or
+ * invalidated while still referenced are marked @dead and destroyed
+ * when the last user drops them.
+ */
+typedef struct DMASGCacheEntry {
+    dma_addr_t base;
+    dma_addr_t len;
+    bool is_write;
+    bool dead;
+    unsigned refcnt;
+    MemoryRegionCache mrc;
+} DMASGCacheEntry;
+
+struct DMASGCache {
+    AddressSpace *as;
+    MemoryListener listener;
+    QemuMutex lock;
+    unsigned size;
+    unsigned pos;    /* next slot to evict, FIFO */
+    DMASGCacheEntry **slots;
+};
+
+static void dma_sg_cache_entry_destroy(DMASGCacheEntry *entry)
+{
+    address_space_cache_destroy(&entry->mrc);
+    g_free(entry);
+}
+
+/* Called on memory topology changes; drops all cached translations. */
+static void dma_sg_cache_listener_commit(MemoryListener *listener)
+{
+    DMASGCache *cache = container_of(listener, DMASGCache, listener);
+    unsigned i;
+
+    QEMU_LOCK_GUARD(&cache->lock);
+    for (i = 0; i < cache->size; i++) {
+        DMASGCacheEntry *entry = cache->slots[i];
+
+        if (!entry) {
+            continue;
+        }
+        cache->slots[i] = NULL;
+        if (entry->refcnt == 0) {
+            dma_sg_cache_entry_destroy(entry);
+        } else {
+            entry->dead = true;
+        }
+    }
+}
+
+DMASGCache *dma_sg_cache_new(AddressSpace *as, unsigned size)
+{
+    DMASGCache *cache = g_new0(DMASGCache, 1);
+
+    assert(size > 0);
+    cache->as = as;
+    cache->size = size;
+    cache->slots = g_new0(DMASGCacheEntry *, size);
+    qemu_mutex_init(&cache->lock);
+    cache->listener.commit = dma_sg_cache_listener_commit;
+    memory_listener_register(&cache->listener, as);
+
+    return cache;
+}
+
+void dma_sg_cache_free(DMASGCache *cache)
+{
+    unsigned i;
+
+    if (!cache) {
+        return;
+    }
+
+    memory_listener_unregister(&cache->listener);
+    for (i = 0; i < cache->size; i++) {
+        if (cache->slots[i]) {
+            assert(cache->slots[i]->refcnt == 0);
+            dma_sg_cache_entry_destroy(cache->slots[i]);
+        }
+    }
+    qemu_mutex_destroy(&cache->lock);
+    g_free(cache->slots);
+    g_free(cache);
+}
+
+/*
+ * Look up or create a translation for [addr, addr + *len). Returns the
+ * host pointer and shrinks *len to the contiguously translated length,
+ * or returns NULL if the range is not directly accessible RAM; the
+ * caller then falls back to dma_memory_map(). On success, a reference
+ * to the entry is returned in *entryp and must be dropped with
+ * dma_sg_cache_put().
+ */
+static void *dma_sg_cache_get(DMASGCache *cache, AddressSpace *as,
+                              dma_addr_t addr, dma_addr_t *len,
+                              DMADirection dir, DMASGCacheEntry **entryp)
+{
+    bool is_write = dir == DMA_DIRECTION_FROM_DEVICE;
+    DMASGCacheEntry *entry, *old;
+    int64_t cached_len;
+    unsigned i;
+
+    if (cache->as != as) {
+        return NULL;
+    }
+
+    QEMU_LOCK_GUARD(&cache->lock);
+    for (i = 0; i < cache->size; i++) {
+        entry = cache->slots[i];
+        if (entry && entry->is_write == is_write &&
+            addr >= entry->base && addr - entry->base < entry->len) {
+            dma_addr_t offset = addr - entry->base;
+
+            entry->refcnt++;
+            *len = MIN(*len, entry->len - offset);
+            *entryp = entry;
+            return (uint8_t *)entry->mrc.ptr + offset;
+        }
+    }
+
+    entry = g_new0(DMASGCacheEntry, 1);
+    cached_len = address_space_cache_init(&entry->mrc, as, addr, *len,
+                                          is_write);
+    if (cached_len <= 0 || !entry->mrc.ptr) {
+        /* Not directly accessible RAM; leave it to dma_memory_map() */
+        if (cached_len > 0) {
+            address_space_cache_destroy(&entry->mrc);
+        }
+        g_free(entry);
+        return NULL;
+    }
+    entry->base = addr;
+    entry->len = cached_len;
+    entry->is_write = is_write;
+    entry->refcnt = 1;
+
+    old = cache->slots[cache->pos];
+    if (old) {
+        if (old->refcnt == 0) {
+            dma_sg_cache_entry_destroy(old);
+        } else {
+            old->dead = true;
+        }
+    }
+    cache->slots[cache->pos] = entry;
+    cache->pos = (cache->pos + 1) % cache->size;
+
+    *len = cached_len;
+    *entryp = entry;
+    return entry->mrc.ptr;
+}
+
+/*
+ * Drop a reference returned by dma_sg_cache_get(). @access_len bytes
+ * starting at @buffer were written by the device (0 for reads or when
+ * the mapping went unused); like dma_memory_unmap(), this marks the
+ * range dirty.
+ */
+static void dma_sg_cache_put(DMASGCache *cache, DMASGCacheEntry *entry,
+                             void *buffer, dma_addr_t access_len)
+{
+    if (entry->is_write && access_len) {
+        address_space_cache_invalidate(&entry->mrc,
+                                       (uint8_t *)buffer -
+                                       (uint8_t *)entry->mrc.ptr,
+                                       access_len);
+    }
+
+    QEMU_LOCK_GUARD(&cache->lock);
+    if (--entry->refcnt == 0 && entry->dead) {
+        dma_sg_cache_entry_destroy(entry);
+    }
+}
+
 void qemu_sglist_init(QEMUSGList *qsg, DeviceState *dev, int alloc_hint,
                       AddressSpace *as)
 {
@@ -49,9 +228,15 @@ void qemu_sglist_init(QEMUSGList *qsg, DeviceState *dev, int alloc_hint,
     qsg->size = 0;
     qsg->as = as;
     qsg->dev = dev;
+    qsg->map_cache = NULL;
     object_ref(OBJECT(dev));
 }
 
+void qemu_sglist_set_map_cache(QEMUSGList *qsg, DMASGCache *cache)
+{
+    qsg->map_cache = cache;
+}
+
 void qemu_sglist_add(QEMUSGList *qsg, dma_addr_t base, dma_addr_t len)
 {
     if (qsg->nsg == qsg->nalloc) {
@@ -82,11 +267,27 @@ typedef struct {
     int sg_cur_index;
     dma_addr_t sg_cur_byte;
     QEMUIOVector iov;
+    /* Parallel to iov.iov[]; non-NULL where the mapping came from the
+     * sg list's map cache instead of dma_memory_map(). */
+    DMASGCacheEntry **map_entries;
+    int map_entries_nalloc;
     QEMUBH *bh;
     DMAIOFunc *io_func;
     void *io_func_opaque;
 } DMAAIOCB;
 
+static void dma_aiocb_add_mapping(DMAAIOCB *dbs, void *mem, dma_addr_t len,
+                                  DMASGCacheEntry *entry)
+{
+    qemu_iovec_add(&dbs->iov, mem, len);
+    if (dbs->iov.nalloc > dbs->map_entries_nalloc) {
+        dbs->map_entries_nalloc = dbs->iov.nalloc;
+        dbs->map_entries = g_renew(DMASGCacheEntry *, dbs->map_entries,
+                                   dbs->map_entries_nalloc);
+    }
+    dbs->map_entries[dbs->iov.niov - 1] = entry;
+}
+
 static void dma_blk_cb(void *opaque, int ret);
 
 static void reschedule_dma(void *opaque)
@@ -104,9 +305,15 @@ static void dma_blk_unmap(DMAAIOCB *dbs)
     int i;
 
     for (i = 0; i < dbs->iov.niov; ++i) {
-        dma_memory_unmap(dbs->sg->as, dbs->iov.iov[i].iov_base,
-                         dbs->iov.iov[i].iov_len, dbs->dir,
-                         dbs->iov.iov[i].iov_len);
+        if (dbs->map_entries[i]) {
+            dma_sg_cache_put(dbs->sg->map_cache, dbs->map_entries[i],
+                             dbs->iov.iov[i].iov_base,
+                             dbs->iov.iov[i].iov_len);
+        } else {
+            dma_memory_unmap(dbs->sg->as, dbs->iov.iov[i].iov_base,
+                             dbs->iov.iov[i].iov_len, dbs->dir,
+                             dbs->iov.iov[i].iov_len);
+        }
     }
     qemu_iovec_reset(&dbs->iov);
 }
@@ -121,6 +328,7 @@ static void dma_complete(DMAAIOCB *dbs, int ret)
         dbs->common.cb(dbs->common.opaque, ret);
     }
     qemu_iovec_destroy(&dbs->iov);
+    g_free(dbs->map_entries);
     qemu_aio_unref(dbs);
 }
 
@@ -142,9 +350,18 @@ static void dma_blk_cb(void *opaque, int ret)
     dma_blk_unmap(dbs);
 
     while (dbs->sg_cur_index < dbs->sg->nsg) {
+        DMASGCacheEntry *entry = NULL;
+
         cur_addr = dbs->sg->sg[dbs->sg_cur_index].base + dbs->sg_cur_byte;
         cur_len = dbs->sg->sg[dbs->sg_cur_index].len - dbs->sg_cur_byte;
-        mem = dma_memory_map(dbs->sg->as, cur_addr, &cur_len, dbs->dir);
+        mem = NULL;
+        if (dbs->sg->map_cache) {
+            mem = dma_sg_cache_get(dbs->sg->map_cache, dbs->sg->as,
+                                   cur_addr, &cur_len, dbs->dir, &entry);
+        }
+        if (!mem) {
+            mem = dma_memory_map(dbs->sg->as, cur_addr, &cur_len, dbs->dir);
+        }
         /*
          * Make reads deterministic in icount mode. Windows sometimes issues
          * disk read requests with overlapping SGs. It leads
@@ -158,8 +375,12 @@ static void dma_blk_cb(void *opaque, int ret)
                 if (ranges_overlap((intptr_t)dbs->iov.iov[i].iov_base,
                                    dbs->iov.iov[i].iov_len, (intptr_t)mem,
                                    cur_len)) {
-                    dma_memory_unmap(dbs->sg->as, mem, cur_len,
-                                     dbs->dir, cur_len);
+                    if (entry) {
+                        dma_sg_cache_put(dbs->sg->map_cache, entry, mem, 0);
+                    } else {
+                        dma_memory_unmap(dbs->sg->as, mem, cur_len,
+                                         dbs->dir, cur_len);
+                    }
                     mem = NULL;
                     break;
                 }
@@ -167,7 +388,7 @@ static void dma_blk_cb(void *opaque, int ret)
         }
         if (!mem)
             break;
-        qemu_iovec_add(&dbs->iov, mem, cur_len);
+        dma_aiocb_add_mapping(dbs, mem, cur_len, entry);
         dbs->sg_cur_byte += cur_len;
         if (dbs->sg_cur_byte == dbs->sg->sg[dbs->sg_cur_index].len) {
             dbs->sg_cur_byte = 0;
@@ -251,6 +472,8 @@ BlockAIOCB *dma_blk_io(AioContext *ctx,
     dbs->io_func = io_func;
     dbs->io_func_opaque = io_func_opaque;
     dbs->bh = NULL;
+    dbs->map_entries = NULL;
+    dbs->map_entries_nalloc = 0;
     qemu_iovec_init(&dbs->iov, sg->nsg);
     dma_blk_cb(dbs, 0);
     return &dbs->common;
@@ -214,6 +214,34 @@ static bool memory_region_ioeventfd_equal(MemoryRegionIoeventfd *a,
     return false;
 }
 
+/*
+ * Rebuild the hash from address to the first entry in the sorted
+ * @ioeventfds array with that address.  Matching an eventfd requires
+ * equal start addresses, so one bucket covers all candidates and
+ * dispatch does not have to scan the whole array.
+ */
+static void memory_region_ioeventfd_reindex(MemoryRegion *mr)
+{
+    unsigned i;
+
+    if (!mr->ioeventfd_index) {
+        mr->ioeventfd_index = g_hash_table_new_full(g_int64_hash,
+                                                    g_int64_equal,
+                                                    g_free, NULL);
+    } else {
+        g_hash_table_remove_all(mr->ioeventfd_index);
+    }
+
+    /* Walk backwards so the lowest index for each address wins. */
+    for (i = mr->ioeventfd_nb; i-- > 0; ) {
+        uint64_t *key = g_new(uint64_t, 1);
+
+        *key = int128_get64(mr->ioeventfds[i].addr.start);
+        g_hash_table_replace(mr->ioeventfd_index, key,
+                             GUINT_TO_POINTER(i + 1));
+    }
+}
+
 /* Range of memory in the global map.  Addresses are absolute. */
 struct FlatRange {
     MemoryRegion *mr;
@@ -761,8 +789,31 @@ static void render_memory_region(FlatView *view,
     fr.readonly = readonly;
     fr.nonvolatile = nonvolatile;
 
+    /*
+     * The view is sorted by address and the ranges ending at or before
+     * @base form a prefix of it, so binary search for the first range
+     * that can still overlap the clip instead of scanning from the
+     * start.  With thousands of regions (DIMM-heavy or vfio-heavy
+     * machines) the linear scan made every rebuild quadratic in the
+     * number of flat ranges.
+     */
+    {
+        unsigned lo = 0, hi = view->nr;
+
+        while (lo < hi) {
+            unsigned mid = lo + (hi - lo) / 2;
+
+            if (int128_ge(base, addrrange_end(view->ranges[mid].addr))) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        i = lo;
+    }
+
     /* Render the region itself into any gaps left by the current view. */
-    for (i = 0; i < view->nr && int128_nz(remain); ++i) {
+    for (; i < view->nr && int128_nz(remain); ++i) {
         if (int128_ge(base, addrrange_end(view->ranges[i].addr))) {
             continue;
         }
@@ -977,6 +1028,19 @@ static void address_space_update_ioeventfds(AddressSpace *as)
         }
     }
 
+    /*
+     * Most commits leave the ioeventfd set of this address space alone;
+     * all entries originate from zero-initialized structs, so a flat
+     * comparison is sufficient to skip the add/del walk.
+     */
+    if (ioeventfd_nb == as->ioeventfd_nb &&
+        (ioeventfd_nb == 0 ||
+         memcmp(ioeventfds, as->ioeventfds,
+                ioeventfd_nb * sizeof(*ioeventfds)) == 0)) {
+        g_free(ioeventfds);
+        return;
+    }
+
     address_space_add_del_ioeventfds(as, ioeventfds, ioeventfd_nb,
                                      as->ioeventfds, as->ioeventfd_nb);
 
@@ -1149,6 +1213,22 @@ static void flatviews_reset(void)
     }
 }
 
+static bool flatview_equal(FlatView *a, FlatView *b)
+{
+    unsigned i;
+
+    if (a->nr != b->nr) {
+        return false;
+    }
+    for (i = 0; i < a->nr; i++) {
+        if (!flatrange_equal(&a->ranges[i], &b->ranges[i]) ||
+            a->ranges[i].dirty_log_mask != b->ranges[i].dirty_log_mask) {
+            return false;
+        }
+    }
+    return true;
+}
+
 static void address_space_set_flatview(AddressSpace *as)
 {
     FlatView *old_view = address_space_to_flatview(as);
@@ -1161,6 +1241,20 @@ static void address_space_set_flatview(AddressSpace *as)
         return;
     }
 
+    /*
+     * Rebuilds are global, so most address spaces get handed a freshly
+     * rendered view identical to the one they already have.  Put the
+     * old view back into the hash in that case: the listener walk is
+     * skipped here, and every other address space sharing this root
+     * takes the pointer comparison above.
+     */
+    if (old_view && old_view->root == physmr &&
+        flatview_equal(old_view, new_view)) {
+        flatview_ref(old_view);
+        g_hash_table_replace(flat_views, physmr, old_view);
+        return;
+    }
+
     if (old_view) {
         flatview_ref(old_view);
     }
@@ -1593,9 +1687,23 @@ static bool memory_region_dispatch_write_eventfds(MemoryRegion *mr,
         .addr = addrrange_make(int128_make64(addr), int128_make64(size)),
         .data = data,
     };
+    uint64_t key = addr;
+    gpointer first;
     unsigned i;
 
-    for (i = 0; i < mr->ioeventfd_nb; i++) {
+    if (!mr->ioeventfd_index) {
+        return false;
+    }
+
+    first = g_hash_table_lookup(mr->ioeventfd_index, &key);
+    if (!first) {
+        return false;
+    }
+
+    for (i = GPOINTER_TO_UINT(first) - 1;
+         i < mr->ioeventfd_nb &&
+         int128_eq(mr->ioeventfds[i].addr.start, ioeventfd.addr.start);
+         i++) {
         ioeventfd.match_data = mr->ioeventfds[i].match_data;
         ioeventfd.e = mr->ioeventfds[i].e;
 
@@ -1885,6 +1993,9 @@ static void memory_region_finalize(Object *obj)
     memory_region_clear_coalescing(mr);
     g_free((char *)mr->name);
     g_free(mr->ioeventfds);
+    if (mr->ioeventfd_index) {
+        g_hash_table_destroy(mr->ioeventfd_index);
+    }
 }
 
 Object *memory_region_owner(MemoryRegion *mr)
@@ -2360,6 +2471,23 @@ bool memory_region_snapshot_get_dirty(MemoryRegion *mr, DirtyBitmapSnapshot *sna
                 memory_region_get_ram_addr(mr) + addr, size);
 }
 
+bool memory_region_snapshot_get_dirty_extent(MemoryRegion *mr,
+                                             DirtyBitmapSnapshot *snap,
+                                             hwaddr *first, hwaddr *last)
+{
+    ram_addr_t base = memory_region_get_ram_addr(mr);
+    ram_addr_t f, l;
+
+    assert(mr->ram_block);
+    if (!cpu_physical_memory_snapshot_dirty_extent(snap, &f, &l)) {
+        return false;
+    }
+    /* the snapshot rounding may reach below the start of the region */
+    *first = f > base ? f - base : 0;
+    *last = l - base;
+    return true;
+}
+
 void memory_region_set_readonly(MemoryRegion *mr, bool readonly)
 {
     if (mr->readonly != readonly) {
@@ -2582,6 +2710,7 @@ void memory_region_add_eventfd(MemoryRegion *mr,
     memmove(&mr->ioeventfds[i+1], &mr->ioeventfds[i],
             sizeof(*mr->ioeventfds) * (mr->ioeventfd_nb-1 - i));
     mr->ioeventfds[i] = mrfd;
+    memory_region_ioeventfd_reindex(mr);
     ioeventfd_update_pending |= mr->enabled;
     memory_region_transaction_commit();
 }
@@ -2617,6 +2746,7 @@ void memory_region_del_eventfd(MemoryRegion *mr,
     --mr->ioeventfd_nb;
     mr->ioeventfds = g_realloc(mr->ioeventfds,
                                   sizeof(*mr->ioeventfds)*mr->ioeventfd_nb + 1);
+    memory_region_ioeventfd_reindex(mr);
     ioeventfd_update_pending |= mr->enabled;
     memory_region_transaction_commit();
 }
@@ -3056,6 +3186,7 @@ void address_space_init(AddressSpace *as, MemoryRegion *root, const char *name)
     as->current_map = NULL;
     as->ioeventfd_nb = 0;
     as->ioeventfds = NULL;
+    as->bounce_buffer_size = 0;
     QTAILQ_INIT(&as->listeners);
     QTAILQ_INSERT_TAIL(&address_spaces, as, address_spaces_link);
     as->name = g_strdup(name ? name : "anonymous");
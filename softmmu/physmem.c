@@ -69,6 +69,7 @@
 #include "qemu/range.h"
 #ifndef _WIN32
 #include "qemu/mmap-alloc.h"
+#include "qemu/memusage.h"
 #endif
 
 #include "monitor/monitor.h"
@@ -124,8 +125,24 @@ typedef struct PhysPageMap {
     MemoryRegionSection *sections;
 } PhysPageMap;
 
+/*
+ * Number of recently used section pointers kept per dispatch, indexed
+ * by a hash of the page being translated.  One entry is enough for
+ * streaming access, but emulated DMA alternates between descriptor
+ * rings and payload buffers and thrashes a single slot.
+ */
+#define PHYS_MRU_SECTIONS 8
+
+/* Size of the flat port->section table, covering the 16 bit ISA port space */
+#define IOPORT_MAP_SIZE 0x10000
+
 struct AddressSpaceDispatch {
-    MemoryRegionSection *mru_section;
+    MemoryRegionSection *mru_sections[PHYS_MRU_SECTIONS];
+    /*
+     * Flat byte-granular lookup table, only built for dispatches whose
+     * sections all lie below 64k (in practice the I/O port space).
+     */
+    uint16_t *ioport_map;
     /* This is a multi-level map on the physical address space.
      * The bottom level has pointers to MemoryRegionSections.
      */
@@ -288,11 +305,14 @@ static void phys_page_compact(PhysPageEntry *lp, Node *nodes)
     }
 }
 
+static void phys_build_ioport_map(AddressSpaceDispatch *d);
+
 void address_space_dispatch_compact(AddressSpaceDispatch *d)
 {
     if (d->phys_map.skip) {
         phys_page_compact(&d->phys_map, d->map.nodes);
     }
+    phys_build_ioport_map(d);
 }
 
 static inline bool section_covers_addr(const MemoryRegionSection *section,
@@ -329,18 +349,73 @@ static MemoryRegionSection *phys_page_find(AddressSpaceDispatch *d, hwaddr addr)
     }
 }
 
+/*
+ * The I/O port space is small enough for a flat byte->section table, so
+ * port I/O exits (the bulk of what a PC guest does during firmware PCI
+ * probing and PIT/RTC setup) can skip the radix walk and the subpage
+ * resolution entirely.  Build it once per topology change; the table is
+ * immutable afterwards and published together with the dispatch.
+ */
+static void phys_build_ioport_map(AddressSpaceDispatch *d)
+{
+    uint16_t *map;
+    hwaddr addr, p;
+    int i;
+
+    if (d->map.sections_nb < 2) {
+        /* empty view, not worth a table */
+        return;
+    }
+    for (i = 1; i < d->map.sections_nb; i++) {
+        MemoryRegionSection *s = &d->map.sections[i];
+
+        if (int128_gethi(s->size) ||
+            s->offset_within_address_space + int128_getlo(s->size)
+            > IOPORT_MAP_SIZE) {
+            return;
+        }
+    }
+
+    map = g_new(uint16_t, IOPORT_MAP_SIZE);
+    for (addr = 0; addr < IOPORT_MAP_SIZE; addr += TARGET_PAGE_SIZE) {
+        MemoryRegionSection *section = phys_page_find(d, addr);
+
+        if (section->mr->subpage) {
+            subpage_t *subpage = container_of(section->mr, subpage_t, iomem);
+
+            for (p = 0; p < TARGET_PAGE_SIZE; p++) {
+                map[addr + p] = subpage->sub_section[p];
+            }
+        } else {
+            uint16_t idx = section - d->map.sections;
+
+            for (p = 0; p < TARGET_PAGE_SIZE; p++) {
+                map[addr + p] = idx;
+            }
+        }
+    }
+    d->ioport_map = map;
+}
+
 /* Called from RCU critical section */
 static MemoryRegionSection *address_space_lookup_region(AddressSpaceDispatch *d,
                                                         hwaddr addr,
                                                         bool resolve_subpage)
 {
-    MemoryRegionSection *section = qatomic_read(&d->mru_section);
+    MemoryRegionSection **mru =
+        &d->mru_sections[(addr >> TARGET_PAGE_BITS) % PHYS_MRU_SECTIONS];
+    MemoryRegionSection *section;
     subpage_t *subpage;
 
+    if (resolve_subpage && d->ioport_map && addr < IOPORT_MAP_SIZE) {
+        return &d->map.sections[d->ioport_map[addr]];
+    }
+
+    section = qatomic_read(mru);
     if (!section || section == &d->map.sections[PHYS_SECTION_UNASSIGNED] ||
         !section_covers_addr(section, addr)) {
         section = phys_page_find(d, addr);
-        qatomic_set(&d->mru_section, section);
+        qatomic_set(mru, section);
     }
     if (resolve_subpage && section->mr->subpage) {
         subpage = container_of(section->mr, subpage_t, iomem);
@@ -1139,6 +1214,24 @@ bool cpu_physical_memory_snapshot_get_dirty(DirtyBitmapSnapshot *snap,
     return false;
 }
 
+bool cpu_physical_memory_snapshot_dirty_extent(DirtyBitmapSnapshot *snap,
+                                               ram_addr_t *first,
+                                               ram_addr_t *last)
+{
+    unsigned long npages = (snap->end - snap->start) >> TARGET_PAGE_BITS;
+    unsigned long first_page, last_page;
+
+    first_page = find_first_bit(snap->dirty, npages);
+    if (first_page == npages) {
+        return false;
+    }
+    last_page = find_last_bit(snap->dirty, npages);
+
+    *first = snap->start + ((ram_addr_t)first_page << TARGET_PAGE_BITS);
+    *last = snap->start + ((ram_addr_t)(last_page + 1) << TARGET_PAGE_BITS);
+    return true;
+}
+
 /* Called from RCU critical section */
 hwaddr memory_region_section_get_iotlb(CPUState *cpu,
                                        MemoryRegionSection *section)
@@ -1954,15 +2047,38 @@ static void dirty_memory_extend(ram_addr_t old_ram_size,
     }
 }
 
+static void ram_block_mem_usage(MemUsageEmitFn emit, void *emit_opaque,
+                                void *opaque)
+{
+    RAMBlock *block;
+
+    RCU_READ_LOCK_GUARD();
+    RAMBLOCK_FOREACH(block) {
+        g_autofree char *name =
+            g_strdup_printf("ram/%s",
+                            block->idstr[0] ? block->idstr : "(unnamed)");
+
+        emit(name, block->used_length, MEM_USAGE_UNKNOWN, block->max_length,
+             emit_opaque);
+    }
+}
+
 static void ram_block_add(RAMBlock *new_block, Error **errp)
 {
     const bool noreserve = qemu_ram_is_noreserve(new_block);
     const bool shared = qemu_ram_is_shared(new_block);
+    static bool mem_usage_registered;
     RAMBlock *block;
     RAMBlock *last_block = NULL;
     ram_addr_t old_ram_size, new_ram_size;
     Error *err = NULL;
 
+    /* Called with the BQL held, so a plain flag suffices */
+    if (!mem_usage_registered) {
+        mem_usage_registered = true;
+        mem_usage_register(ram_block_mem_usage, NULL);
+    }
+
     old_ram_size = last_ram_page();
 
     qemu_mutex_lock_ramlist();
@@ -2594,6 +2710,7 @@ AddressSpaceDispatch *address_space_dispatch_new(FlatView *fv)
 void address_space_dispatch_free(AddressSpaceDispatch *d)
 {
     phys_sections_free(&d->map);
+    g_free(d->ioport_map);
     g_free(d);
 }
 
@@ -3003,13 +3120,17 @@ void cpu_flush_icache_range(hwaddr start, hwaddr len)
 
 typedef struct {
     MemoryRegion *mr;
-    void *buffer;
     hwaddr addr;
-    hwaddr len;
-    bool in_use;
+    size_t len;
+    uint8_t buffer[];
 } BounceBuffer;
 
-static BounceBuffer bounce;
+/*
+ * Bounce buffers are allocated per mapping so that concurrent DMA to
+ * non-direct memory can proceed in parallel; this only bounds the total
+ * amount of memory an address space's in-flight mappings can pin.
+ */
+#define BOUNCE_BUFFER_SIZE_MAX (32 * TARGET_PAGE_SIZE)
 
 typedef struct MapClient {
     QEMUBH *bh;
@@ -3044,9 +3165,12 @@ void cpu_register_map_client(QEMUBH *bh)
     qemu_mutex_lock(&map_client_list_lock);
     client->bh = bh;
     QLIST_INSERT_HEAD(&map_client_list, client, link);
-    if (!qatomic_read(&bounce.in_use)) {
-        cpu_notify_map_clients_locked();
-    }
+    /*
+     * A bounce buffer may already have been freed between the failed map
+     * and this registration; schedule a retry rather than trying to guess
+     * whether one of the address spaces has room again.
+     */
+    cpu_notify_map_clients_locked();
     qemu_mutex_unlock(&map_client_list_lock);
 }
 
@@ -3178,25 +3302,29 @@ void *address_space_map(AddressSpace *as,
     mr = flatview_translate(fv, addr, &xlat, &l, is_write, attrs);
 
     if (!memory_access_is_direct(mr, is_write)) {
-        if (qatomic_xchg(&bounce.in_use, true)) {
+        BounceBuffer *bounce;
+
+        /* Avoid unbounded allocations */
+        l = MIN(l, TARGET_PAGE_SIZE);
+        if (qatomic_fetch_add(&as->bounce_buffer_size, l) + l >
+            BOUNCE_BUFFER_SIZE_MAX) {
+            qatomic_sub(&as->bounce_buffer_size, l);
             *plen = 0;
             return NULL;
         }
-        /* Avoid unbounded allocations */
-        l = MIN(l, TARGET_PAGE_SIZE);
-        bounce.buffer = qemu_memalign(TARGET_PAGE_SIZE, l);
-        bounce.addr = addr;
-        bounce.len = l;
+        bounce = g_malloc(sizeof(*bounce) + l);
+        bounce->addr = addr;
+        bounce->len = l;
 
         memory_region_ref(mr);
-        bounce.mr = mr;
+        bounce->mr = mr;
         if (!is_write) {
             flatview_read(fv, addr, MEMTXATTRS_UNSPECIFIED,
-                               bounce.buffer, l);
+                          bounce->buffer, l);
         }
 
         *plen = l;
-        return bounce.buffer;
+        return bounce->buffer;
     }
 
 
@@ -3216,30 +3344,38 @@ void *address_space_map(AddressSpace *as,
 void address_space_unmap(AddressSpace *as, void *buffer, hwaddr len,
                          bool is_write, hwaddr access_len)
 {
-    if (buffer != bounce.buffer) {
-        MemoryRegion *mr;
-        ram_addr_t addr1;
+    MemoryRegion *mr;
+    ram_addr_t addr1;
+
+    mr = memory_region_from_host(buffer, &addr1);
+    if (mr == NULL) {
+        /*
+         * Must be a bounce buffer: they are the only mappings we hand out
+         * that do not point into guest RAM.
+         */
+        BounceBuffer *bounce = container_of(buffer, BounceBuffer, buffer);
+        size_t bounce_len = bounce->len;
 
-        mr = memory_region_from_host(buffer, &addr1);
-        assert(mr != NULL);
         if (is_write) {
-            invalidate_and_set_dirty(mr, addr1, access_len);
-        }
-        if (xen_enabled()) {
-            xen_invalidate_map_cache_entry(buffer);
-        }
-        memory_region_unref(mr);
+            address_space_write(as, bounce->addr, MEMTXATTRS_UNSPECIFIED,
+                                bounce->buffer, access_len);
+        }
+        memory_region_unref(bounce->mr);
+        g_free(bounce);
+        qatomic_sub(&as->bounce_buffer_size, bounce_len);
+        /* Write bounce_buffer_size before reading map_client_list.  */
+        smp_mb();
+        cpu_notify_map_clients();
         return;
     }
+
     if (is_write) {
-        address_space_write(as, bounce.addr, MEMTXATTRS_UNSPECIFIED,
-                            bounce.buffer, access_len);
+        invalidate_and_set_dirty(mr, addr1, access_len);
+    }
+    if (xen_enabled()) {
+        xen_invalidate_map_cache_entry(buffer);
     }
-    qemu_vfree(bounce.buffer);
-    bounce.buffer = NULL;
-    memory_region_unref(bounce.mr);
-    qatomic_mb_set(&bounce.in_use, false);
-    cpu_notify_map_clients();
+    memory_region_unref(mr);
 }
 
 void *cpu_physical_memory_map(hwaddr addr,
@@ -3625,6 +3761,19 @@ static void mtree_print_phys_entries(int start, int end, int skip, int ptr)
 #define MR_SIZE(size) (int128_nz(size) ? (hwaddr)int128_get64( \
                            int128_sub((size), int128_one())) : 0)
 
+static bool phys_section_is_mru(AddressSpaceDispatch *d,
+                                MemoryRegionSection *s)
+{
+    int i;
+
+    for (i = 0; i < PHYS_MRU_SECTIONS; i++) {
+        if (d->mru_sections[i] == s) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void mtree_print_dispatch(AddressSpaceDispatch *d, MemoryRegion *root)
 {
     int i;
@@ -3645,7 +3794,7 @@ void mtree_print_dispatch(AddressSpaceDispatch *d, MemoryRegion *root)
             s->mr->name ? s->mr->name : "(noname)",
             i < ARRAY_SIZE(names) ? names[i] : "",
             s->mr == root ? " [ROOT]" : "",
-            s == d->mru_section ? " [MRU]" : "",
+            phys_section_is_mru(d, s) ? " [MRU]" : "",
             s->mr->is_iommu ? " [iommu]" : "");
 
         if (s->mr->alias) {
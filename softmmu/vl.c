@@ -39,6 +39,7 @@
 #include "qemu/uuid.h"
 #include "sysemu/reset.h"
 #include "sysemu/runstate.h"
+#include "sysemu/boot-profile.h"
 #include "sysemu/runstate-action.h"
 #include "sysemu/seccomp.h"
 #include "sysemu/tcg.h"
@@ -361,6 +362,26 @@ static QemuOptsList qemu_msg_opts = {
     },
 };
 
+static QemuOptsList qemu_boot_profile_opts = {
+    .name = "boot-profile",
+    .head = QTAILQ_HEAD_INITIALIZER(qemu_boot_profile_opts.head),
+    .desc = {
+        {
+            .name = "report",
+            .type = QEMU_OPT_BOOL,
+            .help = "print the boot phase report to stderr when "
+                    "initialization completes (default on)",
+        },
+        {
+            .name = "exit",
+            .type = QEMU_OPT_BOOL,
+            .help = "exit after initialization instead of running the "
+                    "guest (default off)",
+        },
+        { /* end of list */ }
+    },
+};
+
 static QemuOptsList qemu_name_opts = {
     .name = "name",
     .implied_opt_name = "guest",
@@ -434,6 +455,9 @@ static QemuOptsList qemu_icount_opts = {
         }, {
             .name = "rrsnapshot",
             .type = QEMU_OPT_STRING,
+        }, {
+            .name = "rrperiod",
+            .type = QEMU_OPT_NUMBER,
         },
         { /* end of list */ }
     },
@@ -2616,6 +2640,7 @@ static void qemu_init_board(void)
 
     /* From here on we enter MACHINE_PHASE_INITIALIZED.  */
     machine_run_board_init(current_machine);
+    boot_profile_stamp("board-initialized");
 
     drive_check_orphaned();
 
@@ -2645,6 +2670,8 @@ static void qemu_create_cli_devices(void)
     qemu_opts_foreach(qemu_find_opts("device"),
                       device_init_func, NULL, &error_fatal);
     rom_reset_order_override();
+
+    boot_profile_stamp("cli-devices-realized");
 }
 
 static void qemu_machine_creation_done(void)
@@ -2680,6 +2707,8 @@ static void qemu_machine_creation_done(void)
     if (foreach_device_config(DEV_GDB, gdbserver_start) < 0) {
         exit(1);
     }
+
+    boot_profile_stamp("machine-done");
 }
 
 void qmp_x_exit_preconfig(Error **errp)
@@ -2730,6 +2759,8 @@ void qemu_init(int argc, char **argv, char **envp)
     bool userconfig = true;
     FILE *vmstate_dump_file = NULL;
 
+    boot_profile_stamp("start");
+
     qemu_add_opts(&qemu_drive_opts);
     qemu_add_drive_opts(&qemu_legacy_drive_opts);
     qemu_add_drive_opts(&qemu_common_drive_opts);
@@ -2755,6 +2786,7 @@ void qemu_init(int argc, char **argv, char **envp)
     qemu_add_opts(&qemu_tpmdev_opts);
     qemu_add_opts(&qemu_overcommit_opts);
     qemu_add_opts(&qemu_msg_opts);
+    qemu_add_opts(&qemu_boot_profile_opts);
     qemu_add_opts(&qemu_name_opts);
     qemu_add_opts(&qemu_numa_opts);
     qemu_add_opts(&qemu_icount_opts);
@@ -3578,6 +3610,14 @@ void qemu_init(int argc, char **argv, char **envp)
                 }
                 configure_msg(opts);
                 break;
+            case QEMU_OPTION_boot_profile:
+                opts = qemu_opts_parse_noisily(qemu_find_opts("boot-profile"),
+                                               optarg, false);
+                if (!opts) {
+                    exit(1);
+                }
+                boot_profile_parse_opts(opts);
+                break;
             case QEMU_OPTION_dump_vmstate:
                 if (vmstate_dump_file) {
                     error_report("only one '-dump-vmstate' "
@@ -3610,6 +3650,8 @@ void qemu_init(int argc, char **argv, char **envp)
      */
     loc_set_none();
 
+    boot_profile_stamp("options-parsed");
+
     qemu_validate_options(machine_opts_dict);
     qemu_process_sugar_options();
 
@@ -3644,12 +3686,14 @@ void qemu_init(int argc, char **argv, char **envp)
     configure_rtc(qemu_find_opts_singleton("rtc"));
 
     qemu_create_machine(machine_opts_dict);
+    boot_profile_stamp("machine-created");
 
     suspend_mux_open();
 
     qemu_disable_default_devices();
     qemu_create_default_devices();
     qemu_create_early_backends();
+    boot_profile_stamp("early-backends");
 
     qemu_apply_legacy_machine_options(machine_opts_dict);
     qemu_apply_machine_options(machine_opts_dict);
@@ -3662,6 +3706,7 @@ void qemu_init(int argc, char **argv, char **envp)
      */
     configure_accelerators(argv[0]);
     phase_advance(PHASE_ACCEL_CREATED);
+    boot_profile_stamp("accel-configured");
 
     /*
      * Beware, QOM objects created before this point miss global and
@@ -3692,6 +3737,7 @@ void qemu_init(int argc, char **argv, char **envp)
     migration_object_init();
 
     qemu_create_late_backends();
+    boot_profile_stamp("late-backends");
 
     /* parse features once if machine provides default cpu_type */
     current_machine->cpu_type = machine_class->default_cpu_type;
@@ -3716,4 +3762,7 @@ void qemu_init(int argc, char **argv, char **envp)
     accel_setup_post(current_machine);
     os_setup_post();
     resume_mux_open();
+
+    boot_profile_stamp("init-complete");
+    boot_profile_init_done();
 }
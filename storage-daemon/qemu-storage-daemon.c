@@ -51,6 +51,7 @@
 #include "qemu/main-loop.h"
 #include "qemu/module.h"
 #include "qemu/option.h"
+#include "qemu/sockets.h"
 #include "qom/object_interfaces.h"
 
 #include "storage-daemon/qapi/qapi-commands.h"
@@ -60,6 +61,8 @@
 #include "trace/control.h"
 
 static const char *pid_file;
+static const char *fork_server_path;
+static int fork_server_ready_fd = -1;
 static volatile bool exit_requested = false;
 
 void qemu_system_killed(int signal, pid_t pid)
@@ -102,6 +105,12 @@ static void help(void)
 "           [,growable=on|off][,writable=on|off]\n"
 "                         export the specified block node over FUSE\n"
 "\n"
+#ifdef CONFIG_POSIX
+"  --fork-server <path>   listen on a Unix socket and fork one\n"
+"                         preinitialized daemon per connection; must be\n"
+"                         the only option\n"
+"\n"
+#endif
 "  --monitor [chardev=]name[,mode=control][,pretty[=on|off]]\n"
 "                         configure a QMP monitor\n"
 "\n"
@@ -287,6 +296,98 @@ static void process_options(int argc, char *argv[])
     loc_set_none();
 }
 
+#ifdef CONFIG_POSIX
+/*
+ * Accept connections on the fork server socket and fork one child per
+ * connection.  The client sends the child's command-line options as
+ * NUL-terminated strings and shuts down its writing side; once the child
+ * has processed them and its exports are live, it answers with its PID
+ * and closes the connection.
+ *
+ * Only returns in a forked child, with *argcp/*argvp replaced by the
+ * options received over the connection.  All block-layer and main-loop
+ * setup happens after the fork, so children don't share AioContext file
+ * descriptors (epoll instances, io_uring rings) with each other.
+ */
+static void fork_server_serve(int *argcp, char ***argvp)
+{
+    int listen_fd;
+    Error *local_err = NULL;
+
+    listen_fd = unix_listen(fork_server_path, &local_err);
+    if (listen_fd < 0) {
+        error_report_err(local_err);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Children are long-lived and independent; auto-reap them */
+    signal(SIGCHLD, SIG_IGN);
+
+    while (!exit_requested) {
+        g_autoptr(GByteArray) buf = NULL;
+        uint8_t bytes[4096];
+        ssize_t len;
+        int conn_fd;
+        pid_t pid;
+
+        conn_fd = accept(listen_fd, NULL, NULL);
+        if (conn_fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error_report("fork server: accept failed: %s", strerror(errno));
+            break;
+        }
+
+        buf = g_byte_array_new();
+        do {
+            len = read(conn_fd, bytes, sizeof(bytes));
+            if (len > 0) {
+                g_byte_array_append(buf, bytes, len);
+            }
+        } while (len > 0 || (len < 0 && errno == EINTR));
+
+        if (len < 0 || (buf->len && buf->data[buf->len - 1] != '\0')) {
+            error_report("fork server: malformed request");
+            close(conn_fd);
+            continue;
+        }
+
+        pid = fork();
+        if (pid == 0) {
+            GPtrArray *args = g_ptr_array_new();
+            size_t offset = 0;
+
+            close(listen_fd);
+            fork_server_ready_fd = conn_fd;
+
+            g_ptr_array_add(args, (char *)error_get_progname());
+            while (offset < buf->len) {
+                char *arg = (char *)buf->data + offset;
+
+                g_ptr_array_add(args, arg);
+                offset += strlen(arg) + 1;
+            }
+            *argcp = args->len;
+            g_ptr_array_add(args, NULL);
+            *argvp = (char **)g_ptr_array_free(args, false);
+
+            /* The option strings stay backed by the received buffer */
+            g_byte_array_free(g_steal_pointer(&buf), false);
+            return;
+        }
+        if (pid < 0) {
+            error_report("fork server: fork failed: %s", strerror(errno));
+        }
+        close(conn_fd);
+    }
+
+    close(listen_fd);
+    unlink(fork_server_path);
+    exit(EXIT_SUCCESS);
+}
+#endif /* CONFIG_POSIX */
+
 static void pid_file_cleanup(void)
 {
     unlink(pid_file);
@@ -318,6 +419,23 @@ int main(int argc, char *argv[])
     qemu_init_exec_dir(argv[0]);
     os_setup_signal_handling();
 
+#ifdef CONFIG_POSIX
+    /*
+     * The fork server must be set up before anything creates file
+     * descriptors or threads that forked children must not share, so it
+     * cannot be combined with other options: children receive their full
+     * configuration over the socket instead.
+     */
+    if (argc > 1 && g_str_equal(argv[1], "--fork-server")) {
+        if (argc != 3) {
+            error_report("--fork-server requires a socket path and must be "
+                         "the only option");
+            exit(EXIT_FAILURE);
+        }
+        fork_server_path = argv[2];
+    }
+#endif
+
     module_call_init(MODULE_INIT_QOM);
     module_call_init(MODULE_INIT_TRACE);
     qemu_add_opts(&qemu_trace_opts);
@@ -331,6 +449,13 @@ int main(int argc, char *argv[])
     }
     qemu_set_log(LOG_TRACE);
 
+#ifdef CONFIG_POSIX
+    if (fork_server_path) {
+        /* Returns only in a forked child, with that child's options */
+        fork_server_serve(&argc, &argv);
+    }
+#endif
+
     qemu_init_main_loop(&error_fatal);
     process_options(argc, argv);
 
@@ -341,6 +466,15 @@ int main(int argc, char *argv[])
      */
     pid_file_init();
 
+    if (fork_server_ready_fd >= 0) {
+        /* The fork server client is waiting for the exports to be live */
+        g_autofree char *msg = g_strdup_printf("%d\n", (int)getpid());
+
+        qemu_write_full(fork_server_ready_fd, msg, strlen(msg));
+        close(fork_server_ready_fd);
+        fork_server_ready_fd = -1;
+    }
+
     while (!exit_requested) {
         main_loop_wait(false);
     }
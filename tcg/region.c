@@ -24,6 +24,7 @@
 
 #include "qemu/osdep.h"
 #include "qemu/units.h"
+#include "qemu/memusage.h"
 #include "qapi/error.h"
 #include "exec/exec-all.h"
 #include "tcg/tcg.h"
@@ -414,11 +415,20 @@ static size_t tcg_n_regions(size_t tb_size, unsigned max_cpus)
 
     /*
      * Try to have more regions than max_cpus, with each region being >= 2 MB.
-     * If we can't, then just allocate one region per vCPU thread.
+     * If the buffer is too small for that, shrink the regions instead of
+     * falling back to exactly one region per vCPU: with no spare regions,
+     * the first vCPU to fill its region forces a global tb_flush while the
+     * other regions may sit mostly empty.  Since regions are handed out on
+     * demand, spare regions let translation-heavy vCPUs claim more than
+     * their even share.  Note that region pages are faulted in by the
+     * claiming thread at code generation time, so on NUMA hosts each
+     * vCPU's translated code lands on that vCPU's local node for free.
      */
     n_regions = tb_size / (2 * MiB);
     if (n_regions <= max_cpus) {
-        return max_cpus;
+        size_t max_fine = tb_size / (16 * qemu_real_host_page_size);
+
+        return MAX(MIN((size_t)max_cpus * 2, max_fine), 1);
     }
     return MIN(n_regions, max_cpus * 8);
 #endif
@@ -814,6 +824,13 @@ static int alloc_code_gen_buffer(size_t size, int splitwx, Error **errp)
  * in practice. Multi-threaded guests share most if not all of their translated
  * code, which makes parallel code generation less appealing than in softmmu.
  */
+static void tcg_code_mem_usage(MemUsageEmitFn emit, void *emit_opaque,
+                               void *opaque)
+{
+    emit("tcg/code", tcg_code_size(), MEM_USAGE_UNKNOWN, tcg_code_capacity(),
+         emit_opaque);
+}
+
 void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
 {
     const size_t page_size = qemu_real_host_page_size;
@@ -913,6 +930,8 @@ void tcg_region_init(size_t tb_size, int splitwx, unsigned max_cpus)
 
     tcg_region_trees_init();
 
+    mem_usage_register(tcg_code_mem_usage, NULL);
+
     /*
      * Leave the initial context initialized to the first region.
      * This will be the context into which we generate the prologue.
@@ -109,6 +109,20 @@ uint32_t simd_desc(uint32_t oprsz, uint32_t maxsz, int32_t data)
     return desc;
 }
 
+/*
+ * Statistics for "info jit": how often gvec expansion could use host
+ * vector ops, and how often it went out of line to a helper.  Updated
+ * with racy read-modify-writes, like the TCGProfile counters.
+ */
+uint64_t tcg_gvec_vector_expansions;
+uint64_t tcg_gvec_scalar_expansions;
+uint64_t tcg_gvec_ool_expansions;
+
+static void gvec_count_ool(void)
+{
+    qatomic_set(&tcg_gvec_ool_expansions, tcg_gvec_ool_expansions + 1);
+}
+
 /* Generate a call to a gvec-style helper with two vector operands.  */
 void tcg_gen_gvec_2_ool(uint32_t dofs, uint32_t aofs,
                         uint32_t oprsz, uint32_t maxsz, int32_t data,
@@ -123,6 +137,7 @@ void tcg_gen_gvec_2_ool(uint32_t dofs, uint32_t aofs,
     tcg_gen_addi_ptr(a0, cpu_env, dofs);
     tcg_gen_addi_ptr(a1, cpu_env, aofs);
 
+    gvec_count_ool();
     fn(a0, a1, desc);
 
     tcg_temp_free_ptr(a0);
@@ -144,6 +159,7 @@ void tcg_gen_gvec_2i_ool(uint32_t dofs, uint32_t aofs, TCGv_i64 c,
     tcg_gen_addi_ptr(a0, cpu_env, dofs);
     tcg_gen_addi_ptr(a1, cpu_env, aofs);
 
+    gvec_count_ool();
     fn(a0, a1, c, desc);
 
     tcg_temp_free_ptr(a0);
@@ -166,6 +182,7 @@ void tcg_gen_gvec_3_ool(uint32_t dofs, uint32_t aofs, uint32_t bofs,
     tcg_gen_addi_ptr(a1, cpu_env, aofs);
     tcg_gen_addi_ptr(a2, cpu_env, bofs);
 
+    gvec_count_ool();
     fn(a0, a1, a2, desc);
 
     tcg_temp_free_ptr(a0);
@@ -191,6 +208,7 @@ void tcg_gen_gvec_4_ool(uint32_t dofs, uint32_t aofs, uint32_t bofs,
     tcg_gen_addi_ptr(a2, cpu_env, bofs);
     tcg_gen_addi_ptr(a3, cpu_env, cofs);
 
+    gvec_count_ool();
     fn(a0, a1, a2, a3, desc);
 
     tcg_temp_free_ptr(a0);
@@ -219,6 +237,7 @@ void tcg_gen_gvec_5_ool(uint32_t dofs, uint32_t aofs, uint32_t bofs,
     tcg_gen_addi_ptr(a3, cpu_env, cofs);
     tcg_gen_addi_ptr(a4, cpu_env, xofs);
 
+    gvec_count_ool();
     fn(a0, a1, a2, a3, a4, desc);
 
     tcg_temp_free_ptr(a0);
@@ -469,6 +488,22 @@ static TCGType choose_vector_type(const TCGOpcode *list, unsigned vece,
     return 0;
 }
 
+/* Count the outcome of choose_vector_type for "info jit".  */
+static TCGType counted_vector_type(const TCGOpcode *list, unsigned vece,
+                                   uint32_t size, bool prefer_i64)
+{
+    TCGType type = choose_vector_type(list, vece, size, prefer_i64);
+
+    if (type) {
+        qatomic_set(&tcg_gvec_vector_expansions,
+                    tcg_gvec_vector_expansions + 1);
+    } else {
+        qatomic_set(&tcg_gvec_scalar_expansions,
+                    tcg_gvec_scalar_expansions + 1);
+    }
+    return type;
+}
+
 static void do_dup_store(TCGType type, uint32_t dofs, uint32_t oprsz,
                          uint32_t maxsz, TCGv_vec t_vec)
 {
@@ -547,7 +582,7 @@ static void do_dup(unsigned vece, uint32_t dofs, uint32_t oprsz,
     /* Implement inline with a vector type, if possible.
      * Prefer integer when 64-bit host and no variable dup.
      */
-    type = choose_vector_type(NULL, vece, oprsz,
+    type = counted_vector_type(NULL, vece, oprsz,
                               (TCG_TARGET_REG_BITS == 64 && in_32 == NULL
                                && (in_64 == NULL || vece == MO_64)));
     if (type != 0) {
@@ -1135,7 +1170,7 @@ void tcg_gen_gvec_2(uint32_t dofs, uint32_t aofs,
 
     type = 0;
     if (g->fniv) {
-        type = choose_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
+        type = counted_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
     }
     switch (type) {
     case TCG_TYPE_V256:
@@ -1199,7 +1234,7 @@ void tcg_gen_gvec_2i(uint32_t dofs, uint32_t aofs, uint32_t oprsz,
 
     type = 0;
     if (g->fniv) {
-        type = choose_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
+        type = counted_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
     }
     switch (type) {
     case TCG_TYPE_V256:
@@ -1265,7 +1300,7 @@ void tcg_gen_gvec_2s(uint32_t dofs, uint32_t aofs, uint32_t oprsz,
 
     type = 0;
     if (g->fniv) {
-        type = choose_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
+        type = counted_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
     }
     if (type != 0) {
         const TCGOpcode *this_list = g->opt_opc ? : vecop_list_empty;
@@ -1345,7 +1380,7 @@ void tcg_gen_gvec_3(uint32_t dofs, uint32_t aofs, uint32_t bofs,
 
     type = 0;
     if (g->fniv) {
-        type = choose_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
+        type = counted_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
     }
     switch (type) {
     case TCG_TYPE_V256:
@@ -1412,7 +1447,7 @@ void tcg_gen_gvec_3i(uint32_t dofs, uint32_t aofs, uint32_t bofs,
 
     type = 0;
     if (g->fniv) {
-        type = choose_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
+        type = counted_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
     }
     switch (type) {
     case TCG_TYPE_V256:
@@ -1478,7 +1513,7 @@ void tcg_gen_gvec_4(uint32_t dofs, uint32_t aofs, uint32_t bofs, uint32_t cofs,
 
     type = 0;
     if (g->fniv) {
-        type = choose_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
+        type = counted_vector_type(g->opt_opc, g->vece, oprsz, g->prefer_i64);
     }
     switch (type) {
     case TCG_TYPE_V256:
@@ -2996,7 +3031,7 @@ do_gvec_shifts(unsigned vece, uint32_t dofs, uint32_t aofs, TCGv_i32 shift,
     check_overlap_2(dofs, aofs, maxsz);
 
     /* If the backend has a scalar expansion, great.  */
-    type = choose_vector_type(g->s_list, vece, oprsz, vece == MO_64);
+    type = counted_vector_type(g->s_list, vece, oprsz, vece == MO_64);
     if (type) {
         const TCGOpcode *hold_list = tcg_swap_vecop_list(NULL);
         switch (type) {
@@ -3028,7 +3063,7 @@ do_gvec_shifts(unsigned vece, uint32_t dofs, uint32_t aofs, TCGv_i32 shift,
     }
 
     /* If the backend supports variable vector shifts, also cool.  */
-    type = choose_vector_type(g->v_list, vece, oprsz, vece == MO_64);
+    type = counted_vector_type(g->v_list, vece, oprsz, vece == MO_64);
     if (type) {
         const TCGOpcode *hold_list = tcg_swap_vecop_list(NULL);
         TCGv_vec v_shift = tcg_temp_new_vec(type);
@@ -3619,7 +3654,7 @@ void tcg_gen_gvec_cmp(TCGCond cond, unsigned vece, uint32_t dofs,
      * Prefer integer when 64-bit host and 64-bit comparison.
      */
     hold_list = tcg_swap_vecop_list(cmp_list);
-    type = choose_vector_type(cmp_list, vece, oprsz,
+    type = counted_vector_type(cmp_list, vece, oprsz,
                               TCG_TARGET_REG_BITS == 64 && vece == MO_64);
     switch (type) {
     case TCG_TYPE_V256:
@@ -0,0 +1,325 @@
+/*
+ * AioContext and coroutine microbenchmarks
+ *
+ * The correctness tests in tests/unit/test-aio.c and test-coroutine.c
+ * time a few loops, but only report totals.  The dispatch paths in
+ * util/async.c and util/qemu-coroutine.c care about tail latency as
+ * much as throughput, so every benchmark here collects per-iteration
+ * samples and reports mean, p50, p99 and worst case, as one JSON
+ * object per benchmark.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "block/aio.h"
+#include "qemu/atomic.h"
+#include "qapi/error.h"
+#include "qemu/coroutine.h"
+#include "qemu/main-loop.h"
+#include "qemu/thread.h"
+#include "qemu/timer.h"
+
+static AioContext *ctx;
+
+#define LATENCY_SAMPLES     10000
+#define BATCH_SAMPLES       2000
+/* Coroutine operations are too cheap to time one by one; time batches
+ * and report the per-operation cost. */
+#define BATCH_OPS           64
+
+static int cmp_int64(const void *a, const void *b)
+{
+    int64_t va = *(const int64_t *)a, vb = *(const int64_t *)b;
+
+    return va < vb ? -1 : va > vb;
+}
+
+static void report(const char *name, int64_t *samples, size_t nsamples,
+                   unsigned ops_per_sample)
+{
+    double sum = 0;
+    size_t i;
+
+    qsort(samples, nsamples, sizeof(samples[0]), cmp_int64);
+    for (i = 0; i < nsamples; i++) {
+        sum += samples[i];
+    }
+
+    g_test_message("{\"bench\": \"%s\", \"samples\": %zu, "
+                   "\"mean-ns\": %.1f, \"p50-ns\": %.1f, "
+                   "\"p99-ns\": %.1f, \"max-ns\": %.1f}",
+                   name, nsamples,
+                   sum / nsamples / ops_per_sample,
+                   (double)samples[nsamples / 2] / ops_per_sample,
+                   (double)samples[nsamples * 99 / 100] / ops_per_sample,
+                   (double)samples[nsamples - 1] / ops_per_sample);
+}
+
+/*
+ * Coroutine create/terminate cost with a warm release pool, i.e. the
+ * price the block layer pays per request in steady state.
+ */
+
+static void coroutine_fn empty_coroutine(void *opaque)
+{
+}
+
+static void bench_co_recycle(void)
+{
+    int64_t *samples = g_new(int64_t, BATCH_SAMPLES);
+    unsigned i, j;
+
+    for (i = 0; i < BATCH_SAMPLES; i++) {
+        int64_t t0 = get_clock();
+
+        for (j = 0; j < BATCH_OPS; j++) {
+            qemu_coroutine_enter(qemu_coroutine_create(empty_coroutine, NULL));
+        }
+        samples[i] = get_clock() - t0;
+    }
+
+    report("coroutine-recycle", samples, BATCH_SAMPLES, BATCH_OPS);
+    g_free(samples);
+}
+
+/*
+ * Coroutine switch cost: enter a coroutine that yields straight back,
+ * so each operation is one switch in and one switch out.
+ */
+
+static void coroutine_fn yield_loop(void *opaque)
+{
+    bool *done = opaque;
+
+    while (!*done) {
+        qemu_coroutine_yield();
+    }
+}
+
+static void bench_co_switch(void)
+{
+    int64_t *samples = g_new(int64_t, BATCH_SAMPLES);
+    bool done = false;
+    Coroutine *co = qemu_coroutine_create(yield_loop, &done);
+    unsigned i, j;
+
+    qemu_coroutine_enter(co);
+
+    for (i = 0; i < BATCH_SAMPLES; i++) {
+        int64_t t0 = get_clock();
+
+        for (j = 0; j < BATCH_OPS; j++) {
+            qemu_coroutine_enter(co);
+        }
+        samples[i] = get_clock() - t0;
+    }
+
+    done = true;
+    qemu_coroutine_enter(co);
+
+    report("coroutine-switch", samples, BATCH_SAMPLES, BATCH_OPS);
+    g_free(samples);
+}
+
+/*
+ * Bottom half schedule-to-run latency in the home thread.
+ */
+
+typedef struct {
+    QEMUBH *bh;
+    int64_t t_run;
+} BHLatency;
+
+static void bh_record_cb(void *opaque)
+{
+    BHLatency *b = opaque;
+
+    b->t_run = get_clock();
+}
+
+static void bench_bh_latency(void)
+{
+    int64_t *samples = g_new(int64_t, LATENCY_SAMPLES);
+    BHLatency b = {};
+    unsigned i;
+
+    b.bh = aio_bh_new(ctx, bh_record_cb, &b);
+
+    for (i = 0; i < LATENCY_SAMPLES; i++) {
+        int64_t t0 = get_clock();
+
+        b.t_run = 0;
+        qemu_bh_schedule(b.bh);
+        while (!b.t_run) {
+            aio_poll(ctx, true);
+        }
+        samples[i] = b.t_run - t0;
+    }
+
+    qemu_bh_delete(b.bh);
+    report("bh-schedule-to-run", samples, LATENCY_SAMPLES, 1);
+    g_free(samples);
+}
+
+/*
+ * Event notifier dispatch latency while the context carries N idle
+ * handlers that never fire, to show how the handler walk in aio_poll()
+ * scales with registration count.
+ */
+
+typedef struct {
+    EventNotifier e;
+    int64_t t_run;
+} NotifierLatency;
+
+static void notifier_record_cb(EventNotifier *e)
+{
+    NotifierLatency *n = container_of(e, NotifierLatency, e);
+
+    event_notifier_test_and_clear(e);
+    n->t_run = get_clock();
+}
+
+static void notifier_idle_cb(EventNotifier *e)
+{
+    event_notifier_test_and_clear(e);
+}
+
+static void bench_poll_idle_handlers(unsigned nidle)
+{
+    int64_t *samples = g_new(int64_t, LATENCY_SAMPLES);
+    EventNotifier *idle = g_new(EventNotifier, nidle);
+    NotifierLatency n = {};
+    g_autofree char *name = g_strdup_printf("poll-wakeup-idle-%u", nidle);
+    unsigned i;
+
+    for (i = 0; i < nidle; i++) {
+        event_notifier_init(&idle[i], 0);
+        aio_set_event_notifier(ctx, &idle[i], false, notifier_idle_cb, NULL);
+    }
+    event_notifier_init(&n.e, 0);
+    aio_set_event_notifier(ctx, &n.e, false, notifier_record_cb, NULL);
+
+    for (i = 0; i < LATENCY_SAMPLES; i++) {
+        int64_t t0 = get_clock();
+
+        n.t_run = 0;
+        event_notifier_set(&n.e);
+        while (!n.t_run) {
+            aio_poll(ctx, true);
+        }
+        samples[i] = n.t_run - t0;
+    }
+
+    aio_set_event_notifier(ctx, &n.e, false, NULL, NULL);
+    event_notifier_cleanup(&n.e);
+    for (i = 0; i < nidle; i++) {
+        aio_set_event_notifier(ctx, &idle[i], false, NULL, NULL);
+        event_notifier_cleanup(&idle[i]);
+    }
+
+    report(name, samples, LATENCY_SAMPLES, 1);
+    g_free(idle);
+    g_free(samples);
+}
+
+static void bench_poll_idle_1(void)
+{
+    bench_poll_idle_handlers(1);
+}
+
+static void bench_poll_idle_100(void)
+{
+    bench_poll_idle_handlers(100);
+}
+
+static void bench_poll_idle_1000(void)
+{
+    bench_poll_idle_handlers(1000);
+}
+
+/*
+ * Cross-thread wakeup latency: the main thread blocks in aio_poll()
+ * with ctx->notify_me raised while a second thread schedules a bottom
+ * half, so every sample pays for aio_notify() and the event notifier
+ * round trip.
+ */
+
+typedef struct {
+    QEMUBH *bh;
+    int64_t *samples;
+    unsigned count;
+    bool ran;       /* read/written with atomics from both threads */
+    bool done;
+} WakeupState;
+
+static void wakeup_bh_cb(void *opaque)
+{
+    WakeupState *w = opaque;
+
+    qatomic_set(&w->ran, true);
+}
+
+static void *wakeup_thread_fn(void *opaque)
+{
+    WakeupState *w = opaque;
+    unsigned i;
+
+    for (i = 0; i < w->count; i++) {
+        int64_t t0 = get_clock();
+
+        qatomic_set(&w->ran, false);
+        qemu_bh_schedule(w->bh);
+        while (!qatomic_read(&w->ran)) {
+            g_usleep(0);
+        }
+        w->samples[i] = get_clock() - t0;
+    }
+
+    qatomic_set(&w->done, true);
+    qemu_bh_schedule(w->bh);
+    return NULL;
+}
+
+static void bench_cross_thread_wakeup(void)
+{
+    WakeupState w = {
+        .samples = g_new(int64_t, LATENCY_SAMPLES),
+        .count = LATENCY_SAMPLES,
+    };
+    QemuThread thread;
+
+    w.bh = aio_bh_new(ctx, wakeup_bh_cb, &w);
+    qemu_thread_create(&thread, "wakeup-bench", wakeup_thread_fn, &w,
+                       QEMU_THREAD_JOINABLE);
+
+    while (!qatomic_read(&w.done)) {
+        aio_poll(ctx, true);
+    }
+    qemu_thread_join(&thread);
+    qemu_bh_delete(w.bh);
+
+    report("cross-thread-wakeup", w.samples, LATENCY_SAMPLES, 1);
+    g_free(w.samples);
+}
+
+int main(int argc, char **argv)
+{
+    qemu_init_main_loop(&error_fatal);
+    ctx = qemu_get_aio_context();
+
+    while (g_main_context_iteration(NULL, false)) {
+    }
+
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/aio-bench/coroutine/recycle", bench_co_recycle);
+    g_test_add_func("/aio-bench/coroutine/switch", bench_co_switch);
+    g_test_add_func("/aio-bench/bh/latency", bench_bh_latency);
+    g_test_add_func("/aio-bench/poll/idle-1", bench_poll_idle_1);
+    g_test_add_func("/aio-bench/poll/idle-100", bench_poll_idle_100);
+    g_test_add_func("/aio-bench/poll/idle-1000", bench_poll_idle_1000);
+    g_test_add_func("/aio-bench/notify/cross-thread", bench_cross_thread_wakeup);
+    return g_test_run();
+}
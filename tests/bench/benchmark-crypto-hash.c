@@ -56,6 +56,47 @@ static void test_hash_speed(const void *opaque)
     g_free(in);
 }
 
+#define BATCH_NBUFS 8
+
+static void test_hash_batch_speed(const void *opaque)
+{
+    const QCryptoHashOpts *opts = opaque;
+    uint8_t *in = NULL, *results = NULL;
+    size_t resultlen = qcrypto_hash_digest_len(opts->alg);
+    const size_t total = 2 * GiB;
+    size_t remain;
+    struct iovec iov[BATCH_NBUFS];
+    int i, ret;
+
+    in = g_new0(uint8_t, opts->chunk_size * BATCH_NBUFS);
+    memset(in, g_test_rand_int(), opts->chunk_size * BATCH_NBUFS);
+    results = g_new0(uint8_t, resultlen * BATCH_NBUFS);
+
+    for (i = 0; i < BATCH_NBUFS; i++) {
+        iov[i].iov_base = (char *)in + i * opts->chunk_size;
+        iov[i].iov_len = opts->chunk_size;
+    }
+
+    g_test_timer_start();
+    remain = total;
+    while (remain) {
+        ret = qcrypto_hash_batchv(opts->alg,
+                                  iov, BATCH_NBUFS, results, resultlen,
+                                  NULL);
+        g_assert(ret == 0);
+
+        remain -= opts->chunk_size * BATCH_NBUFS;
+    }
+    g_test_timer_elapsed();
+
+    g_test_message("hash-batch(%s): %d x %zu bytes %.2f MB/sec",
+                   QCryptoHashAlgorithm_str(opts->alg),
+                   BATCH_NBUFS, opts->chunk_size, total / g_test_timer_last());
+
+    g_free(results);
+    g_free(in);
+}
+
 int main(int argc, char **argv)
 {
     char name[64];
@@ -112,5 +153,24 @@ int main(int argc, char **argv)
     TEST_ONE(RIPEMD160, 4096);
     TEST_ONE(RIPEMD160, 16384);
 
+#define TEST_BATCH_ONE(a, c)                                    \
+    QCryptoHashOpts optsb ## a ## c = {                         \
+        .alg = QCRYPTO_HASH_ALG_ ## a, .chunk_size = c,         \
+    };                                                          \
+    memset(name, 0 , sizeof(name));                             \
+    snprintf(name, sizeof(name),                                \
+             "/crypto/benchmark/hash-batch/%s/bufsize-%d",      \
+             QCryptoHashAlgorithm_str(QCRYPTO_HASH_ALG_ ## a),  \
+             c);                                                \
+    if (qcrypto_hash_supports(QCRYPTO_HASH_ALG_ ## a))          \
+        g_test_add_data_func(name,                              \
+                             &optsb ## a ## c,                  \
+                             test_hash_batch_speed);
+
+    TEST_BATCH_ONE(MD5, 4096);
+    TEST_BATCH_ONE(SHA1, 4096);
+    TEST_BATCH_ONE(SHA256, 4096);
+    TEST_BATCH_ONE(SHA512, 4096);
+
     return g_test_run();
 }
@@ -0,0 +1,72 @@
+/*
+ * QEMU iov copy speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/units.h"
+#include "qemu/iov.h"
+
+typedef struct IovBenchOpts {
+    unsigned int iov_cnt;
+    size_t seg_size;
+} IovBenchOpts;
+
+static void bench_iov_copy(const void *opaque)
+{
+    const IovBenchOpts *opts = opaque;
+    size_t len = opts->iov_cnt * opts->seg_size;
+    const size_t total = 1 * GiB;
+    g_autofree uint8_t *mem = g_malloc(len);
+    g_autofree uint8_t *buf = g_malloc(len);
+    g_autofree struct iovec *iov = g_new(struct iovec, opts->iov_cnt);
+    size_t remain;
+    unsigned int i;
+
+    for (i = 0; i < opts->iov_cnt; i++) {
+        iov[i].iov_base = mem + i * opts->seg_size;
+        iov[i].iov_len = opts->seg_size;
+    }
+    memset(buf, g_test_rand_int(), len);
+
+    g_test_timer_start();
+    remain = total;
+    while (remain) {
+        size_t done;
+
+        done = iov_from_buf(iov, opts->iov_cnt, 0, buf, len);
+        g_assert(done == len);
+        done = iov_to_buf(iov, opts->iov_cnt, 0, buf, len);
+        g_assert(done == len);
+        remain -= 2 * len;
+    }
+    g_test_timer_elapsed();
+
+    g_test_message("iov copy: %u x %zu bytes: %.2f MB/sec",
+                   opts->iov_cnt, opts->seg_size,
+                   (double)total / MiB / g_test_timer_last());
+}
+
+int main(int argc, char **argv)
+{
+    static const unsigned int cnts[] = { 1, 2, 4, 8 };
+    static IovBenchOpts opts[ARRAY_SIZE(cnts)];
+    size_t i;
+
+    g_test_init(&argc, &argv, NULL);
+
+    for (i = 0; i < ARRAY_SIZE(cnts); i++) {
+        char *name = g_strdup_printf("/iov/copy/%u-segments", cnts[i]);
+
+        opts[i] = (IovBenchOpts) {
+            .iov_cnt = cnts[i],
+            .seg_size = 4 * KiB,
+        };
+        g_test_add_data_func(name, &opts[i], bench_iov_copy);
+        g_free(name);
+    }
+
+    return g_test_run();
+}
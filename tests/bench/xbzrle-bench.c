@@ -0,0 +1,87 @@
+/*
+ * XBZRLE encoder speed benchmark
+ *
+ * Copyright (c) 2021 QEMU contributors
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/units.h"
+#include "qemu/cutils.h"
+#include "../migration/xbzrle.h"
+
+#define XBZRLE_PAGE_SIZE 4096
+
+typedef struct XbzrleBenchOpts {
+    /* distance between modified bytes; 0 leaves the page unchanged */
+    int stride;
+} XbzrleBenchOpts;
+
+static void xbzrle_encode_speed(const void *opaque)
+{
+    const XbzrleBenchOpts *opts = opaque;
+    const size_t total = 1 * GiB;
+    uint8_t *old_buf = g_malloc0(XBZRLE_PAGE_SIZE);
+    uint8_t *new_buf = g_malloc0(XBZRLE_PAGE_SIZE);
+    uint8_t *compressed = g_malloc0(2 * XBZRLE_PAGE_SIZE);
+    size_t remain;
+    int i;
+
+    for (i = 0; i < XBZRLE_PAGE_SIZE; i++) {
+        old_buf[i] = g_test_rand_int();
+    }
+    memcpy(new_buf, old_buf, XBZRLE_PAGE_SIZE);
+    if (opts->stride) {
+        for (i = 0; i < XBZRLE_PAGE_SIZE; i += opts->stride) {
+            new_buf[i] ^= 0xff;
+        }
+    }
+
+    g_test_timer_start();
+    remain = total;
+    while (remain) {
+        int ret;
+
+        ret = xbzrle_encode_buffer(old_buf, new_buf, XBZRLE_PAGE_SIZE,
+                                   compressed, 2 * XBZRLE_PAGE_SIZE);
+        g_assert(ret >= 0);
+
+        remain -= XBZRLE_PAGE_SIZE;
+    }
+    g_test_timer_elapsed();
+
+    g_test_message("xbzrle encode: stride %d: %.2f MB/sec",
+                   opts->stride, (double)(total / MiB) / g_test_timer_last());
+
+    g_free(compressed);
+    g_free(new_buf);
+    g_free(old_buf);
+}
+
+int main(int argc, char **argv)
+{
+    char name[64];
+
+    g_test_init(&argc, &argv, NULL);
+
+#define TEST_ONE(s)                                             \
+    static const XbzrleBenchOpts opts_ ## s = {                 \
+        .stride = s,                                            \
+    };                                                          \
+    snprintf(name, sizeof(name),                                \
+             "/migration/benchmark/xbzrle/stride-%d", s);       \
+    g_test_add_data_func(name, &opts_ ## s, xbzrle_encode_speed);
+
+    TEST_ONE(0);
+    TEST_ONE(1024);
+    TEST_ONE(256);
+    TEST_ONE(64);
+    TEST_ONE(16);
+    TEST_ONE(4);
+
+#undef TEST_ONE
+
+    return g_test_run();
+}
@@ -0,0 +1,244 @@
+/*
+ * Datapath benchmark for the VirtIO Block Device
+ *
+ * Drives a virtio-blk-pci request ring directly through libqos, keeping a
+ * configurable number of requests in flight, and reports the achieved
+ * request rate.  The results are emitted as one JSON object per
+ * configuration so that runs from different builds can be diffed or fed
+ * to scripts/simplebench (each record carries a 'seconds' key).
+ *
+ * This is a benchmark, not a functional test: it only asserts that
+ * requests complete successfully, and is registered in the 'speed'
+ * suite so it does not run as part of the normal qtest suites.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "standard-headers/linux/virtio_blk.h"
+#include "libqos/libqos-pc.h"
+#include "libqos/virtio-pci.h"
+
+#define TEST_IMAGE_SIZE         (64 * 1024 * 1024)
+#define PCI_SLOT                0x04
+
+#define BENCH_REQUEST_BYTES     4096
+#define BENCH_REQUESTS          4096
+#define BENCH_TIMEOUT_US        (300 * 1000 * 1000)
+
+static const unsigned bench_queue_depths[] = { 1, 8, 32 };
+
+#ifdef HOST_WORDS_BIGENDIAN
+static const bool host_is_big_endian = true;
+#else
+static const bool host_is_big_endian; /* false */
+#endif
+
+typedef struct QVirtioBlkHdr {
+    uint32_t type;
+    uint32_t ioprio;
+    uint64_t sector;
+} QVirtioBlkHdr;
+
+/*
+ * One guest buffer per in-flight request.  The 16 byte request header,
+ * the data and the status byte live in a single allocation; the
+ * three-descriptor chain set up for it at the start of a run is reused
+ * unchanged for every resubmission, so the steady-state loop only
+ * touches the avail ring, the used ring and the doorbell.
+ */
+typedef struct BenchSlot {
+    uint64_t addr;
+    uint32_t head;
+} BenchSlot;
+
+static void bench_blk_op(QOSState *qs, QVirtioDevice *dev, QVirtQueue *vq,
+                         const char *backend, bool is_write, unsigned depth)
+{
+    QTestState *qts = qs->qts;
+    BenchSlot *slots = g_new0(BenchSlot, depth);
+    unsigned submitted, completed;
+    gint64 start, elapsed_us;
+    double seconds;
+    unsigned i;
+
+    g_assert_cmpuint(3 * depth, <=, vq->size);
+    g_assert_cmpuint(depth, <=, BENCH_REQUESTS);
+
+    for (i = 0; i < depth; i++) {
+        QVirtioBlkHdr hdr = {
+            .type = is_write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN,
+            .ioprio = 0,
+            /* Each slot always targets the same sectors; the benchmark
+             * measures ring and completion throughput, not media layout. */
+            .sector = i * (BENCH_REQUEST_BYTES / 512),
+        };
+
+        if (qvirtio_is_big_endian(dev) != host_is_big_endian) {
+            hdr.type = bswap32(hdr.type);
+            hdr.ioprio = bswap32(hdr.ioprio);
+            hdr.sector = bswap64(hdr.sector);
+        }
+
+        slots[i].addr = guest_alloc(&qs->alloc,
+                                    sizeof(hdr) + BENCH_REQUEST_BYTES + 1);
+        qtest_memwrite(qts, slots[i].addr, &hdr, sizeof(hdr));
+        if (is_write) {
+            qtest_memset(qts, slots[i].addr + sizeof(hdr), 0xc5,
+                         BENCH_REQUEST_BYTES);
+        }
+
+        slots[i].head = qvirtqueue_add(qts, vq, slots[i].addr,
+                                       sizeof(hdr), false, true);
+        qvirtqueue_add(qts, vq, slots[i].addr + sizeof(hdr),
+                       BENCH_REQUEST_BYTES, !is_write, true);
+        qvirtqueue_add(qts, vq,
+                       slots[i].addr + sizeof(hdr) + BENCH_REQUEST_BYTES,
+                       1, true, false);
+    }
+
+    start = g_get_monotonic_time();
+
+    for (i = 0; i < depth; i++) {
+        qvirtqueue_kick(qts, dev, vq, slots[i].head);
+    }
+    submitted = depth;
+    completed = 0;
+
+    while (completed < BENCH_REQUESTS) {
+        uint32_t desc_idx;
+
+        qtest_clock_step(qts, 100);
+
+        while (qvirtqueue_get_buf(qts, vq, &desc_idx, NULL)) {
+            completed++;
+            if (submitted < BENCH_REQUESTS) {
+                /* The chain behind desc_idx is complete; resubmit it. */
+                qvirtqueue_kick(qts, dev, vq, desc_idx);
+                submitted++;
+            }
+        }
+
+        g_assert(g_get_monotonic_time() - start <= BENCH_TIMEOUT_US);
+    }
+
+    elapsed_us = g_get_monotonic_time() - start;
+    seconds = (double)elapsed_us / G_USEC_PER_SEC;
+
+    for (i = 0; i < depth; i++) {
+        uint8_t status = qtest_readb(qts, slots[i].addr +
+                                     sizeof(QVirtioBlkHdr) +
+                                     BENCH_REQUEST_BYTES);
+        g_assert_cmpint(status, ==, 0);
+        guest_free(&qs->alloc, slots[i].addr);
+    }
+    g_free(slots);
+
+    /* All chains have completed; recycle the descriptor table so
+     * consecutive runs cannot walk off the end of it. */
+    vq->free_head = 0;
+    vq->num_free = vq->size;
+
+    g_test_message("{\"device\": \"virtio-blk\", \"backend\": \"%s\", "
+                   "\"op\": \"%s\", \"queue-depth\": %u, "
+                   "\"request-bytes\": %u, \"requests\": %u, "
+                   "\"seconds\": %.6f, \"iops\": %.1f, \"mbps\": %.1f}",
+                   backend, is_write ? "write" : "read", depth,
+                   BENCH_REQUEST_BYTES, BENCH_REQUESTS, seconds,
+                   BENCH_REQUESTS / seconds,
+                   (double)BENCH_REQUESTS * BENCH_REQUEST_BYTES /
+                   (1024 * 1024) / seconds);
+}
+
+static void bench_backend(const char *backend, const char *file)
+{
+    QOSState *qs;
+    QVirtioPCIDevice *dev;
+    QVirtQueue *vq;
+    uint64_t features;
+    unsigned i;
+
+    qs = qtest_pc_boot("-drive if=none,id=drive0,file=%s,format=raw "
+                       "-device virtio-blk-pci,id=blk0,drive=drive0,"
+                       "addr=%x.0",
+                       file, PCI_SLOT);
+
+    dev = virtio_pci_new(qs->pcibus,
+                         &(QPCIAddress) { .devfn = QPCI_DEVFN(PCI_SLOT, 0) });
+    g_assert_nonnull(dev);
+    g_assert_cmpint(dev->vdev.device_type, ==, VIRTIO_ID_BLOCK);
+    qvirtio_pci_device_enable(dev);
+    qvirtio_start_device(&dev->vdev);
+
+    features = qvirtio_get_features(&dev->vdev);
+    features &= ~(QVIRTIO_F_BAD_FEATURE |
+                  (1ull << VIRTIO_RING_F_INDIRECT_DESC) |
+                  (1ull << VIRTIO_RING_F_EVENT_IDX) |
+                  (1ull << VIRTIO_BLK_F_SCSI));
+    qvirtio_set_features(&dev->vdev, features);
+
+    vq = qvirtqueue_setup(&dev->vdev, &qs->alloc, 0);
+    qvirtio_set_driver_ok(&dev->vdev);
+
+    for (i = 0; i < ARRAY_SIZE(bench_queue_depths); i++) {
+        bench_blk_op(qs, &dev->vdev, vq, backend, false,
+                     bench_queue_depths[i]);
+        bench_blk_op(qs, &dev->vdev, vq, backend, true,
+                     bench_queue_depths[i]);
+    }
+
+    qvirtqueue_cleanup(dev->vdev.bus, vq, &qs->alloc);
+    qvirtio_pci_device_disable(dev);
+    qos_object_destroy((QOSGraphObject *)dev);
+    qtest_pc_shutdown(qs);
+}
+
+static char *drive_create(void)
+{
+    int fd, ret;
+    char *t_path;
+
+    /* Keep the image in RAM when the host offers a tmpfs for it, so the
+     * file backend measures the block layer rather than the disk. */
+    if (g_file_test("/dev/shm", G_FILE_TEST_IS_DIR)) {
+        t_path = g_strdup("/dev/shm/qtest.XXXXXX");
+    } else {
+        t_path = g_strdup("/tmp/qtest.XXXXXX");
+    }
+
+    fd = mkstemp(t_path);
+    g_assert_cmpint(fd, >=, 0);
+
+    ret = ftruncate(fd, TEST_IMAGE_SIZE);
+    g_assert_cmpint(ret, ==, 0);
+    close(fd);
+
+    return t_path;
+}
+
+static void bench_null(void)
+{
+    bench_backend("null-co", "null-co://");
+}
+
+static void bench_file(void)
+{
+    char *t_path = drive_create();
+
+    bench_backend("file", t_path);
+
+    unlink(t_path);
+    g_free(t_path);
+}
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/virtio-blk/bench/null", bench_null);
+    g_test_add_func("/virtio-blk/bench/file", bench_file);
+
+    return g_test_run();
+}
@@ -0,0 +1,301 @@
+/*
+ * Datapath benchmark for the VirtIO NIC
+ *
+ * Measures packets per second through the virtio-net rx and tx rings
+ * against a socketpair netdev acting as a dummy peer, at several queue
+ * depths.  Like virtio-blk-bench, results are emitted as one JSON
+ * object per configuration (with a 'seconds' key) so runs from
+ * different builds can be compared with scripts/simplebench.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/iov.h"
+#include "standard-headers/linux/virtio_net.h"
+#include "libqos/libqos-pc.h"
+#include "libqos/virtio-pci.h"
+
+#define PCI_SLOT                0x04
+#define VNET_HDR_SIZE           sizeof(struct virtio_net_hdr_mrg_rxbuf)
+
+#define BENCH_FRAME_BYTES       256
+#define BENCH_FRAMES            4096
+#define BENCH_TIMEOUT_US        (300 * 1000 * 1000)
+
+static const unsigned bench_queue_depths[] = { 1, 8, 32 };
+
+#ifndef _WIN32
+
+typedef struct BenchNet {
+    QOSState *qs;
+    QVirtioPCIDevice *dev;
+    QVirtQueue *rx;
+    QVirtQueue *tx;
+    int socket;     /* our end of the socketpair backing the netdev */
+} BenchNet;
+
+static void bench_net_boot(BenchNet *net)
+{
+    int sv[2], ret;
+    uint64_t features;
+
+    ret = socketpair(PF_UNIX, SOCK_STREAM, 0, sv);
+    g_assert_cmpint(ret, !=, -1);
+
+    net->qs = qtest_pc_boot("-netdev socket,fd=%d,id=hs0 "
+                            "-device virtio-net-pci,netdev=hs0,addr=%x.0",
+                            sv[1], PCI_SLOT);
+    net->socket = sv[0];
+
+    net->dev = virtio_pci_new(net->qs->pcibus,
+                              &(QPCIAddress) {
+                                  .devfn = QPCI_DEVFN(PCI_SLOT, 0)
+                              });
+    g_assert_nonnull(net->dev);
+    g_assert_cmpint(net->dev->vdev.device_type, ==, VIRTIO_ID_NET);
+    qvirtio_pci_device_enable(net->dev);
+    qvirtio_start_device(&net->dev->vdev);
+
+    features = qvirtio_get_features(&net->dev->vdev);
+    features &= ~(QVIRTIO_F_BAD_FEATURE |
+                  (1ull << VIRTIO_RING_F_INDIRECT_DESC) |
+                  (1ull << VIRTIO_RING_F_EVENT_IDX));
+    qvirtio_set_features(&net->dev->vdev, features);
+
+    net->rx = qvirtqueue_setup(&net->dev->vdev, &net->qs->alloc, 0);
+    net->tx = qvirtqueue_setup(&net->dev->vdev, &net->qs->alloc, 1);
+    qvirtio_set_driver_ok(&net->dev->vdev);
+}
+
+static void bench_net_shutdown(BenchNet *net)
+{
+    qvirtqueue_cleanup(net->dev->vdev.bus, net->tx, &net->qs->alloc);
+    qvirtqueue_cleanup(net->dev->vdev.bus, net->rx, &net->qs->alloc);
+    qvirtio_pci_device_disable(net->dev);
+    qos_object_destroy((QOSGraphObject *)net->dev);
+    qtest_pc_shutdown(net->qs);
+    close(net->socket);
+}
+
+static void bench_net_fill_frame(uint8_t *frame)
+{
+    /* Broadcast destination, locally administered source, dummy
+     * ethertype; the socket peer never parses the payload. */
+    memset(frame, 0xff, 6);
+    memcpy(frame + 6, "\x52\x54\x00\x12\x34\x56", 6);
+    frame[12] = 0x08;
+    frame[13] = 0x00;
+    memset(frame + 14, 0x5a, BENCH_FRAME_BYTES - 14);
+}
+
+static void bench_net_report(const char *op, unsigned depth, double seconds)
+{
+    g_test_message("{\"device\": \"virtio-net\", \"backend\": \"socket\", "
+                   "\"op\": \"%s\", \"queue-depth\": %u, "
+                   "\"frame-bytes\": %u, \"frames\": %u, "
+                   "\"seconds\": %.6f, \"pps\": %.1f}",
+                   op, depth, BENCH_FRAME_BYTES, BENCH_FRAMES, seconds,
+                   BENCH_FRAMES / seconds);
+}
+
+/* Discard whatever the netdev has written to our end of the socket. */
+static void bench_net_drain_socket(int socket)
+{
+    char scratch[4096];
+    ssize_t ret;
+
+    do {
+        ret = recv(socket, scratch, sizeof(scratch), 0);
+    } while (ret > 0);
+    g_assert(ret == 0 || errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+static void bench_net_tx_depth(BenchNet *net, unsigned depth)
+{
+    QTestState *qts = net->qs->qts;
+    QVirtQueue *vq = net->tx;
+    uint64_t addrs[32];
+    uint32_t heads[32];
+    uint8_t frame[BENCH_FRAME_BYTES];
+    unsigned submitted, completed;
+    gint64 start;
+    unsigned i;
+
+    g_assert_cmpuint(depth, <=, ARRAY_SIZE(addrs));
+    g_assert_cmpuint(depth, <=, vq->size);
+
+    bench_net_fill_frame(frame);
+
+    for (i = 0; i < depth; i++) {
+        addrs[i] = guest_alloc(&net->qs->alloc,
+                               VNET_HDR_SIZE + BENCH_FRAME_BYTES);
+        qtest_memset(qts, addrs[i], 0, VNET_HDR_SIZE);
+        qtest_memwrite(qts, addrs[i] + VNET_HDR_SIZE, frame,
+                       BENCH_FRAME_BYTES);
+        heads[i] = qvirtqueue_add(qts, vq, addrs[i],
+                                  VNET_HDR_SIZE + BENCH_FRAME_BYTES,
+                                  false, false);
+    }
+
+    start = g_get_monotonic_time();
+
+    for (i = 0; i < depth; i++) {
+        qvirtqueue_kick(qts, &net->dev->vdev, vq, heads[i]);
+    }
+    submitted = depth;
+    completed = 0;
+
+    while (completed < BENCH_FRAMES) {
+        uint32_t desc_idx;
+
+        qtest_clock_step(qts, 100);
+        bench_net_drain_socket(net->socket);
+
+        while (qvirtqueue_get_buf(qts, vq, &desc_idx, NULL)) {
+            completed++;
+            if (submitted < BENCH_FRAMES) {
+                qvirtqueue_kick(qts, &net->dev->vdev, vq, desc_idx);
+                submitted++;
+            }
+        }
+
+        g_assert(g_get_monotonic_time() - start <= BENCH_TIMEOUT_US);
+    }
+
+    bench_net_report("tx", depth,
+                     (double)(g_get_monotonic_time() - start) /
+                     G_USEC_PER_SEC);
+
+    bench_net_drain_socket(net->socket);
+    for (i = 0; i < depth; i++) {
+        guest_free(&net->qs->alloc, addrs[i]);
+    }
+
+    /* All descriptors are idle again; recycle the table. */
+    vq->free_head = 0;
+    vq->num_free = vq->size;
+}
+
+static void bench_net_rx_depth(BenchNet *net, unsigned depth)
+{
+    QTestState *qts = net->qs->qts;
+    QVirtQueue *vq = net->rx;
+    uint64_t addrs[32];
+    uint8_t frame[BENCH_FRAME_BYTES];
+    uint32_t len = htonl(BENCH_FRAME_BYTES);
+    struct iovec iov[] = {
+        {
+            .iov_base = &len,
+            .iov_len = sizeof(len),
+        }, {
+            .iov_base = frame,
+            .iov_len = sizeof(frame),
+        },
+    };
+    unsigned sent, completed;
+    gint64 start;
+    unsigned i;
+
+    g_assert_cmpuint(depth, <=, ARRAY_SIZE(addrs));
+    g_assert_cmpuint(depth, <=, vq->size);
+
+    bench_net_fill_frame(frame);
+
+    for (i = 0; i < depth; i++) {
+        uint32_t head;
+
+        addrs[i] = guest_alloc(&net->qs->alloc,
+                               VNET_HDR_SIZE + BENCH_FRAME_BYTES);
+        head = qvirtqueue_add(qts, vq, addrs[i],
+                              VNET_HDR_SIZE + BENCH_FRAME_BYTES,
+                              true, false);
+        qvirtqueue_kick(qts, &net->dev->vdev, vq, head);
+    }
+
+    start = g_get_monotonic_time();
+
+    sent = 0;
+    completed = 0;
+
+    while (completed < BENCH_FRAMES) {
+        uint32_t desc_idx;
+
+        /* Keep at most one frame in flight per posted rx buffer so the
+         * netdev never has to queue behind a full ring. */
+        while (sent < BENCH_FRAMES && sent - completed < depth) {
+            ssize_t ret = iov_send(net->socket, iov, 2, 0,
+                                   sizeof(len) + sizeof(frame));
+            g_assert_cmpint(ret, ==, sizeof(len) + sizeof(frame));
+            sent++;
+        }
+
+        qtest_clock_step(qts, 100);
+
+        while (qvirtqueue_get_buf(qts, vq, &desc_idx, NULL)) {
+            completed++;
+            if (sent < BENCH_FRAMES || completed < BENCH_FRAMES) {
+                /* Repost the buffer for the next frame. */
+                qvirtqueue_kick(qts, &net->dev->vdev, vq, desc_idx);
+            }
+        }
+
+        g_assert(g_get_monotonic_time() - start <= BENCH_TIMEOUT_US);
+    }
+
+    bench_net_report("rx", depth,
+                     (double)(g_get_monotonic_time() - start) /
+                     G_USEC_PER_SEC);
+
+    for (i = 0; i < depth; i++) {
+        guest_free(&net->qs->alloc, addrs[i]);
+    }
+    vq->free_head = 0;
+    vq->num_free = vq->size;
+}
+
+static void bench_tx(void)
+{
+    BenchNet net;
+    unsigned i;
+    int flags;
+
+    bench_net_boot(&net);
+    flags = fcntl(net.socket, F_GETFL);
+    g_assert_cmpint(fcntl(net.socket, F_SETFL, flags | O_NONBLOCK), !=, -1);
+
+    for (i = 0; i < ARRAY_SIZE(bench_queue_depths); i++) {
+        bench_net_tx_depth(&net, bench_queue_depths[i]);
+    }
+
+    bench_net_shutdown(&net);
+}
+
+static void bench_rx(void)
+{
+    BenchNet net;
+    unsigned i;
+
+    bench_net_boot(&net);
+
+    for (i = 0; i < ARRAY_SIZE(bench_queue_depths); i++) {
+        bench_net_rx_depth(&net, bench_queue_depths[i]);
+    }
+
+    bench_net_shutdown(&net);
+}
+
+#endif /* _WIN32 */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+#ifndef _WIN32
+    g_test_add_func("/virtio-net/bench/tx", bench_tx);
+    g_test_add_func("/virtio-net/bench/rx", bench_rx);
+#endif
+
+    return g_test_run();
+}
@@ -189,6 +189,52 @@ static void test_hash_iov(void)
 
 
 /* Test with printable hashing */
+/* Test batched hashing of independent buffers */
+static void test_hash_batch(void)
+{
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(expected_outputs) ; i++) {
+        struct iovec bufs[3] = {
+            { .iov_base = (char *)INPUT_TEXT, .iov_len = strlen(INPUT_TEXT) },
+            { .iov_base = (char *)INPUT_TEXT, .iov_len = strlen(INPUT_TEXT) },
+            { .iov_base = (char *)INPUT_TEXT, .iov_len = strlen(INPUT_TEXT) },
+        };
+        uint8_t *results;
+        size_t resultlen;
+        int ret;
+        size_t j, k;
+
+        if (!qcrypto_hash_supports(i)) {
+            continue;
+        }
+
+        resultlen = expected_lens[i];
+        results = g_new0(uint8_t, resultlen * G_N_ELEMENTS(bufs));
+
+        ret = qcrypto_hash_batchv(i,
+                                  bufs,
+                                  G_N_ELEMENTS(bufs),
+                                  results,
+                                  resultlen,
+                                  &error_fatal);
+        g_assert(ret == 0);
+
+        for (k = 0; k < G_N_ELEMENTS(bufs); k++) {
+            uint8_t *result = results + k * resultlen;
+
+            for (j = 0; j < resultlen; j++) {
+                g_assert(expected_outputs[i][j * 2] ==
+                         hex[(result[j] >> 4) & 0xf]);
+                g_assert(expected_outputs[i][j * 2 + 1] ==
+                         hex[result[j] & 0xf]);
+            }
+        }
+        g_free(results);
+    }
+}
+
+
 static void test_hash_digest(void)
 {
     size_t i;
@@ -250,6 +296,7 @@ int main(int argc, char **argv)
     g_test_add_func("/crypto/hash/iov", test_hash_iov);
     g_test_add_func("/crypto/hash/alloc", test_hash_alloc);
     g_test_add_func("/crypto/hash/prealloc", test_hash_prealloc);
+    g_test_add_func("/crypto/hash/batch", test_hash_batch);
     g_test_add_func("/crypto/hash/digest", test_hash_digest);
     g_test_add_func("/crypto/hash/base64", test_hash_base64);
     return g_test_run();
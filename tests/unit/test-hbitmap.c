@@ -1042,6 +1042,69 @@ static void test_hbitmap_next_dirty_area_after_truncate(TestHBitmapData *data,
     test_hbitmap_next_dirty_area_check(data, 0, INT64_MAX);
 }
 
+static void test_hbitmap_next_dirty_runs_check(TestHBitmapData *data,
+                                               int64_t offset, int64_t count,
+                                               unsigned max_runs)
+{
+    HBitmapRun runs[8];
+    unsigned n, i;
+    int64_t start = offset;
+    int64_t end = count == INT64_MAX ? INT64_MAX : offset + count;
+    int64_t off, len;
+
+    g_assert_cmpuint(max_runs, <=, ARRAY_SIZE(runs));
+
+    n = hbitmap_next_dirty_runs(data->hb, offset, end, runs, max_runs);
+
+    /* Each returned run must match one hbitmap_next_dirty_area step */
+    for (i = 0; i < n; i++) {
+        g_assert(hbitmap_next_dirty_area(data->hb, start, end, INT64_MAX,
+                                         &off, &len));
+        g_assert_cmpint(runs[i].start, ==, off);
+        g_assert_cmpint(runs[i].count, ==, len);
+        start = off + len;
+    }
+
+    /* A short return means the area past the last run is clean */
+    if (n < max_runs) {
+        g_assert(!hbitmap_next_dirty_area(data->hb, start, end, INT64_MAX,
+                                          &off, &len));
+    }
+}
+
+static void test_hbitmap_next_dirty_runs_do(TestHBitmapData *data,
+                                            int granularity)
+{
+    hbitmap_test_init(data, L3, granularity);
+    test_hbitmap_next_dirty_runs_check(data, 0, INT64_MAX, 8);
+    test_hbitmap_next_dirty_runs_check(data, 0, INT64_MAX, 0);
+
+    hbitmap_set(data->hb, L2, 1);
+    hbitmap_set(data->hb, L2 + 5, L1);
+    hbitmap_set(data->hb, L2 * 2, L1);
+    test_hbitmap_next_dirty_runs_check(data, 0, INT64_MAX, 8);
+    test_hbitmap_next_dirty_runs_check(data, 0, INT64_MAX, 2);
+    test_hbitmap_next_dirty_runs_check(data, L2 + 1, INT64_MAX, 8);
+    test_hbitmap_next_dirty_runs_check(data, L2 + 1, L1, 8);
+    test_hbitmap_next_dirty_runs_check(data, L2 * 2 + L1, INT64_MAX, 8);
+
+    hbitmap_set(data->hb, 0, L3);
+    test_hbitmap_next_dirty_runs_check(data, 0, INT64_MAX, 8);
+    test_hbitmap_next_dirty_runs_check(data, L2, L1, 8);
+}
+
+static void test_hbitmap_next_dirty_runs_0(TestHBitmapData *data,
+                                           const void *unused)
+{
+    test_hbitmap_next_dirty_runs_do(data, 0);
+}
+
+static void test_hbitmap_next_dirty_runs_4(TestHBitmapData *data,
+                                           const void *unused)
+{
+    test_hbitmap_next_dirty_runs_do(data, 4);
+}
+
 int main(int argc, char **argv)
 {
     g_test_init(&argc, &argv, NULL);
@@ -1112,6 +1175,10 @@ int main(int argc, char **argv)
                      test_hbitmap_next_dirty_area_4);
     hbitmap_test_add("/hbitmap/next_dirty_area/next_dirty_area_after_truncate",
                      test_hbitmap_next_dirty_area_after_truncate);
+    hbitmap_test_add("/hbitmap/next_dirty_runs/next_dirty_runs_0",
+                     test_hbitmap_next_dirty_runs_0);
+    hbitmap_test_add("/hbitmap/next_dirty_runs/next_dirty_runs_4",
+                     test_hbitmap_next_dirty_runs_4);
 
     g_test_run();
 
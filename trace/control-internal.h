@@ -10,6 +10,8 @@
 #ifndef TRACE__CONTROL_INTERNAL_H
 #define TRACE__CONTROL_INTERNAL_H
 
+#include "qemu/atomic.h"
+
 extern int trace_events_enabled_count;
 
 
@@ -56,6 +58,16 @@ static inline bool trace_event_get_state_dynamic(TraceEvent *ev)
     return unlikely(trace_events_enabled_count) && *ev->dstate;
 }
 
+static inline uint32_t trace_event_get_sample_rate(TraceEvent *ev)
+{
+    return qatomic_read(&ev->sample_rate);
+}
+
+static inline void trace_event_set_sample_rate(TraceEvent *ev, uint32_t rate)
+{
+    qatomic_set(&ev->sample_rate, rate);
+}
+
 void trace_event_register_group(TraceEvent **events);
 
 #endif /* TRACE__CONTROL_INTERNAL_H */
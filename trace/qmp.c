@@ -131,6 +131,7 @@ TraceEventInfoList *qmp_trace_event_get_state(const char *name,
 void qmp_trace_event_set_state(const char *name, bool enable,
                                bool has_ignore_unavailable, bool ignore_unavailable,
                                bool has_vcpu, int64_t vcpu,
+                               bool has_sample_rate, uint32_t sample_rate,
                                Error **errp)
 {
     Error *err = NULL;
@@ -159,6 +160,9 @@ void qmp_trace_event_set_state(const char *name, bool enable,
             (has_vcpu && !trace_event_is_vcpu(ev))) {
             continue;
         }
+        if (has_sample_rate) {
+            trace_event_set_sample_rate(ev, sample_rate);
+        }
         if (has_vcpu) {
             trace_event_set_vcpu_state_dynamic(cpu, ev, enable);
         } else {
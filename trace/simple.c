@@ -13,6 +13,7 @@
 #include <pthread.h>
 #endif
 #include "qemu/timer.h"
+#include "qemu/queue.h"
 #include "trace/control.h"
 #include "trace/simple.h"
 #include "qemu/error-report.h"
@@ -30,9 +31,6 @@
 /** Records were dropped event ID */
 #define DROPPED_EVENT_ID (~(uint64_t)0 - 1)
 
-/** Trace record is valid */
-#define TRACE_RECORD_VALID ((uint64_t)1 << 63)
-
 /*
  * Trace records are written out by a dedicated thread.  The thread waits for
  * records to become available, writes them out, and then waits again.
@@ -45,14 +43,38 @@ static bool trace_available;
 static bool trace_writeout_enabled;
 
 enum {
-    TRACE_BUF_LEN = 4096 * 64,
+    TRACE_BUF_LEN = 4096 * 16,
     TRACE_BUF_FLUSH_THRESHOLD = TRACE_BUF_LEN / 4,
 };
 
-uint8_t trace_buf[TRACE_BUF_LEN];
-static volatile gint trace_idx;
-static unsigned int writeout_idx;
-static volatile gint dropped_events;
+/*
+ * Each thread that emits trace records owns a private ring buffer.  The
+ * emitting thread is the only writer of @head and the writeout thread is the
+ * only writer of @tail, so records move from producer to consumer without
+ * locks or atomic read-modify-write operations on the fast path.  The indices
+ * are free-running and are masked with TRACE_BUF_LEN - 1 on buffer access.
+ *
+ * When a thread exits its ring is only marked dead (the writeout thread may
+ * not have consumed all records yet); the writeout thread frees dead rings
+ * once they are fully drained.
+ */
+typedef struct TraceThreadRing {
+    uint8_t buf[TRACE_BUF_LEN];
+    unsigned int head;              /* written by owner thread only */
+    unsigned int tail;              /* written by writeout thread only */
+    unsigned int dropped;           /* monotonic, owner thread only */
+    unsigned int dropped_reported;  /* writeout thread only */
+    uint32_t prng;                  /* sampling state, owner thread only */
+    bool dead;                      /* owner thread has exited */
+    QLIST_ENTRY(TraceThreadRing) link;
+} TraceThreadRing;
+
+static GMutex ring_list_lock;
+static QLIST_HEAD(, TraceThreadRing) ring_list =
+    QLIST_HEAD_INITIALIZER(ring_list);
+
+static __thread TraceThreadRing *trace_ring;
+
 static uint32_t trace_pid;
 static FILE *trace_fp;
 static char *trace_file_name;
@@ -76,53 +98,61 @@ typedef struct {
 } TraceLogHeader;
 
 
-static void read_from_buffer(unsigned int idx, void *dataptr, size_t size);
-static unsigned int write_to_buffer(unsigned int idx, void *dataptr, size_t size);
+static void trace_ring_thread_exit(gpointer data)
+{
+    TraceThreadRing *ring = data;
+
+    /* The writeout thread frees the ring once it has been drained */
+    qatomic_store_release(&ring->dead, true);
+}
 
-static void clear_buffer_range(unsigned int idx, size_t len)
+static GPrivate trace_ring_key = G_PRIVATE_INIT(trace_ring_thread_exit);
+
+static TraceThreadRing *trace_ring_get(void)
 {
-    uint32_t num = 0;
-    while (num < len) {
-        if (idx >= TRACE_BUF_LEN) {
-            idx = idx % TRACE_BUF_LEN;
-        }
-        trace_buf[idx++] = 0;
-        num++;
+    TraceThreadRing *ring = trace_ring;
+
+    if (likely(ring)) {
+        return ring;
     }
+
+    /* don't use g_malloc, can deadlock when traced */
+    ring = calloc(1, sizeof(*ring));
+    if (!ring) {
+        return NULL;
+    }
+    ring->prng = (uint32_t)(uintptr_t)ring | 1; /* any non-zero seed is fine */
+
+    g_private_set(&trace_ring_key, ring);
+    g_mutex_lock(&ring_list_lock);
+    QLIST_INSERT_HEAD(&ring_list, ring, link);
+    g_mutex_unlock(&ring_list_lock);
+
+    trace_ring = ring;
+    return ring;
 }
-/**
- * Read a trace record from the trace buffer
- *
- * @idx         Trace buffer index
- * @record      Trace record to fill
- *
- * Returns false if the record is not valid.
- */
-static bool get_trace_record(unsigned int idx, TraceRecord **recordptr)
+
+static void read_from_buffer(TraceThreadRing *ring, unsigned int idx,
+                             void *dataptr, size_t size)
 {
-    uint64_t event_flag = 0;
-    TraceRecord record;
-    /* read the event flag to see if its a valid record */
-    read_from_buffer(idx, &record, sizeof(event_flag));
+    uint8_t *data_ptr = dataptr;
+    size_t x;
 
-    if (!(record.event & TRACE_RECORD_VALID)) {
-        return false;
+    for (x = 0; x < size; x++) {
+        data_ptr[x] = ring->buf[(idx + x) & (TRACE_BUF_LEN - 1)];
     }
+}
 
-    smp_rmb(); /* read memory barrier before accessing record */
-    /* read the record header to know record length */
-    read_from_buffer(idx, &record, sizeof(TraceRecord));
-    *recordptr = malloc(record.length); /* don't use g_malloc, can deadlock when traced */
-    /* make a copy of record to avoid being overwritten */
-    read_from_buffer(idx, *recordptr, record.length);
-    smp_rmb(); /* memory barrier before clearing valid flag */
-    (*recordptr)->event &= ~TRACE_RECORD_VALID;
-    /* clear the trace buffer range for consumed record otherwise any byte
-     * with its MSB set may be considered as a valid event id when the writer
-     * thread crosses this range of buffer again.
-     */
-    clear_buffer_range(idx, record.length);
-    return true;
+static unsigned int write_to_buffer(TraceThreadRing *ring, unsigned int idx,
+                                    const void *dataptr, size_t size)
+{
+    const uint8_t *data_ptr = dataptr;
+    size_t x;
+
+    for (x = 0; x < size; x++) {
+        ring->buf[(idx + x) & (TRACE_BUF_LEN - 1)] = data_ptr[x];
+    }
+    return idx + size; /* most callers want to know where to write next */
 }
 
 /**
@@ -154,42 +184,66 @@ static void wait_for_trace_records_available(void)
     g_mutex_unlock(&trace_lock);
 }
 
-static gpointer writeout_thread(gpointer opaque)
+static void writeout_ring(TraceThreadRing *ring)
 {
-    TraceRecord *recordptr;
-    union {
-        TraceRecord rec;
-        uint8_t bytes[sizeof(TraceRecord) + sizeof(uint64_t)];
-    } dropped;
-    unsigned int idx = 0;
-    int dropped_count;
     size_t unused __attribute__ ((unused));
     uint64_t type = TRACE_RECORD_TYPE_EVENT;
+    unsigned int dropped = qatomic_read(&ring->dropped);
+
+    if (dropped != ring->dropped_reported) {
+        union {
+            TraceRecord rec;
+            uint8_t bytes[sizeof(TraceRecord) + sizeof(uint64_t)];
+        } dropped_rec;
+
+        dropped_rec.rec.event = DROPPED_EVENT_ID;
+        dropped_rec.rec.timestamp_ns = get_clock();
+        dropped_rec.rec.length = sizeof(TraceRecord) + sizeof(uint64_t);
+        dropped_rec.rec.pid = trace_pid;
+        dropped_rec.rec.arguments[0] = dropped - ring->dropped_reported;
+        ring->dropped_reported = dropped;
+        unused = fwrite(&type, sizeof(type), 1, trace_fp);
+        unused = fwrite(&dropped_rec.rec, dropped_rec.rec.length, 1, trace_fp);
+    }
 
     for (;;) {
-        wait_for_trace_records_available();
+        unsigned int head = qatomic_load_acquire(&ring->head);
+        unsigned int tail = ring->tail;
+        TraceRecord record, *recordptr;
 
-        if (g_atomic_int_get(&dropped_events)) {
-            dropped.rec.event = DROPPED_EVENT_ID;
-            dropped.rec.timestamp_ns = get_clock();
-            dropped.rec.length = sizeof(TraceRecord) + sizeof(uint64_t);
-            dropped.rec.pid = trace_pid;
-            do {
-                dropped_count = g_atomic_int_get(&dropped_events);
-            } while (!g_atomic_int_compare_and_exchange(&dropped_events,
-                                                        dropped_count, 0));
-            dropped.rec.arguments[0] = dropped_count;
-            unused = fwrite(&type, sizeof(type), 1, trace_fp);
-            unused = fwrite(&dropped.rec, dropped.rec.length, 1, trace_fp);
+        if (head == tail) {
+            break;
         }
 
-        while (get_trace_record(idx, &recordptr)) {
-            unused = fwrite(&type, sizeof(type), 1, trace_fp);
-            unused = fwrite(recordptr, recordptr->length, 1, trace_fp);
-            writeout_idx += recordptr->length;
-            free(recordptr); /* don't use g_free, can deadlock when traced */
-            idx = writeout_idx % TRACE_BUF_LEN;
+        read_from_buffer(ring, tail, &record, sizeof(record));
+        /* don't use g_malloc, can deadlock when traced */
+        recordptr = malloc(record.length);
+        read_from_buffer(ring, tail, recordptr, record.length);
+        unused = fwrite(&type, sizeof(type), 1, trace_fp);
+        unused = fwrite(recordptr, record.length, 1, trace_fp);
+        free(recordptr);
+        qatomic_set(&ring->tail, tail + record.length);
+    }
+}
+
+static gpointer writeout_thread(gpointer opaque)
+{
+    TraceThreadRing *ring, *next;
+
+    for (;;) {
+        wait_for_trace_records_available();
+
+        g_mutex_lock(&ring_list_lock);
+        QLIST_FOREACH_SAFE(ring, &ring_list, link, next) {
+            writeout_ring(ring);
+            if (qatomic_load_acquire(&ring->dead) &&
+                ring->tail == qatomic_read(&ring->head) &&
+                ring->dropped_reported == qatomic_read(&ring->dropped)) {
+                QLIST_REMOVE(ring, link);
+                free(ring);
+            }
         }
+        g_mutex_unlock(&ring_list_lock);
 
         fflush(trace_fp);
     }
@@ -198,83 +252,77 @@ static gpointer writeout_thread(gpointer opaque)
 
 void trace_record_write_u64(TraceBufferRecord *rec, uint64_t val)
 {
-    rec->rec_off = write_to_buffer(rec->rec_off, &val, sizeof(uint64_t));
+    rec->rec_off = write_to_buffer(trace_ring, rec->rec_off,
+                                   &val, sizeof(uint64_t));
 }
 
 void trace_record_write_str(TraceBufferRecord *rec, const char *s, uint32_t slen)
 {
+    TraceThreadRing *ring = trace_ring;
+
     /* Write string length first */
-    rec->rec_off = write_to_buffer(rec->rec_off, &slen, sizeof(slen));
+    rec->rec_off = write_to_buffer(ring, rec->rec_off, &slen, sizeof(slen));
     /* Write actual string now */
-    rec->rec_off = write_to_buffer(rec->rec_off, (void*)s, slen);
+    rec->rec_off = write_to_buffer(ring, rec->rec_off, s, slen);
 }
 
-int trace_record_start(TraceBufferRecord *rec, uint32_t event, size_t datasize)
+int trace_record_start(TraceBufferRecord *rec, struct TraceEvent *ev,
+                       size_t datasize)
 {
-    unsigned int idx, rec_off, old_idx, new_idx;
+    TraceThreadRing *ring = trace_ring_get();
     uint32_t rec_len = sizeof(TraceRecord) + datasize;
-    uint64_t event_u64 = event;
-    uint64_t timestamp_ns = get_clock();
-
-    do {
-        old_idx = g_atomic_int_get(&trace_idx);
-        smp_rmb();
-        new_idx = old_idx + rec_len;
-
-        if (new_idx - writeout_idx > TRACE_BUF_LEN) {
-            /* Trace Buffer Full, Event dropped ! */
-            g_atomic_int_inc(&dropped_events);
-            return -ENOSPC;
-        }
-    } while (!g_atomic_int_compare_and_exchange(&trace_idx, old_idx, new_idx));
-
-    idx = old_idx % TRACE_BUF_LEN;
-
-    rec_off = idx;
-    rec_off = write_to_buffer(rec_off, &event_u64, sizeof(event_u64));
-    rec_off = write_to_buffer(rec_off, &timestamp_ns, sizeof(timestamp_ns));
-    rec_off = write_to_buffer(rec_off, &rec_len, sizeof(rec_len));
-    rec_off = write_to_buffer(rec_off, &trace_pid, sizeof(trace_pid));
+    uint32_t sample_rate;
+    uint64_t event_u64;
+    uint64_t timestamp_ns;
+    unsigned int rec_off;
 
-    rec->tbuf_idx = idx;
-    rec->rec_off  = (idx + sizeof(TraceRecord)) % TRACE_BUF_LEN;
-    return 0;
-}
+    if (unlikely(!ring)) {
+        return -ENOMEM;
+    }
 
-static void read_from_buffer(unsigned int idx, void *dataptr, size_t size)
-{
-    uint8_t *data_ptr = dataptr;
-    uint32_t x = 0;
-    while (x < size) {
-        if (idx >= TRACE_BUF_LEN) {
-            idx = idx % TRACE_BUF_LEN;
+    sample_rate = trace_event_get_sample_rate(ev);
+    if (sample_rate > 1) {
+        /* xorshift32: cheap thread-local PRNG for statistical sampling */
+        uint32_t x = ring->prng;
+
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        ring->prng = x;
+        if (x % sample_rate) {
+            return -EAGAIN; /* sampled out, not an error */
         }
-        data_ptr[x++] = trace_buf[idx++];
     }
-}
 
-static unsigned int write_to_buffer(unsigned int idx, void *dataptr, size_t size)
-{
-    uint8_t *data_ptr = dataptr;
-    uint32_t x = 0;
-    while (x < size) {
-        if (idx >= TRACE_BUF_LEN) {
-            idx = idx % TRACE_BUF_LEN;
-        }
-        trace_buf[idx++] = data_ptr[x++];
+    if (rec_len > TRACE_BUF_LEN - (ring->head - qatomic_read(&ring->tail))) {
+        /* Trace Buffer Full, Event dropped ! */
+        qatomic_set(&ring->dropped, ring->dropped + 1);
+        return -ENOSPC;
     }
-    return idx; /* most callers wants to know where to write next */
+
+    event_u64 = trace_event_get_id(ev);
+    timestamp_ns = get_clock();
+
+    rec_off = ring->head;
+    rec_off = write_to_buffer(ring, rec_off, &event_u64, sizeof(event_u64));
+    rec_off = write_to_buffer(ring, rec_off, &timestamp_ns,
+                              sizeof(timestamp_ns));
+    rec_off = write_to_buffer(ring, rec_off, &rec_len, sizeof(rec_len));
+    rec_off = write_to_buffer(ring, rec_off, &trace_pid, sizeof(trace_pid));
+
+    rec->tbuf_idx = ring->head;
+    rec->rec_off = rec_off;
+    return 0;
 }
 
 void trace_record_finish(TraceBufferRecord *rec)
 {
-    TraceRecord record;
-    read_from_buffer(rec->tbuf_idx, &record, sizeof(TraceRecord));
-    smp_wmb(); /* write barrier before marking as valid */
-    record.event |= TRACE_RECORD_VALID;
-    write_to_buffer(rec->tbuf_idx, &record, sizeof(TraceRecord));
+    TraceThreadRing *ring = trace_ring;
+
+    /* Publish the completed record to the writeout thread */
+    qatomic_store_release(&ring->head, rec->rec_off);
 
-    if (((unsigned int)g_atomic_int_get(&trace_idx) - writeout_idx)
+    if (rec->rec_off - qatomic_read(&ring->tail)
         > TRACE_BUF_FLUSH_THRESHOLD) {
         flush_trace_file(false);
     }
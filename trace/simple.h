@@ -18,6 +18,8 @@ bool st_init(void);
 void st_init_group(size_t group);
 void st_flush_trace_buffer(void);
 
+struct TraceEvent;
+
 typedef struct {
     unsigned int tbuf_idx;
     unsigned int rec_off;
@@ -26,11 +28,13 @@ typedef struct {
 /* Note for hackers: Make sure MAX_TRACE_LEN < sizeof(uint32_t) */
 #define MAX_TRACE_STRLEN 512
 /**
- * Initialize a trace record and claim space for it in the buffer
+ * Initialize a trace record and claim space for it in the calling thread's
+ * trace buffer
  *
  * @arglen  number of bytes required for arguments
  */
-int trace_record_start(TraceBufferRecord *rec, uint32_t id, size_t arglen);
+int trace_record_start(TraceBufferRecord *rec, struct TraceEvent *ev,
+                       size_t arglen);
 
 /**
  * Append a 64-bit argument to a trace record
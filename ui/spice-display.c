@@ -352,6 +352,35 @@ void qemu_spice_destroy_host_primary(SimpleSpiceDisplay *ssd)
     qemu_spice_destroy_primary_surface(ssd, 0, QXL_SYNC);
 }
 
+/*
+ * Runs qemu_spice_create_update() off the main loop, so that walking
+ * the dirty region and copying the pixels does not stall unrelated
+ * main loop activity during heavy guest video output.  There is no
+ * teardown: SimpleSpiceDisplay instances live as long as the process.
+ */
+static void *qemu_spice_update_thread(void *opaque)
+{
+    SimpleSpiceDisplay *ssd = opaque;
+
+    qemu_mutex_lock(&ssd->lock);
+    for (;;) {
+        while (!ssd->update_pending) {
+            qemu_cond_wait(&ssd->update_cond, &ssd->lock);
+        }
+        ssd->update_pending = false;
+        if (ssd->ds && ssd->surface && ssd->mirror &&
+            QTAILQ_EMPTY(&ssd->updates)) {
+            qemu_spice_create_update(ssd);
+            if (!QTAILQ_EMPTY(&ssd->updates)) {
+                qemu_mutex_unlock(&ssd->lock);
+                qemu_spice_wakeup(ssd);
+                qemu_mutex_lock(&ssd->lock);
+            }
+        }
+    }
+    return NULL;
+}
+
 void qemu_spice_display_init_common(SimpleSpiceDisplay *ssd)
 {
     qemu_mutex_init(&ssd->lock);
@@ -361,6 +390,9 @@ void qemu_spice_display_init_common(SimpleSpiceDisplay *ssd)
     if (ssd->num_surfaces == 0) {
         ssd->num_surfaces = 1024;
     }
+    qemu_cond_init(&ssd->update_cond);
+    qemu_thread_create(&ssd->update_thread, "spice-update",
+                       qemu_spice_update_thread, ssd, QEMU_THREAD_DETACHED);
 }
 
 /* display listener callbacks */
@@ -376,10 +408,12 @@ void qemu_spice_display_update(SimpleSpiceDisplay *ssd,
     update_area.top = y;
     update_area.bottom = y + h;
 
+    qemu_mutex_lock(&ssd->lock);
     if (qemu_spice_rect_is_empty(&ssd->dirty)) {
         ssd->notify++;
     }
     qemu_spice_rect_union(&ssd->dirty, &update_area);
+    qemu_mutex_unlock(&ssd->lock);
 }
 
 void qemu_spice_display_switch(SimpleSpiceDisplay *ssd,
@@ -414,6 +448,7 @@ void qemu_spice_display_switch(SimpleSpiceDisplay *ssd,
                                      surface_height(surface),
                                      false);
 
+    qemu_mutex_lock(&ssd->lock);
     memset(&ssd->dirty, 0, sizeof(ssd->dirty));
     if (ssd->surface) {
         pixman_image_unref(ssd->surface);
@@ -421,8 +456,6 @@ void qemu_spice_display_switch(SimpleSpiceDisplay *ssd,
         pixman_image_unref(ssd->mirror);
         ssd->mirror = NULL;
     }
-
-    qemu_mutex_lock(&ssd->lock);
     need_destroy = (ssd->ds != NULL);
     ssd->ds = surface;
     while ((update = QTAILQ_FIRST(&ssd->updates)) != NULL) {
@@ -434,13 +467,17 @@ void qemu_spice_display_switch(SimpleSpiceDisplay *ssd,
         qemu_spice_destroy_host_primary(ssd);
     }
     if (ssd->ds) {
+        qemu_mutex_lock(&ssd->lock);
         ssd->surface = pixman_image_ref(ssd->ds->image);
         ssd->mirror  = qemu_pixman_mirror_create(ssd->ds->format,
                                                  ssd->ds->image);
+        qemu_mutex_unlock(&ssd->lock);
         qemu_spice_create_host_primary(ssd);
     }
 
+    qemu_mutex_lock(&ssd->lock);
     memset(&ssd->dirty, 0, sizeof(ssd->dirty));
+    qemu_mutex_unlock(&ssd->lock);
     ssd->notify++;
 
     qemu_mutex_lock(&ssd->lock);
@@ -485,9 +522,17 @@ void qemu_spice_display_refresh(SimpleSpiceDisplay *ssd)
     graphic_hw_update(ssd->dcl.con);
 
     WITH_QEMU_LOCK_GUARD(&ssd->lock) {
-        if (QTAILQ_EMPTY(&ssd->updates) && ssd->ds) {
-            qemu_spice_create_update(ssd);
-            ssd->notify++;
+        if (ssd->ds && !qemu_spice_rect_is_empty(&ssd->dirty)) {
+            if (QTAILQ_EMPTY(&ssd->updates)) {
+                ssd->update_pending = true;
+                qemu_cond_signal(&ssd->update_cond);
+            } else {
+                /*
+                 * The client has not fetched the previous frame yet;
+                 * skip this one and let the dirty region keep merging.
+                 */
+                trace_qemu_spice_display_skip(ssd->qxl.id);
+            }
         }
     }
 
@@ -79,15 +79,18 @@ static void vnc_unlock_queue(VncJobQueue *queue)
     qemu_mutex_unlock(&queue->mutex);
 }
 
+/*
+ * A job is private to the main thread until vnc_job_push() publishes
+ * it on the queue, so building it (vnc_job_new() and one
+ * vnc_job_add_rect() per dirty rectangle) needs no locking.
+ */
 VncJob *vnc_job_new(VncState *vs)
 {
     VncJob *job = g_new0(VncJob, 1);
 
     assert(vs->magic == VNC_MAGIC);
     job->vs = vs;
-    vnc_lock_queue(queue);
     QLIST_INIT(&job->rectangles);
-    vnc_unlock_queue(queue);
     return job;
 }
 
@@ -102,9 +105,7 @@ int vnc_job_add_rect(VncJob *job, int x, int y, int w, int h)
     entry->rect.w = w;
     entry->rect.h = h;
 
-    vnc_lock_queue(queue);
     QLIST_INSERT_HEAD(&job->rectangles, entry, next);
-    vnc_unlock_queue(queue);
     return 1;
 }
 
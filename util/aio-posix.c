@@ -331,6 +331,7 @@ static bool aio_dispatch_handler(AioContext *ctx, AioHandler *node)
         /* aio_notify() does not count as progress */
         if (node->opaque != &ctx->notifier) {
             progress = true;
+            ctx->stat_dispatched_handlers++;
         }
     }
     if (!QLIST_IS_INSERTED(node, node_deleted) &&
@@ -339,6 +340,7 @@ static bool aio_dispatch_handler(AioContext *ctx, AioHandler *node)
         node->io_write) {
         node->io_write(node->opaque);
         progress = true;
+        ctx->stat_dispatched_handlers++;
     }
 
     return progress;
@@ -530,6 +532,9 @@ static bool try_poll_mode(AioContext *ctx, int64_t *timeout)
     }
 
     max_ns = qemu_soonest_timeout(*timeout, ctx->poll_ns);
+    if (max_ns && ctx->fdmon_ops->flush) {
+        ctx->fdmon_ops->flush(ctx);
+    }
     if (max_ns && !ctx->fdmon_ops->need_wait(ctx)) {
         poll_set_started(ctx, true);
 
@@ -577,6 +582,14 @@ bool aio_poll(AioContext *ctx, bool blocking)
     progress = try_poll_mode(ctx, &timeout);
     assert(!(timeout && progress));
 
+    if (ctx->poll_max_ns) {
+        if (progress) {
+            ctx->stat_poll_success++;
+        } else {
+            ctx->stat_poll_fail++;
+        }
+    }
+
     /*
      * aio_notify can avoid the expensive event_notifier_set if
      * everything (file descriptors, bottom halves, timers) will
@@ -631,6 +644,7 @@ bool aio_poll(AioContext *ctx, bool blocking)
                 ctx->poll_ns = 0;
             }
 
+            ctx->stat_poll_shrink++;
             trace_poll_shrink(ctx, old, ctx->poll_ns);
         } else if (ctx->poll_ns < ctx->poll_max_ns &&
                    block_ns < ctx->poll_max_ns) {
@@ -652,6 +666,7 @@ bool aio_poll(AioContext *ctx, bool blocking)
                 ctx->poll_ns = ctx->poll_max_ns;
             }
 
+            ctx->stat_poll_grow++;
             trace_poll_grow(ctx, old, ctx->poll_ns);
         }
     }
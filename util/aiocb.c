@@ -23,14 +23,60 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/notify.h"
+#include "qemu/thread.h"
 #include "block/aio.h"
+#include "trace.h"
+
+/*
+ * Released AIOCBs are recycled through a small per-thread cache instead of
+ * going straight back to the allocator: I/O-bound workloads allocate and
+ * free one AIOCB per request, often of the very same type as the previous
+ * request.  A cached block keeps its AIOCBInfo pointer while on the free
+ * list, so it is only reused for the same request type (and therefore the
+ * same aiocb_size).
+ */
+#define AIOCB_POOL_SIZE 16
+
+typedef struct AIOCBFreeEntry {
+    const AIOCBInfo *aiocb_info;
+    QSLIST_ENTRY(AIOCBFreeEntry) next;
+} AIOCBFreeEntry;
+
+static __thread QSLIST_HEAD(, AIOCBFreeEntry) aiocb_free_list =
+    QSLIST_HEAD_INITIALIZER(aiocb_free_list);
+static __thread unsigned int aiocb_free_list_size;
+static __thread Notifier aiocb_pool_cleanup_notifier;
+
+static void aiocb_pool_cleanup(Notifier *n, void *value)
+{
+    while (!QSLIST_EMPTY(&aiocb_free_list)) {
+        AIOCBFreeEntry *entry = QSLIST_FIRST(&aiocb_free_list);
+
+        QSLIST_REMOVE_HEAD(&aiocb_free_list, next);
+        g_free(entry);
+    }
+}
 
 void *qemu_aio_get(const AIOCBInfo *aiocb_info, BlockDriverState *bs,
                    BlockCompletionFunc *cb, void *opaque)
 {
-    BlockAIOCB *acb;
+    BlockAIOCB *acb = NULL;
+    AIOCBFreeEntry *entry;
+
+    QSLIST_FOREACH(entry, &aiocb_free_list, next) {
+        if (entry->aiocb_info == aiocb_info) {
+            QSLIST_REMOVE(&aiocb_free_list, entry, AIOCBFreeEntry, next);
+            aiocb_free_list_size--;
+            acb = (BlockAIOCB *)entry;
+            break;
+        }
+    }
+    trace_qemu_aio_get(aiocb_info, !!acb);
 
-    acb = g_malloc(aiocb_info->aiocb_size);
+    if (!acb) {
+        acb = g_malloc(aiocb_info->aiocb_size);
+    }
     acb->aiocb_info = aiocb_info;
     acb->bs = bs;
     acb->cb = cb;
@@ -50,6 +96,21 @@ void qemu_aio_unref(void *p)
     BlockAIOCB *acb = p;
     assert(acb->refcnt > 0);
     if (--acb->refcnt == 0) {
-        g_free(acb);
+        const AIOCBInfo *aiocb_info = acb->aiocb_info;
+
+        if (aiocb_free_list_size < AIOCB_POOL_SIZE &&
+            aiocb_info->aiocb_size >= sizeof(AIOCBFreeEntry)) {
+            AIOCBFreeEntry *entry = (AIOCBFreeEntry *)acb;
+
+            if (!aiocb_pool_cleanup_notifier.notify) {
+                aiocb_pool_cleanup_notifier.notify = aiocb_pool_cleanup;
+                qemu_thread_atexit_add(&aiocb_pool_cleanup_notifier);
+            }
+            entry->aiocb_info = aiocb_info;
+            QSLIST_INSERT_HEAD(&aiocb_free_list, entry, next);
+            aiocb_free_list_size++;
+        } else {
+            g_free(acb);
+        }
     }
 }
@@ -53,6 +53,13 @@ enum {
 
     /* Schedule periodically when the event loop is idle */
     BH_IDLE      = (1 << 4),
+
+    /*
+     * Run before regular BHs (set at creation, never cleared).  Meant
+     * for I/O completion BHs so completions are not queued behind
+     * housekeeping work.
+     */
+    BH_PRIORITY  = (1 << 5),
 };
 
 struct QEMUBH {
@@ -79,7 +86,11 @@ static void aio_bh_enqueue(QEMUBH *bh, unsigned new_flags)
      */
     old_flags = qatomic_fetch_or(&bh->flags, BH_PENDING | new_flags);
     if (!(old_flags & BH_PENDING)) {
-        QSLIST_INSERT_HEAD_ATOMIC(&ctx->bh_list, bh, next);
+        if (old_flags & BH_PRIORITY) {
+            QSLIST_INSERT_HEAD_ATOMIC(&ctx->bh_prio_list, bh, next);
+        } else {
+            QSLIST_INSERT_HEAD_ATOMIC(&ctx->bh_list, bh, next);
+        }
     }
 
     aio_notify(ctx);
@@ -136,41 +147,69 @@ QEMUBH *aio_bh_new_full(AioContext *ctx, QEMUBHFunc *cb, void *opaque,
     return bh;
 }
 
+QEMUBH *aio_bh_new_prioritized_full(AioContext *ctx, QEMUBHFunc *cb,
+                                    void *opaque, const char *name)
+{
+    QEMUBH *bh = aio_bh_new_full(ctx, cb, opaque, name);
+
+    bh->flags = BH_PRIORITY;
+    return bh;
+}
+
 void aio_bh_call(QEMUBH *bh)
 {
     bh->cb(bh->opaque);
 }
 
+/* Run one dequeued BH; returns 1 if it counts as progress */
+static int aio_bh_run(QEMUBH *bh, unsigned flags)
+{
+    int ret = 0;
+
+    if ((flags & (BH_SCHEDULED | BH_DELETED)) == BH_SCHEDULED) {
+        /* Idle BHs don't count as progress */
+        if (!(flags & BH_IDLE)) {
+            ret = 1;
+        }
+        aio_bh_call(bh);
+    }
+    if (flags & (BH_DELETED | BH_ONESHOT)) {
+        g_free(bh);
+    }
+    return ret;
+}
+
 /* Multiple occurrences of aio_bh_poll cannot be called concurrently. */
 int aio_bh_poll(AioContext *ctx)
 {
     BHListSlice slice;
     BHListSlice *s;
+    BHList prio_list;
+    QEMUBH *bh;
+    unsigned flags;
     int ret = 0;
 
+    /*
+     * Priority BHs jump the queue.  A nested aio_bh_poll() only grabs
+     * what has accumulated since the outer call took its batch, so each
+     * invocation runs the priority work it claimed before any slices.
+     */
+    QSLIST_MOVE_ATOMIC(&prio_list, &ctx->bh_prio_list);
+    while ((bh = aio_bh_dequeue(&prio_list, &flags))) {
+        ret |= aio_bh_run(bh, flags);
+    }
+
     QSLIST_MOVE_ATOMIC(&slice.bh_list, &ctx->bh_list);
     QSIMPLEQ_INSERT_TAIL(&ctx->bh_slice_list, &slice, next);
 
     while ((s = QSIMPLEQ_FIRST(&ctx->bh_slice_list))) {
-        QEMUBH *bh;
-        unsigned flags;
-
         bh = aio_bh_dequeue(&s->bh_list, &flags);
         if (!bh) {
             QSIMPLEQ_REMOVE_HEAD(&ctx->bh_slice_list, next);
             continue;
         }
 
-        if ((flags & (BH_SCHEDULED | BH_DELETED)) == BH_SCHEDULED) {
-            /* Idle BHs don't count as progress */
-            if (!(flags & BH_IDLE)) {
-                ret = 1;
-            }
-            aio_bh_call(bh);
-        }
-        if (flags & (BH_DELETED | BH_ONESHOT)) {
-            g_free(bh);
-        }
+        ret |= aio_bh_run(bh, flags);
     }
 
     return ret;
@@ -229,6 +268,11 @@ aio_compute_timeout(AioContext *ctx)
     int64_t deadline;
     int timeout = -1;
 
+    timeout = aio_compute_bh_timeout(&ctx->bh_prio_list, timeout);
+    if (timeout == 0) {
+        return 0;
+    }
+
     timeout = aio_compute_bh_timeout(&ctx->bh_list, timeout);
     if (timeout == 0) {
         return 0;
@@ -284,6 +328,12 @@ aio_ctx_check(GSource *source)
     qatomic_store_release(&ctx->notify_me, qatomic_read(&ctx->notify_me) & ~1);
     aio_notify_accept(ctx);
 
+    QSLIST_FOREACH_RCU(bh, &ctx->bh_prio_list, next) {
+        if ((bh->flags & (BH_SCHEDULED | BH_DELETED)) == BH_SCHEDULED) {
+            return true;
+        }
+    }
+
     QSLIST_FOREACH_RCU(bh, &ctx->bh_list, next) {
         if ((bh->flags & (BH_SCHEDULED | BH_DELETED)) == BH_SCHEDULED) {
             return true;
@@ -316,8 +366,10 @@ static void
 aio_ctx_finalize(GSource     *source)
 {
     AioContext *ctx = (AioContext *) source;
+    BHList *bh_lists[] = { &ctx->bh_prio_list, &ctx->bh_list };
     QEMUBH *bh;
     unsigned flags;
+    size_t i;
 
     thread_pool_free(ctx->thread_pool);
 
@@ -343,23 +395,26 @@ aio_ctx_finalize(GSource     *source)
     /* There must be no aio_bh_poll() calls going on */
     assert(QSIMPLEQ_EMPTY(&ctx->bh_slice_list));
 
-    while ((bh = aio_bh_dequeue(&ctx->bh_list, &flags))) {
-        /*
-         * qemu_bh_delete() must have been called on BHs in this AioContext. In
-         * many cases memory leaks, hangs, or inconsistent state occur when a
-         * BH is leaked because something still expects it to run.
-         *
-         * If you hit this, fix the lifecycle of the BH so that
-         * qemu_bh_delete() and any associated cleanup is called before the
-         * AioContext is finalized.
-         */
-        if (unlikely(!(flags & BH_DELETED))) {
-            fprintf(stderr, "%s: BH '%s' leaked, aborting...\n",
-                    __func__, bh->name);
-            abort();
-        }
+    for (i = 0; i < ARRAY_SIZE(bh_lists); i++) {
+        while ((bh = aio_bh_dequeue(bh_lists[i], &flags))) {
+            /*
+             * qemu_bh_delete() must have been called on BHs in this
+             * AioContext.  In many cases memory leaks, hangs, or
+             * inconsistent state occur when a BH is leaked because
+             * something still expects it to run.
+             *
+             * If you hit this, fix the lifecycle of the BH so that
+             * qemu_bh_delete() and any associated cleanup is called before
+             * the AioContext is finalized.
+             */
+            if (unlikely(!(flags & BH_DELETED))) {
+                fprintf(stderr, "%s: BH '%s' leaked, aborting...\n",
+                        __func__, bh->name);
+                abort();
+            }
 
-        g_free(bh);
+            g_free(bh);
+        }
     }
 
     aio_set_event_notifier(ctx, &ctx->notifier, false, NULL, NULL);
@@ -519,6 +574,7 @@ AioContext *aio_context_new(Error **errp)
 
     ctx = (AioContext *) g_source_new(&aio_source_funcs, sizeof(AioContext));
     QSLIST_INIT(&ctx->bh_list);
+    QSLIST_INIT(&ctx->bh_prio_list);
     QSIMPLEQ_INIT(&ctx->bh_slice_list);
     aio_context_setup(ctx);
 
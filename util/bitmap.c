@@ -188,9 +188,19 @@ void bitmap_set_atomic(unsigned long *map, long start, long nr)
 
     assert(start >= 0 && nr >= 0);
 
+    /*
+     * Bits that are already set are skipped without a store: shared
+     * dirty bitmaps are hammered by concurrent writers that mostly set
+     * bits which are set already, and re-asserting them would bounce
+     * the cache line between CPUs for no change in the result.  The
+     * concluding barrier below is issued either way.
+     */
+
     /* First word */
     if (nr - bits_to_set > 0) {
-        qatomic_or(p, mask_to_set);
+        if ((qatomic_read(p) & mask_to_set) != mask_to_set) {
+            qatomic_or(p, mask_to_set);
+        }
         nr -= bits_to_set;
         bits_to_set = BITS_PER_LONG;
         mask_to_set = ~0UL;
@@ -200,7 +210,9 @@ void bitmap_set_atomic(unsigned long *map, long start, long nr)
     /* Full words */
     if (bits_to_set == BITS_PER_LONG) {
         while (nr >= BITS_PER_LONG) {
-            *p = ~0UL;
+            if (*p != ~0UL) {
+                *p = ~0UL;
+            }
             nr -= BITS_PER_LONG;
             p++;
         }
@@ -209,13 +221,15 @@ void bitmap_set_atomic(unsigned long *map, long start, long nr)
     /* Last word */
     if (nr) {
         mask_to_set &= BITMAP_LAST_WORD_MASK(size);
-        qatomic_or(p, mask_to_set);
-    } else {
-        /* If we avoided the full barrier in qatomic_or(), issue a
-         * barrier to account for the assignments in the while loop.
-         */
-        smp_mb();
+        if ((qatomic_read(p) & mask_to_set) != mask_to_set) {
+            qatomic_or(p, mask_to_set);
+            return;
+        }
     }
+    /* If we avoided the full barrier in qatomic_or(), issue a
+     * barrier to account for the assignments and reads above.
+     */
+    smp_mb();
 }
 
 void bitmap_clear(unsigned long *map, long start, long nr)
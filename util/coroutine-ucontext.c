@@ -25,6 +25,8 @@
 #include "qemu/osdep.h"
 #include <ucontext.h>
 #include "qemu/coroutine_int.h"
+#include "qemu/atomic.h"
+#include "qemu/memusage.h"
 
 #ifdef CONFIG_VALGRIND_H
 #include <valgrind/valgrind.h>
@@ -175,6 +177,39 @@ static void coroutine_trampoline(int i0, int i1)
     }
 }
 
+/*
+ * Coroutine stack memory across all live coroutines, for
+ * query-memory-usage.  Coroutines are created from multiple threads,
+ * so the counter and the registration guard use atomics.
+ */
+static uint64_t coroutine_stack_bytes;
+
+static void coroutine_stack_mem_usage(MemUsageEmitFn emit, void *emit_opaque,
+                                      void *opaque)
+{
+    emit("coroutine/stacks", qatomic_read(&coroutine_stack_bytes),
+         MEM_USAGE_UNKNOWN, MEM_USAGE_UNKNOWN, emit_opaque);
+}
+
+static void coroutine_stack_account(CoroutineUContext *co, bool alloc)
+{
+    int64_t bytes = co->stack_size;
+
+#ifdef CONFIG_SAFESTACK
+    bytes += co->unsafe_stack_size;
+#endif
+    if (alloc) {
+        static bool registered;
+
+        if (!qatomic_xchg(&registered, true)) {
+            mem_usage_register(coroutine_stack_mem_usage, NULL);
+        }
+        qatomic_add(&coroutine_stack_bytes, bytes);
+    } else {
+        qatomic_sub(&coroutine_stack_bytes, bytes);
+    }
+}
+
 Coroutine *qemu_coroutine_new(void)
 {
     CoroutineUContext *co;
@@ -202,6 +237,7 @@ Coroutine *qemu_coroutine_new(void)
     co->unsafe_stack_size = COROUTINE_STACK_SIZE;
     co->unsafe_stack = qemu_alloc_stack(&co->unsafe_stack_size);
 #endif
+    coroutine_stack_account(co, true);
     co->base.entry_arg = &old_env; /* stash away our jmp_buf */
 
     uc.uc_link = &old_uc;
@@ -273,6 +309,7 @@ void qemu_coroutine_delete(Coroutine *co_)
     valgrind_stack_deregister(co);
 #endif
 
+    coroutine_stack_account(co, false);
     qemu_free_stack(co->stack, co->stack_size);
 #ifdef CONFIG_SAFESTACK
     qemu_free_stack(co->unsafe_stack, co->unsafe_stack_size);
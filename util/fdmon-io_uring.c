@@ -38,8 +38,9 @@
  * the "cq ring".  Ring entries are called "sqe" and "cqe", respectively.
  *
  * The code is structured so that sq/cq rings are only modified within
- * fdmon_io_uring_wait().  Changes to AioHandlers are made by enqueuing them on
- * ctx->submit_list so that fdmon_io_uring_wait() can submit IORING_OP_POLL_ADD
+ * fdmon_io_uring_wait() and fdmon_io_uring_flush(), both of which run in the
+ * AioContext's home thread.  Changes to AioHandlers are made by enqueuing them
+ * on ctx->submit_list so that those functions can submit IORING_OP_POLL_ADD
  * and/or IORING_OP_POLL_REMOVE sqes for them.
  */
 
@@ -166,12 +167,26 @@ static void fdmon_io_uring_update(AioContext *ctx,
     }
 }
 
+#ifdef IORING_POLL_ADD_MULTI
+/*
+ * Multishot poll keeps the fd armed across completions, so the
+ * remove/re-add churn is only paid when the poll mask actually changes.
+ * Cleared at runtime if the kernel rejects the flag.
+ */
+static bool poll_add_multi = true;
+#endif
+
 static void add_poll_add_sqe(AioContext *ctx, AioHandler *node)
 {
     struct io_uring_sqe *sqe = get_sqe(ctx);
     int events = poll_events_from_pfd(node->pfd.events);
 
     io_uring_prep_poll_add(sqe, node->pfd.fd, events);
+#ifdef IORING_POLL_ADD_MULTI
+    if (poll_add_multi) {
+        sqe->len = IORING_POLL_ADD_MULTI;
+    }
+#endif
     io_uring_sqe_set_data(sqe, node);
 }
 
@@ -228,6 +243,15 @@ static bool process_cqe(AioContext *ctx,
         return false;
     }
 
+#ifdef IORING_POLL_ADD_MULTI
+    if (unlikely(cqe->res == -EINVAL) && poll_add_multi) {
+        /* Kernel predates IORING_POLL_ADD_MULTI; fall back to one-shot */
+        poll_add_multi = false;
+        add_poll_add_sqe(ctx, node);
+        return false;
+    }
+#endif
+
     /*
      * Deletion can only happen when IORING_OP_POLL_ADD completes.  If we race
      * with enqueue() here then we can safely clear the FDMON_IO_URING_REMOVE
@@ -235,13 +259,33 @@ static bool process_cqe(AioContext *ctx,
      */
     flags = qatomic_fetch_and(&node->flags, ~FDMON_IO_URING_REMOVE);
     if (flags & FDMON_IO_URING_REMOVE) {
+#ifdef IORING_POLL_ADD_MULTI
+        if (cqe->flags & IORING_CQE_F_MORE) {
+            /*
+             * The multishot poll is still armed; put the flag back and
+             * wait for the terminal cqe that IORING_OP_POLL_REMOVE will
+             * force before freeing the handler.
+             */
+            qatomic_or(&node->flags, FDMON_IO_URING_REMOVE);
+            return false;
+        }
+#endif
         QLIST_INSERT_HEAD_RCU(&ctx->deleted_aio_handlers, node, node_deleted);
         return false;
     }
 
     aio_add_ready_handler(ready_list, node, pfd_events_from_poll(cqe->res));
 
-    /* IORING_OP_POLL_ADD is one-shot so we must re-arm it */
+    /*
+     * One-shot IORING_OP_POLL_ADD must be re-armed; a multishot poll
+     * only when the kernel says it has been terminated (no
+     * IORING_CQE_F_MORE), e.g. because the fd was closed.
+     */
+#ifdef IORING_POLL_ADD_MULTI
+    if (cqe->flags & IORING_CQE_F_MORE) {
+        return true;
+    }
+#endif
     add_poll_add_sqe(ctx, node);
     return true;
 }
@@ -294,6 +338,33 @@ static int fdmon_io_uring_wait(AioContext *ctx, AioHandlerList *ready_list,
     return process_cq_ring(ctx, ready_list);
 }
 
+/*
+ * Userspace polling was effectively disabled by the ring: after any cqe is
+ * processed the re-armed IORING_OP_POLL_ADD sits in the sq ring until the
+ * next ->wait() call, so ->need_wait() returned true exactly when polling
+ * should have started.  Flushing the buffered sqes here lets virtqueue
+ * kicks be absorbed by the userspace poll handlers (which suppress the
+ * eventfd via ->io_poll_begin()) while slow fds stay armed in the ring.
+ */
+static void fdmon_io_uring_flush(AioContext *ctx)
+{
+    int ret;
+
+    if (qatomic_read(&ctx->external_disable_cnt)) {
+        return;
+    }
+
+    fill_sq_ring(ctx);
+
+    if (io_uring_sq_ready(&ctx->fdmon_io_uring)) {
+        do {
+            ret = io_uring_submit(&ctx->fdmon_io_uring);
+        } while (ret == -EINTR);
+
+        assert(ret >= 0);
+    }
+}
+
 static bool fdmon_io_uring_need_wait(AioContext *ctx)
 {
     /* Have io_uring events completed? */
@@ -319,6 +390,7 @@ static const FDMonOps fdmon_io_uring_ops = {
     .update = fdmon_io_uring_update,
     .wait = fdmon_io_uring_wait,
     .need_wait = fdmon_io_uring_need_wait,
+    .flush = fdmon_io_uring_flush,
 };
 
 bool fdmon_io_uring_setup(AioContext *ctx)
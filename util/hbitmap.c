@@ -301,6 +301,24 @@ bool hbitmap_next_dirty_area(const HBitmap *hb, int64_t start, int64_t end,
     return true;
 }
 
+unsigned hbitmap_next_dirty_runs(const HBitmap *hb, int64_t start, int64_t end,
+                                 HBitmapRun *runs, unsigned max_runs)
+{
+    unsigned n;
+
+    assert(start >= 0 && end >= 0);
+
+    for (n = 0; n < max_runs; n++) {
+        if (!hbitmap_next_dirty_area(hb, start, end, INT64_MAX,
+                                     &runs[n].start, &runs[n].count)) {
+            break;
+        }
+        start = runs[n].start + runs[n].count;
+    }
+
+    return n;
+}
+
 bool hbitmap_empty(const HBitmap *hb)
 {
     return hb->count == 0;
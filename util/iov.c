@@ -27,6 +27,16 @@ size_t iov_from_buf_full(const struct iovec *iov, unsigned int iov_cnt,
 {
     size_t done;
     unsigned int i;
+
+    /* Fast path for copies that fit in the first element.  The inline
+     * wrappers in iov.h only catch this case for constant sizes.
+     */
+    if (iov_cnt && offset <= iov[0].iov_len &&
+        bytes <= iov[0].iov_len - offset) {
+        memcpy(iov[0].iov_base + offset, buf, bytes);
+        return bytes;
+    }
+
     for (i = 0, done = 0; (offset || done < bytes) && i < iov_cnt; i++) {
         if (offset < iov[i].iov_len) {
             size_t len = MIN(iov[i].iov_len - offset, bytes - done);
@@ -46,6 +56,13 @@ size_t iov_to_buf_full(const struct iovec *iov, const unsigned int iov_cnt,
 {
     size_t done;
     unsigned int i;
+
+    if (iov_cnt && offset <= iov[0].iov_len &&
+        bytes <= iov[0].iov_len - offset) {
+        memcpy(buf, iov[0].iov_base + offset, bytes);
+        return bytes;
+    }
+
     for (i = 0, done = 0; (offset || done < bytes) && i < iov_cnt; i++) {
         if (offset < iov[i].iov_len) {
             size_t len = MIN(iov[i].iov_len - offset, bytes - done);
@@ -65,6 +82,13 @@ size_t iov_memset(const struct iovec *iov, const unsigned int iov_cnt,
 {
     size_t done;
     unsigned int i;
+
+    if (iov_cnt && offset <= iov[0].iov_len &&
+        bytes <= iov[0].iov_len - offset) {
+        memset(iov[0].iov_base + offset, fillc, bytes);
+        return bytes;
+    }
+
     for (i = 0, done = 0; (offset || done < bytes) && i < iov_cnt; i++) {
         if (offset < iov[i].iov_len) {
             size_t len = MIN(iov[i].iov_len - offset, bytes - done);
@@ -0,0 +1,49 @@
+/*
+ * Memory usage registry
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/thread.h"
+#include "qemu/queue.h"
+#include "qemu/memusage.h"
+
+typedef struct MemUsageProvider {
+    MemUsageProviderFn fn;
+    void *opaque;
+    QTAILQ_ENTRY(MemUsageProvider) next;
+} MemUsageProvider;
+
+static QemuMutex mem_usage_lock;
+static QTAILQ_HEAD(, MemUsageProvider) mem_usage_providers =
+    QTAILQ_HEAD_INITIALIZER(mem_usage_providers);
+
+static void __attribute__((constructor)) mem_usage_init(void)
+{
+    qemu_mutex_init(&mem_usage_lock);
+}
+
+void mem_usage_register(MemUsageProviderFn fn, void *opaque)
+{
+    MemUsageProvider *p = g_new0(MemUsageProvider, 1);
+
+    p->fn = fn;
+    p->opaque = opaque;
+
+    qemu_mutex_lock(&mem_usage_lock);
+    QTAILQ_INSERT_TAIL(&mem_usage_providers, p, next);
+    qemu_mutex_unlock(&mem_usage_lock);
+}
+
+void mem_usage_query(MemUsageEmitFn emit, void *emit_opaque)
+{
+    MemUsageProvider *p;
+
+    qemu_mutex_lock(&mem_usage_lock);
+    QTAILQ_FOREACH(p, &mem_usage_providers, next) {
+        p->fn(emit, emit_opaque, p->opaque);
+    }
+    qemu_mutex_unlock(&mem_usage_lock);
+}
@@ -22,6 +22,8 @@
 
 enum {
     POOL_BATCH_SIZE = 64,
+    /* Ceiling for the adaptive per-thread pool */
+    POOL_MAX_SIZE = 1024,
 };
 
 /** Free list to speed up creation */
@@ -29,8 +31,52 @@ static QSLIST_HEAD(, Coroutine) release_pool = QSLIST_HEAD_INITIALIZER(pool);
 static unsigned int release_pool_size;
 static __thread QSLIST_HEAD(, Coroutine) alloc_pool = QSLIST_HEAD_INITIALIZER(pool);
 static __thread unsigned int alloc_pool_size;
+/*
+ * Grown by POOL_BATCH_SIZE whenever this thread misses the pools, so
+ * sustained high queue depths end up recycling coroutines entirely
+ * thread-locally instead of hitting qemu_coroutine_new().
+ */
+static __thread unsigned int alloc_pool_max = POOL_BATCH_SIZE;
 static __thread Notifier coroutine_pool_cleanup_notifier;
 
+/*
+ * Per-thread pool counters, chained into a global list so that
+ * qemu_coroutine_pool_stats() can aggregate them.  The counters are
+ * written by their owning thread only and read with qatomic_read; the
+ * structs are deliberately leaked at thread exit so reporters never
+ * race with a teardown.
+ */
+typedef struct CoroutinePoolCounters {
+    uint64_t hits;
+    uint64_t misses;
+    QSLIST_ENTRY(CoroutinePoolCounters) next;
+} CoroutinePoolCounters;
+
+static QSLIST_HEAD(, CoroutinePoolCounters) pool_counters_list =
+    QSLIST_HEAD_INITIALIZER(pool_counters_list);
+static __thread CoroutinePoolCounters *pool_counters;
+
+static CoroutinePoolCounters *coroutine_get_pool_counters(void)
+{
+    if (unlikely(!pool_counters)) {
+        pool_counters = g_new0(CoroutinePoolCounters, 1);
+        QSLIST_INSERT_HEAD_ATOMIC(&pool_counters_list, pool_counters, next);
+    }
+    return pool_counters;
+}
+
+void qemu_coroutine_pool_stats(uint64_t *hits, uint64_t *misses)
+{
+    CoroutinePoolCounters *c;
+
+    *hits = 0;
+    *misses = 0;
+    QSLIST_FOREACH(c, &pool_counters_list, next) {
+        *hits += qatomic_read(&c->hits);
+        *misses += qatomic_read(&c->misses);
+    }
+}
+
 static void coroutine_pool_cleanup(Notifier *n, void *value)
 {
     Coroutine *co;
@@ -42,8 +88,17 @@ static void coroutine_pool_cleanup(Notifier *n, void *value)
     }
 }
 
+static void coroutine_pool_register_cleanup(void)
+{
+    if (!coroutine_pool_cleanup_notifier.notify) {
+        coroutine_pool_cleanup_notifier.notify = coroutine_pool_cleanup;
+        qemu_thread_atexit_add(&coroutine_pool_cleanup_notifier);
+    }
+}
+
 Coroutine *qemu_coroutine_create(CoroutineEntry *entry, void *opaque)
 {
+    CoroutinePoolCounters *counters = coroutine_get_pool_counters();
     Coroutine *co = NULL;
 
     if (CONFIG_COROUTINE_POOL) {
@@ -51,10 +106,7 @@ Coroutine *qemu_coroutine_create(CoroutineEntry *entry, void *opaque)
         if (!co) {
             if (release_pool_size > POOL_BATCH_SIZE) {
                 /* Slow path; a good place to register the destructor, too.  */
-                if (!coroutine_pool_cleanup_notifier.notify) {
-                    coroutine_pool_cleanup_notifier.notify = coroutine_pool_cleanup;
-                    qemu_thread_atexit_add(&coroutine_pool_cleanup_notifier);
-                }
+                coroutine_pool_register_cleanup();
 
                 /* This is not exact; there could be a little skew between
                  * release_pool_size and the actual size of release_pool.  But
@@ -71,7 +123,14 @@ Coroutine *qemu_coroutine_create(CoroutineEntry *entry, void *opaque)
         }
     }
 
-    if (!co) {
+    if (co) {
+        qatomic_set(&counters->hits, counters->hits + 1);
+    } else {
+        qatomic_set(&counters->misses, counters->misses + 1);
+        if (alloc_pool_max < POOL_MAX_SIZE) {
+            alloc_pool_max = MIN(alloc_pool_max + POOL_BATCH_SIZE,
+                                 POOL_MAX_SIZE);
+        }
         co = qemu_coroutine_new();
     }
 
@@ -86,16 +145,23 @@ static void coroutine_delete(Coroutine *co)
     co->caller = NULL;
 
     if (CONFIG_COROUTINE_POOL) {
+        /*
+         * Prefer the thread-local pool: reuse there costs no atomics,
+         * and alloc_pool_max has adapted to this thread's demand.  The
+         * shared release pool only takes the overflow, for threads that
+         * free coroutines created elsewhere.
+         */
+        if (alloc_pool_size < alloc_pool_max) {
+            coroutine_pool_register_cleanup();
+            QSLIST_INSERT_HEAD(&alloc_pool, co, pool_next);
+            alloc_pool_size++;
+            return;
+        }
         if (release_pool_size < POOL_BATCH_SIZE * 2) {
             QSLIST_INSERT_HEAD_ATOMIC(&release_pool, co, pool_next);
             qatomic_inc(&release_pool_size);
             return;
         }
-        if (alloc_pool_size < POOL_BATCH_SIZE) {
-            QSLIST_INSERT_HEAD(&alloc_pool, co, pool_next);
-            alloc_pool_size++;
-            return;
-        }
     }
 
     qemu_coroutine_delete(co);
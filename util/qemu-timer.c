@@ -66,7 +66,17 @@ static QEMUClock qemu_clocks[QEMU_CLOCK_MAX];
 struct QEMUTimerList {
     QEMUClock *clock;
     QemuMutex active_timers_lock;
-    QEMUTimer *active_timers;
+
+    /* Binary min-heap of armed timers, ordered by (expire_time, order) so
+     * that timers sharing a deadline fire in arming order, as the sorted
+     * list used to guarantee.  Protected by active_timers_lock; heap_count
+     * is additionally read outside the lock as an emptiness hint.
+     */
+    QEMUTimer **heap;
+    int heap_count;
+    int heap_size;
+    uint64_t order;
+
     QLIST_ENTRY(QEMUTimerList) list;
     QEMUTimerListNotifyCB *notify_cb;
     void *notify_opaque;
@@ -93,6 +103,91 @@ static bool timer_expired_ns(QEMUTimer *timer_head, int64_t current_time)
     return timer_head && (timer_head->expire_time <= current_time);
 }
 
+/* Heap ordering: earliest deadline first, arming order breaking ties.  */
+static inline bool timer_heap_before(const QEMUTimer *a, const QEMUTimer *b)
+{
+    return a->expire_time < b->expire_time ||
+           (a->expire_time == b->expire_time && a->order < b->order);
+}
+
+static inline void timer_heap_set(QEMUTimerList *timer_list, int idx,
+                                  QEMUTimer *ts)
+{
+    timer_list->heap[idx] = ts;
+    ts->heap_index = idx;
+}
+
+static void timer_heap_sift_up(QEMUTimerList *timer_list, int idx)
+{
+    QEMUTimer *ts = timer_list->heap[idx];
+
+    while (idx > 0) {
+        int parent = (idx - 1) / 2;
+
+        if (!timer_heap_before(ts, timer_list->heap[parent])) {
+            break;
+        }
+        timer_heap_set(timer_list, idx, timer_list->heap[parent]);
+        idx = parent;
+    }
+    timer_heap_set(timer_list, idx, ts);
+}
+
+static void timer_heap_sift_down(QEMUTimerList *timer_list, int idx)
+{
+    QEMUTimer *ts = timer_list->heap[idx];
+
+    for (;;) {
+        int child = 2 * idx + 1;
+
+        if (child >= timer_list->heap_count) {
+            break;
+        }
+        if (child + 1 < timer_list->heap_count &&
+            timer_heap_before(timer_list->heap[child + 1],
+                              timer_list->heap[child])) {
+            child++;
+        }
+        if (!timer_heap_before(timer_list->heap[child], ts)) {
+            break;
+        }
+        timer_heap_set(timer_list, idx, timer_list->heap[child]);
+        idx = child;
+    }
+    timer_heap_set(timer_list, idx, ts);
+}
+
+static void timer_heap_insert(QEMUTimerList *timer_list, QEMUTimer *ts)
+{
+    if (timer_list->heap_count == timer_list->heap_size) {
+        timer_list->heap_size = MAX(timer_list->heap_size * 2, 64);
+        timer_list->heap = g_renew(QEMUTimer *, timer_list->heap,
+                                   timer_list->heap_size);
+    }
+    ts->order = ++timer_list->order;
+    timer_heap_set(timer_list, timer_list->heap_count, ts);
+    qatomic_set(&timer_list->heap_count, timer_list->heap_count + 1);
+    timer_heap_sift_up(timer_list, timer_list->heap_count - 1);
+}
+
+static void timer_heap_remove(QEMUTimerList *timer_list, QEMUTimer *ts)
+{
+    int idx = ts->heap_index;
+    QEMUTimer *last;
+
+    assert(idx >= 0 && timer_list->heap[idx] == ts);
+    ts->heap_index = -1;
+    qatomic_set(&timer_list->heap_count, timer_list->heap_count - 1);
+    last = timer_list->heap[timer_list->heap_count];
+    if (last != ts) {
+        timer_heap_set(timer_list, idx, last);
+        timer_heap_sift_down(timer_list, idx);
+        if (timer_list->heap[idx] == last) {
+            timer_heap_sift_up(timer_list, idx);
+        }
+    }
+}
+
 QEMUTimerList *timerlist_new(QEMUClockType type,
                              QEMUTimerListNotifyCB *cb,
                              void *opaque)
@@ -117,6 +212,7 @@ void timerlist_free(QEMUTimerList *timer_list)
         QLIST_REMOVE(timer_list, list);
     }
     qemu_mutex_destroy(&timer_list->active_timers_lock);
+    g_free(timer_list->heap);
     g_free(timer_list);
 }
 
@@ -171,7 +267,7 @@ void qemu_clock_enable(QEMUClockType type, bool enabled)
 
 bool timerlist_has_timers(QEMUTimerList *timer_list)
 {
-    return !!qatomic_read(&timer_list->active_timers);
+    return qatomic_read(&timer_list->heap_count) > 0;
 }
 
 bool qemu_clock_has_timers(QEMUClockType type)
@@ -184,15 +280,15 @@ bool timerlist_expired(QEMUTimerList *timer_list)
 {
     int64_t expire_time;
 
-    if (!qatomic_read(&timer_list->active_timers)) {
+    if (!qatomic_read(&timer_list->heap_count)) {
         return false;
     }
 
     WITH_QEMU_LOCK_GUARD(&timer_list->active_timers_lock) {
-        if (!timer_list->active_timers) {
+        if (!timer_list->heap_count) {
             return false;
         }
-        expire_time = timer_list->active_timers->expire_time;
+        expire_time = timer_list->heap[0]->expire_time;
     }
 
     return expire_time <= qemu_clock_get_ns(timer_list->clock->type);
@@ -214,7 +310,7 @@ int64_t timerlist_deadline_ns(QEMUTimerList *timer_list)
     int64_t delta;
     int64_t expire_time;
 
-    if (!qatomic_read(&timer_list->active_timers)) {
+    if (!qatomic_read(&timer_list->heap_count)) {
         return -1;
     }
 
@@ -227,10 +323,10 @@ int64_t timerlist_deadline_ns(QEMUTimerList *timer_list)
      * the caller should notice the change and there is no race condition.
      */
     WITH_QEMU_LOCK_GUARD(&timer_list->active_timers_lock) {
-        if (!timer_list->active_timers) {
+        if (!timer_list->heap_count) {
             return -1;
         }
-        expire_time = timer_list->active_timers->expire_time;
+        expire_time = timer_list->heap[0]->expire_time;
     }
 
     delta = expire_time - qemu_clock_get_ns(timer_list->clock->type);
@@ -261,18 +357,26 @@ int64_t qemu_clock_deadline_ns_all(QEMUClockType type, int attr_mask)
     }
 
     QLIST_FOREACH(timer_list, &clock->timerlists, list) {
+        int i;
+
         qemu_mutex_lock(&timer_list->active_timers_lock);
-        ts = timer_list->active_timers;
-        /* Skip all external timers */
-        while (ts && (ts->attributes & ~attr_mask)) {
-            ts = ts->next;
+        /* The heap is only partially ordered, so find the earliest timer
+         * whose attributes all lie within attr_mask by scanning it whole.
+         */
+        expire_time = -1;
+        for (i = 0; i < timer_list->heap_count; i++) {
+            ts = timer_list->heap[i];
+            if (ts->attributes & ~attr_mask) {
+                continue;
+            }
+            if (expire_time == -1 || ts->expire_time < expire_time) {
+                expire_time = ts->expire_time;
+            }
         }
-        if (!ts) {
-            qemu_mutex_unlock(&timer_list->active_timers_lock);
+        qemu_mutex_unlock(&timer_list->active_timers_lock);
+        if (expire_time == -1) {
             continue;
         }
-        expire_time = ts->expire_time;
-        qemu_mutex_unlock(&timer_list->active_timers_lock);
 
         delta = expire_time - qemu_clock_get_ns(type);
         if (delta <= 0) {
@@ -367,6 +471,7 @@ void timer_init_full(QEMUTimer *ts,
     ts->scale = scale;
     ts->attributes = attributes;
     ts->expire_time = -1;
+    ts->heap_index = -1;
 }
 
 void timer_deinit(QEMUTimer *ts)
@@ -377,41 +482,19 @@ void timer_deinit(QEMUTimer *ts)
 
 static void timer_del_locked(QEMUTimerList *timer_list, QEMUTimer *ts)
 {
-    QEMUTimer **pt, *t;
-
     ts->expire_time = -1;
-    pt = &timer_list->active_timers;
-    for(;;) {
-        t = *pt;
-        if (!t)
-            break;
-        if (t == ts) {
-            qatomic_set(pt, t->next);
-            break;
-        }
-        pt = &t->next;
+    if (ts->heap_index >= 0) {
+        timer_heap_remove(timer_list, ts);
     }
 }
 
 static bool timer_mod_ns_locked(QEMUTimerList *timer_list,
                                 QEMUTimer *ts, int64_t expire_time)
 {
-    QEMUTimer **pt, *t;
-
-    /* add the timer in the sorted list */
-    pt = &timer_list->active_timers;
-    for (;;) {
-        t = *pt;
-        if (!timer_expired_ns(t, expire_time)) {
-            break;
-        }
-        pt = &t->next;
-    }
     ts->expire_time = MAX(expire_time, 0);
-    ts->next = *pt;
-    qatomic_set(pt, ts);
+    timer_heap_insert(timer_list, ts);
 
-    return pt == &timer_list->active_timers;
+    return timer_list->heap[0] == ts;
 }
 
 static void timerlist_rearm(QEMUTimerList *timer_list)
@@ -503,7 +586,7 @@ bool timerlist_run_timers(QEMUTimerList *timer_list)
     QEMUTimerCB *cb;
     void *opaque;
 
-    if (!qatomic_read(&timer_list->active_timers)) {
+    if (!qatomic_read(&timer_list->heap_count)) {
         return false;
     }
 
@@ -542,7 +625,8 @@ bool timerlist_run_timers(QEMUTimerList *timer_list)
      */
     current_time = qemu_clock_get_ns(timer_list->clock->type);
     qemu_mutex_lock(&timer_list->active_timers_lock);
-    while ((ts = timer_list->active_timers)) {
+    while (timer_list->heap_count > 0) {
+        ts = timer_list->heap[0];
         if (!timer_expired_ns(ts, current_time)) {
             /* No expired timers left.  The checkpoint can be skipped
              * if no timers fired or they were all external.
@@ -562,9 +646,8 @@ bool timerlist_run_timers(QEMUTimerList *timer_list)
         }
 
         /* remove timer from the list before calling the callback */
-        timer_list->active_timers = ts->next;
-        ts->next = NULL;
         ts->expire_time = -1;
+        timer_heap_remove(timer_list, ts);
         cb = ts->cb;
         opaque = ts->opaque;
 
@@ -159,6 +159,9 @@ QEMU_BUILD_BUG_ON(sizeof(struct qht_bucket) > QHT_BUCKET_ALIGN);
  * @n_added_buckets: number of added (i.e. "non-head") buckets
  * @n_added_buckets_threshold: threshold to trigger an upward resize once the
  *                             number of added buckets surpasses it.
+ * @n_entries: number of entries in the map, maintained with atomic increments
+ * @n_entries_threshold: occupancy at which to trigger an upward resize,
+ *                       before chains have formed in most buckets.
  *
  * Buckets are tracked in what we call a "map", i.e. this structure.
  */
@@ -168,6 +171,8 @@ struct qht_map {
     size_t n_buckets;
     size_t n_added_buckets;
     size_t n_added_buckets_threshold;
+    size_t n_entries;
+    size_t n_entries_threshold;
 };
 
 /* trigger a resize when n_added_buckets > n_buckets / div */
@@ -341,7 +346,8 @@ struct qht_bucket *qht_bucket_lock__no_stale(struct qht *ht, uint32_t hash,
 static inline bool qht_map_needs_resize(const struct qht_map *map)
 {
     return qatomic_read(&map->n_added_buckets) >
-           map->n_added_buckets_threshold;
+               map->n_added_buckets_threshold ||
+           qatomic_read(&map->n_entries) > map->n_entries_threshold;
 }
 
 static inline void qht_chain_destroy(const struct qht_bucket *head)
@@ -386,6 +392,14 @@ static struct qht_map *qht_map_create(size_t n_buckets)
         map->n_added_buckets_threshold = 1;
     }
 
+    map->n_entries = 0;
+    /*
+     * Grow at 75% occupancy: collisions start forcing chain buckets well
+     * before the head buckets are all full, and waiting for the added
+     * bucket count to hit its threshold lets lookup chains grow first.
+     */
+    map->n_entries_threshold = n_buckets * QHT_BUCKET_ENTRIES * 3 / 4;
+
     map->buckets = qemu_memalign(QHT_BUCKET_ALIGN,
                                  sizeof(*map->buckets) * n_buckets);
     for (i = 0; i < n_buckets; i++) {
@@ -443,6 +457,8 @@ static void qht_map_reset__all_locked(struct qht_map *map)
     for (i = 0; i < map->n_buckets; i++) {
         qht_bucket_reset__locked(&map->buckets[i]);
     }
+    /* the chain buckets survive a reset, so n_added_buckets still holds */
+    qatomic_set(&map->n_entries, 0);
     qht_map_debug__all_locked(map);
 }
 
@@ -586,9 +602,6 @@ static void *qht_insert__locked(const struct qht *ht, struct qht_map *map,
     new = b;
     i = 0;
     qatomic_inc(&map->n_added_buckets);
-    if (unlikely(qht_map_needs_resize(map)) && needs_resize) {
-        *needs_resize = true;
-    }
 
  found:
     /* found an empty key: acquire the seqlock and write */
@@ -600,6 +613,11 @@ static void *qht_insert__locked(const struct qht *ht, struct qht_map *map,
     qatomic_set(&b->hashes[i], hash);
     qatomic_set(&b->pointers[i], p);
     seqlock_write_end(&head->sequence);
+
+    qatomic_inc(&map->n_entries);
+    if (needs_resize && unlikely(qht_map_needs_resize(map))) {
+        *needs_resize = true;
+    }
     return NULL;
 }
 
@@ -749,6 +767,9 @@ bool qht_remove(struct qht *ht, const void *p, uint32_t hash)
     ret = qht_remove__locked(b, p, hash);
     qht_bucket_debug__locked(b);
     qemu_spin_unlock(&b->lock);
+    if (ret) {
+        qatomic_dec(&map->n_entries);
+    }
     return ret;
 }
 
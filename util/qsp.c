@@ -664,6 +664,7 @@ struct QSPReportEntry {
     const char *typename;
     double time_s;
     double ns_avg;
+    uint64_t ns;
     uint64_t n_acqs;
     unsigned int n_objs;
 };
@@ -692,6 +693,7 @@ static gboolean qsp_tree_report(gpointer key, gpointer value, gpointer udata)
     entry->n_objs = e->n_objs;
     entry->callsite_at = qsp_at(e->callsite);
     entry->typename = qsp_typenames[e->callsite->type];
+    entry->ns = e->ns;
     entry->time_s = e->ns * 1e-9;
     entry->n_acqs = e->n_acqs;
     entry->ns_avg = e->n_acqs ? e->ns / e->n_acqs : 0;
@@ -765,26 +767,48 @@ static void report_destroy(QSPReport *rep)
     g_free(rep->entries);
 }
 
-void qsp_report(size_t max, enum QSPSortBy sort_by,
-                bool callsite_coalesce)
+static void qsp_mkreport(QSPReport *rep, size_t max, enum QSPSortBy sort_by,
+                         bool callsite_coalesce)
 {
     GTree *tree = g_tree_new_full(qsp_tree_cmp, &sort_by, g_free, NULL);
-    QSPReport rep;
 
     qsp_init();
 
-    rep.entries = g_new0(QSPReportEntry, max);
-    rep.n_entries = 0;
-    rep.max_n_entries = max;
+    rep->entries = g_new0(QSPReportEntry, max);
+    rep->n_entries = 0;
+    rep->max_n_entries = max;
 
     qsp_mktree(tree, callsite_coalesce);
-    g_tree_foreach(tree, qsp_tree_report, &rep);
+    g_tree_foreach(tree, qsp_tree_report, rep);
     g_tree_destroy(tree);
+}
+
+void qsp_report(size_t max, enum QSPSortBy sort_by,
+                bool callsite_coalesce)
+{
+    QSPReport rep;
 
+    qsp_mkreport(&rep, max, sort_by, callsite_coalesce);
     pr_report(&rep);
     report_destroy(&rep);
 }
 
+void qsp_iterate(size_t max, enum QSPSortBy sort_by, bool callsite_coalesce,
+                 qsp_iter_fn fn, void *opaque)
+{
+    QSPReport rep;
+    size_t i;
+
+    qsp_mkreport(&rep, max, sort_by, callsite_coalesce);
+    for (i = 0; i < rep.n_entries; i++) {
+        const QSPReportEntry *e = &rep.entries[i];
+
+        fn(e->obj, e->n_objs, e->typename, e->callsite_at, e->ns, e->n_acqs,
+           opaque);
+    }
+    report_destroy(&rep);
+}
+
 static void qsp_snapshot_destroy(QSPSnapshot *snap)
 {
     qht_iter(&snap->ht, qsp_ht_delete, NULL);
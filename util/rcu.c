@@ -175,6 +175,13 @@ void synchronize_rcu(void)
 
 #define RCU_CALL_MIN_SIZE        30
 
+/*
+ * Drop and re-acquire the iothread lock after this many callbacks, so
+ * that a large reclamation backlog cannot keep the lock held for the
+ * whole batch.
+ */
+#define RCU_CALL_BQL_CHUNK       128
+
 /* Multi-producer, single-consumer queue based on urcu/static/wfqueue.h
  * from liburcu.  Note that head is only used by the consumer.
  */
@@ -183,6 +190,10 @@ static struct rcu_head *head = &dummy, **tail = &dummy.next;
 static int rcu_call_count;
 static QemuEvent rcu_call_ready_event;
 
+/* Callbacks taken off rcu_call_count but not yet invoked.  */
+static int rcu_call_in_flight;
+static aligned_uint64_t rcu_calls_completed;
+
 static void enqueue(struct rcu_head *node)
 {
     struct rcu_head **old_tail;
@@ -262,6 +273,7 @@ static void *call_rcu_thread(void *opaque)
         }
 
         qatomic_sub(&rcu_call_count, n);
+        qatomic_set(&rcu_call_in_flight, n);
         synchronize_rcu();
         qemu_mutex_lock_iothread();
         while (n > 0) {
@@ -279,6 +291,14 @@ static void *call_rcu_thread(void *opaque)
 
             n--;
             node->func(node);
+            qatomic_set(&rcu_call_in_flight, n);
+            qatomic_set_u64(&rcu_calls_completed, rcu_calls_completed + 1);
+
+            /* Give iothread lock waiters a chance during large batches.  */
+            if (n > 0 && n % RCU_CALL_BQL_CHUNK == 0) {
+                qemu_mutex_unlock_iothread();
+                qemu_mutex_lock_iothread();
+            }
         }
         qemu_mutex_unlock_iothread();
     }
@@ -293,6 +313,13 @@ void call_rcu1(struct rcu_head *node, void (*func)(struct rcu_head *node))
     qemu_event_set(&rcu_call_ready_event);
 }
 
+void rcu_call_stats(uint64_t *pending, uint64_t *completed)
+{
+    *pending = qatomic_read(&rcu_call_count) +
+               qatomic_read(&rcu_call_in_flight);
+    *completed = qatomic_read_u64(&rcu_calls_completed);
+}
+
 
 struct rcu_drain {
     struct rcu_head rcu;
@@ -444,12 +444,14 @@ bool throttle_schedule_timer(ThrottleState *ts,
     return true;
 }
 
-/* do the accounting for this operation
+/* do the accounting for a batch of operations at once
  *
  * @is_write: the type of operation (read/write)
- * @size:     the size of the operation
+ * @size:     the total size of the operations
+ * @units:    the total operation unit count (see cfg.op_size)
  */
-void throttle_account(ThrottleState *ts, bool is_write, uint64_t size)
+void throttle_account_batch(ThrottleState *ts, bool is_write,
+                            uint64_t size, double units)
 {
     const BucketType bucket_types_size[2][2] = {
         { THROTTLE_BPS_TOTAL, THROTTLE_BPS_READ },
@@ -459,14 +461,8 @@ void throttle_account(ThrottleState *ts, bool is_write, uint64_t size)
         { THROTTLE_OPS_TOTAL, THROTTLE_OPS_READ },
         { THROTTLE_OPS_TOTAL, THROTTLE_OPS_WRITE }
     };
-    double units = 1.0;
     unsigned i;
 
-    /* if cfg.op_size is defined and smaller than size we compute unit count */
-    if (ts->cfg.op_size && size > ts->cfg.op_size) {
-        units = (double) size / ts->cfg.op_size;
-    }
-
     for (i = 0; i < 2; i++) {
         LeakyBucket *bkt;
 
@@ -484,6 +480,23 @@ void throttle_account(ThrottleState *ts, bool is_write, uint64_t size)
     }
 }
 
+/* do the accounting for this operation
+ *
+ * @is_write: the type of operation (read/write)
+ * @size:     the size of the operation
+ */
+void throttle_account(ThrottleState *ts, bool is_write, uint64_t size)
+{
+    double units = 1.0;
+
+    /* if cfg.op_size is defined and smaller than size we compute unit count */
+    if (ts->cfg.op_size && size > ts->cfg.op_size) {
+        units = (double) size / ts->cfg.op_size;
+    }
+
+    throttle_account_batch(ts, is_write, size, units);
+}
+
 /* return a ThrottleConfig based on the options in a ThrottleLimits
  *
  * @arg:    the ThrottleLimits object to read from
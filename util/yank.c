@@ -12,11 +12,16 @@
 #include "qemu/thread.h"
 #include "qemu/queue.h"
 #include "qemu/lockable.h"
+#include "qemu/timer.h"
 #include "qapi/qapi-commands-yank.h"
+#include "qapi/qapi-events-yank.h"
 #include "qapi/qapi-visit-yank.h"
 #include "qapi/clone-visitor.h"
 #include "qemu/yank.h"
 
+/* Minimum delay between two watchdog polls */
+#define YANK_WATCHDOG_POLL_MIN_MS 100
+
 struct YankFuncAndParam {
     YankFn *func;
     void *opaque;
@@ -26,6 +31,17 @@ struct YankFuncAndParam {
 struct YankInstanceEntry {
     YankInstance *instance;
     QLIST_HEAD(, YankFuncAndParam) yankfns;
+    YankProgressFn *progress_fn;
+    void *progress_opaque;
+
+    /* Stall watchdog state, see qmp_yank_watchdog_set() */
+    uint64_t watchdog_interval_ms;
+    uint64_t watchdog_grace_ms;
+    bool watchdog_auto_yank;
+    uint64_t last_progress;
+    int64_t last_progress_ms;
+    bool stalled;
+
     QLIST_ENTRY(YankInstanceEntry) next;
 };
 
@@ -43,6 +59,9 @@ static QemuMutex yank_lock;
 static QLIST_HEAD(, YankInstanceEntry) yank_instance_list
     = QLIST_HEAD_INITIALIZER(yank_instance_list);
 
+/* Polls the progress counters of all entries with a watchdog armed */
+static QEMUTimer *yank_watchdog_timer;
+
 static bool yank_instance_equal(const YankInstance *a, const YankInstance *b)
 {
     if (a->type != b->type) {
@@ -110,6 +129,20 @@ void yank_unregister_instance(const YankInstance *instance)
     g_free(entry);
 }
 
+void yank_register_progress(const YankInstance *instance,
+                            YankProgressFn *func,
+                            void *opaque)
+{
+    YankInstanceEntry *entry;
+
+    QEMU_LOCK_GUARD(&yank_lock);
+    entry = yank_find_entry(instance);
+    assert(entry);
+
+    entry->progress_fn = func;
+    entry->progress_opaque = opaque;
+}
+
 void yank_register_function(const YankInstance *instance,
                             YankFn *func,
                             void *opaque)
@@ -150,12 +183,21 @@ void yank_unregister_function(const YankInstance *instance,
     abort();
 }
 
+/* Call with yank_lock held */
+static void yank_entry_yank(YankInstanceEntry *entry)
+{
+    YankFuncAndParam *func_entry;
+
+    QLIST_FOREACH(func_entry, &entry->yankfns, next) {
+        func_entry->func(func_entry->opaque);
+    }
+}
+
 void qmp_yank(YankInstanceList *instances,
               Error **errp)
 {
     YankInstanceList *tail;
     YankInstanceEntry *entry;
-    YankFuncAndParam *func_entry;
 
     QEMU_LOCK_GUARD(&yank_lock);
     for (tail = instances; tail; tail = tail->next) {
@@ -168,9 +210,96 @@ void qmp_yank(YankInstanceList *instances,
     for (tail = instances; tail; tail = tail->next) {
         entry = yank_find_entry(tail->value);
         assert(entry);
-        QLIST_FOREACH(func_entry, &entry->yankfns, next) {
-            func_entry->func(func_entry->opaque);
+        yank_entry_yank(entry);
+    }
+}
+
+static void yank_watchdog_cb(void *opaque)
+{
+    int64_t now = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
+    int64_t next = INT64_MAX;
+    YankInstanceEntry *entry;
+
+    QEMU_LOCK_GUARD(&yank_lock);
+    QLIST_FOREACH(entry, &yank_instance_list, next) {
+        uint64_t progress;
+        int64_t deadline;
+
+        if (!entry->watchdog_interval_ms || !entry->progress_fn) {
+            continue;
+        }
+
+        progress = entry->progress_fn(entry->progress_opaque);
+        if (progress != entry->last_progress) {
+            entry->last_progress = progress;
+            entry->last_progress_ms = now;
+            entry->stalled = false;
+        }
+
+        deadline = entry->last_progress_ms + entry->watchdog_interval_ms;
+        if (!entry->stalled && now >= deadline) {
+            entry->stalled = true;
+            qapi_event_send_yank_instance_stalled(entry->instance,
+                                                  now -
+                                                  entry->last_progress_ms,
+                                                  entry->watchdog_auto_yank);
+        }
+        if (entry->stalled) {
+            deadline += entry->watchdog_grace_ms;
+            if (entry->watchdog_auto_yank && now >= deadline) {
+                yank_entry_yank(entry);
+                /*
+                 * The yank functions shut the connection down; give the
+                 * owner a full interval to tear down or reconnect before
+                 * considering the instance stalled again.
+                 */
+                entry->last_progress_ms = now;
+                entry->stalled = false;
+                deadline = now + entry->watchdog_interval_ms;
+            }
+        }
+        next = MIN(next, deadline);
+    }
+
+    if (next < INT64_MAX) {
+        timer_mod(yank_watchdog_timer,
+                  MAX(next, now + YANK_WATCHDOG_POLL_MIN_MS));
+    }
+}
+
+void qmp_yank_watchdog_set(YankInstance *instance,
+                           uint64_t interval_ms,
+                           bool has_grace_ms, uint64_t grace_ms,
+                           bool has_auto_yank, bool auto_yank,
+                           Error **errp)
+{
+    YankInstanceEntry *entry;
+
+    QEMU_LOCK_GUARD(&yank_lock);
+    entry = yank_find_entry(instance);
+    if (!entry) {
+        error_set(errp, ERROR_CLASS_DEVICE_NOT_FOUND, "Instance not found");
+        return;
+    }
+    if (interval_ms && !entry->progress_fn) {
+        error_setg(errp, "Instance does not report progress");
+        return;
+    }
+
+    entry->watchdog_interval_ms = interval_ms;
+    entry->watchdog_grace_ms = has_grace_ms ? grace_ms : 0;
+    entry->watchdog_auto_yank = has_auto_yank ? auto_yank : false;
+    entry->stalled = false;
+
+    if (interval_ms) {
+        entry->last_progress = entry->progress_fn(entry->progress_opaque);
+        entry->last_progress_ms = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
+        if (!yank_watchdog_timer) {
+            yank_watchdog_timer = timer_new_ms(QEMU_CLOCK_REALTIME,
+                                               yank_watchdog_cb, NULL);
         }
+        timer_mod_anticipate(yank_watchdog_timer,
+                             entry->last_progress_ms + interval_ms);
     }
 }
 